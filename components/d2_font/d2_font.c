@@ -12,109 +12,260 @@
 #include "esp_log.h"
 
 #include "d2_font_fmt_txt.h"
+#include "d2_font_prefetch.h"
+#include "d2_font_budget.h"
+#include "d2_font_trace.h"
+#include "d2_font_shrink.h"
+#include "d2_font_render.h"
+#include "d2_font_priv.h"
 
 static const char *TAG = "d2_font";
-typedef struct {
-    uint32_t version;
-    int32_t line_height;
-    int32_t base_line;
-    uint8_t subpx;
-    int8_t underline_position;
-    int8_t underline_thickness;
-    uint8_t padding;
-} __attribute__((packed)) d2_font_header_bin_t;
 
-esp_err_t d2_font_load_from_mem(const uint8_t *bin_ptr, size_t size, lv_font_t **out_font)
+esp_err_t d2_font_check_sha256(const uint8_t *bin_ptr, uint32_t length)
 {
-    const void *data;
-    *out_font = NULL;
-    if (bin_ptr == NULL || size < 8 + sizeof(d2_font_header_bin_t)) {
-        ESP_LOGE(TAG, "Invalid param");
-        return ESP_ERR_INVALID_ARG;
-    }
-
-    /*header*/
-    data = bin_ptr;
-    uint16_t header_length = *(uint16_t *)data;
-    data += sizeof(uint16_t);
-    if (memcmp(data, "D2FtHd", 6) != 0 || header_length < 8 + sizeof(d2_font_header_bin_t)) {
-        ESP_LOGE(TAG, "Header error");
-        return ESP_ERR_INVALID_CRC;
-    }
-    data += 6;
-    const d2_font_header_bin_t *font_header = (const d2_font_header_bin_t *)data;
-
-    /*dsc*/
-    if (header_length + 4 + sizeof(d2_font_fmt_txt_dsc_t) > size) {
-        ESP_LOGE(TAG, "Header_length error");
-        return ESP_ERR_INVALID_CRC;
-    }
-    data = bin_ptr + header_length;
-    uint32_t dsc_length = *(uint32_t *)data;
-    data += sizeof(uint32_t);
-    const d2_font_fmt_txt_dsc_t *fdsc = (const d2_font_fmt_txt_dsc_t *)data;
-
-    /*sha256*/
-    if (header_length + dsc_length + 32 > size) {
-        ESP_LOGE(TAG, "Dsc_length error");
-        return ESP_ERR_INVALID_CRC;
-    }
-    data = bin_ptr + header_length + dsc_length;
-    const uint8_t *sha256 = (const uint8_t *)data;
-
     uint8_t sha256_calc[32] = { 0 };
     mbedtls_sha256_context sha256_ctx;
     mbedtls_sha256_init(&sha256_ctx);
     mbedtls_sha256_starts(&sha256_ctx, false);
-    mbedtls_sha256_update(&sha256_ctx, bin_ptr, header_length + dsc_length);
+    mbedtls_sha256_update(&sha256_ctx, bin_ptr, length);
     mbedtls_sha256_finish(&sha256_ctx, sha256_calc);
     mbedtls_sha256_free(&sha256_ctx);
 
-    if (memcmp(sha256, sha256_calc, 32) != 0) {
+    if (memcmp(bin_ptr + length, sha256_calc, 32) != 0) {
         ESP_LOGE(TAG, "SHA256 error");
         return ESP_ERR_INVALID_CRC;
     }
+    return ESP_OK;
+}
 
-    /* Check each table address */
-    const d2_font_fmt_txt_cmap_t *cmaps = (const d2_font_fmt_txt_cmap_t *)((const uint8_t *)fdsc + (uint32_t)fdsc->cmaps);
-    if ((uint8_t *)cmaps - bin_ptr > size || memcmp((const uint8_t *)cmaps - 4, "CMAP", 4) != 0) {
-        ESP_LOGE(TAG, "cmaps error");
-        return ESP_ERR_INVALID_CRC;
+typedef struct {
+    const uint8_t *pos;
+    const uint8_t *end;
+    bool error;
+} cmap_reader_t;
+
+static uint32_t cmap_read(cmap_reader_t *reader)
+{
+    /*LEB128*/
+    uint32_t value = 0;
+    for (int shift = 0; shift < 32; shift += 7) {
+        if (reader->pos >= reader->end) {
+            break;
+        }
+        uint8_t byte = *reader->pos++;
+        value |= (uint32_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            return value;
+        }
     }
+    reader->error = true;
+    return 0;
+}
+
+static int32_t cmap_read_delta(cmap_reader_t *reader)
+{
+    /*zigzag*/
+    uint32_t value = cmap_read(reader);
+    return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
 
-    const d2_font_fmt_txt_kern_pair_t *kdsc = (const d2_font_fmt_txt_kern_pair_t *)((const uint8_t *)fdsc + (uint32_t)fdsc->kern_dsc);
-    if ((uint8_t *)kdsc - bin_ptr > size || memcmp((const uint8_t *)kdsc - 4, "KERN", 4) != 0) {
-        ESP_LOGE(TAG, "kdsc error");
+/**
+ * Unpack a `d2_font_fmt_txt_cmap_packed_t` CMAP section to RAM, see `D2_FONT_HEADER_FLAG_CMAP_COMPRESSED`
+ */
+static esp_err_t cmap_unpack(d2_font_context_t *ctx, const d2_font_fmt_txt_dsc_t *fdsc, uint32_t dsc_offset, uint32_t dsc_length)
+{
+    const d2_font_fmt_txt_cmap_packed_t *packed = (const d2_font_fmt_txt_cmap_packed_t *)(ctx->base_ptr + (uint32_t)fdsc->cmaps);
+    uint32_t available = dsc_offset + dsc_length - (uint32_t)fdsc->cmaps;
+    uint32_t size = fdsc->cmap_num * sizeof(d2_font_fmt_txt_cmap_t);
+    if (available < sizeof(d2_font_fmt_txt_cmap_packed_t) || packed->packed_size > available - sizeof(d2_font_fmt_txt_cmap_packed_t) ||
+            packed->unpacked_size < size) {
+        ESP_LOGE(TAG, "CMAP error");
         return ESP_ERR_INVALID_CRC;
     }
+    uint32_t unpacked_size = packed->unpacked_size;
+    uint8_t *ram = d2_font_mem_alloc(&ctx->mem, D2_FONT_MEM_INDEX, unpacked_size, false);
+    if (ram == NULL) {
+        ESP_LOGE(TAG, "malloc failed");
+        return ESP_ERR_NO_MEM;
+    }
+
+    cmap_reader_t reader = {
+        .pos = packed->data,
+        .end = packed->data + packed->packed_size,
+        .error = false,
+    };
+    d2_font_fmt_txt_cmap_t *cmaps = (d2_font_fmt_txt_cmap_t *)ram;
+    uint32_t range_start = 0;
+    for (uint32_t i = 0; i < fdsc->cmap_num && !reader.error; i++) {
+        d2_font_fmt_txt_cmap_t cmap = { 0 };
+        range_start += cmap_read_delta(&reader);
+        cmap.range_start = range_start;
+        cmap.range_length = cmap_read(&reader);
+        cmap.glyph_id_start = cmap_read(&reader);
+        cmap.glyph_bitmap_index_base = cmap_read(&reader);
+        cmap.type = cmap_read(&reader);
+        cmap.list_length = cmap_read(&reader);
+        uint32_t list_length = cmap.list_length;
 
-    const d2_font_fmt_txt_glyph_index_t *gindex = (const d2_font_fmt_txt_glyph_index_t *)((const uint8_t *)fdsc + (uint32_t)fdsc->glyph_index);
-    if ((uint8_t *)gindex - bin_ptr > size || memcmp((const uint8_t *)gindex - 4, "GIDX", 4) != 0) {
-        ESP_LOGE(TAG, "gindex error");
+        if (cmap.type == D2_FONT_FMT_TXT_CMAP_SPARSE_TINY || cmap.type == D2_FONT_FMT_TXT_CMAP_SPARSE_FULL) {
+            size = (size + 1) & ~1;
+            if (size + list_length * sizeof(uint16_t) > unpacked_size) {
+                reader.error = true;
+                break;
+            }
+            uint16_t *list = (uint16_t *)(ram + size);
+            cmap.unicode_list = (const uint16_t *)size;
+            uint32_t value = 0;
+            for (uint32_t j = 0; j < list_length; j++) {
+                value += cmap_read(&reader) + (j ? 1 : 0);
+                list[j] = value;
+            }
+            size += list_length * sizeof(uint16_t);
+        }
+        if (cmap.type == D2_FONT_FMT_TXT_CMAP_SPARSE_FULL) {
+            size = (size + 1) & ~1;
+            if (size + list_length * sizeof(uint16_t) > unpacked_size) {
+                reader.error = true;
+                break;
+            }
+            uint16_t *list = (uint16_t *)(ram + size);
+            cmap.glyph_id_ofs_list = (const void *)size;
+            uint32_t value = 0;
+            for (uint32_t j = 0; j < list_length; j++) {
+                value += cmap_read_delta(&reader);
+                list[j] = value;
+            }
+            size += list_length * sizeof(uint16_t);
+        } else if (cmap.type == D2_FONT_FMT_TXT_CMAP_FORMAT0_FULL) {
+            if (size + list_length > unpacked_size || list_length > (size_t)(reader.end - reader.pos)) {
+                reader.error = true;
+                break;
+            }
+            memcpy(ram + size, reader.pos, list_length);
+            reader.pos += list_length;
+            cmap.glyph_id_ofs_list = (const void *)size;
+            size += list_length;
+        }
+        memcpy(&cmaps[i], &cmap, sizeof(cmap));
+    }
+    if (reader.error || size != unpacked_size) {
+        ESP_LOGE(TAG, "CMAP error");
+        d2_font_mem_free(&ctx->mem, D2_FONT_MEM_INDEX, ram, unpacked_size);
         return ESP_ERR_INVALID_CRC;
     }
 
-    const d2_font_fmt_txt_glyph_dsc_t *gdsc = (const d2_font_fmt_txt_glyph_dsc_t *)((const uint8_t *)fdsc + (uint32_t)fdsc->glyph_dsc);
-    if ((uint8_t *)gdsc - bin_ptr > size || memcmp((const uint8_t *)gdsc - 4, "GDSC", 4) != 0) {
-        ESP_LOGE(TAG, "gindex error");
+    ctx->cmaps = cmaps;
+    ctx->cmap_base = ram;
+    ctx->cmap_ram = ram;
+    ctx->cmap_ram_size = unpacked_size;
+    return ESP_OK;
+}
+
+#if CONFIG_D2_FONT_ASCII_TABLE
+#define ASCII_KERN_SIZE (D2_FONT_ASCII_NUM * D2_FONT_ASCII_NUM)
+
+void d2_font_ascii_table_create(lv_font_t *font)
+{
+    d2_font_context_t *ctx = (d2_font_context_t *)font->user_data;
+    d2_font_fmt_txt_ascii_t *ascii = d2_font_mem_alloc(&ctx->mem, D2_FONT_MEM_INDEX, sizeof(d2_font_fmt_txt_ascii_t), true);
+    int8_t *kern = d2_font_mem_alloc(&ctx->mem, D2_FONT_MEM_INDEX, ASCII_KERN_SIZE, false);
+    if (ascii == NULL || kern == NULL) {
+        /*Not fatal, the letters are looked up in the font data as usual*/
+        ESP_LOGW(TAG, "No memory for the ASCII table");
+        d2_font_mem_free(&ctx->mem, D2_FONT_MEM_INDEX, ascii, sizeof(d2_font_fmt_txt_ascii_t));
+        d2_font_mem_free(&ctx->mem, D2_FONT_MEM_INDEX, kern, ASCII_KERN_SIZE);
+        return;
+    }
+    if (d2_font_fmt_txt_ascii_fill(font, ascii, kern)) {
+        ascii->kern = kern;
+    } else {
+        d2_font_mem_free(&ctx->mem, D2_FONT_MEM_INDEX, kern, ASCII_KERN_SIZE);
+    }
+    ctx->ext->ascii = ascii;
+}
+
+void d2_font_ascii_table_free(lv_font_t *font)
+{
+    d2_font_context_t *ctx = (d2_font_context_t *)font->user_data;
+    if (ctx->ext->ascii == NULL) {
+        return;
+    }
+    d2_font_mem_free(&ctx->mem, D2_FONT_MEM_INDEX, ctx->ext->ascii->kern, ASCII_KERN_SIZE);
+    d2_font_mem_free(&ctx->mem, D2_FONT_MEM_INDEX, ctx->ext->ascii, sizeof(d2_font_fmt_txt_ascii_t));
+    ctx->ext->ascii = NULL;
+}
+#endif
+
+static bool check_table(const uint8_t *base_ptr, uint32_t dsc_offset, uint32_t dsc_length, uint32_t table_offset, const char *tag)
+{
+    if (table_offset < dsc_offset + 4 || table_offset - dsc_offset > dsc_length ||
+            memcmp(base_ptr + table_offset - 4, tag, 4) != 0) {
+        ESP_LOGE(TAG, "%.4s error", tag);
+        return false;
+    }
+    return true;
+}
+
+esp_err_t d2_font_create(const uint8_t *base_ptr, uint32_t dsc_offset, uint32_t dsc_length,
+                         const d2_font_header_bin_t *font_header, const d2_font_load_options_t *options,
+                         bool check_tables, lv_font_t **out_font)
+{
+    *out_font = NULL;
+    /*The flags took a byte that was 0 in older bins, the header version was not changed*/
+    if (font_header->flags & ~D2_FONT_HEADER_FLAGS_KNOWN) {
+        ESP_LOGE(TAG, "Unknown header flags 0x%02x", font_header->flags);
+        return ESP_ERR_INVALID_VERSION;
+    }
+    if (dsc_length < sizeof(d2_font_fmt_txt_dsc_t)) {
+        ESP_LOGE(TAG, "Dsc_length error");
         return ESP_ERR_INVALID_CRC;
     }
+    const d2_font_fmt_txt_dsc_t *fdsc = (const d2_font_fmt_txt_dsc_t *)(base_ptr + dsc_offset);
 
-    const uint8_t *bitmap_in = (const uint8_t *)((const uint8_t *)fdsc + (uint32_t)fdsc->glyph_bitmap);
-    if ((uint8_t *)bitmap_in - bin_ptr > size || memcmp((const uint8_t *)bitmap_in - 4, "GBIT", 4) != 0) {
-        ESP_LOGE(TAG, "gindex error");
+    /* Check each table address */
+    if (check_tables && (!check_table(base_ptr, dsc_offset, dsc_length, (uint32_t)fdsc->cmaps, "CMAP") ||
+            !check_table(base_ptr, dsc_offset, dsc_length, (uint32_t)fdsc->kern_dsc, "KERN") ||
+            !check_table(base_ptr, dsc_offset, dsc_length, (uint32_t)fdsc->glyph_index, "GIDX") ||
+            !check_table(base_ptr, dsc_offset, dsc_length, (uint32_t)fdsc->glyph_dsc, "GDSC") ||
+            !check_table(base_ptr, dsc_offset, dsc_length, (uint32_t)fdsc->glyph_bitmap, "GBIT"))) {
         return ESP_ERR_INVALID_CRC;
     }
 
-    lv_font_t *font = (lv_font_t *)heap_caps_calloc(1, sizeof(lv_font_t) + sizeof(d2_font_context_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    const d2_font_load_options_t default_options = D2_FONT_LOAD_OPTIONS_DEFAULT();
+    if (options == NULL) {
+        options = &default_options;
+    }
+    const d2_font_mem_config_t *context_config = &options->mem[D2_FONT_MEM_CONTEXT];
+    size_t font_size = sizeof(lv_font_t) + sizeof(d2_font_context_t) + sizeof(struct d2_font_context_ext_t);
+    lv_font_t *font = NULL;
+    if (context_config->budget == 0 || font_size <= context_config->budget) {
+        font = (lv_font_t *)heap_caps_calloc(1, font_size, context_config->caps);
+    }
     if (font == NULL) {
         ESP_LOGE(TAG, "malloc failed");
         return ESP_ERR_NO_MEM;
     }
     font->get_glyph_dsc = d2_font_get_glyph_dsc_fmt_txt;
     font->get_glyph_bitmap = d2_font_get_bitmap_fmt_txt;
+    /*Offsets in the tables are relative to base_ptr, font->dsc too*/
+    font->dsc = (const void *)dsc_offset;
     d2_font_context_t *ctx = (d2_font_context_t *)(font + 1);
-    ctx->base_ptr = (uint8_t *)fdsc;
+    ctx->ext = (struct d2_font_context_ext_t *)(ctx + 1);
+    ctx->base_ptr = (uint8_t *)base_ptr;
+    ctx->wide_index = font_header->flags & D2_FONT_HEADER_FLAG_WIDE_INDEX;
+    ctx->cmaps = (const d2_font_fmt_txt_cmap_t *)(base_ptr + (uint32_t)fdsc->cmaps);
+    ctx->cmap_base = base_ptr;
+    /*The glyph index ends with the tag of the GDSC section*/
+    uint32_t gindex_size = ctx->wide_index ? sizeof(d2_font_fmt_txt_glyph_index_wide_t) : sizeof(d2_font_fmt_txt_glyph_index_t);
+    if ((uint32_t)fdsc->glyph_dsc > (uint32_t)fdsc->glyph_index + 4) {
+        ctx->glyph_num = ((uint32_t)fdsc->glyph_dsc - 4 - (uint32_t)fdsc->glyph_index) / gindex_size;
+    }
+    for (int i = 0; i < D2_FONT_MEM_TYPE_MAX; i++) {
+        ctx->mem.caps[i] = options->mem[i].caps;
+        ctx->mem.budget[i] = options->mem[i].budget;
+    }
+    ctx->mem.used[D2_FONT_MEM_CONTEXT] = font_size;
+    ctx->mem.peak[D2_FONT_MEM_CONTEXT] = font_size;
 
     font->user_data = (void *)ctx;
 
@@ -124,11 +275,106 @@ esp_err_t d2_font_load_from_mem(const uint8_t *bin_ptr, size_t size, lv_font_t *
     font->underline_position = font_header->underline_position;
     font->underline_thickness = font_header->underline_thickness;
 
+    if (font_header->flags & D2_FONT_HEADER_FLAG_CMAP_COMPRESSED) {
+        esp_err_t err = cmap_unpack(ctx, fdsc, dsc_offset, dsc_length);
+        if (err != ESP_OK) {
+            heap_caps_free(font);
+            return err;
+        }
+    }
+
+#if CONFIG_D2_FONT_ASCII_TABLE
+    d2_font_ascii_table_create(font);
+#endif
+
     *out_font = font;
     return ESP_OK;
 }
 
+esp_err_t d2_font_load_from_mem(const uint8_t *bin_ptr, size_t size, lv_font_t **out_font)
+{
+    return d2_font_load_from_mem_with_options(bin_ptr, size, NULL, out_font);
+}
+
+/**
+ * @param partition partition mapped at `bin_ptr`, NULL if the bin does not come from a partition
+ */
+static esp_err_t load_from_mem(const uint8_t *bin_ptr, size_t size, const d2_font_load_options_t *options,
+                               const esp_partition_t *partition, lv_font_t **out_font)
+{
+    const void *data;
+    *out_font = NULL;
+    if (bin_ptr == NULL || size < 8 + sizeof(d2_font_header_bin_t)) {
+        ESP_LOGE(TAG, "Invalid param");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    /*header*/
+    data = bin_ptr;
+    uint16_t header_length = *(uint16_t *)data;
+    data += sizeof(uint16_t);
+    if (memcmp(data, "D2FtHd", 6) != 0 || header_length < 8 + sizeof(d2_font_header_bin_t)) {
+        ESP_LOGE(TAG, "Header error");
+        return ESP_ERR_INVALID_CRC;
+    }
+    data += 6;
+    const d2_font_header_bin_t *font_header = (const d2_font_header_bin_t *)data;
+
+    /*dsc*/
+    if (header_length + 4 + sizeof(d2_font_fmt_txt_dsc_t) > size) {
+        ESP_LOGE(TAG, "Header_length error");
+        return ESP_ERR_INVALID_CRC;
+    }
+    data = bin_ptr + header_length;
+    uint32_t dsc_length = *(uint32_t *)data;
+
+    /*sha256*/
+    if (header_length + dsc_length + 32 > size || dsc_length < 4) {
+        ESP_LOGE(TAG, "Dsc_length error");
+        return ESP_ERR_INVALID_CRC;
+    }
+    esp_err_t err = d2_font_verify(partition, bin_ptr, header_length + dsc_length);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    return d2_font_create(bin_ptr + header_length + 4, 0, dsc_length - 4, font_header, options, true, out_font);
+}
+
+esp_err_t d2_font_load_from_mem_with_options(const uint8_t *bin_ptr, size_t size, const d2_font_load_options_t *options,
+                                             lv_font_t **out_font)
+{
+    return load_from_mem(bin_ptr, size, options, NULL, out_font);
+}
+
+esp_err_t d2_font_load_embedded(const d2_font_embedded_t *embedded, const d2_font_load_options_t *options,
+                                lv_font_t **out_font)
+{
+    if (out_font == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *out_font = NULL;
+    if (embedded == NULL || embedded->magic != D2_FONT_EMBEDDED_MAGIC) {
+        ESP_LOGE(TAG, "Invalid param");
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!(embedded->flags & D2_FONT_EMBEDDED_FLAG_VERIFIED)) {
+        return load_from_mem(embedded->bin, embedded->size, options, NULL, out_font);
+    }
+    /*The header, the tables and the SHA-256 were checked by d2_font_embed.py, the app image hash covers the rest*/
+    uint16_t header_length = *(const uint16_t *)embedded->bin;
+    const d2_font_header_bin_t *font_header = (const d2_font_header_bin_t *)(embedded->bin + 8);
+    uint32_t dsc_length = *(const uint32_t *)(embedded->bin + header_length);
+    return d2_font_create(embedded->bin + header_length + 4, 0, dsc_length - 4, font_header, options, false, out_font);
+}
+
 esp_err_t d2_font_load_from_partition(const char* label, lv_font_t **out_font)
+{
+    return d2_font_load_from_partition_with_options(label, NULL, out_font);
+}
+
+esp_err_t d2_font_load_from_partition_with_options(const char *label, const d2_font_load_options_t *options,
+                                                   lv_font_t **out_font)
 {
     esp_err_t err;
     *out_font = NULL;
@@ -148,12 +394,15 @@ esp_err_t d2_font_load_from_partition(const char* label, lv_font_t **out_font)
         return err;
     }
 
-    err = d2_font_load_from_mem(map_ptr, partition->size, out_font);
+    err = load_from_mem(map_ptr, partition->size, options, partition, out_font);
     if (err != ESP_OK) {
         goto error;
     }
     d2_font_context_t *ctx = (*out_font)->user_data;
     ctx->mmap_handle = (void *)map_handle;
+    ctx->partition = partition;
+    ctx->base_offset = (const uint8_t *)ctx->base_ptr - (const uint8_t *)map_ptr;
+    ctx->mem.mmap_size = partition->size;
     return ESP_OK;
 error:
     esp_partition_munmap(map_handle);
@@ -163,9 +412,253 @@ error:
 void d2_font_unload(lv_font_t *font)
 {
     d2_font_context_t *ctx = (d2_font_context_t *)font->user_data;
+    d2_font_prefetch_disable(font);
+    d2_font_budget_disable(font);
+    d2_font_trace_stop(font);
+    d2_font_shrink_hook_disable(font);
+    d2_font_preload_release(font);
+    d2_font_run_cache_clear(font);
+    d2_font_tile_cache_clear(font);
+#if CONFIG_D2_FONT_ASCII_TABLE
+    d2_font_ascii_table_free(font);
+#endif
+#if LVGL_VERSION_MAJOR < 9
+    d2_font_mem_free(&ctx->mem, D2_FONT_MEM_SCRATCH, ctx->ext->bitmap_out, ctx->ext->bitmap_out_size);
+#endif
+    d2_font_mem_free(&ctx->mem, D2_FONT_MEM_INDEX, ctx->cmap_ram, ctx->cmap_ram_size);
+    if (ctx->gid_ranges) {
+        const d2_font_fmt_txt_dsc_t *fdsc = (const d2_font_fmt_txt_dsc_t *)(ctx->base_ptr + (uint32_t)font->dsc);
+        d2_font_mem_free(&ctx->mem, D2_FONT_MEM_INDEX, ctx->gid_ranges, fdsc->cmap_num * sizeof(d2_font_fmt_txt_gid_range_t));
+    }
     esp_partition_mmap_handle_t mmap_handle = (esp_partition_mmap_handle_t)ctx->mmap_handle;
     if (mmap_handle) {
         esp_partition_munmap(mmap_handle);
     }
     heap_caps_free(font);
 }
+
+#if LVGL_VERSION_MAJOR >= 9
+esp_err_t d2_font_pin_glyph(lv_font_t *font, uint32_t letter)
+{
+    d2_font_context_t *ctx = (d2_font_context_t *)font->user_data;
+    d2_font_fmt_txt_pin_t *pin = &ctx->pin;
+
+    uint32_t pos;
+    if (d2_font_fmt_txt_pin_find(pin, letter, &pos)) {
+        return ESP_OK;
+    }
+    d2_font_fmt_txt_glyph_t glyph;
+    if (!d2_font_fmt_txt_resolve_glyph(font, letter, &glyph)) {
+        return ESP_OK;
+    }
+    uint32_t box_w = glyph.gdsc->box_w;
+    uint32_t box_h = glyph.gdsc->box_h;
+    if (box_w == 0 || box_h == 0) {
+        /*Nothing to draw, the bitmap callback returns NULL for it anyway*/
+        return ESP_OK;
+    }
+
+    /*The pinned glyphs are the ones being added to*/
+    uint32_t caches = D2_FONT_SHRINK_RETRY_TILES;
+    if (pin->num == pin->size) {
+        uint32_t size = pin->size ? pin->size * 2 : 16;
+        d2_font_fmt_txt_pin_glyph_t *glyphs = d2_font_mem_realloc(&ctx->mem, D2_FONT_MEM_CACHE, pin->glyphs,
+                                                                  pin->size * sizeof(d2_font_fmt_txt_pin_glyph_t),
+                                                                  size * sizeof(d2_font_fmt_txt_pin_glyph_t));
+        while (glyphs == NULL && d2_font_shrink_retry(font, &caches)) {
+            glyphs = d2_font_mem_realloc(&ctx->mem, D2_FONT_MEM_CACHE, pin->glyphs,
+                                         pin->size * sizeof(d2_font_fmt_txt_pin_glyph_t),
+                                         size * sizeof(d2_font_fmt_txt_pin_glyph_t));
+        }
+        if (glyphs == NULL) {
+            ESP_LOGE(TAG, "malloc failed");
+            return ESP_ERR_NO_MEM;
+        }
+        pin->glyphs = glyphs;
+        pin->size = size;
+    }
+
+    uint32_t stride = lv_draw_buf_width_to_stride(box_w, LV_COLOR_FORMAT_A8);
+    uint8_t *data = d2_font_mem_alloc(&ctx->mem, D2_FONT_MEM_CACHE, stride * box_h, false);
+    while (data == NULL && d2_font_shrink_retry(font, &caches)) {
+        data = d2_font_mem_alloc(&ctx->mem, D2_FONT_MEM_CACHE, stride * box_h, false);
+    }
+    if (data == NULL) {
+        ESP_LOGE(TAG, "malloc failed");
+        return ESP_ERR_NO_MEM;
+    }
+    if (!d2_font_fmt_txt_decode_a8(font, &glyph, data, caches)) {
+        d2_font_mem_free(&ctx->mem, D2_FONT_MEM_CACHE, data, stride * box_h);
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    memmove(&pin->glyphs[pos + 1], &pin->glyphs[pos], (pin->num - pos) * sizeof(d2_font_fmt_txt_pin_glyph_t));
+    d2_font_fmt_txt_pin_glyph_t *pinned = &pin->glyphs[pos];
+    pinned->unicode_letter = letter;
+    lv_draw_buf_init(&pinned->draw_buf, box_w, box_h, LV_COLOR_FORMAT_A8, stride, data, stride * box_h);
+    lv_draw_buf_flush_cache(&pinned->draw_buf, NULL);
+    pin->num++;
+    return ESP_OK;
+}
+#endif
+
+esp_err_t d2_font_preload_utf8(lv_font_t *font, const char *text)
+{
+#if LVGL_VERSION_MAJOR >= 9
+    if (font == NULL || text == NULL || font->get_glyph_bitmap != d2_font_get_bitmap_fmt_txt) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    uint32_t i = 0;
+    uint32_t letter;
+    while ((letter = d2_font_utf8_next(text, &i)) != 0) {
+        esp_err_t err = d2_font_pin_glyph(font, letter);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+    return ESP_OK;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+void d2_font_preload_release(lv_font_t *font)
+{
+    if (font == NULL) {
+        return;
+    }
+    d2_font_context_t *ctx = (d2_font_context_t *)font->user_data;
+    d2_font_fmt_txt_pin_t *pin = &ctx->pin;
+#if LVGL_VERSION_MAJOR >= 9
+    for (uint32_t i = 0; i < pin->num; i++) {
+        d2_font_mem_free(&ctx->mem, D2_FONT_MEM_CACHE, pin->glyphs[i].draw_buf.data, pin->glyphs[i].draw_buf.data_size);
+    }
+#endif
+    d2_font_mem_free(&ctx->mem, D2_FONT_MEM_CACHE, pin->glyphs, pin->size * sizeof(d2_font_fmt_txt_pin_glyph_t));
+    pin->glyphs = NULL;
+    pin->num = 0;
+    pin->size = 0;
+}
+
+#if CONFIG_D2_FONT_RUN_CACHE
+static uint32_t run_hash(const char *text, uint32_t *len)
+{
+    /*FNV-1a*/
+    uint32_t hash = 2166136261u;
+    const uint8_t *p = (const uint8_t *)text;
+    while (*p) {
+        hash ^= *p++;
+        hash *= 16777619u;
+    }
+    *len = (const char *)p - text;
+    return hash;
+}
+
+static size_t run_size(uint32_t glyph_num, uint32_t text_len)
+{
+    return sizeof(d2_font_run_t) + glyph_num * sizeof(d2_font_run_glyph_t) + text_len + 1;
+}
+
+static void run_cache_evict(d2_font_context_t *ctx, uint32_t index)
+{
+    d2_font_fmt_txt_run_cache_t *cache = &ctx->ext->run_cache;
+    d2_font_run_t *run = cache->runs[index];
+    if (cache->follow == run) {
+        cache->follow = NULL;
+    }
+    d2_font_mem_free(&ctx->mem, D2_FONT_MEM_CACHE, run, run_size(run->glyph_num, run->text_len));
+    cache->num--;
+    memmove(&cache->runs[index], &cache->runs[index + 1], (cache->num - index) * sizeof(cache->runs[0]));
+}
+#endif
+
+esp_err_t d2_font_run_get(lv_font_t *font, const char *text, const d2_font_run_t **out_run)
+{
+#if CONFIG_D2_FONT_RUN_CACHE
+    *out_run = NULL;
+    if (font == NULL || text == NULL || font->get_glyph_dsc != d2_font_get_glyph_dsc_fmt_txt) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    d2_font_context_t *ctx = (d2_font_context_t *)font->user_data;
+    d2_font_fmt_txt_run_cache_t *cache = &ctx->ext->run_cache;
+
+    uint32_t text_len;
+    uint32_t hash = run_hash(text, &text_len);
+    for (uint32_t i = 0; i < cache->num; i++) {
+        d2_font_run_t *run = cache->runs[i];
+        if (run->hash == hash && run->text_len == text_len && memcmp(run->text, text, text_len) == 0) {
+            /*Move to front*/
+            memmove(&cache->runs[1], &cache->runs[0], i * sizeof(cache->runs[0]));
+            cache->runs[0] = run;
+            *out_run = run;
+            return ESP_OK;
+        }
+    }
+
+    uint32_t glyph_num = 0;
+    uint32_t i = 0;
+    while (d2_font_utf8_next(text, &i)) {
+        glyph_num++;
+    }
+    if (glyph_num > CONFIG_D2_FONT_RUN_MAX_GLYPHS) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    /*Other calls may evict the runs anyway*/
+    uint32_t caches = D2_FONT_SHRINK_RETRY_RUNS | D2_FONT_SHRINK_RETRY_TILES | D2_FONT_SHRINK_RETRY_PINNED;
+    d2_font_run_t *run = d2_font_mem_alloc(&ctx->mem, D2_FONT_MEM_CACHE, run_size(glyph_num, text_len), false);
+    while (run == NULL && d2_font_shrink_retry(font, &caches)) {
+        run = d2_font_mem_alloc(&ctx->mem, D2_FONT_MEM_CACHE, run_size(glyph_num, text_len), false);
+    }
+    if (run == NULL) {
+        ESP_LOGE(TAG, "malloc failed");
+        return ESP_ERR_NO_MEM;
+    }
+    char *text_copy = (char *)&run->glyphs[glyph_num];
+    memcpy(text_copy, text, text_len + 1);
+    run->hash = hash;
+    run->text_len = text_len;
+    run->text = text_copy;
+    run->glyph_num = glyph_num;
+
+    int32_t pos_x = 0;
+    uint32_t letter;
+    uint32_t n = 0;
+    i = 0;
+    letter = d2_font_utf8_next(text, &i);
+    while (letter) {
+        uint32_t letter_next = d2_font_utf8_next(text, &i);
+        d2_font_run_glyph_t *glyph = &run->glyphs[n++];
+        d2_font_fmt_txt_lookup_glyph(font, letter, letter_next, glyph);
+        glyph->pos_x = pos_x;
+        pos_x += glyph->adv_w;
+        letter = letter_next;
+    }
+    run->width = pos_x;
+
+    if (cache->num == CONFIG_D2_FONT_RUN_CACHE_NUM) {
+        run_cache_evict(ctx, cache->num - 1);
+    }
+    memmove(&cache->runs[1], &cache->runs[0], cache->num * sizeof(cache->runs[0]));
+    cache->runs[0] = run;
+    cache->num++;
+
+    *out_run = run;
+    return ESP_OK;
+#else
+    *out_run = NULL;
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+void d2_font_run_cache_clear(lv_font_t *font)
+{
+#if CONFIG_D2_FONT_RUN_CACHE
+    d2_font_context_t *ctx = (d2_font_context_t *)font->user_data;
+    d2_font_fmt_txt_run_cache_t *cache = &ctx->ext->run_cache;
+    while (cache->num) {
+        run_cache_evict(ctx, cache->num - 1);
+    }
+#endif
+}
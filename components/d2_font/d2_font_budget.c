@@ -0,0 +1,336 @@
+/*
+ * SPDX-FileCopyrightText: 2026 udoudou
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "d2_font_budget.h"
+
+#include "string.h"
+#include "esp_log.h"
+
+#include "d2_font_fmt_txt.h"
+#include "d2_font_priv.h"
+
+#if CONFIG_D2_FONT_FRAME_BUDGET && LVGL_VERSION_MAJOR >= 9
+#include "esp_timer.h"
+
+/*Period of the timer decoding the deferred glyphs while some are queued*/
+#define BUDGET_TIMER_PERIOD_MS  1
+/*Areas recorded per set, more are merged into the last one*/
+#define BUDGET_AREAS_MAX        8
+
+static const char *TAG = "d2_font_budget";
+
+typedef struct {
+    uint32_t num;
+    lv_area_t areas[BUDGET_AREAS_MAX];
+} d2_font_budget_areas_t;
+
+struct d2_font_budget_t {
+    d2_font_budget_config_t config;
+    lv_font_t *font;
+    lv_timer_t *timer;              /*Paused while the queue is empty*/
+    int64_t decode_start;
+    uint32_t frame_us;
+    uint32_t frame_glyphs;
+    bool frame_deferred;            /*The frame being refreshed drew placeholders*/
+    d2_font_budget_stats_t stats;
+    d2_font_budget_areas_t invalid; /*Invalidated since the last frame started, refreshed by the next one*/
+    d2_font_budget_areas_t frame;   /*Refreshed by the frame being drawn*/
+    d2_font_budget_areas_t redraw;  /*Refreshed by frames with placeholders, invalidated once glyphs are decoded*/
+    uint32_t queue_num;
+    uint32_t queue[CONFIG_D2_FONT_FRAME_BUDGET_QUEUE_LEN];    /*Deferred letters, oldest first*/
+    uint32_t glyph_num;
+    uint32_t glyph_next;            /*Slot of the next decoded glyph, the oldest once the store is full*/
+    d2_font_fmt_txt_pin_glyph_t glyphs[CONFIG_D2_FONT_FRAME_BUDGET_QUEUE_LEN];  /*Deferred glyphs decoded by the timer*/
+};
+
+static void areas_add(d2_font_budget_areas_t *set, const lv_area_t *area)
+{
+    for (uint32_t i = 0; i < set->num; i++) {
+        const lv_area_t *in = &set->areas[i];
+        if (area->x1 >= in->x1 && area->y1 >= in->y1 && area->x2 <= in->x2 && area->y2 <= in->y2) {
+            return;
+        }
+    }
+    if (set->num < BUDGET_AREAS_MAX) {
+        set->areas[set->num++] = *area;
+        return;
+    }
+    lv_area_t *last = &set->areas[BUDGET_AREAS_MAX - 1];
+    last->x1 = LV_MIN(last->x1, area->x1);
+    last->y1 = LV_MIN(last->y1, area->y1);
+    last->x2 = LV_MAX(last->x2, area->x2);
+    last->y2 = LV_MAX(last->y2, area->y2);
+}
+
+static bool budget_spent(const d2_font_budget_config_t *config, uint32_t us, uint32_t glyphs)
+{
+    return (config->budget_us && us >= config->budget_us) || (config->budget_glyphs && glyphs >= config->budget_glyphs);
+}
+
+bool d2_font_budget_begin(const lv_font_t *font, uint32_t letter, const d2_font_fmt_txt_glyph_dsc_t *gdsc,
+                          uint8_t *bitmap_out)
+{
+    d2_font_context_t *ctx = (d2_font_context_t *)font->user_data;
+    struct d2_font_budget_t *budget = ctx->ext->budget;
+    if (!budget_spent(&budget->config, budget->frame_us, budget->frame_glyphs)) {
+        budget->decode_start = esp_timer_get_time();
+        return true;
+    }
+
+    uint32_t stride = lv_draw_buf_width_to_stride(gdsc->box_w, LV_COLOR_FORMAT_A8);
+    memset(bitmap_out, budget->config.placeholder_opa, stride * gdsc->box_h);
+    budget->frame_deferred = true;
+    budget->stats.deferred++;
+    for (uint32_t i = 0; i < budget->queue_num; i++) {
+        if (budget->queue[i] == letter) {
+            return false;
+        }
+    }
+    /*A full queue drops the letter, it is deferred again when the text is redrawn*/
+    if (budget->queue_num < CONFIG_D2_FONT_FRAME_BUDGET_QUEUE_LEN) {
+        budget->queue[budget->queue_num++] = letter;
+    }
+    return false;
+}
+
+void d2_font_budget_end(const lv_font_t *font)
+{
+    d2_font_context_t *ctx = (d2_font_context_t *)font->user_data;
+    struct d2_font_budget_t *budget = ctx->ext->budget;
+    budget->frame_us += esp_timer_get_time() - budget->decode_start;
+    budget->frame_glyphs++;
+}
+
+const lv_draw_buf_t *d2_font_budget_take(const lv_font_t *font, uint32_t letter)
+{
+    const d2_font_context_t *ctx = (const d2_font_context_t *)font->user_data;
+    struct d2_font_budget_t *budget = ctx->ext->budget;
+    for (uint32_t i = 0; i < budget->glyph_num; i++) {
+        if (budget->glyphs[i].unicode_letter == letter && budget->glyphs[i].draw_buf.data) {
+            return &budget->glyphs[i].draw_buf;
+        }
+    }
+    return NULL;
+}
+
+static void budget_glyphs_free(struct d2_font_budget_t *budget)
+{
+    d2_font_context_t *ctx = (d2_font_context_t *)budget->font->user_data;
+    for (uint32_t i = 0; i < budget->glyph_num; i++) {
+        d2_font_mem_free(&ctx->mem, D2_FONT_MEM_CACHE, budget->glyphs[i].draw_buf.data,
+                         budget->glyphs[i].draw_buf.data_size);
+        budget->glyphs[i].draw_buf.data = NULL;
+    }
+    budget->glyph_num = 0;
+    budget->glyph_next = 0;
+}
+
+static void budget_frame_event(lv_event_t *e)
+{
+    struct d2_font_budget_t *budget = lv_event_get_user_data(e);
+    lv_event_code_t code = lv_event_get_code(e);
+    if (code == LV_EVENT_INVALIDATE_AREA) {
+        areas_add(&budget->invalid, lv_event_get_param(e));
+        return;
+    }
+    if (code == LV_EVENT_REFR_START) {
+        budget->frame = budget->invalid;
+        budget->invalid.num = 0;
+        budget->frame_deferred = false;
+        budget->frame_us = 0;
+        budget->frame_glyphs = 0;
+        return;
+    }
+    budget->stats.last_frame_us = budget->frame_us;
+    budget->stats.last_frame_glyphs = budget->frame_glyphs;
+    budget->stats.max_frame_us = LV_MAX(budget->stats.max_frame_us, budget->frame_us);
+    ESP_LOGD(TAG, "frame: %" PRIu32 " glyphs in %" PRIu32 " us, %" PRIu32 " pending", budget->frame_glyphs,
+             budget->frame_us, budget->queue_num);
+    if (budget->frame_deferred) {
+        if (budget->frame.num == 0) {
+            /*Invalidated before the budget was enabled, the areas are not known*/
+            lv_area_t screen = {
+                .x1 = 0,
+                .y1 = 0,
+                .x2 = lv_display_get_horizontal_resolution(budget->config.display) - 1,
+                .y2 = lv_display_get_vertical_resolution(budget->config.display) - 1,
+            };
+            areas_add(&budget->redraw, &screen);
+        }
+        for (uint32_t i = 0; i < budget->frame.num; i++) {
+            areas_add(&budget->redraw, &budget->frame.areas[i]);
+        }
+    }
+    if (budget->queue_num) {
+        lv_timer_resume(budget->timer);
+    }
+}
+
+/**
+ * Decode a deferred glyph into the store of the budget, over its oldest glyph once full.
+ * A replaced glyph still on the screen is decoded again, or deferred again, when it is redrawn.
+ */
+static esp_err_t budget_glyph_store(struct d2_font_budget_t *budget, uint32_t letter)
+{
+    const lv_font_t *font = budget->font;
+    d2_font_context_t *ctx = (d2_font_context_t *)font->user_data;
+    d2_font_fmt_txt_glyph_t glyph;
+    if (!d2_font_fmt_txt_resolve_glyph(font, letter, &glyph) || glyph.gdsc->box_w == 0 || glyph.gdsc->box_h == 0) {
+        return ESP_OK;
+    }
+    uint32_t box_w = glyph.gdsc->box_w;
+    uint32_t box_h = glyph.gdsc->box_h;
+    uint32_t stride = lv_draw_buf_width_to_stride(box_w, LV_COLOR_FORMAT_A8);
+
+    d2_font_fmt_txt_pin_glyph_t *stored = &budget->glyphs[budget->glyph_next];
+    if (stored->draw_buf.data) {
+        d2_font_mem_free(&ctx->mem, D2_FONT_MEM_CACHE, stored->draw_buf.data, stored->draw_buf.data_size);
+        stored->draw_buf.data = NULL;
+    }
+    if (budget->glyph_num < CONFIG_D2_FONT_FRAME_BUDGET_QUEUE_LEN) {
+        budget->glyph_num++;
+    }
+    budget->glyph_next = (budget->glyph_next + 1) % CONFIG_D2_FONT_FRAME_BUDGET_QUEUE_LEN;
+
+    uint32_t caches = D2_FONT_SHRINK_RETRY_TILES;
+    uint8_t *data = d2_font_mem_alloc(&ctx->mem, D2_FONT_MEM_CACHE, stride * box_h, false);
+    while (data == NULL && d2_font_shrink_retry(font, &caches)) {
+        data = d2_font_mem_alloc(&ctx->mem, D2_FONT_MEM_CACHE, stride * box_h, false);
+    }
+    if (data == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    if (!d2_font_fmt_txt_decode_a8(font, &glyph, data, caches)) {
+        d2_font_mem_free(&ctx->mem, D2_FONT_MEM_CACHE, data, stride * box_h);
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    stored->unicode_letter = letter;
+    lv_draw_buf_init(&stored->draw_buf, box_w, box_h, LV_COLOR_FORMAT_A8, stride, data, stride * box_h);
+    lv_draw_buf_flush_cache(&stored->draw_buf, NULL);
+    return ESP_OK;
+}
+
+/** Decode deferred glyphs, one budget per run, then redraw the areas that showed placeholders*/
+static void budget_timer_cb(lv_timer_t *timer)
+{
+    struct d2_font_budget_t *budget = lv_timer_get_user_data(timer);
+    int64_t start = esp_timer_get_time();
+    uint32_t done = 0;
+    uint32_t stored = 0;
+    do {
+        uint32_t letter = budget->queue[done++];
+        esp_err_t err = budget_glyph_store(budget, letter);
+        if (err == ESP_OK) {
+            stored++;
+        } else {
+            /*Not invalidated, so a glyph that cannot be decoded does not keep the display refreshing*/
+            ESP_LOGW(TAG, "decode U+%04" PRIX32 " failed: %s", letter, esp_err_to_name(err));
+        }
+    } while (done < budget->queue_num && !budget_spent(&budget->config, esp_timer_get_time() - start, done));
+
+    budget->queue_num -= done;
+    memmove(budget->queue, budget->queue + done, budget->queue_num * sizeof(uint32_t));
+    if (budget->queue_num == 0) {
+        lv_timer_pause(timer);
+    }
+    if (stored) {
+        /*Recorded again by the frames that still draw placeholders*/
+        d2_font_budget_areas_t redraw = budget->redraw;
+        budget->redraw.num = 0;
+        for (uint32_t i = 0; i < redraw.num; i++) {
+            lv_inv_area(budget->config.display, &redraw.areas[i]);
+        }
+    }
+}
+#endif
+
+esp_err_t d2_font_budget_enable(lv_font_t *font, const d2_font_budget_config_t *config)
+{
+#if CONFIG_D2_FONT_FRAME_BUDGET && LVGL_VERSION_MAJOR >= 9
+    if (font == NULL || config == NULL || font->get_glyph_bitmap != d2_font_get_bitmap_fmt_txt) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    lv_display_t *display = config->display ? config->display : lv_display_get_default();
+    if (display == NULL) {
+        ESP_LOGE(TAG, "No display");
+        return ESP_ERR_INVALID_ARG;
+    }
+    d2_font_budget_disable(font);
+
+    d2_font_context_t *ctx = (d2_font_context_t *)font->user_data;
+    struct d2_font_budget_t *budget = d2_font_mem_alloc(&ctx->mem, D2_FONT_MEM_CONTEXT, sizeof(struct d2_font_budget_t), true);
+    if (budget == NULL) {
+        ESP_LOGE(TAG, "malloc failed");
+        return ESP_ERR_NO_MEM;
+    }
+    budget->config = *config;
+    budget->config.display = display;
+    budget->font = font;
+    budget->timer = lv_timer_create(budget_timer_cb, BUDGET_TIMER_PERIOD_MS, budget);
+    if (budget->timer == NULL) {
+        ESP_LOGE(TAG, "timer create failed");
+        d2_font_mem_free(&ctx->mem, D2_FONT_MEM_CONTEXT, budget, sizeof(struct d2_font_budget_t));
+        return ESP_ERR_NO_MEM;
+    }
+    lv_timer_pause(budget->timer);
+    lv_display_add_event_cb(display, budget_frame_event, LV_EVENT_REFR_START, budget);
+    lv_display_add_event_cb(display, budget_frame_event, LV_EVENT_REFR_READY, budget);
+    lv_display_add_event_cb(display, budget_frame_event, LV_EVENT_INVALIDATE_AREA, budget);
+    ctx->ext->budget = budget;
+    return ESP_OK;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+esp_err_t d2_font_budget_disable(lv_font_t *font)
+{
+#if CONFIG_D2_FONT_FRAME_BUDGET && LVGL_VERSION_MAJOR >= 9
+    if (font == NULL || font->get_glyph_bitmap != d2_font_get_bitmap_fmt_txt) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    d2_font_context_t *ctx = (d2_font_context_t *)font->user_data;
+    struct d2_font_budget_t *budget = ctx->ext->budget;
+    if (budget == NULL) {
+        return ESP_OK;
+    }
+    lv_display_remove_event_cb_with_user_data(budget->config.display, budget_frame_event, budget);
+    lv_timer_delete(budget->timer);
+    budget_glyphs_free(budget);
+    d2_font_mem_free(&ctx->mem, D2_FONT_MEM_CONTEXT, budget, sizeof(struct d2_font_budget_t));
+    ctx->ext->budget = NULL;
+    return ESP_OK;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+void d2_font_budget_clear(lv_font_t *font)
+{
+#if CONFIG_D2_FONT_FRAME_BUDGET && LVGL_VERSION_MAJOR >= 9
+    d2_font_context_t *ctx = (d2_font_context_t *)font->user_data;
+    if (ctx->ext->budget) {
+        budget_glyphs_free(ctx->ext->budget);
+    }
+#endif
+}
+
+esp_err_t d2_font_budget_get_stats(const lv_font_t *font, d2_font_budget_stats_t *stats)
+{
+#if CONFIG_D2_FONT_FRAME_BUDGET && LVGL_VERSION_MAJOR >= 9
+    if (font == NULL || stats == NULL || font->get_glyph_bitmap != d2_font_get_bitmap_fmt_txt) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    const d2_font_context_t *ctx = (const d2_font_context_t *)font->user_data;
+    if (ctx->ext->budget == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    *stats = ctx->ext->budget->stats;
+    stats->pending = ctx->ext->budget->queue_num;
+    return ESP_OK;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
@@ -0,0 +1,291 @@
+/*
+ * SPDX-FileCopyrightText: 2026 udoudou
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "d2_font_chain.h"
+
+#include "stdlib.h"
+#include "string.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "lvgl.h"
+
+#include "d2_font_fmt_txt.h"
+#include "d2_font_priv.h"
+
+static const char *TAG = "d2_font_chain";
+
+/*Codepoints of the fonts that are not indexed*/
+#define CHAIN_CODEPOINT_MAX     0x10FFFF
+
+/** Codepoints `first` to `last`, held by the fonts of the bits of `fonts`*/
+typedef struct {
+    uint32_t first;
+    uint32_t last;
+    uint32_t fonts;
+} chain_range_t;
+
+typedef struct {
+    const lv_font_t *fonts[D2_FONT_CHAIN_FONTS_MAX];
+    uint32_t font_num;
+    uint32_t range_num;
+    chain_range_t *ranges;          /**< Sorted, not overlapping*/
+} d2_font_chain_t;
+
+static uint32_t chain_fonts_of(const d2_font_chain_t *chain, uint32_t letter)
+{
+    uint32_t low = 0;
+    uint32_t high = chain->range_num;
+    while (low < high) {
+        uint32_t mid = (low + high) / 2;
+        const chain_range_t *range = &chain->ranges[mid];
+        if (letter < range->first) {
+            high = mid;
+        } else if (letter > range->last) {
+            low = mid + 1;
+        } else {
+            return range->fonts;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Ask the fonts whose ranges hold the letter, in order.
+ * @return the font having the letter, NULL if none
+ */
+static const lv_font_t *chain_resolve(const d2_font_chain_t *chain, lv_font_glyph_dsc_t *dsc_out, uint32_t letter,
+                                      uint32_t letter_next)
+{
+    uint32_t fonts = chain_fonts_of(chain, letter);
+    while (fonts) {
+        const lv_font_t *member = chain->fonts[__builtin_ctz(fonts)];
+        fonts &= fonts - 1;
+#if LVGL_VERSION_MAJOR >= 9
+        uint32_t next = member->kerning == LV_FONT_KERNING_NONE ? 0 : letter_next;
+#else
+        uint32_t next = letter_next;
+#endif
+        if (member->get_glyph_dsc(member, dsc_out, letter, next)) {
+            return member;
+        }
+    }
+    return NULL;
+}
+
+/** The font drawing a letter; a letter in the ranges of one font only needs no lookup*/
+static const lv_font_t *chain_member_of(const d2_font_chain_t *chain, uint32_t letter)
+{
+    uint32_t fonts = chain_fonts_of(chain, letter);
+    if (fonts && !(fonts & (fonts - 1))) {
+        return chain->fonts[__builtin_ctz(fonts)];
+    }
+    lv_font_glyph_dsc_t dsc;
+    return chain_resolve(chain, &dsc, letter, 0);
+}
+
+static bool chain_get_glyph_dsc(const lv_font_t *font, lv_font_glyph_dsc_t *dsc_out, uint32_t unicode_letter,
+                                uint32_t unicode_letter_next)
+{
+    const d2_font_chain_t *chain = (const d2_font_chain_t *)font->user_data;
+    return chain_resolve(chain, dsc_out, unicode_letter, unicode_letter_next) != NULL;
+}
+
+#if LVGL_VERSION_MAJOR >= 9
+static const void *chain_get_bitmap(lv_font_glyph_dsc_t *g_dsc, lv_draw_buf_t *draw_buf)
+{
+    const d2_font_chain_t *chain = (const d2_font_chain_t *)g_dsc->resolved_font->user_data;
+    const lv_font_t *member = chain_member_of(chain, g_dsc->gid.index);
+    if (member == NULL) {
+        return NULL;
+    }
+    /*Left on the member, so LVGL releases the glyph with the font that drew it*/
+    g_dsc->resolved_font = member;
+    return member->get_glyph_bitmap(g_dsc, draw_buf);
+}
+#else
+static const uint8_t *chain_get_bitmap(const lv_font_t *font, uint32_t letter)
+{
+    const d2_font_chain_t *chain = (const d2_font_chain_t *)font->user_data;
+    const lv_font_t *member = chain_member_of(chain, letter);
+    if (member == NULL) {
+        return NULL;
+    }
+    return member->get_glyph_bitmap(member, letter);
+}
+#endif
+
+static int boundary_compare(const void *a, const void *b)
+{
+    uint32_t va = *(const uint32_t *)a;
+    uint32_t vb = *(const uint32_t *)b;
+    return va < vb ? -1 : va > vb;
+}
+
+/**
+ * Codepoint ranges of a font: its cmaps, or every codepoint for fonts not from `d2_font_load_xx` and fonts
+ * that could not be mapped again after `d2_font_suspend`
+ */
+static uint32_t font_spans(const lv_font_t *font, uint32_t bit, chain_range_t *spans)
+{
+    if (font->get_glyph_bitmap != d2_font_get_bitmap_fmt_txt || !d2_font_fmt_txt_mapped(font)) {
+        if (spans) {
+            spans[0] = (chain_range_t) {
+                0, CHAIN_CODEPOINT_MAX, bit
+            };
+        }
+        return 1;
+    }
+    const d2_font_context_t *ctx = (const d2_font_context_t *)font->user_data;
+    const d2_font_fmt_txt_dsc_t *fdsc = (const d2_font_fmt_txt_dsc_t *)(ctx->base_ptr + (uint32_t)font->dsc);
+    uint32_t num = 0;
+    for (uint32_t i = 0; i < fdsc->cmap_num; i++) {
+        const d2_font_fmt_txt_cmap_t *cmap = &ctx->cmaps[i];
+        if (cmap->range_length == 0) {
+            continue;
+        }
+        if (spans) {
+            spans[num] = (chain_range_t) {
+                cmap->range_start, cmap->range_start + cmap->range_length - 1, bit
+            };
+        }
+        num++;
+    }
+    return num;
+}
+
+/** Join the neighbouring pieces held by the same fonts, piece k is bounds[k] to bounds[k + 1] - 1*/
+static uint32_t join_pieces(const uint32_t *bounds, uint32_t bound_num, const uint32_t *pieces, chain_range_t *ranges)
+{
+    uint32_t num = 0;
+    for (uint32_t k = 0; k + 1 < bound_num; k++) {
+        if (pieces[k] == 0) {
+            continue;
+        }
+        bool join = k > 0 && pieces[k - 1] == pieces[k];
+        if (!join) {
+            num++;
+        }
+        if (ranges) {
+            if (!join) {
+                ranges[num - 1].first = bounds[k];
+                ranges[num - 1].fonts = pieces[k];
+            }
+            ranges[num - 1].last = bounds[k + 1] - 1;
+        }
+    }
+    return num;
+}
+
+/**
+ * Merge the ranges of all the fonts: cut them at every range boundary, mark the fonts of each piece,
+ * then join the neighbouring pieces held by the same fonts.
+ */
+static esp_err_t chain_build_index(d2_font_chain_t *chain)
+{
+    uint32_t span_num = 0;
+    for (uint32_t i = 0; i < chain->font_num; i++) {
+        span_num += font_spans(chain->fonts[i], 0, NULL);
+    }
+    if (span_num == 0) {
+        return ESP_OK;
+    }
+    esp_err_t err = ESP_ERR_NO_MEM;
+    chain_range_t *spans = heap_caps_malloc(span_num * sizeof(chain_range_t), MALLOC_CAP_8BIT);
+    uint32_t *bounds = heap_caps_malloc(span_num * 2 * sizeof(uint32_t), MALLOC_CAP_8BIT);
+    uint32_t *pieces = heap_caps_calloc(span_num * 2, sizeof(uint32_t), MALLOC_CAP_8BIT);
+    if (spans == NULL || bounds == NULL || pieces == NULL) {
+        goto exit;
+    }
+    uint32_t num = 0;
+    for (uint32_t i = 0; i < chain->font_num; i++) {
+        num += font_spans(chain->fonts[i], 1UL << i, spans + num);
+    }
+    for (uint32_t i = 0; i < span_num; i++) {
+        bounds[2 * i] = spans[i].first;
+        bounds[2 * i + 1] = spans[i].last + 1;
+    }
+    qsort(bounds, span_num * 2, sizeof(uint32_t), boundary_compare);
+    uint32_t bound_num = 0;
+    for (uint32_t i = 0; i < span_num * 2; i++) {
+        if (bound_num == 0 || bounds[bound_num - 1] != bounds[i]) {
+            bounds[bound_num++] = bounds[i];
+        }
+    }
+    for (uint32_t i = 0; i < span_num; i++) {
+        const uint32_t *bound = bsearch(&spans[i].first, bounds, bound_num, sizeof(uint32_t), boundary_compare);
+        for (uint32_t k = bound - bounds; bounds[k] <= spans[i].last; k++) {
+            pieces[k] |= spans[i].fonts;
+        }
+    }
+
+    /*Looked up for every letter, kept in internal RAM*/
+    uint32_t range_num = join_pieces(bounds, bound_num, pieces, NULL);
+    chain->ranges = heap_caps_malloc(range_num * sizeof(chain_range_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (chain->ranges == NULL) {
+        goto exit;
+    }
+    chain->range_num = join_pieces(bounds, bound_num, pieces, chain->ranges);
+    ESP_LOGD(TAG, "%" PRIu32 " cmap ranges merged into %" PRIu32, span_num, chain->range_num);
+    err = ESP_OK;
+exit:
+    heap_caps_free(spans);
+    heap_caps_free(bounds);
+    heap_caps_free(pieces);
+    return err;
+}
+
+esp_err_t d2_font_chain_create(const lv_font_t *const *fonts, uint32_t font_num, lv_font_t **out_font)
+{
+    if (out_font == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *out_font = NULL;
+    if (fonts == NULL || font_num == 0 || font_num > D2_FONT_CHAIN_FONTS_MAX) {
+        ESP_LOGE(TAG, "Invalid param");
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (uint32_t i = 0; i < font_num; i++) {
+        if (fonts[i] == NULL) {
+            ESP_LOGE(TAG, "Invalid param");
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+    lv_font_t *font = heap_caps_calloc(1, sizeof(lv_font_t) + sizeof(d2_font_chain_t),
+                                       MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (font == NULL) {
+        ESP_LOGE(TAG, "malloc failed");
+        return ESP_ERR_NO_MEM;
+    }
+    d2_font_chain_t *chain = (d2_font_chain_t *)(font + 1);
+    memcpy(chain->fonts, fonts, font_num * sizeof(lv_font_t *));
+    chain->font_num = font_num;
+    if (chain_build_index(chain) != ESP_OK) {
+        ESP_LOGE(TAG, "malloc failed");
+        heap_caps_free(font);
+        return ESP_ERR_NO_MEM;
+    }
+
+    font->get_glyph_dsc = chain_get_glyph_dsc;
+    font->get_glyph_bitmap = chain_get_bitmap;
+    font->user_data = chain;
+    font->line_height = fonts[0]->line_height;
+    font->base_line = fonts[0]->base_line;
+    font->subpx = fonts[0]->subpx;
+    font->underline_position = fonts[0]->underline_position;
+    font->underline_thickness = fonts[0]->underline_thickness;
+
+    *out_font = font;
+    return ESP_OK;
+}
+
+void d2_font_chain_delete(lv_font_t *font)
+{
+    if (font == NULL) {
+        return;
+    }
+    d2_font_chain_t *chain = (d2_font_chain_t *)font->user_data;
+    heap_caps_free(chain->ranges);
+    heap_caps_free(font);
+}
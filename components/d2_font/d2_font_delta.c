@@ -0,0 +1,536 @@
+/*
+ * SPDX-FileCopyrightText: 2026 udoudou
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "d2_font_delta.h"
+
+#include "string.h"
+#include "sys/param.h"
+#include "mbedtls/sha256.h"
+#include "esp_partition.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+
+#include "d2_font_priv.h"
+
+#define DELTA_SECTOR_SIZE       4096
+#define DELTA_PATCH_VERSION     2
+#define DELTA_JOURNAL_VERSION   1
+
+static const char *TAG = "d2_font_delta";
+
+/*
+ * Patch layout, made by tools/d2_font/d2_font_delta.py:
+ *     d2_font_delta_header_bin_t
+ *     region_num * (d2_font_delta_region_bin_t, data[length] if the source is DELTA_REGION_DATA)
+ * Regions are sorted by offset and do not overlap. Regions with another source copy bytes of the old font that
+ * moved, e.g. the sections after a grown glyph index: every sector is staged from the old font before any is
+ * written, so the copies always read the old bytes.
+ */
+typedef struct {
+    char magic[6];                  /*"D2FtDp"*/
+    uint16_t version;
+    uint8_t base_sha256[32];        /*Trailer of the font the patch applies to*/
+    uint8_t new_sha256[32];         /*Trailer of the patched font*/
+    uint32_t new_size;              /*Size of the patched font, trailer included*/
+    uint32_t region_num;
+    uint8_t sha256[32];             /*Of this header up to here and the region headers, without their data*/
+} __attribute__((packed)) d2_font_delta_header_bin_t;
+
+#define DELTA_REGION_DATA       0xFFFFFFFF
+
+typedef struct {
+    uint32_t offset;
+    uint32_t length;
+    uint32_t source;                /*DELTA_REGION_DATA: the data follows, otherwise offset in the old font*/
+    uint8_t sha256[32];             /*Of the new data*/
+    // uint8_t data[length];
+} __attribute__((packed)) d2_font_delta_region_bin_t;
+
+/** Read a region header, return its data (NULL for a copy) and move `p` to the next region*/
+static const uint8_t *region_next(const uint8_t **p, d2_font_delta_region_bin_t *region)
+{
+    memcpy(region, *p, sizeof(*region));
+    *p += sizeof(*region);
+    if (region->source != DELTA_REGION_DATA) {
+        return NULL;
+    }
+    const uint8_t *data = *p;
+    *p += region->length;
+    return data;
+}
+
+/*
+ * Journal in the last sector of the partition. The staged sectors are stored right before it, in order:
+ *     [font ...][free][sector 0][sector 1]...[sector n-1][journal]
+ */
+typedef struct {
+    char magic[8];                  /*"D2FtJnl"*/
+    uint32_t version;
+    uint32_t sector_num;
+    uint8_t sectors_sha256[32];     /*Of the staged sectors, in order*/
+    uint8_t sha256[32];             /*Of this header up to here and the offsets, tells a torn write*/
+    // uint32_t offsets[sector_num];   /*Target of each staged sector*/
+} __attribute__((packed)) d2_font_delta_journal_bin_t;
+
+#define DELTA_JOURNAL_SECTOR_MAX ((DELTA_SECTOR_SIZE - sizeof(d2_font_delta_journal_bin_t)) / sizeof(uint32_t))
+
+static void journal_digest(const uint8_t *journal, uint8_t *sha256)
+{
+    const d2_font_delta_journal_bin_t *header = (const d2_font_delta_journal_bin_t *)journal;
+    mbedtls_sha256_context sha256_ctx;
+    mbedtls_sha256_init(&sha256_ctx);
+    mbedtls_sha256_starts(&sha256_ctx, false);
+    mbedtls_sha256_update(&sha256_ctx, journal, offsetof(d2_font_delta_journal_bin_t, sha256));
+    mbedtls_sha256_update(&sha256_ctx, journal + sizeof(d2_font_delta_journal_bin_t), header->sector_num * sizeof(uint32_t));
+    mbedtls_sha256_finish(&sha256_ctx, sha256);
+    mbedtls_sha256_free(&sha256_ctx);
+}
+
+/**
+ * Copy the staged sectors in place, then drop the journal.
+ * @param journal the journal sector, already checked
+ * @param buf two sectors of scratch memory
+ */
+static esp_err_t journal_replay(const esp_partition_t *partition, const uint8_t *journal, uint8_t *buf)
+{
+    esp_err_t err;
+    const d2_font_delta_journal_bin_t *header = (const d2_font_delta_journal_bin_t *)journal;
+    const uint32_t *offsets = (const uint32_t *)(journal + sizeof(d2_font_delta_journal_bin_t));
+    uint32_t journal_ofs = partition->size - DELTA_SECTOR_SIZE;
+    uint32_t slot_ofs = journal_ofs - header->sector_num * DELTA_SECTOR_SIZE;
+    uint8_t *readback = buf + DELTA_SECTOR_SIZE;
+
+    /*The staged sectors are complete if the header was written, check them anyway before erasing anything*/
+    uint8_t sha256_calc[32];
+    mbedtls_sha256_context sha256_ctx;
+    mbedtls_sha256_init(&sha256_ctx);
+    mbedtls_sha256_starts(&sha256_ctx, false);
+    for (uint32_t i = 0; i < header->sector_num; i++) {
+        err = esp_partition_read(partition, slot_ofs + i * DELTA_SECTOR_SIZE, buf, DELTA_SECTOR_SIZE);
+        if (err != ESP_OK) {
+            mbedtls_sha256_free(&sha256_ctx);
+            return err;
+        }
+        mbedtls_sha256_update(&sha256_ctx, buf, DELTA_SECTOR_SIZE);
+    }
+    mbedtls_sha256_finish(&sha256_ctx, sha256_calc);
+    mbedtls_sha256_free(&sha256_ctx);
+    if (memcmp(sha256_calc, header->sectors_sha256, 32) != 0) {
+        ESP_LOGE(TAG, "Journal data error");
+        return ESP_ERR_INVALID_CRC;
+    }
+
+    /*The font is about to change, it must be hashed again at the next load*/
+    err = d2_font_verify_cache_invalidate_partition(partition);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    for (uint32_t i = 0; i < header->sector_num; i++) {
+        err = esp_partition_read(partition, slot_ofs + i * DELTA_SECTOR_SIZE, buf, DELTA_SECTOR_SIZE);
+        if (err != ESP_OK) {
+            return err;
+        }
+        err = esp_partition_erase_range(partition, offsets[i], DELTA_SECTOR_SIZE);
+        if (err != ESP_OK) {
+            return err;
+        }
+        err = esp_partition_write(partition, offsets[i], buf, DELTA_SECTOR_SIZE);
+        if (err != ESP_OK) {
+            return err;
+        }
+        err = esp_partition_read(partition, offsets[i], readback, DELTA_SECTOR_SIZE);
+        if (err != ESP_OK) {
+            return err;
+        }
+        if (memcmp(buf, readback, DELTA_SECTOR_SIZE) != 0) {
+            ESP_LOGE(TAG, "Write verify error at 0x%" PRIx32, offsets[i]);
+            return ESP_ERR_INVALID_CRC;
+        }
+    }
+
+    return esp_partition_erase_range(partition, journal_ofs, DELTA_SECTOR_SIZE);
+}
+
+static esp_err_t journal_recover(const esp_partition_t *partition, uint8_t *buf)
+{
+    uint32_t journal_ofs = partition->size - DELTA_SECTOR_SIZE;
+    uint8_t *journal = buf;
+    esp_err_t err = esp_partition_read(partition, journal_ofs, journal, sizeof(d2_font_delta_journal_bin_t));
+    if (err != ESP_OK) {
+        return err;
+    }
+    const d2_font_delta_journal_bin_t *header = (const d2_font_delta_journal_bin_t *)journal;
+    if (memcmp(header->magic, "D2FtJnl", 8) != 0) {
+        return ESP_OK;
+    }
+
+    /*A torn header means the reset happened before anything was copied, or while dropping the journal*/
+    uint8_t sha256_calc[32];
+    bool valid = header->version == DELTA_JOURNAL_VERSION && header->sector_num <= DELTA_JOURNAL_SECTOR_MAX &&
+                 (header->sector_num + 1) * DELTA_SECTOR_SIZE <= partition->size;
+    if (valid) {
+        err = esp_partition_read(partition, journal_ofs, journal, DELTA_SECTOR_SIZE);
+        if (err != ESP_OK) {
+            return err;
+        }
+        journal_digest(journal, sha256_calc);
+        valid = memcmp(sha256_calc, header->sha256, 32) == 0;
+    }
+    if (!valid) {
+        ESP_LOGW(TAG, "Drop incomplete journal");
+        return esp_partition_erase_range(partition, journal_ofs, DELTA_SECTOR_SIZE);
+    }
+
+    ESP_LOGI(TAG, "Finish interrupted patch, %" PRIu32 " sectors", header->sector_num);
+    /*journal_replay needs a sector of scratch memory besides the journal*/
+    uint8_t *scratch = heap_caps_malloc(2 * DELTA_SECTOR_SIZE, MALLOC_CAP_8BIT);
+    if (scratch == NULL) {
+        ESP_LOGE(TAG, "malloc failed");
+        return ESP_ERR_NO_MEM;
+    }
+    err = journal_replay(partition, journal, scratch);
+    heap_caps_free(scratch);
+    return err;
+}
+
+/**
+ * Read the SHA-256 trailer of the font in a partition and get the font size.
+ */
+static esp_err_t read_trailer(const esp_partition_t *partition, uint8_t *sha256, uint32_t *size)
+{
+    uint16_t header_length;
+    uint32_t dsc_length;
+    esp_err_t err = esp_partition_read(partition, 0, &header_length, sizeof(header_length));
+    if (err != ESP_OK) {
+        return err;
+    }
+    err = esp_partition_read(partition, header_length, &dsc_length, sizeof(dsc_length));
+    if (err != ESP_OK) {
+        return err;
+    }
+    if ((uint64_t)header_length + dsc_length + 32 > partition->size) {
+        ESP_LOGE(TAG, "No valid font in partition");
+        return ESP_ERR_INVALID_VERSION;
+    }
+    *size = header_length + dsc_length + 32;
+    return esp_partition_read(partition, header_length + dsc_length, sha256, 32);
+}
+
+static esp_err_t check_patch(const uint8_t *patch, size_t size)
+{
+    const d2_font_delta_header_bin_t *header = (const d2_font_delta_header_bin_t *)patch;
+    if (size < sizeof(d2_font_delta_header_bin_t) || memcmp(header->magic, "D2FtDp", 6) != 0 ||
+            header->version != DELTA_PATCH_VERSION) {
+        ESP_LOGE(TAG, "Patch header error");
+        return ESP_ERR_INVALID_CRC;
+    }
+
+    const uint8_t *p = patch + sizeof(d2_font_delta_header_bin_t);
+    uint32_t last_end = 0;
+    uint8_t sha256_calc[32];
+    mbedtls_sha256_context sha256_ctx;
+    mbedtls_sha256_init(&sha256_ctx);
+    mbedtls_sha256_starts(&sha256_ctx, false);
+    mbedtls_sha256_update(&sha256_ctx, patch, offsetof(d2_font_delta_header_bin_t, sha256));
+    esp_err_t err = ESP_OK;
+    for (uint32_t i = 0; i < header->region_num && err == ESP_OK; i++) {
+        d2_font_delta_region_bin_t region;
+        if (p + sizeof(region) > patch + size) {
+            ESP_LOGE(TAG, "Patch truncated");
+            err = ESP_ERR_INVALID_CRC;
+            break;
+        }
+        memcpy(&region, p, sizeof(region));
+        bool data = region.source == DELTA_REGION_DATA;
+        if ((data && p + sizeof(region) + region.length > patch + size) || region.offset < last_end ||
+                (uint64_t)region.offset + region.length > header->new_size) {
+            ESP_LOGE(TAG, "Patch region %" PRIu32 " error", i);
+            err = ESP_ERR_INVALID_CRC;
+            break;
+        }
+        mbedtls_sha256_update(&sha256_ctx, p, sizeof(region));
+        const uint8_t *region_data = region_next(&p, &region);
+        /*Copies are checked against the old font by check_copies*/
+        if (region_data) {
+            mbedtls_sha256(region_data, region.length, sha256_calc, false);
+            if (memcmp(sha256_calc, region.sha256, 32) != 0) {
+                ESP_LOGE(TAG, "Patch region %" PRIu32 " SHA256 error", i);
+                err = ESP_ERR_INVALID_CRC;
+            }
+        }
+        last_end = region.offset + region.length;
+    }
+    mbedtls_sha256_finish(&sha256_ctx, sha256_calc);
+    mbedtls_sha256_free(&sha256_ctx);
+    /*The region headers tell where the checked data goes, they are checked too*/
+    if (err == ESP_OK && memcmp(sha256_calc, header->sha256, 32) != 0) {
+        ESP_LOGE(TAG, "Patch header SHA256 error");
+        err = ESP_ERR_INVALID_CRC;
+    }
+    return err;
+}
+
+/**
+ * Check that the bytes copied from the old font are the expected ones, before anything is staged.
+ * @param buf a sector of scratch memory
+ */
+static esp_err_t check_copies(const esp_partition_t *partition, const uint8_t *patch, uint32_t font_size, uint8_t *buf)
+{
+    const d2_font_delta_header_bin_t *header = (const d2_font_delta_header_bin_t *)patch;
+    const uint8_t *p = patch + sizeof(d2_font_delta_header_bin_t);
+    esp_err_t err = ESP_OK;
+
+    for (uint32_t i = 0; i < header->region_num && err == ESP_OK; i++) {
+        d2_font_delta_region_bin_t region;
+        if (region_next(&p, &region)) {
+            continue;
+        }
+        if ((uint64_t)region.source + region.length > font_size) {
+            ESP_LOGE(TAG, "Patch region %" PRIu32 " error", i);
+            return ESP_ERR_INVALID_CRC;
+        }
+        uint8_t sha256_calc[32];
+        mbedtls_sha256_context sha256_ctx;
+        mbedtls_sha256_init(&sha256_ctx);
+        mbedtls_sha256_starts(&sha256_ctx, false);
+        for (uint32_t ofs = 0; ofs < region.length && err == ESP_OK; ofs += DELTA_SECTOR_SIZE) {
+            uint32_t len = MIN(region.length - ofs, DELTA_SECTOR_SIZE);
+            err = esp_partition_read(partition, region.source + ofs, buf, len);
+            mbedtls_sha256_update(&sha256_ctx, buf, len);
+        }
+        mbedtls_sha256_finish(&sha256_ctx, sha256_calc);
+        mbedtls_sha256_free(&sha256_ctx);
+        if (err == ESP_OK && memcmp(sha256_calc, region.sha256, 32) != 0) {
+            ESP_LOGE(TAG, "Patch region %" PRIu32 " SHA256 error", i);
+            err = ESP_ERR_INVALID_CRC;
+        }
+    }
+    return err;
+}
+
+/**
+ * Stage every sector touched by the patch at the end of the partition, and write the journal header.
+ * @param buf two sectors of scratch memory
+ */
+static esp_err_t journal_write(const esp_partition_t *partition, const uint8_t *patch, uint32_t font_size, uint8_t *buf)
+{
+    esp_err_t err;
+    const d2_font_delta_header_bin_t *header = (const d2_font_delta_header_bin_t *)patch;
+    const uint8_t *regions = patch + sizeof(d2_font_delta_header_bin_t);
+    uint8_t *journal = buf + DELTA_SECTOR_SIZE;
+    d2_font_delta_journal_bin_t *journal_header = (d2_font_delta_journal_bin_t *)journal;
+    uint32_t *offsets = (uint32_t *)(journal + sizeof(d2_font_delta_journal_bin_t));
+
+    /*Sectors touched by the regions, in order*/
+    uint32_t sector_num = 0;
+    const uint8_t *p = regions;
+    for (uint32_t i = 0; i < header->region_num; i++) {
+        d2_font_delta_region_bin_t region;
+        region_next(&p, &region);
+        if (region.length == 0) {
+            continue;
+        }
+        uint32_t first = region.offset / DELTA_SECTOR_SIZE * DELTA_SECTOR_SIZE;
+        uint32_t last = (region.offset + region.length - 1) / DELTA_SECTOR_SIZE * DELTA_SECTOR_SIZE;
+        for (uint32_t ofs = first; ofs <= last; ofs += DELTA_SECTOR_SIZE) {
+            if (sector_num && offsets[sector_num - 1] == ofs) {
+                continue;
+            }
+            if (sector_num == DELTA_JOURNAL_SECTOR_MAX) {
+                ESP_LOGE(TAG, "Patch touches too many sectors");
+                return ESP_ERR_INVALID_SIZE;
+            }
+            offsets[sector_num++] = ofs;
+        }
+    }
+
+    uint32_t journal_ofs = partition->size - DELTA_SECTOR_SIZE;
+    uint32_t used = MAX(font_size, header->new_size);
+    used = (used + DELTA_SECTOR_SIZE - 1) / DELTA_SECTOR_SIZE * DELTA_SECTOR_SIZE;
+    if (journal_ofs < used || journal_ofs - used < sector_num * DELTA_SECTOR_SIZE) {
+        ESP_LOGE(TAG, "No room for the journal, %" PRIu32 " sectors needed", sector_num + 1);
+        return ESP_ERR_INVALID_SIZE;
+    }
+    uint32_t slot_ofs = journal_ofs - sector_num * DELTA_SECTOR_SIZE;
+
+    mbedtls_sha256_context sha256_ctx;
+    mbedtls_sha256_init(&sha256_ctx);
+    mbedtls_sha256_starts(&sha256_ctx, false);
+    err = esp_partition_erase_range(partition, slot_ofs, sector_num * DELTA_SECTOR_SIZE);
+    p = regions;
+    uint32_t region_index = 0;
+    for (uint32_t i = 0; i < sector_num && err == ESP_OK; i++) {
+        err = esp_partition_read(partition, offsets[i], buf, DELTA_SECTOR_SIZE);
+        if (err != ESP_OK) {
+            break;
+        }
+        /*Overlay the regions intersecting this sector. A region can span several sectors, so keep it for the next one*/
+        while (region_index < header->region_num) {
+            d2_font_delta_region_bin_t region;
+            const uint8_t *next = p;
+            const uint8_t *data = region_next(&next, &region);
+            uint32_t start = MAX(region.offset, offsets[i]);
+            uint32_t end = MIN(region.offset + region.length, offsets[i] + DELTA_SECTOR_SIZE);
+            if (region.offset >= offsets[i] + DELTA_SECTOR_SIZE) {
+                break;
+            }
+            if (start < end && data) {
+                memcpy(buf + start - offsets[i], data + start - region.offset, end - start);
+            } else if (start < end) {
+                /*Nothing is written in place yet, the old font is still whole*/
+                err = esp_partition_read(partition, region.source + start - region.offset, buf + start - offsets[i],
+                                         end - start);
+                if (err != ESP_OK) {
+                    break;
+                }
+            }
+            if (region.offset + region.length > offsets[i] + DELTA_SECTOR_SIZE) {
+                break;
+            }
+            p = next;
+            region_index++;
+        }
+        if (err != ESP_OK) {
+            break;
+        }
+        mbedtls_sha256_update(&sha256_ctx, buf, DELTA_SECTOR_SIZE);
+        err = esp_partition_write(partition, slot_ofs + i * DELTA_SECTOR_SIZE, buf, DELTA_SECTOR_SIZE);
+    }
+    mbedtls_sha256_finish(&sha256_ctx, journal_header->sectors_sha256);
+    mbedtls_sha256_free(&sha256_ctx);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    /*The patch takes effect once this header is written*/
+    memcpy(journal_header->magic, "D2FtJnl", 8);
+    journal_header->version = DELTA_JOURNAL_VERSION;
+    journal_header->sector_num = sector_num;
+    journal_digest(journal, journal_header->sha256);
+    err = esp_partition_erase_range(partition, journal_ofs, DELTA_SECTOR_SIZE);
+    if (err != ESP_OK) {
+        return err;
+    }
+    return esp_partition_write(partition, journal_ofs, journal, sizeof(d2_font_delta_journal_bin_t) + sector_num * sizeof(uint32_t));
+}
+
+/**
+ * Read back the patched regions and check their SHA-256.
+ */
+static esp_err_t check_regions(const esp_partition_t *partition, const uint8_t *patch, uint8_t *buf)
+{
+    const d2_font_delta_header_bin_t *header = (const d2_font_delta_header_bin_t *)patch;
+    const uint8_t *p = patch + sizeof(d2_font_delta_header_bin_t);
+    esp_err_t err = ESP_OK;
+
+    for (uint32_t i = 0; i < header->region_num && err == ESP_OK; i++) {
+        d2_font_delta_region_bin_t region;
+        region_next(&p, &region);
+
+        uint8_t sha256_calc[32];
+        mbedtls_sha256_context sha256_ctx;
+        mbedtls_sha256_init(&sha256_ctx);
+        mbedtls_sha256_starts(&sha256_ctx, false);
+        for (uint32_t ofs = 0; ofs < region.length && err == ESP_OK; ofs += DELTA_SECTOR_SIZE) {
+            uint32_t len = MIN(region.length - ofs, DELTA_SECTOR_SIZE);
+            err = esp_partition_read(partition, region.offset + ofs, buf, len);
+            mbedtls_sha256_update(&sha256_ctx, buf, len);
+        }
+        mbedtls_sha256_finish(&sha256_ctx, sha256_calc);
+        mbedtls_sha256_free(&sha256_ctx);
+        if (err == ESP_OK && memcmp(sha256_calc, region.sha256, 32) != 0) {
+            ESP_LOGE(TAG, "Region at 0x%" PRIx32 " verify error", region.offset);
+            err = ESP_ERR_INVALID_CRC;
+        }
+    }
+    return err;
+}
+
+esp_err_t d2_font_delta_recover(const char *label)
+{
+    if (label == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    const esp_partition_t *partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, label);
+    if (partition == NULL) {
+        ESP_LOGE(TAG, "Partition not found");
+        return ESP_ERR_NOT_FOUND;
+    }
+    uint8_t *buf = heap_caps_malloc(DELTA_SECTOR_SIZE, MALLOC_CAP_8BIT);
+    if (buf == NULL) {
+        ESP_LOGE(TAG, "malloc failed");
+        return ESP_ERR_NO_MEM;
+    }
+    esp_err_t err = journal_recover(partition, buf);
+    heap_caps_free(buf);
+    return err;
+}
+
+esp_err_t d2_font_delta_apply(const char *label, const uint8_t *patch, size_t size)
+{
+    if (label == NULL || patch == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    const esp_partition_t *partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, label);
+    if (partition == NULL) {
+        ESP_LOGE(TAG, "Partition not found");
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (partition->size < 2 * DELTA_SECTOR_SIZE) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    esp_err_t err = check_patch(patch, size);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    uint8_t *buf = heap_caps_malloc(2 * DELTA_SECTOR_SIZE, MALLOC_CAP_8BIT);
+    if (buf == NULL) {
+        ESP_LOGE(TAG, "malloc failed");
+        return ESP_ERR_NO_MEM;
+    }
+
+    err = journal_recover(partition, buf);
+    if (err != ESP_OK) {
+        goto exit;
+    }
+
+    const d2_font_delta_header_bin_t *header = (const d2_font_delta_header_bin_t *)patch;
+    uint8_t sha256[32];
+    uint32_t font_size;
+    err = read_trailer(partition, sha256, &font_size);
+    if (err != ESP_OK) {
+        goto exit;
+    }
+    if (memcmp(sha256, header->new_sha256, 32) == 0) {
+        ESP_LOGI(TAG, "Patch already applied");
+        goto exit;
+    }
+    if (memcmp(sha256, header->base_sha256, 32) != 0) {
+        ESP_LOGE(TAG, "Patch is made for another font");
+        err = ESP_ERR_INVALID_VERSION;
+        goto exit;
+    }
+
+    err = check_copies(partition, patch, font_size, buf);
+    if (err != ESP_OK) {
+        goto exit;
+    }
+    err = journal_write(partition, patch, font_size, buf);
+    if (err != ESP_OK) {
+        goto exit;
+    }
+    err = journal_recover(partition, buf);
+    if (err != ESP_OK) {
+        goto exit;
+    }
+    err = check_regions(partition, patch, buf);
+
+exit:
+    heap_caps_free(buf);
+    return err;
+}
@@ -4,33 +4,31 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 #include "d2_font_fmt_txt.h"
+#include "d2_font_priv.h"
 
+#include "string.h"
 #include "src/misc/lv_utils.h"
 
-#if LV_USE_FONT_COMPRESSED
-typedef enum {
-    D2_RLE_STATE_SINGLE = 0,
-    D2_RLE_STATE_REPEATED,
-    D2_RLE_STATE_COUNTER,
-} d2_font_fmt_rle_state_t;
-
-typedef struct {
-    uint32_t rdp;
-    const uint8_t * in;
-    uint8_t bpp;
-    uint8_t prev_v;
-    uint8_t count;
-    d2_font_fmt_rle_state_t state;
-} d2_font_fmt_rle_t;
-#endif /*LV_USE_FONT_COMPRESSED*/
-
 typedef struct {
     uint32_t gid_left;
     uint32_t gid_right;
 } kern_pair_ref_t;
 
 static uint32_t get_glyph_dsc_id(const lv_font_t * font, uint32_t letter, const d2_font_fmt_txt_cmap_t **cmap);
+static uint32_t find_glyph_dsc_id(const lv_font_t * font, uint32_t letter, const d2_font_fmt_txt_cmap_t **cmap);
+static void fill_glyph(const lv_font_t * font, uint32_t gid, const d2_font_fmt_txt_cmap_t *cmap, d2_font_fmt_txt_glyph_t *glyph);
+static const d2_font_fmt_txt_cmap_t *get_gid_cmap(const lv_font_t *font, uint32_t gid);
+static const d2_font_fmt_txt_glyph_dsc_t *get_gdsc(const lv_font_t *font, uint32_t gid);
+static void run_glyph_fill(const lv_font_t *font, uint32_t gid, const d2_font_fmt_txt_glyph_dsc_t *gdsc, int8_t kvalue,
+                           bool is_tab, d2_font_run_glyph_t *glyph);
 static int8_t get_kern_value(const lv_font_t * font, uint32_t gid_left, uint32_t gid_right);
+#if CONFIG_D2_FONT_TRACE
+static void trace_record(const lv_font_t *font, d2_font_trace_kind_t kind, uint32_t letter, uint32_t gid,
+                         const d2_font_fmt_txt_glyph_t *glyph);
+#endif
+#if CONFIG_D2_FONT_RUN_CACHE
+static const d2_font_run_glyph_t *run_follow(d2_font_fmt_txt_run_cache_t *cache, uint32_t letter, uint32_t letter_next);
+#endif
 #if LVGL_VERSION_MAJOR >= 9
 static int unicode_list_compare(const void * ref, const void * element);
 static int kern_pair_8_compare(const void * ref, const void * element);
@@ -44,7 +42,8 @@ static int32_t kern_pair_16_compare(const void * ref, const void * element);
 #endif
 
 #if LV_USE_FONT_COMPRESSED
-static void decompress(const uint8_t * in, uint8_t * out, int32_t w, int32_t h, uint8_t bpp, bool prefilter);
+static bool decompress(const lv_font_t *font, uint32_t caches, const uint8_t * in, uint8_t * out, int32_t w, int32_t h,
+                       uint8_t bpp, bool prefilter);
 static inline void decompress_line(d2_font_fmt_rle_t *rle, uint8_t * out, int32_t w);
 static inline void rle_init(d2_font_fmt_rle_t *rle, const uint8_t * in,  uint8_t bpp);
 static inline uint8_t rle_next(d2_font_fmt_rle_t *rle);
@@ -55,19 +54,105 @@ static inline void bits_write(uint8_t * out, uint32_t bit_pos, uint8_t val, uint
 
 #endif /*LV_USE_FONT_COMPRESSED*/
 
-#if LVGL_VERSION_MAJOR >= 9
 static const uint8_t opa4_table[16] = {0,  17, 34,  51,
                                        68, 85, 102, 119,
                                        136, 153, 170, 187,
                                        204, 221, 238, 255
                                       };
 
-#if LV_USE_FONT_COMPRESSED
 static const uint8_t opa3_table[8] = {0, 36, 73, 109, 146, 182, 218, 255};
-#endif
 
 static const uint8_t opa2_table[4] = {0, 85, 170, 255};
-#include <stdio.h>
+
+static const uint8_t opa1_table[2] = {0, 255};
+
+static void plain3_expand(const uint8_t *bitmap, uint32_t pos, uint32_t num, uint8_t *out);
+static void plain4_expand(const uint8_t *bitmap, uint32_t pos, uint32_t num, uint8_t *out);
+#if LVGL_VERSION_MAJOR < 9
+static void plain3_to_4bpp(const uint8_t *bitmap, uint32_t num, uint8_t *out);
+#endif
+
+#if LVGL_VERSION_MAJOR >= 9
+static void decode_plain(const d2_font_fmt_txt_dsc_t *fdsc, const d2_font_fmt_txt_glyph_dsc_t *gdsc,
+                         const uint8_t *bitmap_in, uint8_t *bitmap_out);
+
+/**
+ * Get a glyph already decoded in RAM, pinned, decoded after a frame over budget, or prefetched.
+ * @return the draw buffer of the glyph, or NULL
+ */
+static const void *get_bitmap_decoded(const lv_font_t *font, uint32_t letter, lv_draw_buf_t * draw_buf)
+{
+    d2_font_context_t *ctx = (d2_font_context_t *)font->user_data;
+
+    const void *decoded = NULL;
+
+    /*Glyphs pinned by `d2_font_preload_utf8` are served without touching the font data*/
+    if (ctx->pin.num) {
+        uint32_t pos;
+        if (d2_font_fmt_txt_pin_find(&ctx->pin, letter, &pos)) {
+            decoded = &ctx->pin.glyphs[pos].draw_buf;
+        }
+    }
+#if CONFIG_D2_FONT_FRAME_BUDGET
+    /*Glyphs deferred by the frame budget, decoded after their frame*/
+    if (decoded == NULL && ctx->ext->budget) {
+        decoded = d2_font_budget_take(font, letter);
+    }
+#endif
+#if CONFIG_D2_FONT_PREFETCH
+    /*Glyphs decoded ahead by the prefetch task*/
+    if (decoded == NULL && ctx->ext->prefetch) {
+        decoded = d2_font_prefetch_take(font, letter);
+    }
+#endif
+#if CONFIG_D2_FONT_TRACE
+    if (decoded && ctx->ext->trace) {
+        trace_record(font, D2_FONT_TRACE_BITMAP_RAM, letter, 0, NULL);
+    }
+#endif
+    return decoded;
+}
+
+const void *d2_font_get_bitmap_area_fmt_txt(lv_font_glyph_dsc_t * g_dsc, lv_draw_buf_t * draw_buf, const lv_area_t *area)
+{
+    const lv_font_t *font = g_dsc->resolved_font;
+    uint32_t letter = g_dsc->gid.index;
+
+    const void *decoded = get_bitmap_decoded(font, letter, draw_buf);
+    if (decoded) {
+        return decoded;
+    }
+    d2_font_fmt_txt_glyph_t glyph;
+    if (!d2_font_fmt_txt_resolve_glyph(font, letter, &glyph) || glyph.gdsc->box_w == 0 || glyph.gdsc->box_h == 0) {
+        return NULL;
+    }
+#if CONFIG_D2_FONT_TRACE || CONFIG_D2_FONT_FRAME_BUDGET
+    d2_font_context_t *ctx = (d2_font_context_t *)font->user_data;
+#endif
+#if CONFIG_D2_FONT_TRACE
+    if (ctx->ext->trace) {
+        trace_record(font, D2_FONT_TRACE_BITMAP, letter, glyph.glyph_id, &glyph);
+    }
+#endif
+#if CONFIG_D2_FONT_FRAME_BUDGET
+    if (ctx->ext->budget && !d2_font_budget_begin(font, letter, glyph.gdsc, draw_buf->data)) {
+        lv_draw_buf_flush_cache(draw_buf, NULL);
+        return draw_buf;
+    }
+#endif
+    uint32_t stride = lv_draw_buf_width_to_stride(glyph.gdsc->box_w, LV_COLOR_FORMAT_A8);
+    if (!d2_font_fmt_txt_decode_a8_area(font, &glyph, area, draw_buf->data, stride)) {
+        return NULL;
+    }
+#if CONFIG_D2_FONT_FRAME_BUDGET
+    if (ctx->ext->budget) {
+        d2_font_budget_end(font);
+    }
+#endif
+    lv_draw_buf_flush_cache(draw_buf, NULL);
+    return draw_buf;
+}
+
 const void *d2_font_get_bitmap_fmt_txt(lv_font_glyph_dsc_t * g_dsc, lv_draw_buf_t * draw_buf)
 #else
 const uint8_t * d2_font_get_bitmap_fmt_txt(const lv_font_t * font, uint32_t letter)
@@ -75,126 +160,74 @@ const uint8_t * d2_font_get_bitmap_fmt_txt(const lv_font_t * font, uint32_t lett
 {
 #if LVGL_VERSION_MAJOR >= 9
     const lv_font_t *font = g_dsc->resolved_font;
-#endif
-    d2_font_context_t *ctx = (d2_font_context_t *)font->user_data;
-
-    d2_font_fmt_txt_dsc_t * fdsc = (d2_font_fmt_txt_dsc_t *)(ctx->base_ptr + (uint32_t)font->dsc);
-#if LVGL_VERSION_MAJOR >= 9
     uint32_t letter = g_dsc->gid.index;
+
+    const void *decoded = get_bitmap_decoded(font, letter, draw_buf);
+    if (decoded) {
+        return decoded;
+    }
 #endif
-    const d2_font_fmt_txt_cmap_t * cmap;
-    uint32_t gid = get_glyph_dsc_id(font, letter, &cmap);
-    if (!gid) {
+    d2_font_fmt_txt_glyph_t glyph;
+    if (!d2_font_fmt_txt_resolve_glyph(font, letter, &glyph)) {
         return NULL;
     }
 
-    const d2_font_fmt_txt_glyph_index_t *gindex = (d2_font_fmt_txt_glyph_index_t *)(ctx->base_ptr + (uint32_t)fdsc->glyph_index) + gid;
-    const d2_font_fmt_txt_glyph_dsc_t *gdsc = (d2_font_fmt_txt_glyph_dsc_t *)(ctx->base_ptr + (uint32_t)fdsc->glyph_dsc) + gindex->dsc_index;
-    const uint8_t * bitmap_in = (uint8_t*)(ctx->base_ptr + (uint32_t)fdsc->glyph_bitmap) + cmap->glyph_bitmap_index_base + gindex->bitmap_index_offset;
+    const d2_font_fmt_txt_glyph_dsc_t *gdsc = glyph.gdsc;
 
 #if LVGL_VERSION_MAJOR >= 10    //todo
     if (g_dsc->req_raw_bitmap) {
-        return bitmap_in;
+        return glyph.bitmap;
     }
-#endif
-#if LVGL_VERSION_MAJOR >= 9
-    uint8_t * bitmap_out = draw_buf->data;
 #endif
     int32_t gsize = (int32_t) gdsc->box_w * gdsc->box_h;
     if (gsize == 0) {
         return NULL;
     }
 
-    if (fdsc->bitmap_format == D2_FONT_FMT_TXT_PLAIN) {
+#if CONFIG_D2_FONT_TRACE || CONFIG_D2_FONT_FRAME_BUDGET || LVGL_VERSION_MAJOR < 9
+    d2_font_context_t *ctx = (d2_font_context_t *)font->user_data;
+#endif
+#if CONFIG_D2_FONT_TRACE
+    if (ctx->ext->trace) {
+        trace_record(font, D2_FONT_TRACE_BITMAP, letter, glyph.glyph_id, &glyph);
+    }
+#endif
 #if LVGL_VERSION_MAJOR >= 9
-        uint8_t * bitmap_out_tmp = bitmap_out;
-        int32_t i = 0;
-        int32_t x, y;
-        uint32_t stride_out = lv_draw_buf_width_to_stride(gdsc->box_w, LV_COLOR_FORMAT_A8);
-        if (fdsc->bpp == 1) {
-            for (y = 0; y < gdsc->box_h; y ++) {
-                for (x = 0; x < gdsc->box_w; x++, i++) {
-                    i = i & 0x7;
-                    if (i == 0) {
-                        bitmap_out_tmp[x] = (*bitmap_in) & 0x80 ? 0xff : 0x00;
-                    } else if (i == 1) {
-                        bitmap_out_tmp[x] = (*bitmap_in) & 0x40 ? 0xff : 0x00;
-                    } else if (i == 2) {
-                        bitmap_out_tmp[x] = (*bitmap_in) & 0x20 ? 0xff : 0x00;
-                    } else if (i == 3) {
-                        bitmap_out_tmp[x] = (*bitmap_in) & 0x10 ? 0xff : 0x00;
-                    } else if (i == 4) {
-                        bitmap_out_tmp[x] = (*bitmap_in) & 0x08 ? 0xff : 0x00;
-                    } else if (i == 5) {
-                        bitmap_out_tmp[x] = (*bitmap_in) & 0x04 ? 0xff : 0x00;
-                    } else if (i == 6) {
-                        bitmap_out_tmp[x] = (*bitmap_in) & 0x02 ? 0xff : 0x00;
-                    } else if (i == 7) {
-                        bitmap_out_tmp[x] = (*bitmap_in) & 0x01 ? 0xff : 0x00;
-                        bitmap_in++;
-                    }
-                }
-                bitmap_out_tmp += stride_out;
-            }
-        } else if (fdsc->bpp == 2) {
-            for (y = 0; y < gdsc->box_h; y ++) {
-                for (x = 0; x < gdsc->box_w; x++, i++) {
-                    i = i & 0x3;
-                    if (i == 0) {
-                        bitmap_out_tmp[x] = opa2_table[(*bitmap_in) >> 6];
-                    } else if (i == 1) {
-                        bitmap_out_tmp[x] = opa2_table[((*bitmap_in) >> 4) & 0x3];
-                    } else if (i == 2) {
-                        bitmap_out_tmp[x] = opa2_table[((*bitmap_in) >> 2) & 0x3];
-                    } else if (i == 3) {
-                        bitmap_out_tmp[x] = opa2_table[((*bitmap_in) >> 0) & 0x3];
-                        bitmap_in++;
-                    }
-                }
-
-                bitmap_out_tmp += stride_out;
-            }
-
-        } else if (fdsc->bpp == 4) {
-            for (y = 0; y < gdsc->box_h; y ++) {
-                for (x = 0; x < gdsc->box_w; x++, i++) {
-                    i = i & 0x1;
-                    if (i == 0) {
-                        bitmap_out_tmp[x] = opa4_table[(*bitmap_in) >> 4];
-                    } else if (i == 1) {
-                        bitmap_out_tmp[x] = opa4_table[(*bitmap_in) & 0xF];
-                        bitmap_in++;
-                    }
-                }
-                bitmap_out_tmp += stride_out;
-            }
-        } else if (fdsc->bpp == 8) {
-            for (y = 0; y < gdsc->box_h; y ++) {
-                for (x = 0; x < gdsc->box_w; x++, i++) {
-                    bitmap_out_tmp[x] = *bitmap_in;
-                    bitmap_in++;
-                }
-                bitmap_out_tmp += stride_out;
-            }
-        }
-
+#if CONFIG_D2_FONT_FRAME_BUDGET
+    /*Over budget, a placeholder is drawn and the glyph is decoded after the frame*/
+    if (ctx->ext->budget && !d2_font_budget_begin(font, letter, gdsc, draw_buf->data)) {
         lv_draw_buf_flush_cache(draw_buf, NULL);
         return draw_buf;
+    }
+#endif
+    /*Pinned glyphs are only drawn from the bitmap callback, which is done with the glyph before*/
+    if (!d2_font_fmt_txt_decode_a8(font, &glyph, draw_buf->data,
+                                   D2_FONT_SHRINK_RETRY_TILES | D2_FONT_SHRINK_RETRY_PINNED)) {
+        return NULL;
+    }
+#if CONFIG_D2_FONT_FRAME_BUDGET
+    if (ctx->ext->budget) {
+        d2_font_budget_end(font);
+    }
+#endif
+    lv_draw_buf_flush_cache(draw_buf, NULL);
+    return draw_buf;
 #else
+    d2_font_fmt_txt_dsc_t * fdsc = (d2_font_fmt_txt_dsc_t *)(ctx->base_ptr + (uint32_t)font->dsc);
+    const uint8_t * bitmap_in = glyph.bitmap;
+    bool plain = fdsc->bitmap_format == D2_FONT_FMT_TXT_PLAIN;
+    /*LVGL v8 draws 3 bpp bitmaps as 4 bpp, the other plain bitmaps are drawn from the font data*/
+    if (plain && fdsc->bpp != 3) {
         return bitmap_in;
-#endif
     }
-    /*Handle compressed bitmap*/
+    /*Handle 3 bpp and compressed bitmaps*/
     else {
-#if LV_USE_FONT_COMPRESSED
-#if LVGL_VERSION_MAJOR < 9
-        static uint8_t *bitmap_out = NULL;
-        static size_t last_buf_size = 0;
-        uint32_t gsize = gdsc->box_w * gdsc->box_h;
-        if (gsize == 0) {
+#if !LV_USE_FONT_COMPRESSED
+        if (!plain) {
+            // LV_LOG_WARN("Compressed fonts is used but LV_USE_FONT_COMPRESSED is not enabled in lv_conf.h");
             return NULL;
         }
-
+#endif
         uint32_t buf_size = gsize;
         /*Compute memory size needed to hold decompressed glyph, rounding up*/
         switch (fdsc->bpp) {
@@ -212,52 +245,636 @@ const uint8_t * d2_font_get_bitmap_fmt_txt(const lv_font_t * font, uint32_t lett
             break;
         }
 
-        if (last_buf_size < buf_size) {
-            uint8_t * tmp = lv_mem_realloc(bitmap_out, buf_size);
-            LV_ASSERT_MALLOC(tmp);
+        if (ctx->ext->bitmap_out_size < buf_size) {
+            uint32_t caches = D2_FONT_SHRINK_RETRY_TILES | D2_FONT_SHRINK_RETRY_PINNED;
+            uint8_t * tmp = d2_font_mem_realloc(&ctx->mem, D2_FONT_MEM_SCRATCH, ctx->ext->bitmap_out, ctx->ext->bitmap_out_size,
+                                                buf_size);
+            while (tmp == NULL && d2_font_shrink_retry(font, &caches)) {
+                tmp = d2_font_mem_realloc(&ctx->mem, D2_FONT_MEM_SCRATCH, ctx->ext->bitmap_out, ctx->ext->bitmap_out_size,
+                                          buf_size);
+            }
             if (tmp == NULL) {
                 return NULL;
             }
-            bitmap_out = tmp;
-            last_buf_size = buf_size;
+            ctx->ext->bitmap_out = tmp;
+            ctx->ext->bitmap_out_size = buf_size;
         }
-#endif
+        if (plain) {
+            plain3_to_4bpp(bitmap_in, gsize, ctx->ext->bitmap_out);
+            return ctx->ext->bitmap_out;
+        }
+#if LV_USE_FONT_COMPRESSED
         bool prefilter = fdsc->bitmap_format == D2_FONT_FMT_TXT_COMPRESSED;
-        decompress(bitmap_in, bitmap_out, gdsc->box_w, gdsc->box_h,
-                   (uint8_t)fdsc->bpp, prefilter);
-#if LVGL_VERSION_MAJOR >= 9
-        lv_draw_buf_flush_cache(draw_buf, NULL);
-        return draw_buf;
-#else
-        return bitmap_out;
+        if (!decompress(font, D2_FONT_SHRINK_RETRY_TILES | D2_FONT_SHRINK_RETRY_PINNED, bitmap_in, ctx->ext->bitmap_out,
+                        gdsc->box_w, gdsc->box_h, (uint8_t)fdsc->bpp, prefilter)) {
+            return NULL;
+        }
+        return ctx->ext->bitmap_out;
+#endif
+    }
+#endif
+}
+
+#if CONFIG_D2_FONT_ASCII_TABLE
+/**
+ * Resolve a letter from the ASCII table of a font.
+ * @return true: the letter is in the table's range, `*found` tells if the font has it
+ */
+static inline bool ascii_resolve(const lv_font_t *font, uint32_t letter, d2_font_fmt_txt_glyph_t *glyph, bool *found)
+{
+    const d2_font_fmt_txt_ascii_t *ascii = ((d2_font_context_t *)font->user_data)->ext->ascii;
+    uint32_t index = letter - D2_FONT_ASCII_FIRST;
+    if (ascii == NULL || index >= D2_FONT_ASCII_NUM) {
+        return false;
+    }
+    glyph->glyph_id = ascii->glyphs[index].glyph_id;
+    glyph->gdsc = &ascii->glyphs[index].dsc;
+    glyph->bitmap = ascii->glyphs[index].bitmap;
+    *found = glyph->glyph_id != 0;
+    return true;
+}
 #endif
+
+bool d2_font_fmt_txt_resolve_glyph(const lv_font_t *font, uint32_t letter, d2_font_fmt_txt_glyph_t *glyph)
+{
+    if (!d2_font_fmt_txt_mapped(font)) {
+        return false;
+    }
+#if CONFIG_D2_FONT_ASCII_TABLE
+    bool found;
+    if (ascii_resolve(font, letter, glyph, &found)) {
+        return found;
+    }
+#endif
+    const d2_font_fmt_txt_cmap_t * cmap;
+    uint32_t gid = get_glyph_dsc_id(font, letter, &cmap);
+    if (!gid) {
+        return false;
+    }
+    fill_glyph(font, gid, cmap, glyph);
+    return true;
+}
+
+bool d2_font_fmt_txt_resolve_glyph_nocache(const lv_font_t *font, uint32_t letter, d2_font_fmt_txt_glyph_t *glyph)
+{
+    if (!d2_font_fmt_txt_mapped(font)) {
+        return false;
+    }
+#if CONFIG_D2_FONT_ASCII_TABLE
+    bool found;
+    if (ascii_resolve(font, letter, glyph, &found)) {
+        return found;
+    }
+#endif
+    const d2_font_fmt_txt_cmap_t * cmap;
+    uint32_t gid = letter ? find_glyph_dsc_id(font, letter, &cmap) : 0;
+    if (!gid) {
+        return false;
+    }
+    fill_glyph(font, gid, cmap, glyph);
+    return true;
+}
+
+static void fill_glyph(const lv_font_t * font, uint32_t gid, const d2_font_fmt_txt_cmap_t *cmap, d2_font_fmt_txt_glyph_t *glyph)
+{
+    d2_font_context_t *ctx = (d2_font_context_t *)font->user_data;
+    d2_font_fmt_txt_dsc_t * fdsc = (d2_font_fmt_txt_dsc_t *)(ctx->base_ptr + (uint32_t)font->dsc);
+
+    uint32_t dsc_index;
+    uint32_t bitmap_offset;
+    if (ctx->wide_index) {
+        const d2_font_fmt_txt_glyph_index_wide_t *gindex = (d2_font_fmt_txt_glyph_index_wide_t *)(ctx->base_ptr + (uint32_t)fdsc->glyph_index) + gid;
+        dsc_index = gindex->dsc_index;
+        bitmap_offset = gindex->bitmap_index_offset;
+    } else {
+        const d2_font_fmt_txt_glyph_index_t *gindex = (d2_font_fmt_txt_glyph_index_t *)(ctx->base_ptr + (uint32_t)fdsc->glyph_index) + gid;
+        dsc_index = gindex->dsc_index;
+        bitmap_offset = cmap->glyph_bitmap_index_base + gindex->bitmap_index_offset;
+    }
+    glyph->glyph_id = gid;
+    glyph->gdsc = (d2_font_fmt_txt_glyph_dsc_t *)(ctx->base_ptr + (uint32_t)fdsc->glyph_dsc) + dsc_index;
+    glyph->bitmap = (uint8_t*)(ctx->base_ptr + (uint32_t)fdsc->glyph_bitmap) + bitmap_offset;
+}
+
+#if CONFIG_D2_FONT_TRACE
+/**
+ * Append an event to the trace ring of the font.
+ * @param glyph the glyph, `D2_FONT_TRACE_BITMAP` only
+ */
+static void trace_record(const lv_font_t *font, d2_font_trace_kind_t kind, uint32_t letter, uint32_t gid,
+                         const d2_font_fmt_txt_glyph_t *glyph)
+{
+    d2_font_context_t *ctx = (d2_font_context_t *)font->user_data;
+    d2_font_fmt_txt_dsc_t * fdsc = (d2_font_fmt_txt_dsc_t *)(ctx->base_ptr + (uint32_t)font->dsc);
+    d2_font_trace_t *trace = ctx->ext->trace;
+    d2_font_trace_event_t *event = &trace->events[trace->total++ % CONFIG_D2_FONT_TRACE_EVENTS];
+
+    event->letter = letter;
+    event->kind = kind;
+    event->reserved = 0;
+    event->glyph_id = gid;
+    event->bitmap_ofs = 0;
+    event->bitmap_len = 0;
+    if (glyph) {
+        event->bitmap_ofs = glyph->bitmap - ((const uint8_t *)ctx->base_ptr + (uint32_t)fdsc->glyph_bitmap);
+        /*The end of a compressed bitmap is only known once it is decoded*/
+        if (fdsc->bitmap_format == D2_FONT_FMT_TXT_PLAIN) {
+            event->bitmap_len = ((uint32_t)glyph->gdsc->box_w * glyph->gdsc->box_h * fdsc->bpp + 7) >> 3;
+        }
+    }
+}
+#endif
+
+bool d2_font_fmt_txt_pin_find(const d2_font_fmt_txt_pin_t *pin, uint32_t letter, uint32_t *pos)
+{
+    uint32_t low = 0;
+    uint32_t high = pin->num;
+    while (low < high) {
+        uint32_t mid = (low + high) >> 1;
+        if (pin->glyphs[mid].unicode_letter < letter) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    *pos = low;
+    return low < pin->num && pin->glyphs[low].unicode_letter == letter;
+}
+
+bool d2_font_fmt_txt_rows_init(const lv_font_t *font, const d2_font_fmt_txt_glyph_t *glyph, d2_font_fmt_txt_rows_t *rows)
+{
+    d2_font_context_t *ctx = (d2_font_context_t *)font->user_data;
+    d2_font_fmt_txt_dsc_t * fdsc = (d2_font_fmt_txt_dsc_t *)(ctx->base_ptr + (uint32_t)font->dsc);
+
+    rows->bitmap = glyph->bitmap;
+    rows->bit_pos = 0;
+    rows->box_w = glyph->gdsc->box_w;
+    rows->row = 0;
+    rows->bpp = (uint8_t)fdsc->bpp;
+    rows->bitmap_format = fdsc->bitmap_format;
+    switch (rows->bpp) {
+    case 1:
+        rows->opa_table = opa1_table;
+        break;
+    case 2:
+        rows->opa_table = opa2_table;
+        break;
+    case 3:
+        rows->opa_table = opa3_table;
+        break;
+    case 4:
+        rows->opa_table = opa4_table;
+        break;
+    case 8:
+        rows->opa_table = NULL;
+        break;
+    default:
+        return false;
+    }
+
+    if (rows->bitmap_format == D2_FONT_FMT_TXT_PLAIN) {
+        return true;
+    }
+#if LV_USE_FONT_COMPRESSED
+    if (rows->bpp == 8) {
+        return false;
+    }
+    rle_init(&rows->rle, glyph->bitmap, rows->bpp);
+    return true;
 #else /*!LV_USE_FONT_COMPRESSED*/
-        // LV_LOG_WARN("Compressed fonts is used but LV_USE_FONT_COMPRESSED is not enabled in lv_conf.h");
-        return NULL;
+    return false;
+#endif
+}
+
+#if LV_USE_FONT_COMPRESSED
+/** Decode the next compressed row to `rows->line`, one raw value per byte*/
+static void rows_decompress(d2_font_fmt_txt_rows_t *rows)
+{
+    if (rows->bitmap_format == D2_FONT_FMT_TXT_COMPRESSED && rows->row) {
+        uint8_t line[256];
+        decompress_line(&rows->rle, line, rows->box_w);
+        for (int32_t x = 0; x < rows->box_w; x++) {
+            rows->line[x] ^= line[x];
+        }
+    } else {
+        decompress_line(&rows->rle, rows->line, rows->box_w);
+    }
+}
 #endif
+
+void d2_font_fmt_txt_rows_skip(d2_font_fmt_txt_rows_t *rows, uint32_t num)
+{
+    if (rows->bitmap_format == D2_FONT_FMT_TXT_PLAIN) {
+        /*Rows of plain bitmaps are not padded, seek straight to the row*/
+        rows->bit_pos += num * rows->box_w * rows->bpp;
+        rows->row += num;
+        return;
     }
+#if LV_USE_FONT_COMPRESSED
+    for (uint32_t i = 0; i < num; i++) {
+        rows_decompress(rows);
+        rows->row++;
+    }
+#endif
+}
 
-    /*If not returned earlier then the letter is not found in this font*/
-    return NULL;
+bool d2_font_fmt_txt_decode_a8_area(const lv_font_t *font, const d2_font_fmt_txt_glyph_t *glyph, const lv_area_t *area,
+                                    uint8_t *bitmap_out, uint32_t stride)
+{
+    int32_t x_start = LV_MAX(area->x1, 0);
+    int32_t x_end = LV_MIN(area->x2 + 1, glyph->gdsc->box_w);
+    int32_t y_start = LV_MAX(area->y1, 0);
+    int32_t y_end = LV_MIN(area->y2 + 1, glyph->gdsc->box_h);
+    d2_font_fmt_txt_rows_t rows;
+    if (!d2_font_fmt_txt_rows_init(font, glyph, &rows)) {
+        return false;
+    }
+    if (x_start >= x_end || y_start >= y_end) {
+        return true;
+    }
+
+    d2_font_fmt_txt_rows_skip(&rows, y_start);
+    bitmap_out += y_start * stride + x_start;
+    for (int32_t y = y_start; y < y_end; y++) {
+        d2_font_fmt_txt_rows_read(&rows, x_start, x_end, bitmap_out);
+        bitmap_out += stride;
+    }
+    /*Compressed rows below the area are never decoded*/
+    return true;
 }
 
+void d2_font_fmt_txt_rows_read(d2_font_fmt_txt_rows_t *rows, int32_t x_start, int32_t x_end, uint8_t *out)
+{
+    const uint8_t *opa_table = rows->opa_table;
+    int32_t x;
+    if (rows->bitmap_format == D2_FONT_FMT_TXT_PLAIN) {
+        uint8_t bpp = rows->bpp;
+        uint8_t mask = (uint8_t)((1 << bpp) - 1);
+        uint32_t bit_pos = rows->bit_pos + x_start * bpp;
+        if (opa_table == NULL) {
+            memcpy(out, rows->bitmap + (bit_pos >> 3), x_end - x_start);
+        } else if (bpp == 3) {
+            plain3_expand(rows->bitmap, bit_pos / 3, x_end - x_start, out);
+        } else if (bpp == 4) {
+            plain4_expand(rows->bitmap, bit_pos / 4, x_end - x_start, out);
+        } else {
+            for (x = x_start; x < x_end; x++, bit_pos += bpp) {
+                /*Pixels never cross a byte boundary with 1 and 2 bpp*/
+                uint8_t shift = 8 - bpp - (bit_pos & 0x7);
+                *out++ = opa_table[(rows->bitmap[bit_pos >> 3] >> shift) & mask];
+            }
+        }
+        rows->bit_pos += rows->box_w * bpp;
+        rows->row++;
+        return;
+    }
+#if LV_USE_FONT_COMPRESSED
+    /*The RLE stream has to be decoded for the whole row, only the visible columns are converted*/
+    rows_decompress(rows);
+    rows->row++;
+    for (x = x_start; x < x_end; x++) {
+        *out++ = opa_table[rows->line[x]];
+    }
+#endif
+}
+
+#if LVGL_VERSION_MAJOR >= 9
+bool d2_font_fmt_txt_decode_a8(const lv_font_t *font, const d2_font_fmt_txt_glyph_t *glyph, uint8_t *bitmap_out,
+                               uint32_t caches)
+{
+    d2_font_context_t *ctx = (d2_font_context_t *)font->user_data;
+    d2_font_fmt_txt_dsc_t * fdsc = (d2_font_fmt_txt_dsc_t *)(ctx->base_ptr + (uint32_t)font->dsc);
+
+    if (fdsc->bitmap_format == D2_FONT_FMT_TXT_PLAIN) {
+        decode_plain(fdsc, glyph->gdsc, glyph->bitmap, bitmap_out);
+        return true;
+    }
+#if LV_USE_FONT_COMPRESSED
+    bool prefilter = fdsc->bitmap_format == D2_FONT_FMT_TXT_COMPRESSED;
+    return decompress(font, caches, glyph->bitmap, bitmap_out, glyph->gdsc->box_w, glyph->gdsc->box_h,
+                      (uint8_t)fdsc->bpp, prefilter);
+#else /*!LV_USE_FONT_COMPRESSED*/
+    // LV_LOG_WARN("Compressed fonts is used but LV_USE_FONT_COMPRESSED is not enabled in lv_conf.h");
+    return false;
+#endif
+}
+
+/**
+ * Expand a plain glyph bitmap to A8
+ * @param fdsc font descriptor, supplies the bpp
+ * @param gdsc the glyph to expand
+ * @param bitmap_in the packed bitmap in the font data
+ * @param bitmap_out A8 buffer, one line is `lv_draw_buf_width_to_stride(box_w)` bytes
+ */
+static void decode_plain(const d2_font_fmt_txt_dsc_t *fdsc, const d2_font_fmt_txt_glyph_dsc_t *gdsc,
+                         const uint8_t *bitmap_in, uint8_t *bitmap_out)
+{
+    uint8_t * bitmap_out_tmp = bitmap_out;
+    int32_t i = 0;
+    int32_t x, y;
+    uint32_t stride_out = lv_draw_buf_width_to_stride(gdsc->box_w, LV_COLOR_FORMAT_A8);
+    if (fdsc->bpp == 1) {
+        for (y = 0; y < gdsc->box_h; y ++) {
+            for (x = 0; x < gdsc->box_w; x++, i++) {
+                i = i & 0x7;
+                if (i == 0) {
+                    bitmap_out_tmp[x] = (*bitmap_in) & 0x80 ? 0xff : 0x00;
+                } else if (i == 1) {
+                    bitmap_out_tmp[x] = (*bitmap_in) & 0x40 ? 0xff : 0x00;
+                } else if (i == 2) {
+                    bitmap_out_tmp[x] = (*bitmap_in) & 0x20 ? 0xff : 0x00;
+                } else if (i == 3) {
+                    bitmap_out_tmp[x] = (*bitmap_in) & 0x10 ? 0xff : 0x00;
+                } else if (i == 4) {
+                    bitmap_out_tmp[x] = (*bitmap_in) & 0x08 ? 0xff : 0x00;
+                } else if (i == 5) {
+                    bitmap_out_tmp[x] = (*bitmap_in) & 0x04 ? 0xff : 0x00;
+                } else if (i == 6) {
+                    bitmap_out_tmp[x] = (*bitmap_in) & 0x02 ? 0xff : 0x00;
+                } else if (i == 7) {
+                    bitmap_out_tmp[x] = (*bitmap_in) & 0x01 ? 0xff : 0x00;
+                    bitmap_in++;
+                }
+            }
+            bitmap_out_tmp += stride_out;
+        }
+    } else if (fdsc->bpp == 2) {
+        for (y = 0; y < gdsc->box_h; y ++) {
+            for (x = 0; x < gdsc->box_w; x++, i++) {
+                i = i & 0x3;
+                if (i == 0) {
+                    bitmap_out_tmp[x] = opa2_table[(*bitmap_in) >> 6];
+                } else if (i == 1) {
+                    bitmap_out_tmp[x] = opa2_table[((*bitmap_in) >> 4) & 0x3];
+                } else if (i == 2) {
+                    bitmap_out_tmp[x] = opa2_table[((*bitmap_in) >> 2) & 0x3];
+                } else if (i == 3) {
+                    bitmap_out_tmp[x] = opa2_table[((*bitmap_in) >> 0) & 0x3];
+                    bitmap_in++;
+                }
+            }
+
+            bitmap_out_tmp += stride_out;
+        }
+
+    } else if (fdsc->bpp == 3) {
+        if (stride_out == gdsc->box_w) {
+            /*Unpadded rows on both sides, the glyph is one run of 3-byte groups*/
+            plain3_expand(bitmap_in, 0, gdsc->box_w * gdsc->box_h, bitmap_out_tmp);
+            return;
+        }
+        for (y = 0; y < gdsc->box_h; y ++) {
+            plain3_expand(bitmap_in, y * gdsc->box_w, gdsc->box_w, bitmap_out_tmp);
+            bitmap_out_tmp += stride_out;
+        }
+    } else if (fdsc->bpp == 4) {
+        if (stride_out == gdsc->box_w) {
+            /*Unpadded rows on both sides, the glyph is one run of bytes*/
+            plain4_expand(bitmap_in, 0, gdsc->box_w * gdsc->box_h, bitmap_out_tmp);
+            return;
+        }
+        for (y = 0; y < gdsc->box_h; y ++) {
+            plain4_expand(bitmap_in, y * gdsc->box_w, gdsc->box_w, bitmap_out_tmp);
+            bitmap_out_tmp += stride_out;
+        }
+    } else if (fdsc->bpp == 8) {
+        for (y = 0; y < gdsc->box_h; y ++) {
+            for (x = 0; x < gdsc->box_w; x++, i++) {
+                bitmap_out_tmp[x] = *bitmap_in;
+                bitmap_in++;
+            }
+            bitmap_out_tmp += stride_out;
+        }
+    }
+}
+#endif
+
+/** A pixel of a plain 3 bpp bitmap, it may cross a byte boundary*/
+static inline uint8_t plain3_get(const uint8_t *bitmap, uint32_t pos)
+{
+    uint32_t bit_pos = pos * 3;
+    uint32_t word = bitmap[bit_pos >> 3] << 8;
+    if ((bit_pos & 0x7) > 5) {
+        word |= bitmap[(bit_pos >> 3) + 1];
+    }
+    return (word >> (13 - (bit_pos & 0x7))) & 0x7;
+}
+
+/**
+ * Expand pixels of a plain 3 bpp bitmap to opacity.
+ * Eight pixels fill three bytes, so the pixels between the first and the last 3-byte group are expanded
+ * eight at a time from a 24-bit word, without per pixel bit position arithmetic.
+ * @param bitmap the packed bitmap
+ * @param pos index of the first pixel in the bitmap
+ * @param num pixels to expand
+ * @param out one opacity byte per pixel
+ */
+static void plain3_expand(const uint8_t *bitmap, uint32_t pos, uint32_t num, uint8_t *out)
+{
+    uint32_t head = (8 - (pos & 0x7)) & 0x7;
+    if (head > num) {
+        head = num;
+    }
+    for (num -= head; head; head--, pos++) {
+        *out++ = opa3_table[plain3_get(bitmap, pos)];
+    }
+    const uint8_t *in = bitmap + (pos >> 3) * 3;
+    for (; num >= 8; num -= 8, pos += 8, in += 3, out += 8) {
+        uint32_t word = (in[0] << 16) | (in[1] << 8) | in[2];
+        out[0] = opa3_table[word >> 21];
+        out[1] = opa3_table[(word >> 18) & 0x7];
+        out[2] = opa3_table[(word >> 15) & 0x7];
+        out[3] = opa3_table[(word >> 12) & 0x7];
+        out[4] = opa3_table[(word >> 9) & 0x7];
+        out[5] = opa3_table[(word >> 6) & 0x7];
+        out[6] = opa3_table[(word >> 3) & 0x7];
+        out[7] = opa3_table[word & 0x7];
+    }
+    for (; num; num--, pos++) {
+        *out++ = opa3_table[plain3_get(bitmap, pos)];
+    }
+}
+
+/**
+ * Expand pixels of a plain 4 bpp bitmap to opacity.
+ * Two pixels fill a byte, so after an odd first pixel the pixels are expanded eight at a time from a
+ * 32-bit word, like `plain3_expand`.
+ * @param bitmap the packed bitmap
+ * @param pos index of the first pixel in the bitmap
+ * @param num pixels to expand
+ * @param out one opacity byte per pixel
+ */
+static void plain4_expand(const uint8_t *bitmap, uint32_t pos, uint32_t num, uint8_t *out)
+{
+    const uint8_t *in = bitmap + (pos >> 1);
+    if ((pos & 0x1) && num) {
+        *out++ = opa4_table[*in++ & 0xF];
+        num--;
+    }
+    for (; num >= 8; num -= 8, in += 4, out += 8) {
+        uint32_t word = ((uint32_t)in[0] << 24) | (in[1] << 16) | (in[2] << 8) | in[3];
+        out[0] = opa4_table[word >> 28];
+        out[1] = opa4_table[(word >> 24) & 0xF];
+        out[2] = opa4_table[(word >> 20) & 0xF];
+        out[3] = opa4_table[(word >> 16) & 0xF];
+        out[4] = opa4_table[(word >> 12) & 0xF];
+        out[5] = opa4_table[(word >> 8) & 0xF];
+        out[6] = opa4_table[(word >> 4) & 0xF];
+        out[7] = opa4_table[word & 0xF];
+    }
+    for (; num >= 2; num -= 2, in++, out += 2) {
+        uint8_t byte = *in;
+        out[0] = opa4_table[byte >> 4];
+        out[1] = opa4_table[byte & 0xF];
+    }
+    if (num) {
+        *out = opa4_table[*in >> 4];
+    }
+}
+
+#if LVGL_VERSION_MAJOR < 9
+/*Two 3 bpp pixels to two 4 bpp pixels, the same values as `bits_write`*/
+static const uint8_t plain3_pair_4bpp_table[64] = {
+    0x00, 0x02, 0x04, 0x06, 0x09, 0x0B, 0x0D, 0x0F,
+    0x20, 0x22, 0x24, 0x26, 0x29, 0x2B, 0x2D, 0x2F,
+    0x40, 0x42, 0x44, 0x46, 0x49, 0x4B, 0x4D, 0x4F,
+    0x60, 0x62, 0x64, 0x66, 0x69, 0x6B, 0x6D, 0x6F,
+    0x90, 0x92, 0x94, 0x96, 0x99, 0x9B, 0x9D, 0x9F,
+    0xB0, 0xB2, 0xB4, 0xB6, 0xB9, 0xBB, 0xBD, 0xBF,
+    0xD0, 0xD2, 0xD4, 0xD6, 0xD9, 0xDB, 0xDD, 0xDF,
+    0xF0, 0xF2, 0xF4, 0xF6, 0xF9, 0xFB, 0xFD, 0xFF,
+};
+
+/**
+ * Convert a plain 3 bpp bitmap to the 4 bpp bitstream LVGL v8 draws, rows are not padded in either.
+ * Each 3-byte group gives 4 bytes, one table lookup per pair of pixels.
+ * @param bitmap the packed bitmap
+ * @param num pixels of the glyph
+ * @param out `(num + 1) / 2` bytes
+ */
+static void plain3_to_4bpp(const uint8_t *bitmap, uint32_t num, uint8_t *out)
+{
+    const uint8_t *in = bitmap;
+    uint32_t pos = 0;
+    for (; num - pos >= 8; pos += 8, in += 3, out += 4) {
+        uint32_t word = (in[0] << 16) | (in[1] << 8) | in[2];
+        out[0] = plain3_pair_4bpp_table[word >> 18];
+        out[1] = plain3_pair_4bpp_table[(word >> 12) & 0x3F];
+        out[2] = plain3_pair_4bpp_table[(word >> 6) & 0x3F];
+        out[3] = plain3_pair_4bpp_table[word & 0x3F];
+    }
+    for (; pos < num; pos += 2, out++) {
+        uint8_t pair = plain3_get(bitmap, pos) << 3;
+        if (pos + 1 < num) {
+            pair |= plain3_get(bitmap, pos + 1);
+        }
+        *out = plain3_pair_4bpp_table[pair];
+    }
+}
+#endif
+
 bool d2_font_get_glyph_dsc_fmt_txt(const lv_font_t * font, lv_font_glyph_dsc_t * dsc_out, uint32_t unicode_letter,
                                    uint32_t unicode_letter_next)
 {
+    /*A suspended font is mapped again by its first lookup*/
+    if (!d2_font_fmt_txt_mapped(font)) {
+        return false;
+    }
+    d2_font_context_t *ctx = (d2_font_context_t *)font->user_data;
+    d2_font_fmt_txt_dsc_t * fdsc = (d2_font_fmt_txt_dsc_t *)(ctx->base_ptr + (uint32_t)font->dsc);
+
+    const d2_font_run_glyph_t *glyph = NULL;
+    d2_font_run_glyph_t glyph_tmp;
+#if CONFIG_D2_FONT_RUN_CACHE
+    if (ctx->ext->run_cache.num) {
+        glyph = run_follow(&ctx->ext->run_cache, unicode_letter, unicode_letter_next);
+    }
+#if CONFIG_D2_FONT_TRACE
+    if (glyph && ctx->ext->trace) {
+        trace_record(font, D2_FONT_TRACE_DSC_RAM, unicode_letter, glyph->glyph_id, NULL);
+    }
+#endif
+#endif
+    if (glyph == NULL) {
+        d2_font_fmt_txt_lookup_glyph(font, unicode_letter, unicode_letter_next, &glyph_tmp);
+        glyph = &glyph_tmp;
+    }
+    if (!glyph->glyph_id) {
+        return false;
+    }
+
+    dsc_out->adv_w = glyph->adv_w;
+    dsc_out->box_h = glyph->box_h;
+    dsc_out->box_w = glyph->box_w;
+    dsc_out->ofs_x = glyph->ofs_x;
+    dsc_out->ofs_y = glyph->ofs_y;
+#if LVGL_VERSION_MAJOR >= 9
+    dsc_out->format = (uint8_t)fdsc->bpp;
+    /*A tab is drawn as a wide space*/
+    dsc_out->gid.index = glyph->unicode_letter == '\t' ? ' ' : glyph->unicode_letter;
+#else
+    dsc_out->bpp   = (uint8_t)fdsc->bpp;
+#endif
+    dsc_out->is_placeholder = false;
+
+    return true;
+}
+
+bool d2_font_fmt_txt_lookup_glyph(const lv_font_t *font, uint32_t unicode_letter, uint32_t unicode_letter_next,
+                                  d2_font_run_glyph_t *glyph)
+{
+    glyph->unicode_letter = unicode_letter;
+    glyph->glyph_id = 0;
+    glyph->pos_x = 0;
+    glyph->adv_w = 0;
+    glyph->box_w = 0;
+    glyph->box_h = 0;
+    glyph->ofs_x = 0;
+    glyph->ofs_y = 0;
+
     /*It fixes a strange compiler optimization issue: https://github.com/lvgl/lvgl/issues/4370*/
     bool is_tab = unicode_letter == '\t';
     if (is_tab) {
         unicode_letter = ' ';
     }
+    if (!d2_font_fmt_txt_mapped(font)) {
+        return false;
+    }
     d2_font_context_t *ctx = (d2_font_context_t *)font->user_data;
     d2_font_fmt_txt_dsc_t * fdsc = (d2_font_fmt_txt_dsc_t *)(ctx->base_ptr + (uint32_t)font->dsc);
 
-    uint32_t gid = get_glyph_dsc_id(font, unicode_letter, NULL);
+    uint32_t gid;
+    const d2_font_fmt_txt_glyph_dsc_t *gdsc = NULL;
+#if CONFIG_D2_FONT_ASCII_TABLE
+    const d2_font_fmt_txt_ascii_t *ascii = ctx->ext->ascii;
+    uint32_t ascii_index = unicode_letter - D2_FONT_ASCII_FIRST;
+    uint32_t ascii_next = unicode_letter_next - D2_FONT_ASCII_FIRST;
+    if (ascii && ascii_index < D2_FONT_ASCII_NUM) {
+        /*Printable ASCII was resolved at load time, no font data is read*/
+        gid = ascii->glyphs[ascii_index].glyph_id;
+        gdsc = &ascii->glyphs[ascii_index].dsc;
+    } else
+#endif
+    {
+        gid = get_glyph_dsc_id(font, unicode_letter, NULL);
+    }
+#if CONFIG_D2_FONT_TRACE
+    if (ctx->ext->trace) {
+        trace_record(font, gdsc ? D2_FONT_TRACE_DSC_RAM : D2_FONT_TRACE_DSC, glyph->unicode_letter, gid, NULL);
+    }
+#endif
     if (!gid) {
         return false;
     }
 
     int8_t kvalue = 0;
+#if CONFIG_D2_FONT_ASCII_TABLE
+    if (ascii && ascii_index < D2_FONT_ASCII_NUM && ascii_next < D2_FONT_ASCII_NUM) {
+        if (ascii->kern) {
+            kvalue = ascii->kern[ascii_index * D2_FONT_ASCII_NUM + ascii_next];
+        }
+    } else
+#endif
     if (fdsc->kern_dsc) {
         uint32_t gid_next = get_glyph_dsc_id(font, unicode_letter_next, NULL);
         if (gid_next) {
@@ -266,8 +883,131 @@ bool d2_font_get_glyph_dsc_fmt_txt(const lv_font_t * font, lv_font_glyph_dsc_t *
     }
 
     /*Put together a glyph dsc*/
-    const d2_font_fmt_txt_glyph_index_t *gindex = (d2_font_fmt_txt_glyph_index_t *)(ctx->base_ptr + (uint32_t)fdsc->glyph_index) + gid;
-    const d2_font_fmt_txt_glyph_dsc_t *gdsc = (d2_font_fmt_txt_glyph_dsc_t *)(ctx->base_ptr + (uint32_t)fdsc->glyph_dsc) + gindex->dsc_index;
+    if (gdsc == NULL) {
+        gdsc = get_gdsc(font, gid);
+    }
+    run_glyph_fill(font, gid, gdsc, kvalue, is_tab, glyph);
+    return true;
+}
+
+bool d2_font_fmt_txt_lookup_gid(const lv_font_t *font, uint32_t gid, uint32_t gid_next, d2_font_run_glyph_t *glyph)
+{
+    memset(glyph, 0, sizeof(d2_font_run_glyph_t));
+    if (!d2_font_fmt_txt_mapped(font)) {
+        return false;
+    }
+    d2_font_context_t *ctx = (d2_font_context_t *)font->user_data;
+    d2_font_fmt_txt_dsc_t * fdsc = (d2_font_fmt_txt_dsc_t *)(ctx->base_ptr + (uint32_t)font->dsc);
+    if (gid == 0 || gid >= ctx->glyph_num) {
+        return false;
+    }
+    int8_t kvalue = 0;
+    if (fdsc->kern_dsc && gid_next && gid_next < ctx->glyph_num) {
+        kvalue = get_kern_value(font, gid, gid_next);
+    }
+    run_glyph_fill(font, gid, get_gdsc(font, gid), kvalue, false, glyph);
+    return true;
+}
+
+bool d2_font_fmt_txt_resolve_gid(const lv_font_t *font, uint32_t gid, d2_font_fmt_txt_glyph_t *glyph)
+{
+    if (!d2_font_fmt_txt_mapped(font)) {
+        return false;
+    }
+    d2_font_context_t *ctx = (d2_font_context_t *)font->user_data;
+    if (gid == 0 || gid >= ctx->glyph_num) {
+        return false;
+    }
+    const d2_font_fmt_txt_cmap_t *cmap = NULL;
+    if (!ctx->wide_index) {
+        /*The compact glyph index is relative to the bitmap base of the cmap holding the glyph*/
+        cmap = get_gid_cmap(font, gid);
+        if (cmap == NULL) {
+            return false;
+        }
+    }
+    fill_glyph(font, gid, cmap, glyph);
+    return true;
+}
+
+/**
+ * Find the cmap holding a glyph id, for the bitmap base of the compact glyph index.
+ * The glyph id range of every cmap is computed at the first call.
+ * @return the cmap, NULL if no cmap holds the glyph or memory allocation failed
+ */
+static const d2_font_fmt_txt_cmap_t *get_gid_cmap(const lv_font_t *font, uint32_t gid)
+{
+    d2_font_context_t *ctx = (d2_font_context_t *)font->user_data;
+    d2_font_fmt_txt_dsc_t * fdsc = (d2_font_fmt_txt_dsc_t *)(ctx->base_ptr + (uint32_t)font->dsc);
+    const d2_font_fmt_txt_cmap_t * cmaps = ctx->cmaps;
+
+    if (ctx->gid_ranges == NULL) {
+        d2_font_fmt_txt_gid_range_t *ranges = d2_font_mem_alloc(&ctx->mem, D2_FONT_MEM_INDEX,
+                                                                fdsc->cmap_num * sizeof(d2_font_fmt_txt_gid_range_t), false);
+        if (ranges == NULL) {
+            return NULL;
+        }
+        for (size_t i = 0; i < fdsc->cmap_num; i++) {
+            uint32_t ofs_max = 0;
+            uint32_t num = 0;
+            if (cmaps[i].type == D2_FONT_FMT_TXT_CMAP_FORMAT0_TINY) {
+                num = cmaps[i].range_length;
+                ofs_max = num - 1;
+            } else if (cmaps[i].type == D2_FONT_FMT_TXT_CMAP_SPARSE_TINY) {
+                num = cmaps[i].list_length;
+                ofs_max = num - 1;
+            } else if (cmaps[i].type == D2_FONT_FMT_TXT_CMAP_FORMAT0_FULL) {
+                const uint8_t * gid_ofs_8 = (const uint8_t *)(ctx->cmap_base + (uint32_t)cmaps[i].glyph_id_ofs_list);
+                num = cmaps[i].range_length;
+                for (uint32_t j = 0; j < num; j++) {
+                    ofs_max = LV_MAX(ofs_max, gid_ofs_8[j]);
+                }
+            } else if (cmaps[i].type == D2_FONT_FMT_TXT_CMAP_SPARSE_FULL) {
+                const uint16_t * gid_ofs_16 = (const uint16_t *)(ctx->cmap_base + (uint32_t)cmaps[i].glyph_id_ofs_list);
+                num = cmaps[i].list_length;
+                for (uint32_t j = 0; j < num; j++) {
+                    ofs_max = LV_MAX(ofs_max, gid_ofs_16[j]);
+                }
+            }
+            ranges[i].first = cmaps[i].glyph_id_start;
+            /*An empty cmap holds no glyph id*/
+            ranges[i].num = num ? ofs_max + 1 : 0;
+        }
+        ctx->gid_ranges = ranges;
+    }
+
+    for (size_t i = 0; i < fdsc->cmap_num; i++) {
+        if (gid - ctx->gid_ranges[i].first < ctx->gid_ranges[i].num) {
+            return &cmaps[i];
+        }
+    }
+    return NULL;
+}
+
+/** Get the descriptor of a glyph id*/
+static const d2_font_fmt_txt_glyph_dsc_t *get_gdsc(const lv_font_t *font, uint32_t gid)
+{
+    d2_font_context_t *ctx = (d2_font_context_t *)font->user_data;
+    d2_font_fmt_txt_dsc_t * fdsc = (d2_font_fmt_txt_dsc_t *)(ctx->base_ptr + (uint32_t)font->dsc);
+    uint32_t dsc_index;
+    if (ctx->wide_index) {
+        dsc_index = ((d2_font_fmt_txt_glyph_index_wide_t *)(ctx->base_ptr + (uint32_t)fdsc->glyph_index) + gid)->dsc_index;
+    } else {
+        dsc_index = ((d2_font_fmt_txt_glyph_index_t *)(ctx->base_ptr + (uint32_t)fdsc->glyph_index) + gid)->dsc_index;
+    }
+    return (d2_font_fmt_txt_glyph_dsc_t *)(ctx->base_ptr + (uint32_t)fdsc->glyph_dsc) + dsc_index;
+}
+
+/**
+ * Fill the metrics of a laid out glyph.
+ * @param kvalue kern value with the next glyph, not scaled yet
+ * @param is_tab the letter is a tab, drawn as 2 spaces
+ */
+static void run_glyph_fill(const lv_font_t *font, uint32_t gid, const d2_font_fmt_txt_glyph_dsc_t *gdsc, int8_t kvalue,
+                           bool is_tab, d2_font_run_glyph_t *glyph)
+{
+    d2_font_context_t *ctx = (d2_font_context_t *)font->user_data;
+    d2_font_fmt_txt_dsc_t * fdsc = (d2_font_fmt_txt_dsc_t *)(ctx->base_ptr + (uint32_t)font->dsc);
 
     int32_t kv = ((int32_t)((int32_t)kvalue * fdsc->kern_scale) >> 4);
 
@@ -279,25 +1019,84 @@ bool d2_font_get_glyph_dsc_fmt_txt(const lv_font_t * font, lv_font_glyph_dsc_t *
     adv_w += kv;
     adv_w  = (adv_w + (1 << 3)) >> 4;
 
-    dsc_out->adv_w = adv_w;
-    dsc_out->box_h = gdsc->box_h;
-    dsc_out->box_w = gdsc->box_w;
-    dsc_out->ofs_x = gdsc->ofs_x;
-    dsc_out->ofs_y = gdsc->ofs_y;
-#if LVGL_VERSION_MAJOR >= 9
-    dsc_out->format = (uint8_t)fdsc->bpp;
-    dsc_out->gid.index = unicode_letter;
-#else
-    dsc_out->bpp   = (uint8_t)fdsc->bpp;
-#endif
-    dsc_out->is_placeholder = false;
+    glyph->glyph_id = gid;
+    glyph->adv_w = adv_w;
+    glyph->box_h = gdsc->box_h;
+    glyph->box_w = gdsc->box_w;
+    glyph->ofs_x = gdsc->ofs_x;
+    glyph->ofs_y = gdsc->ofs_y;
 
     if (is_tab) {
-        dsc_out->box_w = dsc_out->box_w * 2;
+        glyph->box_w = glyph->box_w * 2;
     }
+}
 
-    return true;
+#if CONFIG_D2_FONT_RUN_CACHE
+/** Positions checked on each side of the expected one in the followed run*/
+#define RUN_FOLLOW_SCAN     4
+
+static inline bool run_glyph_match(const d2_font_run_t *run, uint32_t pos, uint32_t letter, uint32_t letter_next)
+{
+    uint32_t next = pos + 1 < run->glyph_num ? run->glyphs[pos + 1].unicode_letter : 0;
+    return run->glyphs[pos].unicode_letter == letter && next == letter_next;
+}
+
+/* A glyph of a cached run is used: follow the run from there and make it the most recently used */
+static const d2_font_run_glyph_t *run_hit(d2_font_fmt_txt_run_cache_t *cache, const d2_font_run_t *run, uint32_t pos)
+{
+    cache->follow = run;
+    cache->follow_pos = pos + 1;
+    for (uint32_t i = 1; cache->runs[0] != run && i < cache->num; i++) {
+        if (cache->runs[i] == run) {
+            memmove(&cache->runs[1], &cache->runs[0], i * sizeof(cache->runs[0]));
+            cache->runs[0] = (d2_font_run_t *)run;
+        }
+    }
+    return &run->glyphs[pos];
+}
+
+/**
+ * Find a letter pair in the cached runs.
+ * A glyph descriptor only depends on the letter and the next one, so any matching position gives the right result.
+ * @param cache run cache of the font
+ * @param letter a UNICODE letter code
+ * @param letter_next the letter after it
+ * @return the cached glyph or NULL if the pair was not found
+ */
+static const d2_font_run_glyph_t *run_follow(d2_font_fmt_txt_run_cache_t *cache, uint32_t letter, uint32_t letter_next)
+{
+    const d2_font_run_t *run = cache->follow;
+    if (run && run->glyph_num) {
+        /*LVGL walks the text in order and asks for each letter more than once (measure, then draw)*/
+        uint32_t pos = cache->follow_pos;
+        if (pos < run->glyph_num && run_glyph_match(run, pos, letter, letter_next)) {
+            return run_hit(cache, run, pos);
+        }
+        if (pos > 0 && run_glyph_match(run, pos - 1, letter, letter_next)) {
+            return run_hit(cache, run, pos - 1);
+        }
+        /*E.g. the first letter of a wrapped line: a few letters after or before the expected position*/
+        for (uint32_t n = 1; n <= RUN_FOLLOW_SCAN; n++) {
+            if (pos + n < run->glyph_num && run_glyph_match(run, pos + n, letter, letter_next)) {
+                return run_hit(cache, run, pos + n);
+            }
+            if (pos > n && run_glyph_match(run, pos - 1 - n, letter, letter_next)) {
+                return run_hit(cache, run, pos - 1 - n);
+            }
+        }
+    }
+
+    for (uint32_t i = 0; i < cache->num; i++) {
+        run = cache->runs[i];
+        if (run->glyph_num && run_glyph_match(run, 0, letter, letter_next)) {
+            return run_hit(cache, run, 0);
+        }
+    }
+    /*Text that is not cached: stop following, so its next letters only check the run starts*/
+    cache->follow = NULL;
+    return NULL;
 }
+#endif
 
 static uint32_t get_glyph_dsc_id(const lv_font_t * font, uint32_t letter, const d2_font_fmt_txt_cmap_t **cmap)
 {
@@ -322,8 +1121,33 @@ static uint32_t get_glyph_dsc_id(const lv_font_t * font, uint32_t letter, const
         }
     }
 
+    const d2_font_fmt_txt_cmap_t * found_cmap = NULL;
+    uint32_t glyph_id = find_glyph_dsc_id(font, letter, &found_cmap);
+    if (found_cmap == NULL) {
+        return 0;
+    }
+    ctx->cache[1] = ctx->cache[0];
+    ctx->cache[0].unicode_letter = letter;
+    ctx->cache[0].glyph_id = glyph_id;
+    ctx->cache[0].cmap = found_cmap;
+    if (cmap) {
+        *cmap = found_cmap;
+    }
+    return glyph_id;
+}
+
+/**
+ * Search a letter in the cmaps, without the per-font cache. It only reads the font data.
+ * @param font pointer to font
+ * @param letter a UNICODE letter code
+ * @param cmap store the cmap holding the letter, not changed if no cmap holds it
+ * @return glyph id, 0: not found
+ */
+static uint32_t find_glyph_dsc_id(const lv_font_t * font, uint32_t letter, const d2_font_fmt_txt_cmap_t **cmap)
+{
+    d2_font_context_t *ctx = (d2_font_context_t *)font->user_data;
     d2_font_fmt_txt_dsc_t * fdsc = (d2_font_fmt_txt_dsc_t *)(ctx->base_ptr + (uint32_t)font->dsc);
-    const d2_font_fmt_txt_cmap_t * cmaps = (const d2_font_fmt_txt_cmap_t *)(ctx->base_ptr + (uint32_t)fdsc->cmaps);
+    const d2_font_fmt_txt_cmap_t * cmaps = ctx->cmaps;
 
     for (size_t i = 0; i < fdsc->cmap_num; i++) {
         /*Relative code point*/
@@ -335,7 +1159,7 @@ static uint32_t get_glyph_dsc_id(const lv_font_t * font, uint32_t letter, const
         if (cmaps[i].type == D2_FONT_FMT_TXT_CMAP_FORMAT0_TINY) {
             glyph_id = cmaps[i].glyph_id_start + rcp;
         } else if (cmaps[i].type == D2_FONT_FMT_TXT_CMAP_FORMAT0_FULL) {
-            const uint8_t * gid_ofs_8 = (const uint8_t *)(ctx->base_ptr + (uint32_t)cmaps[i].glyph_id_ofs_list);
+            const uint8_t * gid_ofs_8 = (const uint8_t *)(ctx->cmap_base + (uint32_t)cmaps[i].glyph_id_ofs_list);
             /* The first character is always valid and should have offset = 0
              * However if a character is missing it also has offset=0.
              * So if there is a 0 not on the first position then it's a missing character */
@@ -345,7 +1169,7 @@ static uint32_t get_glyph_dsc_id(const lv_font_t * font, uint32_t letter, const
             glyph_id = cmaps[i].glyph_id_start + gid_ofs_8[rcp];
         } else if (cmaps[i].type == D2_FONT_FMT_TXT_CMAP_SPARSE_TINY) {
             uint16_t key = rcp;
-            const uint16_t *unicode_list = (const uint16_t *)(ctx->base_ptr + (uint32_t)cmaps[i].unicode_list);
+            const uint16_t *unicode_list = (const uint16_t *)(ctx->cmap_base + (uint32_t)cmaps[i].unicode_list);
             uint16_t * p = lv_utils_bsearch(&key, unicode_list, cmaps[i].list_length,
                                             sizeof(unicode_list[0]), unicode_list_compare);
 
@@ -355,20 +1179,16 @@ static uint32_t get_glyph_dsc_id(const lv_font_t * font, uint32_t letter, const
             }
         } else if (cmaps[i].type == D2_FONT_FMT_TXT_CMAP_SPARSE_FULL) {
             uint16_t key = rcp;
-            const uint16_t *unicode_list = (const uint16_t *)(ctx->base_ptr + (uint32_t)cmaps[i].unicode_list);
+            const uint16_t *unicode_list = (const uint16_t *)(ctx->cmap_base + (uint32_t)cmaps[i].unicode_list);
             uint16_t * p = lv_utils_bsearch(&key, unicode_list, cmaps[i].list_length,
                                             sizeof(unicode_list[0]), unicode_list_compare);
 
             if (p) {
                 lv_uintptr_t ofs = p - unicode_list;
-                const uint16_t * gid_ofs_16 = (const uint16_t *)(ctx->base_ptr + (uint32_t)cmaps[i].glyph_id_ofs_list);
+                const uint16_t * gid_ofs_16 = (const uint16_t *)(ctx->cmap_base + (uint32_t)cmaps[i].glyph_id_ofs_list);
                 glyph_id = cmaps[i].glyph_id_start + gid_ofs_16[ofs];
             }
         }
-        ctx->cache[1] = ctx->cache[0];
-        ctx->cache[0].unicode_letter = letter;
-        ctx->cache[0].glyph_id = glyph_id;
-        ctx->cache[0].cmap = &cmaps[i];
         if (cmap) {
             *cmap = &cmaps[i];
         }
@@ -379,6 +1199,38 @@ static uint32_t get_glyph_dsc_id(const lv_font_t * font, uint32_t letter, const
 
 }
 
+#if CONFIG_D2_FONT_ASCII_TABLE
+bool d2_font_fmt_txt_ascii_fill(const lv_font_t *font, d2_font_fmt_txt_ascii_t *ascii, int8_t *kern)
+{
+    for (uint32_t i = 0; i < D2_FONT_ASCII_NUM; i++) {
+        d2_font_fmt_txt_ascii_glyph_t *entry = &ascii->glyphs[i];
+        d2_font_fmt_txt_glyph_t glyph;
+        if (d2_font_fmt_txt_resolve_glyph_nocache(font, D2_FONT_ASCII_FIRST + i, &glyph)) {
+            entry->glyph_id = glyph.glyph_id;
+            entry->bitmap = glyph.bitmap;
+            entry->dsc = *glyph.gdsc;
+        } else {
+            *entry = (d2_font_fmt_txt_ascii_glyph_t) {
+                0
+            };
+        }
+    }
+
+    bool kerned = false;
+    for (uint32_t left = 0; left < D2_FONT_ASCII_NUM; left++) {
+        for (uint32_t right = 0; right < D2_FONT_ASCII_NUM; right++) {
+            int8_t value = 0;
+            if (ascii->glyphs[left].glyph_id && ascii->glyphs[right].glyph_id) {
+                value = get_kern_value(font, ascii->glyphs[left].glyph_id, ascii->glyphs[right].glyph_id);
+            }
+            kern[left * D2_FONT_ASCII_NUM + right] = value;
+            kerned |= value != 0;
+        }
+    }
+    return kerned;
+}
+#endif
+
 static int8_t get_kern_value(const lv_font_t * font, uint32_t gid_left, uint32_t gid_right)
 {
     d2_font_context_t *ctx = (d2_font_context_t *)font->user_data;
@@ -501,16 +1353,31 @@ static int32_t kern_pair_16_compare(const void * ref, const void * element)
 
 #if LV_USE_FONT_COMPRESSED
 
+/** Scratch line of `decompress`, freeing `caches` of the font to retry if it cannot be allocated*/
+static uint8_t *decompress_line_alloc(const lv_font_t *font, uint32_t *caches, int32_t w)
+{
+    d2_font_context_t *ctx = (d2_font_context_t *)font->user_data;
+    uint8_t *buf = d2_font_mem_alloc(&ctx->mem, D2_FONT_MEM_SCRATCH, w, false);
+    while (buf == NULL && d2_font_shrink_retry(font, caches)) {
+        buf = d2_font_mem_alloc(&ctx->mem, D2_FONT_MEM_SCRATCH, w, false);
+    }
+    return buf;
+}
+
 /**
  * The compress a glyph's bitmap
+ * @param font the font, its memory counters hold the scratch lines
+ * @param caches caches freed to retry when the scratch lines cannot be allocated, see `d2_font_shrink_retry`
  * @param in the compressed bitmap
  * @param out buffer to store the result
  * @param px_num number of pixels in the glyph (width * height)
  * @param bpp bit per pixel (bpp = 3 will be converted to bpp = 4)
  * @param prefilter true: the lines are XORed
  */
-static void decompress(const uint8_t * in, uint8_t * out, int32_t w, int32_t h, uint8_t bpp, bool prefilter)
+static bool decompress(const lv_font_t *font, uint32_t caches, const uint8_t * in, uint8_t * out, int32_t w, int32_t h,
+                       uint8_t bpp, bool prefilter)
 {
+    d2_font_fmt_txt_mem_t *mem = &((d2_font_context_t *)font->user_data)->mem;
     d2_font_fmt_rle_t rle;
 
 #if LVGL_VERSION_MAJOR >= 9
@@ -527,7 +1394,7 @@ static void decompress(const uint8_t * in, uint8_t * out, int32_t w, int32_t h,
         break;
     default:
         // LV_LOG_WARN("%d bpp is not handled", bpp);
-        return;
+        return false;
     }
 #else
     uint32_t wrp = 0;
@@ -539,12 +1406,18 @@ static void decompress(const uint8_t * in, uint8_t * out, int32_t w, int32_t h,
 
     rle_init(&rle, in, bpp);
 
-    uint8_t * line_buf1 = malloc(w);
+    uint8_t * line_buf1 = decompress_line_alloc(font, &caches, w);
 
     uint8_t * line_buf2 = NULL;
 
-    if (prefilter) {
-        line_buf2 = malloc(w);
+    if (prefilter && line_buf1) {
+        line_buf2 = decompress_line_alloc(font, &caches, w);
+    }
+
+    if (line_buf1 == NULL || (prefilter && line_buf2 == NULL)) {
+        d2_font_mem_free(mem, D2_FONT_MEM_SCRATCH, line_buf1, w);
+        d2_font_mem_free(mem, D2_FONT_MEM_SCRATCH, line_buf2, w);
+        return false;
     }
 
     decompress_line(&rle, line_buf1, w);
@@ -606,8 +1479,9 @@ static void decompress(const uint8_t * in, uint8_t * out, int32_t w, int32_t h,
 
 #endif
 
-    free(line_buf1);
-    free(line_buf2);
+    d2_font_mem_free(mem, D2_FONT_MEM_SCRATCH, line_buf1, w);
+    d2_font_mem_free(mem, D2_FONT_MEM_SCRATCH, line_buf2, w);
+    return true;
 }
 
 /**
@@ -0,0 +1,91 @@
+/*
+ * SPDX-FileCopyrightText: 2026 udoudou
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "d2_font.h"
+
+#include "string.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+
+#include "d2_font_priv.h"
+
+/*The counters of a font are updated from the LVGL task, the prefetch task and the caller of d2_font_prefetch_utf8*/
+static portMUX_TYPE s_mem_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static bool mem_reserve(d2_font_fmt_txt_mem_t *mem, d2_font_mem_type_t type, size_t size)
+{
+    bool ok = true;
+    portENTER_CRITICAL(&s_mem_lock);
+    if (mem->budget[type] && mem->used[type] + size > mem->budget[type]) {
+        ok = false;
+    } else {
+        mem->used[type] += size;
+        if (mem->used[type] > mem->peak[type]) {
+            mem->peak[type] = mem->used[type];
+        }
+    }
+    portEXIT_CRITICAL(&s_mem_lock);
+    return ok;
+}
+
+static void mem_release(d2_font_fmt_txt_mem_t *mem, d2_font_mem_type_t type, size_t size)
+{
+    portENTER_CRITICAL(&s_mem_lock);
+    mem->used[type] -= size;
+    portEXIT_CRITICAL(&s_mem_lock);
+}
+
+void *d2_font_mem_alloc(d2_font_fmt_txt_mem_t *mem, d2_font_mem_type_t type, size_t size, bool zero)
+{
+    if (!mem_reserve(mem, type, size)) {
+        return NULL;
+    }
+    void *ptr = zero ? heap_caps_calloc(1, size, mem->caps[type]) : heap_caps_malloc(size, mem->caps[type]);
+    if (ptr == NULL) {
+        mem_release(mem, type, size);
+    }
+    return ptr;
+}
+
+void *d2_font_mem_realloc(d2_font_fmt_txt_mem_t *mem, d2_font_mem_type_t type, void *ptr, size_t old_size, size_t size)
+{
+    if (size > old_size && !mem_reserve(mem, type, size - old_size)) {
+        return NULL;
+    }
+    void *new_ptr = heap_caps_realloc(ptr, size, mem->caps[type]);
+    if (new_ptr == NULL) {
+        if (size > old_size) {
+            mem_release(mem, type, size - old_size);
+        }
+        return NULL;
+    }
+    if (size < old_size) {
+        mem_release(mem, type, old_size - size);
+    }
+    return new_ptr;
+}
+
+void d2_font_mem_free(d2_font_fmt_txt_mem_t *mem, d2_font_mem_type_t type, void *ptr, size_t size)
+{
+    if (ptr == NULL) {
+        return;
+    }
+    heap_caps_free(ptr);
+    mem_release(mem, type, size);
+}
+
+esp_err_t d2_font_get_memory_usage(const lv_font_t *font, d2_font_memory_usage_t *usage)
+{
+    if (font == NULL || usage == NULL || font->get_glyph_bitmap != d2_font_get_bitmap_fmt_txt) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    d2_font_context_t *ctx = (d2_font_context_t *)font->user_data;
+    portENTER_CRITICAL(&s_mem_lock);
+    memcpy(usage->used, ctx->mem.used, sizeof(usage->used));
+    memcpy(usage->peak, ctx->mem.peak, sizeof(usage->peak));
+    portEXIT_CRITICAL(&s_mem_lock);
+    usage->mmap = ctx->mem.mmap_size;
+    return ESP_OK;
+}
@@ -0,0 +1,178 @@
+/*
+ * SPDX-FileCopyrightText: 2026 udoudou
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "d2_font_pack.h"
+
+#include "string.h"
+#include "esp_partition.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+
+#include "d2_font.h"
+#include "d2_font_priv.h"
+
+static const char *TAG = "d2_font_pack";
+
+/*
+ * Pack layout:
+ *     u16 header_length | "D2FtPk" | d2_font_pack_header_bin_t | font_num * d2_font_pack_font_bin_t
+ *     u32 dsc_length | "ULST" shared cmap lists | font_num * (d2_font_fmt_txt_dsc_t, "CMAP" ... "GBIT" ...)
+ *     sha256 of everything above
+ * Offsets in the font tables are relative to the byte after dsc_length.
+ */
+typedef struct {
+    uint32_t version;
+    uint32_t font_num;
+} __attribute__((packed)) d2_font_pack_header_bin_t;
+
+typedef struct {
+    uint32_t size;                  /*Font size in pixels, the key of d2_font_pack_get*/
+    uint32_t dsc_offset;            /*d2_font_fmt_txt_dsc_t of this size*/
+    uint32_t dsc_length;            /*Length of the tables of this size, from dsc_offset*/
+    d2_font_header_bin_t header;
+} __attribute__((packed)) d2_font_pack_font_bin_t;
+
+typedef struct {
+    uint32_t size;
+    lv_font_t *font;
+} d2_font_pack_font_t;
+
+struct d2_font_pack_t {
+    void *mmap_handle;
+    uint32_t font_num;
+    d2_font_pack_font_t fonts[];
+};
+
+/**
+ * @param partition partition mapped at `bin_ptr`, NULL if the pack does not come from a partition
+ */
+static esp_err_t pack_open(const uint8_t *bin_ptr, size_t size, const esp_partition_t *partition, d2_font_pack_t **out_pack)
+{
+    esp_err_t err;
+    *out_pack = NULL;
+    if (bin_ptr == NULL || size < 8 + sizeof(d2_font_pack_header_bin_t)) {
+        ESP_LOGE(TAG, "Invalid param");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    /*header*/
+    uint16_t header_length = *(uint16_t *)bin_ptr;
+    const d2_font_pack_header_bin_t *pack_header = (const d2_font_pack_header_bin_t *)(bin_ptr + 8);
+    if (memcmp(bin_ptr + 2, "D2FtPk", 6) != 0 || header_length < 8 + sizeof(d2_font_pack_header_bin_t) ||
+            header_length + 4 > size || pack_header->font_num == 0 ||
+            pack_header->font_num > (header_length - 8 - sizeof(d2_font_pack_header_bin_t)) / sizeof(d2_font_pack_font_bin_t)) {
+        ESP_LOGE(TAG, "Header error");
+        return ESP_ERR_INVALID_CRC;
+    }
+    const d2_font_pack_font_bin_t *font_bins = (const d2_font_pack_font_bin_t *)(pack_header + 1);
+
+    /*dsc and sha256, one pass for all the sizes*/
+    uint32_t dsc_length = *(uint32_t *)(bin_ptr + header_length);
+    if (header_length + dsc_length + 32 > size || dsc_length < 4) {
+        ESP_LOGE(TAG, "Dsc_length error");
+        return ESP_ERR_INVALID_CRC;
+    }
+    err = d2_font_verify(partition, bin_ptr, header_length + dsc_length);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    d2_font_pack_t *pack = heap_caps_calloc(1, sizeof(d2_font_pack_t) + pack_header->font_num * sizeof(d2_font_pack_font_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (pack == NULL) {
+        ESP_LOGE(TAG, "malloc failed");
+        return ESP_ERR_NO_MEM;
+    }
+
+    const uint8_t *base_ptr = bin_ptr + header_length + 4;
+    for (uint32_t i = 0; i < pack_header->font_num; i++) {
+        const d2_font_pack_font_bin_t *font_bin = &font_bins[i];
+        if (font_bin->dsc_offset % 4 != 0 || (uint64_t)font_bin->dsc_offset + font_bin->dsc_length > dsc_length - 4) {
+            ESP_LOGE(TAG, "Font %" PRIu32 " error", i);
+            err = ESP_ERR_INVALID_CRC;
+            goto error;
+        }
+        err = d2_font_create(base_ptr, font_bin->dsc_offset, font_bin->dsc_length, &font_bin->header, NULL, true,
+                             &pack->fonts[i].font);
+        if (err != ESP_OK) {
+            goto error;
+        }
+        pack->fonts[i].size = font_bin->size;
+        pack->font_num++;
+    }
+
+    *out_pack = pack;
+    return ESP_OK;
+error:
+    d2_font_pack_close(pack);
+    return err;
+}
+
+esp_err_t d2_font_pack_open_from_mem(const uint8_t *bin_ptr, size_t size, d2_font_pack_t **out_pack)
+{
+    return pack_open(bin_ptr, size, NULL, out_pack);
+}
+
+esp_err_t d2_font_pack_open(const char *label, d2_font_pack_t **out_pack)
+{
+    esp_err_t err;
+    *out_pack = NULL;
+    if (label == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    const esp_partition_t *partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, label);
+    if (partition == NULL) {
+        ESP_LOGE(TAG, "Partition not found");
+        return ESP_ERR_NOT_FOUND;
+    }
+    const void *map_ptr;
+    esp_partition_mmap_handle_t map_handle;
+    err = esp_partition_mmap(partition, 0, partition->size, ESP_PARTITION_MMAP_DATA, &map_ptr, &map_handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Partition mmap failed");
+        return err;
+    }
+
+    err = pack_open(map_ptr, partition->size, partition, out_pack);
+    if (err != ESP_OK) {
+        esp_partition_munmap(map_handle);
+        return err;
+    }
+    (*out_pack)->mmap_handle = (void *)map_handle;
+    return ESP_OK;
+}
+
+esp_err_t d2_font_pack_get(const d2_font_pack_t *pack, uint32_t size, lv_font_t **out_font)
+{
+    if (out_font == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *out_font = NULL;
+    if (pack == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (uint32_t i = 0; i < pack->font_num; i++) {
+        if (pack->fonts[i].size == size) {
+            *out_font = pack->fonts[i].font;
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+void d2_font_pack_close(d2_font_pack_t *pack)
+{
+    if (pack == NULL) {
+        return;
+    }
+    /*The fonts do not own the mapping, d2_font_unload only frees them*/
+    for (uint32_t i = 0; i < pack->font_num; i++) {
+        d2_font_unload(pack->fonts[i].font);
+    }
+    esp_partition_mmap_handle_t mmap_handle = (esp_partition_mmap_handle_t)pack->mmap_handle;
+    if (mmap_handle) {
+        esp_partition_munmap(mmap_handle);
+    }
+    heap_caps_free(pack);
+}
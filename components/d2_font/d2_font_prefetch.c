@@ -0,0 +1,288 @@
+/*
+ * SPDX-FileCopyrightText: 2026 udoudou
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "d2_font_prefetch.h"
+
+#include "string.h"
+#include "esp_log.h"
+
+#include "d2_font_fmt_txt.h"
+#include "d2_font_priv.h"
+
+#if CONFIG_D2_FONT_PREFETCH && LVGL_VERSION_MAJOR >= 9
+#include "stdatomic.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+
+/*How long the task waits for LVGL to take glyphs from a full ring before it gives up the rest of a text*/
+#define PREFETCH_FULL_WAIT_MS   50
+
+static const char *TAG = "d2_font_prefetch";
+
+typedef struct {
+    uint32_t unicode_letter;
+    uint32_t seq;                   /*Text the glyph belongs to*/
+    uint16_t box_w;
+    uint16_t box_h;
+    lv_draw_buf_t draw_buf;         /*Over `data`, set when the glyph is lent to LVGL*/
+    uint8_t data[CONFIG_D2_FONT_PREFETCH_SLOT_SIZE] __attribute__((aligned(4)));
+} d2_font_prefetch_slot_t;
+
+/*
+ * Single producer (the prefetch task, writes `head`), single consumer (the LVGL task, writes `tail`).
+ * Slots in [tail, head) are ready. The indexes run freely and wrap with the slot count.
+ * A full ring makes the producer wait, it never writes over a slot LVGL did not release.
+ */
+struct d2_font_prefetch_ring_t {
+    atomic_uint head;
+    atomic_uint tail;
+    atomic_uint wait_seq;           /*Text waiting for a free slot, 0 if none*/
+    uint32_t seq;                   /*Last text, producer only*/
+    bool lent;                      /*The slot at `tail` is drawn by LVGL, consumer only*/
+    d2_font_prefetch_slot_t slots[CONFIG_D2_FONT_PREFETCH_SLOTS];
+};
+
+typedef struct {
+    lv_font_t *font;
+    char *text;                     /*NULL: only give `done`*/
+    SemaphoreHandle_t done;
+} d2_font_prefetch_req_t;
+
+static QueueHandle_t s_queue;
+
+static void prefetch_text(const lv_font_t *font, const char *text)
+{
+    d2_font_context_t *ctx = (d2_font_context_t *)font->user_data;
+    struct d2_font_prefetch_ring_t *ring = ctx->ext->prefetch;
+    unsigned head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    if (++ring->seq == 0) {
+        ring->seq = 1;
+    }
+
+    uint32_t i = 0;
+    uint32_t letter;
+    while ((letter = d2_font_utf8_next(text, &i)) != 0) {
+        d2_font_fmt_txt_glyph_t glyph;
+        if (!d2_font_fmt_txt_resolve_glyph_nocache(font, letter, &glyph)) {
+            continue;
+        }
+        uint32_t box_w = glyph.gdsc->box_w;
+        uint32_t box_h = glyph.gdsc->box_h;
+        uint32_t size = lv_draw_buf_width_to_stride(box_w, LV_COLOR_FORMAT_A8) * box_h;
+        if (size == 0 || size > CONFIG_D2_FONT_PREFETCH_SLOT_SIZE) {
+            continue;
+        }
+
+        /*Wait for LVGL to take glyphs, it drops the older texts it did not draw to make room for this one*/
+        TickType_t start = xTaskGetTickCount();
+        while (head - atomic_load_explicit(&ring->tail, memory_order_acquire) == CONFIG_D2_FONT_PREFETCH_SLOTS) {
+            atomic_store_explicit(&ring->wait_seq, ring->seq, memory_order_release);
+            if (xTaskGetTickCount() - start > pdMS_TO_TICKS(PREFETCH_FULL_WAIT_MS)) {
+                atomic_store_explicit(&ring->wait_seq, 0, memory_order_relaxed);
+                return;
+            }
+            vTaskDelay(1);
+        }
+        atomic_store_explicit(&ring->wait_seq, 0, memory_order_relaxed);
+
+        d2_font_prefetch_slot_t *slot = &ring->slots[head % CONFIG_D2_FONT_PREFETCH_SLOTS];
+        /*Not the LVGL context, the caches of the font are not freed from here*/
+        if (!d2_font_fmt_txt_decode_a8(font, &glyph, slot->data, 0)) {
+            return;
+        }
+        slot->unicode_letter = letter;
+        slot->seq = ring->seq;
+        slot->box_w = box_w;
+        slot->box_h = box_h;
+        head++;
+        atomic_store_explicit(&ring->head, head, memory_order_release);
+    }
+}
+
+static void prefetch_task(void *arg)
+{
+    d2_font_prefetch_req_t req;
+    while (1) {
+        if (xQueueReceive(s_queue, &req, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+        if (req.text) {
+            d2_font_context_t *ctx = (d2_font_context_t *)req.font->user_data;
+            prefetch_text(req.font, req.text);
+            d2_font_mem_free(&ctx->mem, D2_FONT_MEM_SCRATCH, req.text, strlen(req.text) + 1);
+        }
+        if (req.done) {
+            xSemaphoreGive(req.done);
+        }
+    }
+}
+
+static esp_err_t prefetch_task_start(void)
+{
+    if (s_queue) {
+        return ESP_OK;
+    }
+    s_queue = xQueueCreate(CONFIG_D2_FONT_PREFETCH_QUEUE_LEN, sizeof(d2_font_prefetch_req_t));
+    if (s_queue == NULL) {
+        ESP_LOGE(TAG, "malloc failed");
+        return ESP_ERR_NO_MEM;
+    }
+#if CONFIG_D2_FONT_PREFETCH_TASK_CORE < 0
+    BaseType_t core = tskNO_AFFINITY;
+#else
+    BaseType_t core = CONFIG_D2_FONT_PREFETCH_TASK_CORE;
+#endif
+    if (xTaskCreatePinnedToCore(prefetch_task, "d2_font_prefetch", CONFIG_D2_FONT_PREFETCH_TASK_STACK, NULL,
+                                CONFIG_D2_FONT_PREFETCH_TASK_PRIORITY, NULL, core) != pdPASS) {
+        ESP_LOGE(TAG, "task create failed");
+        vQueueDelete(s_queue);
+        s_queue = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+const lv_draw_buf_t *d2_font_prefetch_take(const lv_font_t *font, uint32_t letter)
+{
+    d2_font_context_t *ctx = (d2_font_context_t *)font->user_data;
+    struct d2_font_prefetch_ring_t *ring = ctx->ext->prefetch;
+    unsigned tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    /*LVGL is done with the glyph lent by the previous call*/
+    if (ring->lent) {
+        ring->lent = false;
+        tail++;
+        atomic_store_explicit(&ring->tail, tail, memory_order_release);
+    }
+    unsigned head = atomic_load_explicit(&ring->head, memory_order_acquire);
+
+    for (unsigned pos = tail; pos != head; pos++) {
+        d2_font_prefetch_slot_t *slot = &ring->slots[pos % CONFIG_D2_FONT_PREFETCH_SLOTS];
+        if (slot->unicode_letter == letter) {
+            /*The glyphs before it were not drawn in the prefetched order. This one stays at the tail while it is drawn*/
+            atomic_store_explicit(&ring->tail, pos, memory_order_release);
+            ring->lent = true;
+            uint32_t stride = lv_draw_buf_width_to_stride(slot->box_w, LV_COLOR_FORMAT_A8);
+            lv_draw_buf_init(&slot->draw_buf, slot->box_w, slot->box_h, LV_COLOR_FORMAT_A8, stride, slot->data,
+                             stride * slot->box_h);
+            lv_draw_buf_flush_cache(&slot->draw_buf, NULL);
+            return &slot->draw_buf;
+        }
+    }
+
+    /*A full ring while a newer text waits for room holds texts that were not drawn, drop the oldest one*/
+    unsigned wait_seq = atomic_load_explicit(&ring->wait_seq, memory_order_acquire);
+    if (head - tail == CONFIG_D2_FONT_PREFETCH_SLOTS && wait_seq) {
+        uint32_t seq = ring->slots[tail % CONFIG_D2_FONT_PREFETCH_SLOTS].seq;
+        if (seq != wait_seq) {
+            while (tail != head && ring->slots[tail % CONFIG_D2_FONT_PREFETCH_SLOTS].seq == seq) {
+                tail++;
+            }
+            atomic_store_explicit(&ring->tail, tail, memory_order_release);
+        }
+    }
+    return NULL;
+}
+#endif
+
+esp_err_t d2_font_prefetch_enable(lv_font_t *font)
+{
+#if CONFIG_D2_FONT_PREFETCH && LVGL_VERSION_MAJOR >= 9
+    if (font == NULL || font->get_glyph_bitmap != d2_font_get_bitmap_fmt_txt) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    d2_font_context_t *ctx = (d2_font_context_t *)font->user_data;
+    if (ctx->ext->prefetch) {
+        return ESP_OK;
+    }
+    /*The task looks glyphs up without mapping a suspended font again, and the font cannot be suspended below it*/
+    esp_err_t err = d2_font_resume(font);
+    if (err != ESP_OK) {
+        return err;
+    }
+    err = prefetch_task_start();
+    if (err != ESP_OK) {
+        return err;
+    }
+    struct d2_font_prefetch_ring_t *ring = d2_font_mem_alloc(&ctx->mem, D2_FONT_MEM_CACHE, sizeof(struct d2_font_prefetch_ring_t), true);
+    if (ring == NULL) {
+        ESP_LOGE(TAG, "malloc failed");
+        return ESP_ERR_NO_MEM;
+    }
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    atomic_init(&ring->wait_seq, 0);
+    ctx->ext->prefetch = ring;
+    return ESP_OK;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+esp_err_t d2_font_prefetch_disable(lv_font_t *font)
+{
+#if CONFIG_D2_FONT_PREFETCH && LVGL_VERSION_MAJOR >= 9
+    if (font == NULL || font->get_glyph_bitmap != d2_font_get_bitmap_fmt_txt) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    d2_font_context_t *ctx = (d2_font_context_t *)font->user_data;
+    if (ctx->ext->prefetch == NULL) {
+        return ESP_OK;
+    }
+    /*The task handles requests in order, once it gives `done` nothing refers to the ring anymore*/
+    d2_font_prefetch_req_t req = {
+        .font = font,
+        .text = NULL,
+        .done = xSemaphoreCreateBinary(),
+    };
+    if (req.done == NULL || xQueueSend(s_queue, &req, portMAX_DELAY) != pdTRUE) {
+        ESP_LOGE(TAG, "disable failed, the ring is leaked");
+        ctx->ext->prefetch = NULL;
+        if (req.done) {
+            vSemaphoreDelete(req.done);
+        }
+        return ESP_ERR_NO_MEM;
+    }
+    xSemaphoreTake(req.done, portMAX_DELAY);
+    vSemaphoreDelete(req.done);
+    d2_font_mem_free(&ctx->mem, D2_FONT_MEM_CACHE, ctx->ext->prefetch, sizeof(struct d2_font_prefetch_ring_t));
+    ctx->ext->prefetch = NULL;
+    return ESP_OK;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+esp_err_t d2_font_prefetch_utf8(lv_font_t *font, const char *text)
+{
+#if CONFIG_D2_FONT_PREFETCH && LVGL_VERSION_MAJOR >= 9
+    if (font == NULL || text == NULL || font->get_glyph_bitmap != d2_font_get_bitmap_fmt_txt) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    d2_font_context_t *ctx = (d2_font_context_t *)font->user_data;
+    if (ctx->ext->prefetch == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    size_t len = strlen(text) + 1;
+    d2_font_prefetch_req_t req = {
+        .font = font,
+        .text = d2_font_mem_alloc(&ctx->mem, D2_FONT_MEM_SCRATCH, len, false),
+        .done = NULL,
+    };
+    if (req.text == NULL) {
+        ESP_LOGE(TAG, "malloc failed");
+        return ESP_ERR_NO_MEM;
+    }
+    memcpy(req.text, text, len);
+    if (xQueueSend(s_queue, &req, 0) != pdTRUE) {
+        d2_font_mem_free(&ctx->mem, D2_FONT_MEM_SCRATCH, req.text, len);
+        return ESP_ERR_TIMEOUT;
+    }
+    return ESP_OK;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
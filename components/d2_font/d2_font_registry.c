@@ -0,0 +1,156 @@
+/*
+ * SPDX-FileCopyrightText: 2026 udoudou
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "d2_font.h"
+
+#include "string.h"
+#include "esp_partition.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+
+static const char *TAG = "d2_font_registry";
+
+/** A shared font, keyed by its partition or by its address range*/
+typedef struct d2_font_registry_entry_t {
+    struct d2_font_registry_entry_t *next;
+    const esp_partition_t *partition;       /**< NULL for fonts from memory*/
+    const uint8_t *bin_ptr;                 /**< Fonts from memory only*/
+    size_t size;
+    uint32_t refs;
+    lv_font_t *font;
+} d2_font_registry_entry_t;
+
+/*Only the list is guarded, fonts are loaded and unloaded outside the lock*/
+static portMUX_TYPE s_registry_lock = portMUX_INITIALIZER_UNLOCKED;
+static d2_font_registry_entry_t *s_registry;
+
+static bool entry_match(const d2_font_registry_entry_t *entry, const esp_partition_t *partition,
+                        const uint8_t *bin_ptr, size_t size)
+{
+    if (partition) {
+        return entry->partition == partition;
+    }
+    return entry->partition == NULL && entry->bin_ptr == bin_ptr && entry->size == size;
+}
+
+/**
+ * Take a reference on a registered font. Call it with the lock held.
+ * @return the font, NULL if it is not registered
+ */
+static lv_font_t *registry_ref(const esp_partition_t *partition, const uint8_t *bin_ptr, size_t size)
+{
+    for (d2_font_registry_entry_t *entry = s_registry; entry; entry = entry->next) {
+        if (entry_match(entry, partition, bin_ptr, size)) {
+            entry->refs++;
+            return entry->font;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @param partition partition of the font, NULL to load from `bin_ptr`
+ */
+static esp_err_t registry_acquire(const esp_partition_t *partition, const uint8_t *bin_ptr, size_t size,
+                                  lv_font_t **out_font)
+{
+    portENTER_CRITICAL(&s_registry_lock);
+    *out_font = registry_ref(partition, bin_ptr, size);
+    portEXIT_CRITICAL(&s_registry_lock);
+    if (*out_font) {
+        return ESP_OK;
+    }
+
+    d2_font_registry_entry_t *entry = heap_caps_calloc(1, sizeof(d2_font_registry_entry_t),
+                                                       MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (entry == NULL) {
+        ESP_LOGE(TAG, "No mem for registry entry");
+        return ESP_ERR_NO_MEM;
+    }
+    lv_font_t *font;
+    esp_err_t err;
+    if (partition) {
+        err = d2_font_load_from_partition(partition->label, &font);
+    } else {
+        err = d2_font_load_from_mem(bin_ptr, size, &font);
+    }
+    if (err != ESP_OK) {
+        heap_caps_free(entry);
+        return err;
+    }
+    entry->partition = partition;
+    entry->bin_ptr = partition ? NULL : bin_ptr;
+    entry->size = size;
+    entry->refs = 1;
+    entry->font = font;
+
+    /*Another task may have loaded the same font meanwhile, keep the first one*/
+    portENTER_CRITICAL(&s_registry_lock);
+    *out_font = registry_ref(partition, bin_ptr, size);
+    if (*out_font == NULL) {
+        entry->next = s_registry;
+        s_registry = entry;
+        *out_font = font;
+    }
+    portEXIT_CRITICAL(&s_registry_lock);
+    if (*out_font != font) {
+        d2_font_unload(font);
+        heap_caps_free(entry);
+    }
+    return ESP_OK;
+}
+
+esp_err_t d2_font_acquire(const char *label, lv_font_t **out_font)
+{
+    *out_font = NULL;
+    if (label == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    const esp_partition_t *partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, label);
+    if (partition == NULL) {
+        ESP_LOGE(TAG, "Partition not found");
+        return ESP_ERR_NOT_FOUND;
+    }
+    return registry_acquire(partition, NULL, partition->size, out_font);
+}
+
+esp_err_t d2_font_acquire_from_mem(const uint8_t *bin_ptr, size_t size, lv_font_t **out_font)
+{
+    *out_font = NULL;
+    if (bin_ptr == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return registry_acquire(NULL, bin_ptr, size, out_font);
+}
+
+void d2_font_release(lv_font_t *font)
+{
+    if (font == NULL) {
+        return;
+    }
+    d2_font_registry_entry_t *entry = NULL;
+    bool found = false;
+    portENTER_CRITICAL(&s_registry_lock);
+    for (d2_font_registry_entry_t **prev = &s_registry; *prev; prev = &(*prev)->next) {
+        if ((*prev)->font == font) {
+            found = true;
+            if (--(*prev)->refs == 0) {
+                entry = *prev;
+                *prev = entry->next;
+            }
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&s_registry_lock);
+    if (!found) {
+        ESP_LOGE(TAG, "Font not acquired");
+        return;
+    }
+    if (entry) {
+        d2_font_unload(entry->font);
+        heap_caps_free(entry);
+    }
+}
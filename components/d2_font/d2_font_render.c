@@ -0,0 +1,548 @@
+/*
+ * SPDX-FileCopyrightText: 2026 udoudou
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "d2_font_render.h"
+
+#include "string.h"
+#include "esp_log.h"
+
+#include "d2_font_fmt_txt.h"
+#include "d2_font_priv.h"
+
+static const char *TAG = "d2_font_render";
+
+static void blend_a8(uint8_t *dst, const uint8_t *row, int32_t len)
+{
+    for (int32_t x = 0; x < len; x++) {
+        uint8_t a = row[x];
+        if (a == 0) {
+            continue;
+        }
+        if (a == 0xFF) {
+            dst[x] = 0xFF;
+        } else {
+            dst[x] += ((0xFF - dst[x]) * a + 127) / 255;
+        }
+    }
+}
+
+static void blend_i1(uint8_t *dst, int32_t x_dst, const uint8_t *row, int32_t len)
+{
+    for (int32_t x = 0; x < len; x++, x_dst++) {
+        if (row[x] >= 0x80) {
+            dst[x_dst >> 3] |= 0x80 >> (x_dst & 0x7);
+        }
+    }
+}
+
+/** Destination of a rendered text*/
+typedef struct {
+    uint8_t *dst;
+    uint32_t stride;
+    const lv_area_t *clip;
+    d2_font_render_format_t fmt;    /**< A8 and I1 only*/
+    uint16_t fg;                    /**< RGB565 only*/
+    uint16_t bg;                    /**< RGB565 only*/
+} render_target_t;
+
+/**
+ * Draw a glyph with its bounding box at (`box_x`, `box_y`), only the part inside the clip area.
+ * @return false: the bitmap format is not supported
+ */
+typedef bool (*render_glyph_fn_t)(const lv_font_t *font, const d2_font_fmt_txt_glyph_t *glyph, int32_t box_x,
+                                  int32_t box_y, const render_target_t *target);
+
+/**
+ * Get the part of a glyph box inside the clip area, relative to the box.
+ * @return false: nothing is visible
+ */
+static bool glyph_window(const d2_font_fmt_txt_glyph_t *glyph, int32_t box_x, int32_t box_y, const lv_area_t *clip,
+                         lv_area_t *window)
+{
+    window->x1 = LV_MAX(clip->x1 - box_x, 0);
+    window->x2 = LV_MIN(clip->x2 - box_x, glyph->gdsc->box_w - 1);
+    window->y1 = LV_MAX(clip->y1 - box_y, 0);
+    window->y2 = LV_MIN(clip->y2 - box_y, glyph->gdsc->box_h - 1);
+    return window->x1 <= window->x2 && window->y1 <= window->y2;
+}
+
+static bool render_glyph_mask(const lv_font_t *font, const d2_font_fmt_txt_glyph_t *glyph, int32_t box_x, int32_t box_y,
+                              const render_target_t *target)
+{
+    lv_area_t window;
+    if (!glyph_window(glyph, box_x, box_y, target->clip, &window)) {
+        return true;
+    }
+    d2_font_fmt_txt_rows_t rows;
+    if (!d2_font_fmt_txt_rows_init(font, glyph, &rows)) {
+        return false;
+    }
+    d2_font_fmt_txt_rows_skip(&rows, window.y1);
+
+    uint8_t row[256];
+    int32_t len = window.x2 + 1 - window.x1;
+    uint8_t *dst_line = target->dst + (box_y + window.y1) * target->stride;
+    for (int32_t y = window.y1; y <= window.y2; y++) {
+        d2_font_fmt_txt_rows_read(&rows, window.x1, window.x2 + 1, row);
+        if (target->fmt == D2_FONT_RENDER_FORMAT_A8) {
+            blend_a8(dst_line + box_x + window.x1, row, len);
+        } else {
+            blend_i1(dst_line, box_x + window.x1, row, len);
+        }
+        dst_line += target->stride;
+    }
+    /*Rows below the clip area are not decoded*/
+    return true;
+}
+
+/**
+ * Place a laid out glyph on the line at (`pen_x`, `line_y`).
+ * @return true: the glyph touches the clip area, it has to be resolved and drawn at (`box_x`, `box_y`)
+ */
+static bool glyph_place(const lv_font_t *font, const d2_font_run_glyph_t *run_glyph, int32_t pen_x, int32_t line_y,
+                        const lv_area_t *clip, int32_t *box_x, int32_t *box_y)
+{
+    *box_x = pen_x + run_glyph->ofs_x;
+    *box_y = line_y + (font->line_height - font->base_line) - run_glyph->box_h - run_glyph->ofs_y;
+    return run_glyph->box_w && run_glyph->box_h && *box_x <= clip->x2 && *box_x + run_glyph->box_w > clip->x1 &&
+           *box_y <= clip->y2 && *box_y + run_glyph->box_h > clip->y1;
+}
+
+/** Lay out a text and draw the glyphs touching the clip area*/
+static esp_err_t render_text(const lv_font_t *font, const char *text, int32_t x, int32_t y,
+                             const render_target_t *target, render_glyph_fn_t render_glyph)
+{
+    int32_t pen_x = x;
+    int32_t line_y = y;
+    uint32_t i = 0;
+    uint32_t letter = d2_font_utf8_next(text, &i);
+    while (letter) {
+        uint32_t letter_next = d2_font_utf8_next(text, &i);
+        if (letter == '\n') {
+            pen_x = x;
+            line_y += font->line_height;
+            letter = letter_next;
+            continue;
+        }
+
+        d2_font_run_glyph_t run_glyph;
+        if (d2_font_fmt_txt_lookup_glyph(font, letter, letter_next, &run_glyph)) {
+            int32_t box_x;
+            int32_t box_y;
+            /*Only glyphs touching the clip area are resolved and read*/
+            if (glyph_place(font, &run_glyph, pen_x, line_y, target->clip, &box_x, &box_y)) {
+                /*The lookup already went through the cmaps, resolve its glyph id*/
+                d2_font_fmt_txt_glyph_t glyph;
+                if (d2_font_fmt_txt_resolve_gid(font, run_glyph.glyph_id, &glyph) &&
+                        !render_glyph(font, &glyph, box_x, box_y, target)) {
+                    ESP_LOGE(TAG, "Bitmap format not supported");
+                    return ESP_ERR_NOT_SUPPORTED;
+                }
+            }
+            pen_x += run_glyph.adv_w;
+        }
+        letter = letter_next;
+    }
+    return ESP_OK;
+}
+
+/** Same as `render_text` for glyph ids, 0 starts a new line*/
+static esp_err_t render_gids(const lv_font_t *font, const uint32_t *gids, uint32_t num, int32_t x, int32_t y,
+                             const render_target_t *target, render_glyph_fn_t render_glyph)
+{
+    int32_t pen_x = x;
+    int32_t line_y = y;
+    for (uint32_t i = 0; i < num; i++) {
+        if (gids[i] == 0) {
+            pen_x = x;
+            line_y += font->line_height;
+            continue;
+        }
+        d2_font_run_glyph_t run_glyph;
+        if (d2_font_fmt_txt_lookup_gid(font, gids[i], i + 1 < num ? gids[i + 1] : 0, &run_glyph)) {
+            int32_t box_x;
+            int32_t box_y;
+            if (glyph_place(font, &run_glyph, pen_x, line_y, target->clip, &box_x, &box_y)) {
+                d2_font_fmt_txt_glyph_t glyph;
+                if (d2_font_fmt_txt_resolve_gid(font, gids[i], &glyph) &&
+                        !render_glyph(font, &glyph, box_x, box_y, target)) {
+                    ESP_LOGE(TAG, "Bitmap format not supported");
+                    return ESP_ERR_NOT_SUPPORTED;
+                }
+            }
+            pen_x += run_glyph.adv_w;
+        }
+    }
+    return ESP_OK;
+}
+
+/**
+ * Check the destination of `d2_font_render_xx` for A8 and I1.
+ * @return ESP_ERR_INVALID_SIZE: nothing to draw, the clip area is empty
+ */
+static esp_err_t mask_target_check(uint8_t *dst, uint32_t stride, d2_font_render_format_t fmt, const lv_area_t *clip)
+{
+    if (dst == NULL || clip == NULL || clip->x1 < 0 || clip->y1 < 0 ||
+            (fmt != D2_FONT_RENDER_FORMAT_A8 && fmt != D2_FONT_RENDER_FORMAT_I1)) {
+        ESP_LOGE(TAG, "Invalid param");
+        return ESP_ERR_INVALID_ARG;
+    }
+    uint32_t width = fmt == D2_FONT_RENDER_FORMAT_A8 ? stride : stride * 8;
+    if (clip->x2 >= (int32_t)width) {
+        ESP_LOGE(TAG, "Clip area is wider than stride");
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (clip->x1 > clip->x2 || clip->y1 > clip->y2) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    return ESP_OK;
+}
+
+esp_err_t d2_font_render_utf8(const lv_font_t *font, const char *text, int32_t x, int32_t y,
+                              uint8_t *dst, uint32_t stride, d2_font_render_format_t fmt, const lv_area_t *clip)
+{
+    if (font == NULL || text == NULL || font->get_glyph_dsc != d2_font_get_glyph_dsc_fmt_txt) {
+        ESP_LOGE(TAG, "Invalid param");
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_err_t err = mask_target_check(dst, stride, fmt, clip);
+    if (err != ESP_OK) {
+        return err == ESP_ERR_INVALID_SIZE ? ESP_OK : err;
+    }
+    render_target_t target = { .dst = dst, .stride = stride, .clip = clip, .fmt = fmt };
+    return render_text(font, text, x, y, &target, render_glyph_mask);
+}
+
+esp_err_t d2_font_render_gids(const lv_font_t *font, const uint32_t *gids, uint32_t num, int32_t x, int32_t y,
+                              uint8_t *dst, uint32_t stride, d2_font_render_format_t fmt, const lv_area_t *clip)
+{
+    if (font == NULL || (gids == NULL && num) || font->get_glyph_dsc != d2_font_get_glyph_dsc_fmt_txt) {
+        ESP_LOGE(TAG, "Invalid param");
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_err_t err = mask_target_check(dst, stride, fmt, clip);
+    if (err != ESP_OK) {
+        return err == ESP_ERR_INVALID_SIZE ? ESP_OK : err;
+    }
+    render_target_t target = { .dst = dst, .stride = stride, .clip = clip, .fmt = fmt };
+    return render_gids(font, gids, num, x, y, &target, render_glyph_mask);
+}
+
+/** `fg` over `bg` with opacity `a`*/
+static inline uint16_t mix_rgb565(uint16_t fg, uint16_t bg, uint8_t a)
+{
+    uint32_t na = 0xFF - a;
+    uint32_t r = ((fg >> 11) * a + (bg >> 11) * na + 127) / 255;
+    uint32_t g = (((fg >> 5) & 0x3F) * a + ((bg >> 5) & 0x3F) * na + 127) / 255;
+    uint32_t b = ((fg & 0x1F) * a + (bg & 0x1F) * na + 127) / 255;
+    return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+#if CONFIG_D2_FONT_TILE_CACHE
+#define TILE_BUCKET_NUM     64
+
+/**
+ * A glyph blended into RGB565, followed by `box_w * box_h` pixels and `box_h` spans.
+ * A span is the first column with ink and the column after the last one, only the span of a row is copied.
+ */
+typedef struct d2_font_tile_t {
+    struct d2_font_tile_t *hash_next;
+    struct d2_font_tile_t *lru_prev;    /**< More recently used*/
+    struct d2_font_tile_t *lru_next;    /**< Less recently used*/
+    uint32_t glyph_id;
+    uint32_t size;                      /**< Bytes allocated for the tile*/
+    uint16_t fg;
+    uint16_t bg;
+    uint16_t box_w;
+    uint16_t box_h;
+} d2_font_tile_t;
+
+struct d2_font_tile_cache_t {
+    d2_font_tile_t *buckets[TILE_BUCKET_NUM];
+    d2_font_tile_t *lru_head;           /**< Most recently used*/
+    d2_font_tile_t *lru_tail;
+    size_t size;                        /**< Bytes of all the tiles*/
+};
+
+static inline uint16_t *tile_pixels(d2_font_tile_t *tile)
+{
+    return (uint16_t *)(tile + 1);
+}
+
+static inline uint8_t *tile_spans(d2_font_tile_t *tile)
+{
+    return (uint8_t *)(tile_pixels(tile) + tile->box_w * tile->box_h);
+}
+
+static inline uint32_t tile_bucket(uint32_t glyph_id, uint16_t fg, uint16_t bg)
+{
+    return (glyph_id ^ (fg * 31) ^ (bg * 17)) & (TILE_BUCKET_NUM - 1);
+}
+
+static void tile_lru_unlink(struct d2_font_tile_cache_t *cache, d2_font_tile_t *tile)
+{
+    if (tile->lru_prev) {
+        tile->lru_prev->lru_next = tile->lru_next;
+    } else {
+        cache->lru_head = tile->lru_next;
+    }
+    if (tile->lru_next) {
+        tile->lru_next->lru_prev = tile->lru_prev;
+    } else {
+        cache->lru_tail = tile->lru_prev;
+    }
+}
+
+static void tile_lru_push(struct d2_font_tile_cache_t *cache, d2_font_tile_t *tile)
+{
+    tile->lru_prev = NULL;
+    tile->lru_next = cache->lru_head;
+    if (cache->lru_head) {
+        cache->lru_head->lru_prev = tile;
+    } else {
+        cache->lru_tail = tile;
+    }
+    cache->lru_head = tile;
+}
+
+static void tile_evict(d2_font_context_t *ctx, d2_font_tile_t *tile)
+{
+    struct d2_font_tile_cache_t *cache = ctx->ext->tiles;
+    d2_font_tile_t **prev = &cache->buckets[tile_bucket(tile->glyph_id, tile->fg, tile->bg)];
+    while (*prev != tile) {
+        prev = &(*prev)->hash_next;
+    }
+    *prev = tile->hash_next;
+    tile_lru_unlink(cache, tile);
+    cache->size -= tile->size;
+    d2_font_mem_free(&ctx->mem, D2_FONT_MEM_CACHE, tile, tile->size);
+}
+
+/**
+ * Get the tile of a glyph in the given colors, blending it on a miss.
+ * @return the tile, NULL if it cannot be cached
+ */
+static d2_font_tile_t *tile_get(const lv_font_t *font, const d2_font_fmt_txt_glyph_t *glyph, uint16_t fg, uint16_t bg)
+{
+    d2_font_context_t *ctx = (d2_font_context_t *)font->user_data;
+    /*Runs may be held by the caller, the tiles are evicted from the cache below*/
+    uint32_t caches = D2_FONT_SHRINK_RETRY_PINNED;
+    if (ctx->ext->tiles == NULL) {
+        ctx->ext->tiles = d2_font_mem_alloc(&ctx->mem, D2_FONT_MEM_CACHE, sizeof(struct d2_font_tile_cache_t), true);
+        while (ctx->ext->tiles == NULL && d2_font_shrink_retry(font, &caches)) {
+            ctx->ext->tiles = d2_font_mem_alloc(&ctx->mem, D2_FONT_MEM_CACHE, sizeof(struct d2_font_tile_cache_t), true);
+        }
+        if (ctx->ext->tiles == NULL) {
+            return NULL;
+        }
+    }
+    struct d2_font_tile_cache_t *cache = ctx->ext->tiles;
+    uint32_t bucket = tile_bucket(glyph->glyph_id, fg, bg);
+    for (d2_font_tile_t *tile = cache->buckets[bucket]; tile; tile = tile->hash_next) {
+        if (tile->glyph_id == glyph->glyph_id && tile->fg == fg && tile->bg == bg) {
+            tile_lru_unlink(cache, tile);
+            tile_lru_push(cache, tile);
+            return tile;
+        }
+    }
+
+    uint32_t box_w = glyph->gdsc->box_w;
+    uint32_t box_h = glyph->gdsc->box_h;
+    uint32_t size = sizeof(d2_font_tile_t) + box_w * box_h * sizeof(uint16_t) + box_h * 2;
+    if (size > CONFIG_D2_FONT_TILE_CACHE_SIZE) {
+        return NULL;
+    }
+    d2_font_fmt_txt_rows_t rows;
+    if (!d2_font_fmt_txt_rows_init(font, glyph, &rows)) {
+        return NULL;
+    }
+    while (cache->lru_tail && cache->size + size > CONFIG_D2_FONT_TILE_CACHE_SIZE) {
+        tile_evict(ctx, cache->lru_tail);
+    }
+    d2_font_tile_t *tile = d2_font_mem_alloc(&ctx->mem, D2_FONT_MEM_CACHE, size, false);
+    /*Oldest first, only with the shrink hook like the other caches*/
+    while (tile == NULL && ctx->shrink_hook && cache->lru_tail) {
+        tile_evict(ctx, cache->lru_tail);
+        tile = d2_font_mem_alloc(&ctx->mem, D2_FONT_MEM_CACHE, size, false);
+    }
+    while (tile == NULL && d2_font_shrink_retry(font, &caches)) {
+        tile = d2_font_mem_alloc(&ctx->mem, D2_FONT_MEM_CACHE, size, false);
+    }
+    if (tile == NULL) {
+        return NULL;
+    }
+    tile->glyph_id = glyph->glyph_id;
+    tile->size = size;
+    tile->fg = fg;
+    tile->bg = bg;
+    tile->box_w = box_w;
+    tile->box_h = box_h;
+
+    uint8_t row[256];
+    uint16_t *pixels = tile_pixels(tile);
+    uint8_t *spans = tile_spans(tile);
+    for (uint32_t y = 0; y < box_h; y++) {
+        d2_font_fmt_txt_rows_read(&rows, 0, box_w, row);
+        uint8_t first = box_w;
+        uint8_t end = 0;
+        for (uint32_t x = 0; x < box_w; x++) {
+            pixels[x] = mix_rgb565(fg, bg, row[x]);
+            if (row[x]) {
+                if (first == box_w) {
+                    first = x;
+                }
+                end = x + 1;
+            }
+        }
+        spans[y * 2] = first < end ? first : 0;
+        spans[y * 2 + 1] = end;
+        pixels += box_w;
+    }
+
+    tile->hash_next = cache->buckets[bucket];
+    cache->buckets[bucket] = tile;
+    tile_lru_push(cache, tile);
+    cache->size += size;
+    return tile;
+}
+#endif
+
+static bool render_glyph_rgb565(const lv_font_t *font, const d2_font_fmt_txt_glyph_t *glyph, int32_t box_x,
+                                int32_t box_y, const render_target_t *target)
+{
+    lv_area_t window;
+    if (!glyph_window(glyph, box_x, box_y, target->clip, &window)) {
+        return true;
+    }
+    uint8_t *dst_line = target->dst + (box_y + window.y1) * target->stride;
+
+#if CONFIG_D2_FONT_TILE_CACHE
+    d2_font_tile_t *tile = tile_get(font, glyph, target->fg, target->bg);
+    if (tile) {
+        /*Copy the visible part of the ink span of every row*/
+        const uint8_t *spans = tile_spans(tile);
+        for (int32_t y = window.y1; y <= window.y2; y++) {
+            int32_t x_start = LV_MAX(spans[y * 2], window.x1);
+            int32_t x_end = LV_MIN(spans[y * 2 + 1], window.x2 + 1);
+            if (x_start < x_end) {
+                memcpy((uint16_t *)dst_line + box_x + x_start, tile_pixels(tile) + y * tile->box_w + x_start,
+                       (x_end - x_start) * sizeof(uint16_t));
+            }
+            dst_line += target->stride;
+        }
+        return true;
+    }
+#endif
+
+    d2_font_fmt_txt_rows_t rows;
+    if (!d2_font_fmt_txt_rows_init(font, glyph, &rows)) {
+        return false;
+    }
+    d2_font_fmt_txt_rows_skip(&rows, window.y1);
+    uint8_t row[256];
+    int32_t len = window.x2 + 1 - window.x1;
+    for (int32_t y = window.y1; y <= window.y2; y++) {
+        d2_font_fmt_txt_rows_read(&rows, window.x1, window.x2 + 1, row);
+        uint16_t *dst_px = (uint16_t *)dst_line + box_x + window.x1;
+        for (int32_t x = 0; x < len; x++) {
+            if (row[x]) {
+                dst_px[x] = mix_rgb565(target->fg, target->bg, row[x]);
+            }
+        }
+        dst_line += target->stride;
+    }
+    return true;
+}
+
+esp_err_t d2_font_render_utf8_rgb565(const lv_font_t *font, const char *text, int32_t x, int32_t y,
+                                     uint8_t *dst, uint32_t stride, uint16_t fg, uint16_t bg, const lv_area_t *clip)
+{
+    if (font == NULL || text == NULL || dst == NULL || clip == NULL || clip->x1 < 0 || clip->y1 < 0 ||
+            (stride & 0x1) || font->get_glyph_dsc != d2_font_get_glyph_dsc_fmt_txt) {
+        ESP_LOGE(TAG, "Invalid param");
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (clip->x2 >= (int32_t)(stride / 2)) {
+        ESP_LOGE(TAG, "Clip area is wider than stride");
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (clip->x1 > clip->x2 || clip->y1 > clip->y2) {
+        return ESP_OK;
+    }
+    render_target_t target = { .dst = dst, .stride = stride, .clip = clip, .fg = fg, .bg = bg };
+    return render_text(font, text, x, y, &target, render_glyph_rgb565);
+}
+
+void d2_font_tile_cache_clear(lv_font_t *font)
+{
+#if CONFIG_D2_FONT_TILE_CACHE
+    d2_font_context_t *ctx = (d2_font_context_t *)font->user_data;
+    if (ctx->ext->tiles == NULL) {
+        return;
+    }
+    while (ctx->ext->tiles->lru_tail) {
+        tile_evict(ctx, ctx->ext->tiles->lru_tail);
+    }
+    d2_font_mem_free(&ctx->mem, D2_FONT_MEM_CACHE, ctx->ext->tiles, sizeof(struct d2_font_tile_cache_t));
+    ctx->ext->tiles = NULL;
+#endif
+}
+
+esp_err_t d2_font_get_glyph_a8_area(const lv_font_t *font, uint32_t letter, const lv_area_t *area,
+                                    uint8_t *buf, uint32_t stride)
+{
+    if (font == NULL || area == NULL || buf == NULL || font->get_glyph_dsc != d2_font_get_glyph_dsc_fmt_txt) {
+        ESP_LOGE(TAG, "Invalid param");
+        return ESP_ERR_INVALID_ARG;
+    }
+    d2_font_fmt_txt_glyph_t glyph;
+    if (!d2_font_fmt_txt_resolve_glyph(font, letter, &glyph)) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (stride < glyph.gdsc->box_w) {
+        ESP_LOGE(TAG, "Stride is smaller than the glyph");
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!d2_font_fmt_txt_decode_a8_area(font, &glyph, area, buf, stride)) {
+        ESP_LOGE(TAG, "Bitmap format not supported");
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    return ESP_OK;
+}
+
+esp_err_t d2_font_get_glyph_a8_area_by_gid(const lv_font_t *font, uint32_t gid, const lv_area_t *area,
+                                           uint8_t *buf, uint32_t stride)
+{
+    if (font == NULL || area == NULL || buf == NULL || font->get_glyph_dsc != d2_font_get_glyph_dsc_fmt_txt) {
+        ESP_LOGE(TAG, "Invalid param");
+        return ESP_ERR_INVALID_ARG;
+    }
+    d2_font_fmt_txt_glyph_t glyph;
+    if (!d2_font_fmt_txt_resolve_gid(font, gid, &glyph)) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (stride < glyph.gdsc->box_w) {
+        ESP_LOGE(TAG, "Stride is smaller than the glyph");
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!d2_font_fmt_txt_decode_a8_area(font, &glyph, area, buf, stride)) {
+        ESP_LOGE(TAG, "Bitmap format not supported");
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    return ESP_OK;
+}
+
+esp_err_t d2_font_get_glyph_dsc_by_gid(const lv_font_t *font, uint32_t gid, uint32_t gid_next,
+                                       d2_font_run_glyph_t *out_glyph)
+{
+    if (font == NULL || out_glyph == NULL || font->get_glyph_dsc != d2_font_get_glyph_dsc_fmt_txt) {
+        ESP_LOGE(TAG, "Invalid param");
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!d2_font_fmt_txt_lookup_gid(font, gid, gid_next, out_glyph)) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    return ESP_OK;
+}
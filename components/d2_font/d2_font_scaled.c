@@ -0,0 +1,306 @@
+/*
+ * SPDX-FileCopyrightText: 2026 udoudou
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "d2_font_scaled.h"
+
+#include "string.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "lvgl.h"
+
+static const char *TAG = "d2_font_scaled";
+
+/** Growing buffer for decoded or upsampled glyphs*/
+typedef struct {
+    uint8_t *data;
+    size_t size;
+} scaled_scratch_t;
+
+typedef struct {
+    const lv_font_t *base;
+    uint8_t factor;
+    d2_font_scale_filter_t filter;
+    int8_t phase_ofs[D2_FONT_SCALED_FACTOR_MAX];    /**< Bilinear: first source pixel of a phase, relative*/
+    uint16_t phase_weight[D2_FONT_SCALED_FACTOR_MAX];   /**< Bilinear: weight of the second source pixel, /256*/
+    scaled_scratch_t src;           /**< The base glyph in A8*/
+    scaled_scratch_t tmp;           /**< Bilinear: source rows upsampled horizontally*/
+#if LVGL_VERSION_MAJOR < 9
+    scaled_scratch_t out;           /**< The upsampled glyph returned to LVGL*/
+#endif
+} d2_font_scaled_t;
+
+static bool scratch_reserve(scaled_scratch_t *scratch, size_t size)
+{
+    if (scratch->size >= size) {
+        return true;
+    }
+    uint8_t *tmp = heap_caps_realloc(scratch->data, size, MALLOC_CAP_8BIT);
+    if (tmp == NULL) {
+        return false;
+    }
+    scratch->data = tmp;
+    scratch->size = size;
+    return true;
+}
+
+/**
+ * Every source pixel becomes a factor x factor block: the first row of a block is widened,
+ * the others are copies of it.
+ */
+static void scale_nearest(const uint8_t *src, uint32_t src_stride, uint32_t src_w, uint32_t src_h,
+                          uint8_t *dst, uint32_t dst_stride, uint32_t factor)
+{
+    uint32_t dst_w = src_w * factor;
+    for (uint32_t y = 0; y < src_h; y++) {
+        const uint8_t *in = src + y * src_stride;
+        uint8_t *out = dst + y * factor * dst_stride;
+        if (factor == 2) {
+            for (uint32_t x = 0; x < src_w; x++) {
+                out[2 * x] = in[x];
+                out[2 * x + 1] = in[x];
+            }
+        } else {
+            uint8_t *out_tmp = out;
+            for (uint32_t x = 0; x < src_w; x++) {
+                for (uint32_t i = 0; i < factor; i++) {
+                    *out_tmp++ = in[x];
+                }
+            }
+        }
+        for (uint32_t i = 1; i < factor; i++) {
+            memcpy(out + i * dst_stride, out, dst_w);
+        }
+    }
+}
+
+/**
+ * Bilinear upsampling, one horizontal pass into `tmp` then one vertical pass.
+ * Destination pixels sample the source at their center; pixels past the edges repeat the edge pixels,
+ * so strokes touching the bounding box are not faded.
+ * @param tmp `src_h` rows of `src_w * factor` bytes
+ */
+static void scale_bilinear(const d2_font_scaled_t *scaled, const uint8_t *src, uint32_t src_stride, uint32_t src_w,
+                           uint32_t src_h, uint8_t *tmp, uint8_t *dst, uint32_t dst_stride)
+{
+    uint32_t factor = scaled->factor;
+    uint32_t dst_w = src_w * factor;
+    for (uint32_t y = 0; y < src_h; y++) {
+        const uint8_t *in = src + y * src_stride;
+        uint8_t *out = tmp + y * dst_w;
+        for (uint32_t x = 0; x < src_w; x++) {
+            for (uint32_t p = 0; p < factor; p++) {
+                int32_t a = (int32_t)x + scaled->phase_ofs[p];
+                int32_t b = LV_MIN(a + 1, (int32_t)src_w - 1);
+                a = LV_MAX(a, 0);
+                uint32_t w = scaled->phase_weight[p];
+                *out++ = (in[a] * (256 - w) + in[b] * w + 128) >> 8;
+            }
+        }
+    }
+    for (uint32_t y = 0; y < src_h; y++) {
+        for (uint32_t p = 0; p < factor; p++) {
+            int32_t a = (int32_t)y + scaled->phase_ofs[p];
+            int32_t b = LV_MIN(a + 1, (int32_t)src_h - 1);
+            a = LV_MAX(a, 0);
+            uint32_t w = scaled->phase_weight[p];
+            const uint8_t *in_a = tmp + a * dst_w;
+            const uint8_t *in_b = tmp + b * dst_w;
+            uint8_t *out = dst + (y * factor + p) * dst_stride;
+            if (w == 0 || a == b) {
+                memcpy(out, in_a, dst_w);
+                continue;
+            }
+            for (uint32_t x = 0; x < dst_w; x++) {
+                out[x] = (in_a[x] * (256 - w) + in_b[x] * w + 128) >> 8;
+            }
+        }
+    }
+}
+
+/** Upsample an A8 glyph with the filter of the font*/
+static bool scale_a8(d2_font_scaled_t *scaled, const uint8_t *src, uint32_t src_stride, uint32_t src_w, uint32_t src_h,
+                     uint8_t *dst, uint32_t dst_stride)
+{
+    if (scaled->filter == D2_FONT_SCALE_NEAREST) {
+        scale_nearest(src, src_stride, src_w, src_h, dst, dst_stride, scaled->factor);
+        return true;
+    }
+    if (!scratch_reserve(&scaled->tmp, src_w * scaled->factor * src_h)) {
+        return false;
+    }
+    scale_bilinear(scaled, src, src_stride, src_w, src_h, scaled->tmp.data, dst, dst_stride);
+    return true;
+}
+
+static bool scaled_get_glyph_dsc(const lv_font_t *font, lv_font_glyph_dsc_t *dsc_out, uint32_t unicode_letter,
+                                 uint32_t unicode_letter_next)
+{
+    const d2_font_scaled_t *scaled = (const d2_font_scaled_t *)font->user_data;
+    const lv_font_t *base = scaled->base;
+    if (!base->get_glyph_dsc(base, dsc_out, unicode_letter, unicode_letter_next)) {
+        return false;
+    }
+#if LVGL_VERSION_MAJOR >= 9
+    /*Only bitmaps are upsampled*/
+    if (dsc_out->format > LV_FONT_GLYPH_FORMAT_A8) {
+        return false;
+    }
+#endif
+    int32_t factor = scaled->factor;
+    if ((int32_t)dsc_out->box_w * factor > UINT16_MAX || (int32_t)dsc_out->box_h * factor > UINT16_MAX ||
+            (int32_t)dsc_out->adv_w * factor > UINT16_MAX) {
+        return false;
+    }
+    dsc_out->adv_w *= factor;
+    dsc_out->box_w *= factor;
+    dsc_out->box_h *= factor;
+    dsc_out->ofs_x *= factor;
+    dsc_out->ofs_y *= factor;
+#if LVGL_VERSION_MAJOR < 9
+    /*Glyphs are returned in A8 whatever the bpp of the base font*/
+    dsc_out->bpp = 8;
+#endif
+    return true;
+}
+
+#if LVGL_VERSION_MAJOR >= 9
+static const void *scaled_get_bitmap(lv_font_glyph_dsc_t *g_dsc, lv_draw_buf_t *draw_buf)
+{
+    const lv_font_t *font = g_dsc->resolved_font;
+    d2_font_scaled_t *scaled = (d2_font_scaled_t *)font->user_data;
+    const lv_font_t *base = scaled->base;
+    uint32_t src_w = g_dsc->box_w / scaled->factor;
+    uint32_t src_h = g_dsc->box_h / scaled->factor;
+    if (src_w == 0 || src_h == 0) {
+        return NULL;
+    }
+
+    /*The base font decodes into a draw buffer of its own size*/
+    uint32_t src_stride = lv_draw_buf_width_to_stride(src_w, LV_COLOR_FORMAT_A8);
+    if (!scratch_reserve(&scaled->src, src_stride * src_h)) {
+        return NULL;
+    }
+    lv_draw_buf_t src_buf;
+    lv_draw_buf_init(&src_buf, src_w, src_h, LV_COLOR_FORMAT_A8, src_stride, scaled->src.data, src_stride * src_h);
+    lv_font_glyph_dsc_t base_dsc = *g_dsc;
+    base_dsc.resolved_font = base;
+    base_dsc.box_w = src_w;
+    base_dsc.box_h = src_h;
+    /*Pinned glyphs of the base font come back in their own buffer*/
+    const lv_draw_buf_t *src = base->get_glyph_bitmap(&base_dsc, &src_buf);
+    if (src == NULL) {
+        return NULL;
+    }
+
+    uint32_t dst_stride = lv_draw_buf_width_to_stride(g_dsc->box_w, LV_COLOR_FORMAT_A8);
+    if (!scale_a8(scaled, src->data, src->header.stride, src_w, src_h, draw_buf->data, dst_stride)) {
+        return NULL;
+    }
+    lv_draw_buf_flush_cache(draw_buf, NULL);
+    return draw_buf;
+}
+#else
+static const uint8_t *scaled_get_bitmap(const lv_font_t *font, uint32_t letter)
+{
+    d2_font_scaled_t *scaled = (d2_font_scaled_t *)font->user_data;
+    const lv_font_t *base = scaled->base;
+    lv_font_glyph_dsc_t dsc;
+    if (!base->get_glyph_dsc(base, &dsc, letter, 0) || dsc.box_w == 0 || dsc.box_h == 0) {
+        return NULL;
+    }
+    const uint8_t *bitmap = base->get_glyph_bitmap(base, letter);
+    if (bitmap == NULL) {
+        return NULL;
+    }
+
+    /*Unpack the bitstream of the base font, rows are not byte aligned*/
+    uint32_t src_w = dsc.box_w;
+    uint32_t src_h = dsc.box_h;
+    /*3 bpp glyphs are returned as 4 bpp, as LVGL v8 draws them*/
+    uint32_t bpp = dsc.bpp == 3 ? 4 : dsc.bpp;
+    if (bpp == 0 || bpp > 8 || !scratch_reserve(&scaled->src, src_w * src_h) ||
+            !scratch_reserve(&scaled->out, src_w * src_h * scaled->factor * scaled->factor)) {
+        return NULL;
+    }
+    uint32_t max = (1 << bpp) - 1;
+    uint32_t bit_pos = 0;
+    for (uint32_t i = 0; i < src_w * src_h; i++, bit_pos += bpp) {
+        /*Two bytes cover any value of up to 8 bits*/
+        uint32_t word = bitmap[bit_pos >> 3] << 8;
+        if ((bit_pos & 0x7) + bpp > 8) {
+            word |= bitmap[(bit_pos >> 3) + 1];
+        }
+        uint32_t value = (word >> (16 - bpp - (bit_pos & 0x7))) & max;
+        scaled->src.data[i] = (value * 255 + max / 2) / max;
+    }
+
+    if (!scale_a8(scaled, scaled->src.data, src_w, src_w, src_h, scaled->out.data, src_w * scaled->factor)) {
+        return NULL;
+    }
+    return scaled->out.data;
+}
+#endif
+
+esp_err_t d2_font_load_scaled(const lv_font_t *base_font, uint8_t factor, d2_font_scale_filter_t filter,
+                              lv_font_t **out_font)
+{
+    if (out_font == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *out_font = NULL;
+    if (base_font == NULL || factor < 2 || factor > D2_FONT_SCALED_FACTOR_MAX ||
+            (filter != D2_FONT_SCALE_NEAREST && filter != D2_FONT_SCALE_BILINEAR)) {
+        ESP_LOGE(TAG, "Invalid param");
+        return ESP_ERR_INVALID_ARG;
+    }
+    lv_font_t *font = heap_caps_calloc(1, sizeof(lv_font_t) + sizeof(d2_font_scaled_t),
+                                       MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (font == NULL) {
+        ESP_LOGE(TAG, "malloc failed");
+        return ESP_ERR_NO_MEM;
+    }
+    d2_font_scaled_t *scaled = (d2_font_scaled_t *)(font + 1);
+    scaled->base = base_font;
+    scaled->factor = factor;
+    scaled->filter = filter;
+    /*
+     * Pixel p of a block samples the source at (2p + 1 - factor) / (2 * factor) from the center of its
+     * source pixel, between that pixel and the previous or the next one.
+     */
+    for (int32_t p = 0; p < factor; p++) {
+        int32_t ofs = 2 * p + 1 - factor;
+        if (ofs < 0) {
+            ofs += 2 * factor;
+            scaled->phase_ofs[p] = -1;
+        }
+        scaled->phase_weight[p] = (ofs * 256 + factor) / (2 * factor);
+    }
+
+    font->get_glyph_dsc = scaled_get_glyph_dsc;
+    font->get_glyph_bitmap = scaled_get_bitmap;
+    font->user_data = scaled;
+    font->line_height = base_font->line_height * factor;
+    font->base_line = base_font->base_line * factor;
+    font->subpx = base_font->subpx;
+    font->underline_position = base_font->underline_position * factor;
+    font->underline_thickness = base_font->underline_thickness * factor;
+
+    *out_font = font;
+    return ESP_OK;
+}
+
+void d2_font_unload_scaled(lv_font_t *font)
+{
+    if (font == NULL) {
+        return;
+    }
+    d2_font_scaled_t *scaled = (d2_font_scaled_t *)font->user_data;
+    heap_caps_free(scaled->src.data);
+    heap_caps_free(scaled->tmp.data);
+#if LVGL_VERSION_MAJOR < 9
+    heap_caps_free(scaled->out.data);
+#endif
+    heap_caps_free(font);
+}
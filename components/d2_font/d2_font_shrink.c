@@ -0,0 +1,254 @@
+/*
+ * SPDX-FileCopyrightText: 2026 udoudou
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "d2_font_shrink.h"
+
+#include "string.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "lvgl.h"
+
+#include "d2_font.h"
+#include "d2_font_fmt_txt.h"
+#include "d2_font_render.h"
+#include "d2_font_priv.h"
+
+static const char *TAG = "d2_font_shrink";
+
+#define SHRINK_HOOK_PERIOD_MS   100
+
+#if LVGL_VERSION_MAJOR < 9
+#define lv_timer_delete(timer)          lv_timer_del(timer)
+#define lv_timer_get_user_data(timer)   ((timer)->user_data)
+#endif
+
+struct d2_font_shrink_hook_t {
+    d2_font_shrink_hook_config_t config;
+    lv_font_t *font;
+    lv_timer_t *timer;              /*NULL: only shrunk when an allocation fails*/
+    int level;                      /*Last level applied, -1: none*/
+    size_t cache_used;              /*CACHE memory of the font after the last shrink*/
+};
+
+static bool is_fmt_txt(const lv_font_t *font)
+{
+    return font && font->get_glyph_bitmap == d2_font_get_bitmap_fmt_txt;
+}
+
+esp_err_t d2_font_shrink(lv_font_t *font, d2_font_shrink_level_t level)
+{
+    if (!is_fmt_txt(font) || level >= D2_FONT_SHRINK_LEVEL_MAX) {
+        ESP_LOGE(TAG, "Invalid param");
+        return ESP_ERR_INVALID_ARG;
+    }
+    d2_font_context_t *ctx = (d2_font_context_t *)font->user_data;
+#if CONFIG_D2_FONT_PREFETCH
+    /*The prefetch task looks glyphs up in the ASCII table and the cmaps*/
+    if (level >= D2_FONT_SHRINK_INDEX && ctx->ext->prefetch) {
+        ESP_LOGE(TAG, "Disable the prefetch first");
+        return ESP_ERR_INVALID_STATE;
+    }
+#endif
+
+    d2_font_run_cache_clear(font);
+    d2_font_tile_cache_clear(font);
+#if LVGL_VERSION_MAJOR < 9
+    d2_font_mem_free(&ctx->mem, D2_FONT_MEM_SCRATCH, ctx->ext->bitmap_out, ctx->ext->bitmap_out_size);
+    ctx->ext->bitmap_out = NULL;
+    ctx->ext->bitmap_out_size = 0;
+#endif
+    if (level >= D2_FONT_SHRINK_PINNED) {
+        d2_font_preload_release(font);
+        d2_font_budget_clear(font);
+    }
+    if (level >= D2_FONT_SHRINK_INDEX) {
+#if CONFIG_D2_FONT_ASCII_TABLE
+        d2_font_ascii_table_free(font);
+#endif
+        /*Built by the first lookups, which map a suspended font again before it*/
+        if (ctx->gid_ranges) {
+            const d2_font_fmt_txt_dsc_t *fdsc = (const d2_font_fmt_txt_dsc_t *)(ctx->base_ptr + (uint32_t)font->dsc);
+            d2_font_mem_free(&ctx->mem, D2_FONT_MEM_INDEX, ctx->gid_ranges,
+                             fdsc->cmap_num * sizeof(d2_font_fmt_txt_gid_range_t));
+            ctx->gid_ranges = NULL;
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t d2_font_suspend(lv_font_t *font)
+{
+    if (!is_fmt_txt(font)) {
+        ESP_LOGE(TAG, "Invalid param");
+        return ESP_ERR_INVALID_ARG;
+    }
+    d2_font_context_t *ctx = (d2_font_context_t *)font->user_data;
+    if (ctx->suspended) {
+        return ESP_OK;
+    }
+#if CONFIG_D2_FONT_PREFETCH
+    if (ctx->ext->prefetch) {
+        ESP_LOGE(TAG, "Disable the prefetch first");
+        return ESP_ERR_INVALID_STATE;
+    }
+#endif
+    d2_font_shrink(font, D2_FONT_SHRINK_INDEX);
+    /*The cached cmaps point into the mapping*/
+    memset(ctx->cache, 0, sizeof(ctx->cache));
+    if (ctx->mmap_handle) {
+        esp_partition_munmap((esp_partition_mmap_handle_t)ctx->mmap_handle);
+        ctx->mmap_handle = NULL;
+        ctx->base_ptr = NULL;
+        ctx->mem.mmap_size = 0;
+    }
+    ctx->suspended = true;
+    ESP_LOGD(TAG, "Font %p suspended", font);
+    return ESP_OK;
+}
+
+esp_err_t d2_font_resume(lv_font_t *font)
+{
+    if (!is_fmt_txt(font)) {
+        ESP_LOGE(TAG, "Invalid param");
+        return ESP_ERR_INVALID_ARG;
+    }
+    d2_font_context_t *ctx = (d2_font_context_t *)font->user_data;
+    if (!ctx->suspended) {
+        return ESP_OK;
+    }
+    if (ctx->base_ptr == NULL) {
+        const esp_partition_t *partition = (const esp_partition_t *)ctx->partition;
+        const void *map_ptr;
+        esp_partition_mmap_handle_t map_handle;
+        esp_err_t err = esp_partition_mmap(partition, 0, partition->size, ESP_PARTITION_MMAP_DATA, &map_ptr, &map_handle);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Partition mmap failed");
+            return err;
+        }
+        /*Checked at load: the partition is the same, only the pointers into the old mapping move*/
+        uint8_t *base_ptr = (uint8_t *)map_ptr + ctx->base_offset;
+        if (ctx->cmap_ram == NULL) {
+            const d2_font_fmt_txt_dsc_t *fdsc = (const d2_font_fmt_txt_dsc_t *)(base_ptr + (uint32_t)font->dsc);
+            ctx->cmaps = (const d2_font_fmt_txt_cmap_t *)(base_ptr + (uint32_t)fdsc->cmaps);
+            ctx->cmap_base = base_ptr;
+        }
+        ctx->base_ptr = base_ptr;
+        ctx->mmap_handle = (void *)map_handle;
+        ctx->mem.mmap_size = partition->size;
+    }
+    ctx->suspended = false;
+#if CONFIG_D2_FONT_ASCII_TABLE
+    if (ctx->ext->ascii == NULL) {
+        d2_font_ascii_table_create(font);
+    }
+#endif
+    ESP_LOGD(TAG, "Font %p resumed", font);
+    return ESP_OK;
+}
+
+bool d2_font_shrink_retry(const lv_font_t *font, uint32_t *caches)
+{
+    d2_font_context_t *ctx = (d2_font_context_t *)font->user_data;
+    if (ctx->shrink_hook == NULL) {
+        return false;
+    }
+    lv_font_t *shrunk = (lv_font_t *)font;
+    while (*caches) {
+        uint32_t cache = *caches & -*caches;
+        *caches &= ~cache;
+        size_t used = ctx->mem.used[D2_FONT_MEM_CACHE];
+        if (cache == D2_FONT_SHRINK_RETRY_RUNS) {
+            d2_font_run_cache_clear(shrunk);
+        } else if (cache == D2_FONT_SHRINK_RETRY_TILES) {
+            d2_font_tile_cache_clear(shrunk);
+        } else if (cache == D2_FONT_SHRINK_RETRY_PINNED) {
+            d2_font_preload_release(shrunk);
+            d2_font_budget_clear(shrunk);
+        }
+        if (ctx->mem.used[D2_FONT_MEM_CACHE] < used) {
+            ESP_LOGW(TAG, "Allocation failed, font %p freed %u bytes of cache", font,
+                     (unsigned)(used - ctx->mem.used[D2_FONT_MEM_CACHE]));
+            return true;
+        }
+    }
+    return false;
+}
+
+static void shrink_hook_timer_cb(lv_timer_t *timer)
+{
+    struct d2_font_shrink_hook_t *hook = lv_timer_get_user_data(timer);
+    size_t free_size = heap_caps_get_free_size(hook->config.caps);
+    int level = -1;
+    for (int i = 0; i < D2_FONT_SHRINK_LEVEL_MAX; i++) {
+        if (free_size < hook->config.free_below[i]) {
+            level = i;
+        }
+    }
+    d2_font_context_t *ctx = (d2_font_context_t *)hook->font->user_data;
+#if CONFIG_D2_FONT_PREFETCH
+    if (level >= D2_FONT_SHRINK_INDEX && ctx->ext->prefetch) {
+        level = D2_FONT_SHRINK_PINNED;
+    }
+#endif
+    /*While the heap stays low, only shrink again what the font cached since the last time*/
+    bool shrink = level > hook->level || (level >= 0 && ctx->mem.used[D2_FONT_MEM_CACHE] > hook->cache_used);
+    if (level > hook->level) {
+        ESP_LOGW(TAG, "%u bytes free, font %p shrunk to level %d", (unsigned)free_size, hook->font, level);
+    }
+    hook->level = level;
+    if (shrink) {
+        d2_font_shrink(hook->font, (d2_font_shrink_level_t)level);
+        hook->cache_used = ctx->mem.used[D2_FONT_MEM_CACHE];
+    }
+}
+
+esp_err_t d2_font_shrink_hook_enable(lv_font_t *font, const d2_font_shrink_hook_config_t *config)
+{
+    if (!is_fmt_txt(font) || config == NULL) {
+        ESP_LOGE(TAG, "Invalid param");
+        return ESP_ERR_INVALID_ARG;
+    }
+    d2_font_context_t *ctx = (d2_font_context_t *)font->user_data;
+    d2_font_shrink_hook_disable(font);
+
+    struct d2_font_shrink_hook_t *hook = d2_font_mem_alloc(&ctx->mem, D2_FONT_MEM_CONTEXT,
+                                                           sizeof(struct d2_font_shrink_hook_t), true);
+    if (hook == NULL) {
+        ESP_LOGE(TAG, "malloc failed");
+        return ESP_ERR_NO_MEM;
+    }
+    hook->config = *config;
+    hook->font = font;
+    hook->level = -1;
+    if (!config->timer_disabled) {
+        hook->timer = lv_timer_create(shrink_hook_timer_cb, config->period_ms ? config->period_ms : SHRINK_HOOK_PERIOD_MS,
+                                      hook);
+        if (hook->timer == NULL) {
+            ESP_LOGE(TAG, "malloc failed");
+            d2_font_mem_free(&ctx->mem, D2_FONT_MEM_CONTEXT, hook, sizeof(struct d2_font_shrink_hook_t));
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    ctx->shrink_hook = hook;
+    return ESP_OK;
+}
+
+void d2_font_shrink_hook_disable(lv_font_t *font)
+{
+    if (!is_fmt_txt(font)) {
+        return;
+    }
+    d2_font_context_t *ctx = (d2_font_context_t *)font->user_data;
+    struct d2_font_shrink_hook_t *hook = ctx->shrink_hook;
+    if (hook == NULL) {
+        return;
+    }
+    if (hook->timer) {
+        lv_timer_delete(hook->timer);
+    }
+    d2_font_mem_free(&ctx->mem, D2_FONT_MEM_CONTEXT, hook, sizeof(struct d2_font_shrink_hook_t));
+    ctx->shrink_hook = NULL;
+}
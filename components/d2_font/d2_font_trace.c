@@ -0,0 +1,122 @@
+/*
+ * SPDX-FileCopyrightText: 2026 udoudou
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "d2_font_trace.h"
+
+#include "stdio.h"
+#include "esp_log.h"
+
+#include "d2_font_fmt_txt.h"
+#include "d2_font_priv.h"
+
+#if CONFIG_D2_FONT_TRACE
+static const char *TAG = "d2_font_trace";
+
+/** The oldest event still in the ring and the number of events in it*/
+static void trace_window(const d2_font_trace_t *trace, uint32_t *first, uint32_t *num)
+{
+    *num = LV_MIN(trace->total, CONFIG_D2_FONT_TRACE_EVENTS);
+    *first = trace->total - *num;
+}
+#endif
+
+esp_err_t d2_font_trace_start(lv_font_t *font)
+{
+#if CONFIG_D2_FONT_TRACE
+    if (font == NULL || font->get_glyph_bitmap != d2_font_get_bitmap_fmt_txt) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    d2_font_context_t *ctx = (d2_font_context_t *)font->user_data;
+    if (ctx->ext->trace) {
+        ctx->ext->trace->total = 0;
+        return ESP_OK;
+    }
+    d2_font_trace_t *trace = d2_font_mem_alloc(&ctx->mem, D2_FONT_MEM_SCRATCH, sizeof(d2_font_trace_t), false);
+    if (trace == NULL) {
+        ESP_LOGE(TAG, "malloc failed");
+        return ESP_ERR_NO_MEM;
+    }
+    trace->total = 0;
+    ctx->ext->trace = trace;
+    return ESP_OK;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+esp_err_t d2_font_trace_stop(lv_font_t *font)
+{
+#if CONFIG_D2_FONT_TRACE
+    if (font == NULL || font->get_glyph_bitmap != d2_font_get_bitmap_fmt_txt) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    d2_font_context_t *ctx = (d2_font_context_t *)font->user_data;
+    if (ctx->ext->trace == NULL) {
+        return ESP_OK;
+    }
+    d2_font_mem_free(&ctx->mem, D2_FONT_MEM_SCRATCH, ctx->ext->trace, sizeof(d2_font_trace_t));
+    ctx->ext->trace = NULL;
+    return ESP_OK;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+esp_err_t d2_font_trace_read(const lv_font_t *font, d2_font_trace_event_t *events, uint32_t max, uint32_t *out_num,
+                             uint32_t *out_dropped)
+{
+#if CONFIG_D2_FONT_TRACE
+    if (font == NULL || (events == NULL && max) || out_num == NULL ||
+            font->get_glyph_bitmap != d2_font_get_bitmap_fmt_txt) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    const d2_font_context_t *ctx = (const d2_font_context_t *)font->user_data;
+    const d2_font_trace_t *trace = ctx->ext->trace;
+    if (trace == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    uint32_t first;
+    uint32_t num;
+    trace_window(trace, &first, &num);
+    *out_num = LV_MIN(num, max);
+    for (uint32_t i = 0; i < *out_num; i++) {
+        events[i] = trace->events[(first + i) % CONFIG_D2_FONT_TRACE_EVENTS];
+    }
+    if (out_dropped) {
+        *out_dropped = first;
+    }
+    return ESP_OK;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+esp_err_t d2_font_trace_dump(const lv_font_t *font)
+{
+#if CONFIG_D2_FONT_TRACE
+    if (font == NULL || font->get_glyph_bitmap != d2_font_get_bitmap_fmt_txt) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    const d2_font_context_t *ctx = (const d2_font_context_t *)font->user_data;
+    const d2_font_trace_t *trace = ctx->ext->trace;
+    if (trace == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    uint32_t first;
+    uint32_t num;
+    trace_window(trace, &first, &num);
+    /*Plain lines without log prefixes, they are parsed by d2_font_trace.py*/
+    printf("d2_font_trace begin %" PRIu32 " dropped %" PRIu32 "\n", num, first);
+    for (uint32_t i = 0; i < num; i++) {
+        const d2_font_trace_event_t *event = &trace->events[(first + i) % CONFIG_D2_FONT_TRACE_EVENTS];
+        printf("d2t %u %" PRIx32 " %" PRIu32 " %" PRIu32 " %" PRIu32 "\n", (unsigned)event->kind,
+               (uint32_t)event->letter, event->glyph_id, event->bitmap_ofs, event->bitmap_len);
+    }
+    printf("d2_font_trace end\n");
+    return ESP_OK;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
@@ -0,0 +1,148 @@
+/*
+ * SPDX-FileCopyrightText: 2026 udoudou
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "d2_font.h"
+
+#include <stdio.h>
+#include <inttypes.h>
+#include "string.h"
+#include "esp_partition.h"
+#include "esp_log.h"
+#include "nvs.h"
+
+#include "d2_font_priv.h"
+
+#if CONFIG_D2_FONT_VERIFY_CACHE
+static const char *TAG = "d2_font_verify";
+
+#define VERIFY_NVS_NAMESPACE    "d2_font"
+#define VERIFY_RECORD_VERSION   1
+
+/** A font checked with its full SHA-256, stored in NVS under the partition address*/
+typedef struct {
+    uint32_t version;
+    uint32_t address;
+    uint32_t length;                /**< Bytes covered by the SHA-256*/
+    char label[17];
+    uint8_t sha256[32];             /**< The SHA-256 stored in the font*/
+} __attribute__((packed)) d2_font_verify_record_bin_t;
+
+static void record_key(const esp_partition_t *partition, char *key)
+{
+    snprintf(key, NVS_KEY_NAME_MAX_SIZE, "%08" PRIx32, partition->address);
+}
+
+static void record_fill(const esp_partition_t *partition, const uint8_t *bin_ptr, uint32_t length,
+                        d2_font_verify_record_bin_t *record)
+{
+    memset(record, 0, sizeof(d2_font_verify_record_bin_t));
+    record->version = VERIFY_RECORD_VERSION;
+    record->address = partition->address;
+    record->length = length;
+    memcpy(record->label, partition->label, sizeof(record->label));
+    memcpy(record->sha256, bin_ptr + length, 32);
+}
+
+static bool record_match(const esp_partition_t *partition, const uint8_t *bin_ptr, uint32_t length)
+{
+    nvs_handle_t handle;
+    if (nvs_open(VERIFY_NVS_NAMESPACE, NVS_READONLY, &handle) != ESP_OK) {
+        return false;
+    }
+    char key[NVS_KEY_NAME_MAX_SIZE];
+    record_key(partition, key);
+    d2_font_verify_record_bin_t stored;
+    size_t size = sizeof(stored);
+    esp_err_t err = nvs_get_blob(handle, key, &stored, &size);
+    nvs_close(handle);
+    if (err != ESP_OK || size != sizeof(stored)) {
+        return false;
+    }
+    d2_font_verify_record_bin_t record;
+    record_fill(partition, bin_ptr, length, &record);
+    return memcmp(&stored, &record, sizeof(record)) == 0;
+}
+
+static void record_store(const esp_partition_t *partition, const uint8_t *bin_ptr, uint32_t length)
+{
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(VERIFY_NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (err != ESP_OK) {
+        /*NVS is not initialized by the application, verify every time*/
+        ESP_LOGD(TAG, "nvs_open failed: %s", esp_err_to_name(err));
+        return;
+    }
+    char key[NVS_KEY_NAME_MAX_SIZE];
+    record_key(partition, key);
+    d2_font_verify_record_bin_t record;
+    record_fill(partition, bin_ptr, length, &record);
+    err = nvs_set_blob(handle, key, &record, sizeof(record));
+    if (err == ESP_OK) {
+        err = nvs_commit(handle);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to store the result: %s", esp_err_to_name(err));
+    }
+    nvs_close(handle);
+}
+#endif
+
+esp_err_t d2_font_verify(const esp_partition_t *partition, const uint8_t *bin_ptr, uint32_t length)
+{
+#if CONFIG_D2_FONT_VERIFY_CACHE
+    if (partition && record_match(partition, bin_ptr, length)) {
+        return ESP_OK;
+    }
+#endif
+    esp_err_t err = d2_font_check_sha256(bin_ptr, length);
+#if CONFIG_D2_FONT_VERIFY_CACHE
+    if (err == ESP_OK && partition) {
+        record_store(partition, bin_ptr, length);
+    }
+#endif
+    return err;
+}
+
+esp_err_t d2_font_verify_cache_invalidate_partition(const esp_partition_t *partition)
+{
+#if CONFIG_D2_FONT_VERIFY_CACHE
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(VERIFY_NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (err == ESP_ERR_NVS_NOT_FOUND || err == ESP_ERR_NVS_NOT_INITIALIZED) {
+        /*Nothing was recorded*/
+        return ESP_OK;
+    }
+    if (err != ESP_OK) {
+        return err;
+    }
+    char key[NVS_KEY_NAME_MAX_SIZE];
+    record_key(partition, key);
+    err = nvs_erase_key(handle, key);
+    if (err == ESP_ERR_NVS_NOT_FOUND) {
+        err = ESP_OK;
+    } else if (err == ESP_OK) {
+        err = nvs_commit(handle);
+    }
+    nvs_close(handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to invalidate: %s", esp_err_to_name(err));
+    }
+    return err;
+#else
+    return ESP_OK;
+#endif
+}
+
+esp_err_t d2_font_verify_cache_invalidate(const char *label)
+{
+    if (label == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    const esp_partition_t *partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, label);
+    if (partition == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    return d2_font_verify_cache_invalidate_partition(partition);
+}
@@ -0,0 +1,132 @@
+/*
+ * SPDX-FileCopyrightText: 2026 udoudou
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_private/partition_linux.h"
+#include "unity.h"
+#include "unity_fixture.h"
+
+#include "d2_font.h"
+#include "d2_font_delta.h"
+#include "test_d2_font_partition.h"
+
+#define OLD_FONT    test_font_old_start, (size_t)(test_font_old_end - test_font_old_start)
+#define NEW_FONT    test_font_new_start, (size_t)(test_font_new_end - test_font_new_start)
+#define OTHER_FONT  test_font_other_start, (size_t)(test_font_other_end - test_font_other_start)
+#define PATCH       test_font_patch_start, (size_t)(test_font_patch_end - test_font_patch_start)
+
+TEST_GROUP(d2_font_delta);
+
+TEST_SETUP(d2_font_delta)
+{
+    test_font_write(OLD_FONT);
+}
+
+TEST_TEAR_DOWN(d2_font_delta)
+{
+    esp_partition_fail_after(SIZE_MAX, ESP_PARTITION_FAIL_AFTER_MODE_BOTH);
+}
+
+TEST(d2_font_delta, apply)
+{
+    TEST_ESP_OK(d2_font_delta_apply(TEST_FONT_LABEL, PATCH));
+    TEST_ASSERT_TRUE(test_font_equal(NEW_FONT));
+
+    lv_font_t *font;
+    TEST_ESP_OK(d2_font_load_from_partition(TEST_FONT_LABEL, &font));
+    d2_font_unload(font);
+
+    /*Nothing left to recover*/
+    TEST_ESP_OK(d2_font_delta_recover(TEST_FONT_LABEL));
+    TEST_ASSERT_TRUE(test_font_equal(NEW_FONT));
+}
+
+/* The added glyphs move every section after the glyph index: the moved bytes are copied, not carried */
+TEST(d2_font_delta, patch_size)
+{
+    size_t new_size = test_font_new_end - test_font_new_start;
+    size_t patch_size = test_font_patch_end - test_font_patch_start;
+    printf("new font %u bytes, patch %u bytes\n", (unsigned)new_size, (unsigned)patch_size);
+    TEST_ASSERT_LESS_THAN_UINT32(new_size / 8, patch_size);
+}
+
+TEST(d2_font_delta, applied_twice)
+{
+    TEST_ESP_OK(d2_font_delta_apply(TEST_FONT_LABEL, PATCH));
+    TEST_ESP_OK(d2_font_delta_apply(TEST_FONT_LABEL, PATCH));
+    TEST_ASSERT_TRUE(test_font_equal(NEW_FONT));
+}
+
+TEST(d2_font_delta, other_font)
+{
+    test_font_write(OTHER_FONT);
+    TEST_ESP_ERR(ESP_ERR_INVALID_VERSION, d2_font_delta_apply(TEST_FONT_LABEL, PATCH));
+    TEST_ASSERT_TRUE(test_font_equal(OTHER_FONT));
+}
+
+TEST(d2_font_delta, corrupted_patch)
+{
+    size_t size = test_font_patch_end - test_font_patch_start;
+    uint8_t *patch = malloc(size);
+    TEST_ASSERT_NOT_NULL(patch);
+    memcpy(patch, test_font_patch_start, size);
+    patch[size - 1] ^= 0x01;
+    TEST_ESP_ERR(ESP_ERR_INVALID_CRC, d2_font_delta_apply(TEST_FONT_LABEL, patch, size));
+    free(patch);
+    TEST_ASSERT_TRUE(test_font_equal(OLD_FONT));
+}
+
+/* Cut the power at every erase or write of the flash in turn: after the recovery, the partition holds one of the fonts */
+TEST(d2_font_delta, power_loss)
+{
+    uint32_t old_num = 0;
+    uint32_t new_num = 0;
+    /*Every operation at first, then fewer of them: the staged sectors are written in many operations*/
+    for (size_t count = 0; ; count = count < 64 ? count + 1 : count + count / 16) {
+        test_font_write(OLD_FONT);
+        /*With CONFIG_D2_FONT_VERIFY_CACHE the old font is recorded as verified, the patch must drop the record*/
+        lv_font_t *font;
+        TEST_ESP_OK(d2_font_load_from_partition(TEST_FONT_LABEL, &font));
+        d2_font_unload(font);
+
+        /*The NVS writes of the patch count too*/
+        esp_partition_fail_after(count, ESP_PARTITION_FAIL_AFTER_MODE_BOTH);
+        esp_err_t err = d2_font_delta_apply(TEST_FONT_LABEL, PATCH);
+        esp_partition_fail_after(SIZE_MAX, ESP_PARTITION_FAIL_AFTER_MODE_BOTH);
+        if (err == ESP_OK) {
+            break;
+        }
+
+        test_nvs_reboot();
+        TEST_ESP_OK(d2_font_delta_recover(TEST_FONT_LABEL));
+        if (test_font_equal(NEW_FONT)) {
+            new_num++;
+        } else {
+            TEST_ASSERT_TRUE(test_font_equal(OLD_FONT));
+            old_num++;
+        }
+        TEST_ESP_OK(d2_font_load_from_partition(TEST_FONT_LABEL, &font));
+        d2_font_unload(font);
+    }
+    TEST_ASSERT_TRUE(test_font_equal(NEW_FONT));
+    printf("power lost %" PRIu32 " times: %" PRIu32 " old font, %" PRIu32 " new font\n", old_num + new_num, old_num,
+           new_num);
+    /*Both sides of the journal commit were hit*/
+    TEST_ASSERT_GREATER_THAN_UINT32(0, old_num);
+    TEST_ASSERT_GREATER_THAN_UINT32(0, new_num);
+}
+
+TEST_GROUP_RUNNER(d2_font_delta)
+{
+    RUN_TEST_CASE(d2_font_delta, apply);
+    RUN_TEST_CASE(d2_font_delta, patch_size);
+    RUN_TEST_CASE(d2_font_delta, applied_twice);
+    RUN_TEST_CASE(d2_font_delta, other_font);
+    RUN_TEST_CASE(d2_font_delta, corrupted_patch);
+    RUN_TEST_CASE(d2_font_delta, power_loss);
+}
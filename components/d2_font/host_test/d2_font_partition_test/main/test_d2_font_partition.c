@@ -0,0 +1,70 @@
+/*
+ * SPDX-FileCopyrightText: 2026 udoudou
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "esp_partition.h"
+#include "nvs_flash.h"
+#include "unity.h"
+#include "unity_fixture.h"
+
+#include "test_d2_font_partition.h"
+
+static const esp_partition_t *font_partition(void)
+{
+    const esp_partition_t *partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY,
+                                                                TEST_FONT_LABEL);
+    TEST_ASSERT_NOT_NULL(partition);
+    return partition;
+}
+
+void test_font_write(const uint8_t *bin, size_t size)
+{
+    const esp_partition_t *partition = font_partition();
+    TEST_ESP_OK(esp_partition_erase_range(partition, 0, partition->size));
+    TEST_ESP_OK(esp_partition_write(partition, 0, bin, size));
+}
+
+bool test_font_equal(const uint8_t *bin, size_t size)
+{
+    uint8_t *buf = malloc(size);
+    TEST_ASSERT_NOT_NULL(buf);
+    TEST_ESP_OK(esp_partition_read(font_partition(), 0, buf, size));
+    bool equal = memcmp(buf, bin, size) == 0;
+    free(buf);
+    return equal;
+}
+
+void test_font_corrupt(size_t offset)
+{
+    const esp_partition_t *partition = font_partition();
+    size_t sector = offset / partition->erase_size * partition->erase_size;
+    uint8_t *buf = malloc(partition->erase_size);
+    TEST_ASSERT_NOT_NULL(buf);
+    TEST_ESP_OK(esp_partition_read(partition, sector, buf, partition->erase_size));
+    buf[offset - sector] ^= 0x01;
+    TEST_ESP_OK(esp_partition_erase_range(partition, sector, partition->erase_size));
+    TEST_ESP_OK(esp_partition_write(partition, sector, buf, partition->erase_size));
+    free(buf);
+}
+
+void test_nvs_reboot(void)
+{
+    TEST_ESP_OK(nvs_flash_deinit());
+    TEST_ESP_OK(nvs_flash_init());
+}
+
+static void run_all_tests(void)
+{
+    RUN_TEST_GROUP(d2_font_delta);
+    RUN_TEST_GROUP(d2_font_verify_cache);
+    RUN_TEST_GROUP(d2_font_prefetch);
+}
+
+void app_main(void)
+{
+    TEST_ESP_OK(nvs_flash_init());
+    exit(UnityMain(0, NULL, run_all_tests));
+}
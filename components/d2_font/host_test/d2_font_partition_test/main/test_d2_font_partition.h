@@ -0,0 +1,34 @@
+/*
+ * SPDX-FileCopyrightText: 2026 udoudou
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define TEST_FONT_LABEL     "font"
+
+/* Made by main/CMakeLists.txt: the old font, the same font with more glyphs, the patch between them, and another font */
+extern const uint8_t test_font_old_start[] asm("_binary_d2_font_old_bin_start");
+extern const uint8_t test_font_old_end[] asm("_binary_d2_font_old_bin_end");
+extern const uint8_t test_font_new_start[] asm("_binary_d2_font_new_bin_start");
+extern const uint8_t test_font_new_end[] asm("_binary_d2_font_new_bin_end");
+extern const uint8_t test_font_patch_start[] asm("_binary_d2_font_patch_bin_start");
+extern const uint8_t test_font_patch_end[] asm("_binary_d2_font_patch_bin_end");
+extern const uint8_t test_font_other_start[] asm("_binary_d2_font_other_bin_start");
+extern const uint8_t test_font_other_end[] asm("_binary_d2_font_other_bin_end");
+
+/* Erase the font partition and write `bin` at its start */
+void test_font_write(const uint8_t *bin, size_t size);
+
+/* Whether the font partition starts with `bin` */
+bool test_font_equal(const uint8_t *bin, size_t size);
+
+/* Flip a bit of the font partition without going through d2_font */
+void test_font_corrupt(size_t offset);
+
+/* What a reset does to NVS after a power loss */
+void test_nvs_reboot(void);
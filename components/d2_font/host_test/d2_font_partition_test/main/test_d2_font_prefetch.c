@@ -0,0 +1,157 @@
+/*
+ * SPDX-FileCopyrightText: 2026 udoudou
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <stdint.h>
+#include <stdlib.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "unity.h"
+#include "unity_fixture.h"
+#include "lvgl.h"
+
+#include "d2_font.h"
+#include "d2_font_prefetch.h"
+#include "d2_font_priv.h"
+#include "test_d2_font_partition.h"
+
+#define OLD_FONT_SIZE   (size_t)(test_font_old_end - test_font_old_start)
+
+/*Longer than the task waits on a full ring, see PREFETCH_FULL_WAIT_MS*/
+#define TAKE_WAIT_MS    200
+
+static lv_font_t *s_font;
+/*Not a d2_font*/
+static lv_font_t s_other_font;
+
+/*Letters of the font, each once, more of them than the ring holds (CONFIG_D2_FONT_PREFETCH_SLOTS in sdkconfig.defaults)*/
+static const char s_text[] = "一丁七万abcdefgh";
+#define TEXT_LETTERS    12
+_Static_assert(CONFIG_D2_FONT_PREFETCH_SLOTS < TEXT_LETTERS, "the text must not fit in the ring");
+
+static uint32_t text_letter(uint32_t n)
+{
+    uint32_t i = 0;
+    uint32_t letter = 0;
+    for (uint32_t k = 0; k <= n; k++) {
+        letter = d2_font_utf8_next(s_text, &i);
+    }
+    return letter;
+}
+
+/* Poll the ring like the bitmap callback, while the task decodes */
+static const lv_draw_buf_t *take_wait(uint32_t letter)
+{
+    TickType_t start = xTaskGetTickCount();
+    do {
+        const lv_draw_buf_t *draw_buf = d2_font_prefetch_take(s_font, letter);
+        if (draw_buf) {
+            return draw_buf;
+        }
+        vTaskDelay(1);
+    } while (xTaskGetTickCount() - start < pdMS_TO_TICKS(TAKE_WAIT_MS));
+    return NULL;
+}
+
+/* The prefetched glyph is the one LVGL would decode itself */
+static void check_glyph(uint32_t letter, const lv_draw_buf_t *draw_buf)
+{
+    d2_font_fmt_txt_glyph_t glyph;
+    TEST_ASSERT_TRUE(d2_font_fmt_txt_resolve_glyph(s_font, letter, &glyph));
+    TEST_ASSERT_EQUAL_UINT32(LV_COLOR_FORMAT_A8, draw_buf->header.cf);
+    TEST_ASSERT_EQUAL_UINT32(glyph.gdsc->box_w, draw_buf->header.w);
+    TEST_ASSERT_EQUAL_UINT32(glyph.gdsc->box_h, draw_buf->header.h);
+
+    uint32_t stride = lv_draw_buf_width_to_stride(glyph.gdsc->box_w, LV_COLOR_FORMAT_A8);
+    TEST_ASSERT_EQUAL_UINT32(stride, draw_buf->header.stride);
+    uint8_t *bitmap = malloc(stride * glyph.gdsc->box_h);
+    TEST_ASSERT_NOT_NULL(bitmap);
+    TEST_ASSERT_TRUE(d2_font_fmt_txt_decode_a8(s_font, &glyph, bitmap, 0));
+    TEST_ASSERT_EQUAL_MEMORY(bitmap, draw_buf->data, stride * glyph.gdsc->box_h);
+    free(bitmap);
+}
+
+/* Take the first `num` letters of the text in order */
+static void take_text(uint32_t num)
+{
+    for (uint32_t n = 0; n < num; n++) {
+        uint32_t letter = text_letter(n);
+        const lv_draw_buf_t *draw_buf = take_wait(letter);
+        TEST_ASSERT_NOT_NULL_MESSAGE(draw_buf, "glyph not prefetched");
+        check_glyph(letter, draw_buf);
+    }
+}
+
+TEST_GROUP(d2_font_prefetch);
+
+TEST_SETUP(d2_font_prefetch)
+{
+    if (!lv_is_initialized()) {
+        lv_init();
+    }
+    TEST_ESP_OK(d2_font_load_from_mem(test_font_old_start, OLD_FONT_SIZE, &s_font));
+    TEST_ESP_OK(d2_font_prefetch_enable(s_font));
+}
+
+TEST_TEAR_DOWN(d2_font_prefetch)
+{
+    d2_font_unload(s_font);
+    s_font = NULL;
+}
+
+/* LVGL takes the glyphs of a text as fast as they are decoded */
+TEST(d2_font_prefetch, take)
+{
+    TEST_ESP_OK(d2_font_prefetch_utf8(s_font, s_text));
+    take_text(TEXT_LETTERS);
+}
+
+/* A full ring makes the task wait for LVGL, it goes on with the rest of the text once glyphs are taken */
+TEST(d2_font_prefetch, full_ring_wait)
+{
+    TEST_ESP_OK(d2_font_prefetch_utf8(s_font, s_text));
+    /*Fill the ring, not long enough for the task to give up*/
+    vTaskDelay(pdMS_TO_TICKS(20));
+    take_text(TEXT_LETTERS);
+}
+
+/* The rest of the text is skipped when LVGL does not draw for a while, the glyphs in the ring stay */
+TEST(d2_font_prefetch, full_ring_give_up)
+{
+    TEST_ESP_OK(d2_font_prefetch_utf8(s_font, s_text));
+    vTaskDelay(pdMS_TO_TICKS(TAKE_WAIT_MS));
+    take_text(CONFIG_D2_FONT_PREFETCH_SLOTS);
+    TEST_ASSERT_NULL(take_wait(text_letter(CONFIG_D2_FONT_PREFETCH_SLOTS)));
+
+    /*The next text is prefetched again*/
+    TEST_ESP_OK(d2_font_prefetch_utf8(s_font, s_text));
+    take_text(TEXT_LETTERS);
+}
+
+/* Disabling waits for the task, also while it waits on a full ring, and frees the ring */
+TEST(d2_font_prefetch, disable)
+{
+    TEST_ESP_OK(d2_font_prefetch_utf8(s_font, s_text));
+    TEST_ASSERT_NOT_NULL(take_wait(text_letter(0)));
+    TEST_ESP_OK(d2_font_prefetch_disable(s_font));
+    TEST_ASSERT_NULL(((d2_font_context_t *)s_font->user_data)->ext->prefetch);
+    TEST_ESP_ERR(ESP_ERR_INVALID_STATE, d2_font_prefetch_utf8(s_font, s_text));
+    TEST_ESP_OK(d2_font_prefetch_disable(s_font));
+
+    TEST_ESP_ERR(ESP_ERR_INVALID_ARG, d2_font_prefetch_disable(NULL));
+    TEST_ESP_ERR(ESP_ERR_INVALID_ARG, d2_font_prefetch_disable(&s_other_font));
+    TEST_ESP_ERR(ESP_ERR_INVALID_ARG, d2_font_prefetch_utf8(&s_other_font, s_text));
+
+    /*Enabled again, the font is unloaded with prefetch enabled*/
+    TEST_ESP_OK(d2_font_prefetch_enable(s_font));
+    TEST_ESP_OK(d2_font_prefetch_utf8(s_font, s_text));
+}
+
+TEST_GROUP_RUNNER(d2_font_prefetch)
+{
+    RUN_TEST_CASE(d2_font_prefetch, take);
+    RUN_TEST_CASE(d2_font_prefetch, full_ring_wait);
+    RUN_TEST_CASE(d2_font_prefetch, full_ring_give_up);
+    RUN_TEST_CASE(d2_font_prefetch, disable);
+}
@@ -0,0 +1,78 @@
+/*
+ * SPDX-FileCopyrightText: 2026 udoudou
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <stdint.h>
+#include "unity.h"
+#include "unity_fixture.h"
+
+#include "d2_font.h"
+#include "test_d2_font_partition.h"
+
+#define OLD_FONT_SIZE   (size_t)(test_font_old_end - test_font_old_start)
+
+TEST_GROUP(d2_font_verify_cache);
+
+TEST_SETUP(d2_font_verify_cache)
+{
+    test_font_write(test_font_old_start, OLD_FONT_SIZE);
+    TEST_ESP_OK(d2_font_verify_cache_invalidate(TEST_FONT_LABEL));
+}
+
+TEST_TEAR_DOWN(d2_font_verify_cache)
+{
+}
+
+/* Once verified, the font is not hashed again: a change the record does not cover goes unnoticed until invalidated */
+TEST(d2_font_verify_cache, warm_load)
+{
+    lv_font_t *font;
+    TEST_ESP_OK(d2_font_load_from_partition(TEST_FONT_LABEL, &font));
+    d2_font_unload(font);
+
+    /*Last byte of the glyph bitmaps, right before the SHA-256*/
+    test_font_corrupt(OLD_FONT_SIZE - 33);
+    TEST_ESP_OK(d2_font_load_from_partition(TEST_FONT_LABEL, &font));
+    d2_font_unload(font);
+
+    TEST_ESP_OK(d2_font_verify_cache_invalidate(TEST_FONT_LABEL));
+    TEST_ESP_ERR(ESP_ERR_INVALID_CRC, d2_font_load_from_partition(TEST_FONT_LABEL, &font));
+}
+
+/* The record survives a reset */
+TEST(d2_font_verify_cache, reboot)
+{
+    lv_font_t *font;
+    TEST_ESP_OK(d2_font_load_from_partition(TEST_FONT_LABEL, &font));
+    d2_font_unload(font);
+
+    test_nvs_reboot();
+    test_font_corrupt(OLD_FONT_SIZE - 33);
+    TEST_ESP_OK(d2_font_load_from_partition(TEST_FONT_LABEL, &font));
+    d2_font_unload(font);
+}
+
+/* A font is hashed again once it was corrupted and refused: nothing is recorded for it */
+TEST(d2_font_verify_cache, cold_load)
+{
+    lv_font_t *font;
+    test_font_corrupt(OLD_FONT_SIZE - 33);
+    TEST_ESP_ERR(ESP_ERR_INVALID_CRC, d2_font_load_from_partition(TEST_FONT_LABEL, &font));
+    TEST_ESP_ERR(ESP_ERR_INVALID_CRC, d2_font_load_from_partition(TEST_FONT_LABEL, &font));
+}
+
+TEST(d2_font_verify_cache, invalidate)
+{
+    TEST_ESP_OK(d2_font_verify_cache_invalidate(TEST_FONT_LABEL));
+    TEST_ESP_ERR(ESP_ERR_NOT_FOUND, d2_font_verify_cache_invalidate("no_font"));
+    TEST_ESP_ERR(ESP_ERR_INVALID_ARG, d2_font_verify_cache_invalidate(NULL));
+}
+
+TEST_GROUP_RUNNER(d2_font_verify_cache)
+{
+    RUN_TEST_CASE(d2_font_verify_cache, warm_load);
+    RUN_TEST_CASE(d2_font_verify_cache, reboot);
+    RUN_TEST_CASE(d2_font_verify_cache, cold_load);
+    RUN_TEST_CASE(d2_font_verify_cache, invalidate);
+}
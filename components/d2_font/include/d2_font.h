@@ -10,7 +10,38 @@ extern "C" {
 #endif
 
 #include "esp_err.h"
+#include "esp_heap_caps.h"
 #include "src/font/lv_font.h"
+#include "d2_font_fmt_txt.h"
+#include "d2_font_embedded.h"
+
+/** Heap caps and budget of a memory category*/
+typedef struct {
+    uint32_t caps;                  /**< `MALLOC_CAP_*` flags of the allocations*/
+    size_t budget;                  /**< Maximum bytes the font holds at a time, 0: no limit*/
+} d2_font_mem_config_t;
+
+/** Options of `d2_font_load_xx_with_options`*/
+typedef struct {
+    d2_font_mem_config_t mem[D2_FONT_MEM_TYPE_MAX];     /**< Indexed by `d2_font_mem_type_t`*/
+} d2_font_load_options_t;
+
+/** Options used by `d2_font_load_from_partition` and `d2_font_load_from_mem`*/
+#define D2_FONT_LOAD_OPTIONS_DEFAULT() { \
+    .mem = { \
+        [D2_FONT_MEM_CONTEXT] = { .caps = MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT, .budget = 0 }, \
+        [D2_FONT_MEM_CACHE] = { .caps = MALLOC_CAP_8BIT, .budget = 0 }, \
+        [D2_FONT_MEM_INDEX] = { .caps = MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT, .budget = 0 }, \
+        [D2_FONT_MEM_SCRATCH] = { .caps = MALLOC_CAP_8BIT, .budget = 0 }, \
+    }, \
+}
+
+/** Memory held by a font, see `d2_font_get_memory_usage`*/
+typedef struct {
+    size_t used[D2_FONT_MEM_TYPE_MAX];  /**< Bytes allocated now, per `d2_font_mem_type_t`*/
+    size_t peak[D2_FONT_MEM_TYPE_MAX];  /**< Most bytes allocated at a time since the font was loaded*/
+    size_t mmap;                        /**< Bytes of flash mapped for the font, 0 if it does not own the mapping*/
+} d2_font_memory_usage_t;
 
 /**
  * Loads a `lv_font_t` object from partition.
@@ -21,6 +52,7 @@ extern "C" {
  *     - ESP_ERR_NOT_FOUND: no partitions found
  *     - ESP_ERR_INVALID_ARG: invalid argument
  *     - ESP_ERR_INVALID_CRC: data validation error
+ *     - ESP_ERR_INVALID_VERSION: the bin needs a newer d2_font
  *     - ESP_ERR_NO_MEM: Memory allocation failure
  */
 esp_err_t d2_font_load_from_partition(const char* label, lv_font_t **out_font);
@@ -37,16 +69,201 @@ esp_err_t d2_font_load_from_partition(const char* label, lv_font_t **out_font);
  *     - ESP_OK: succeed
  *     - ESP_ERR_INVALID_ARG: invalid argument
  *     - ESP_ERR_INVALID_CRC: data validation error
+ *     - ESP_ERR_INVALID_VERSION: the bin needs a newer d2_font
  *     - ESP_ERR_NO_MEM: Memory allocation failure
  */
 esp_err_t d2_font_load_from_mem(const uint8_t *bin_ptr, size_t size, lv_font_t **out_font);
 
+/**
+ * Loads a `lv_font_t` object from partition, with memory placement and budgets.
+ *
+ * Allocations that would exceed the budget of their category fail like out of memory allocations:
+ * a cache or table is skipped, or the API that needs it returns `ESP_ERR_NO_MEM`.
+ *
+ * @param label Partition label where d2_font bin is stored.
+ * @param options memory settings, NULL for `D2_FONT_LOAD_OPTIONS_DEFAULT()`. It is copied.
+ * @param[out] out_font Store lv_font_t pointer. IF failed, it will be set to NULL.
+ * @return
+ *     - ESP_OK: succeed
+ *     - ESP_ERR_NOT_FOUND: no partitions found
+ *     - ESP_ERR_INVALID_ARG: invalid argument
+ *     - ESP_ERR_INVALID_CRC: data validation error
+ *     - ESP_ERR_INVALID_VERSION: the bin needs a newer d2_font
+ *     - ESP_ERR_NO_MEM: Memory allocation failure
+ */
+esp_err_t d2_font_load_from_partition_with_options(const char *label, const d2_font_load_options_t *options,
+                                                   lv_font_t **out_font);
+
+/**
+ * Loads a `lv_font_t` object from memory, with memory placement and budgets.
+ * See `d2_font_load_from_mem` and `d2_font_load_from_partition_with_options`.
+ *
+ * @param bin_ptr a pointer to d2_font bin. It can be the address obtained by mmap.
+ * @param size d2_font bin size.
+ * @param options memory settings, NULL for `D2_FONT_LOAD_OPTIONS_DEFAULT()`. It is copied.
+ * @param[out] out_font Store lv_font_t pointer. IF failed, it will be set to NULL.
+ * @return
+ *     - ESP_OK: succeed
+ *     - ESP_ERR_INVALID_ARG: invalid argument
+ *     - ESP_ERR_INVALID_CRC: data validation error
+ *     - ESP_ERR_INVALID_VERSION: the bin needs a newer d2_font
+ *     - ESP_ERR_NO_MEM: Memory allocation failure
+ */
+esp_err_t d2_font_load_from_mem_with_options(const uint8_t *bin_ptr, size_t size, const d2_font_load_options_t *options,
+                                             lv_font_t **out_font);
+
+/**
+ * Loads a `lv_font_t` object from a bin embedded in the application with the `d2_font_embed` CMake function.
+ *
+ * The bin was checked at build time (header, table tags and SHA-256) and is covered by the app image hash,
+ * so it is not hashed again and the font is ready without reading its data. A descriptor not marked
+ * `D2_FONT_EMBEDDED_FLAG_VERIFIED` is checked like `d2_font_load_from_mem_with_options`.
+ *
+ * @code
+ * D2_FONT_EMBEDDED_DECLARE(d2_font_demo_14);
+ * d2_font_load_embedded(&d2_font_embedded_d2_font_demo_14, NULL, &font);
+ * @endcode
+ *
+ * @param embedded descriptor generated by `d2_font_embed`
+ * @param options memory settings, NULL for `D2_FONT_LOAD_OPTIONS_DEFAULT()`. It is copied.
+ * @param[out] out_font Store lv_font_t pointer. IF failed, it will be set to NULL.
+ * @return
+ *     - ESP_OK: succeed
+ *     - ESP_ERR_INVALID_ARG: invalid argument
+ *     - ESP_ERR_INVALID_CRC: data validation error
+ *     - ESP_ERR_INVALID_VERSION: the bin needs a newer d2_font
+ *     - ESP_ERR_NO_MEM: Memory allocation failure
+ */
+esp_err_t d2_font_load_embedded(const d2_font_embedded_t *embedded, const d2_font_load_options_t *options,
+                                lv_font_t **out_font);
+
+/**
+ * Get the memory held by a font, per category.
+ * @param font `lv_font_t` object from `d2_font_load_xx`.
+ * @param[out] usage the current and peak bytes.
+ * @return
+ *     - ESP_OK: succeed
+ *     - ESP_ERR_INVALID_ARG: invalid argument
+ */
+esp_err_t d2_font_get_memory_usage(const lv_font_t *font, d2_font_memory_usage_t *usage);
+
+/**
+ * Forget that the font in a partition was verified, so its SHA-256 is checked again at the next load.
+ *
+ * Only needed with `CONFIG_D2_FONT_VERIFY_CACHE`, before the application writes the partition by other means
+ * than `d2_font_delta_apply`. It does nothing otherwise.
+ *
+ * @param label Partition label where d2_font bin is stored.
+ * @return
+ *     - ESP_OK: succeed
+ *     - ESP_ERR_NOT_FOUND: no partitions found
+ *     - ESP_ERR_INVALID_ARG: invalid argument
+ *     - Others: NVS errors
+ */
+esp_err_t d2_font_verify_cache_invalidate(const char *label);
+
 /**
  * Unload a `lv_font_t` object from `d2_font_load_xx`.
  * @param font `lv_font_t` object.
  */
 void d2_font_unload(lv_font_t * font);
 
+/**
+ * Get the font of a partition from the shared font registry, loading it at the first call.
+ *
+ * Every user of the same partition gets the same `lv_font_t`, so the partition is mapped and verified once
+ * and the caches are shared. The font is unloaded when the last reference is released.
+ * It is loaded with `D2_FONT_LOAD_OPTIONS_DEFAULT`.
+ *
+ * Note: Release it with `d2_font_release`, not `d2_font_unload`. Functions changing the font state
+ *       (e.g. `d2_font_preload_utf8`, `d2_font_run_cache_clear`) affect all the users.
+ *
+ * @param label Partition label where d2_font bin is stored.
+ * @param[out] out_font Store lv_font_t pointer. IF failed, it will be set to NULL.
+ * @return
+ *     - ESP_OK: succeed
+ *     - ESP_ERR_NOT_FOUND: no partitions found
+ *     - ESP_ERR_INVALID_ARG: invalid argument
+ *     - ESP_ERR_INVALID_CRC: data validation error
+ *     - ESP_ERR_INVALID_VERSION: the bin needs a newer d2_font
+ *     - ESP_ERR_NO_MEM: Memory allocation failure
+ */
+esp_err_t d2_font_acquire(const char *label, lv_font_t **out_font);
+
+/**
+ * Get the font of a memory range from the shared font registry, like `d2_font_acquire`.
+ * Fonts are shared when `bin_ptr` and `size` are the same.
+ * @param bin_ptr d2_font bin pointer
+ * @param size d2_font bin size
+ * @param[out] out_font Store lv_font_t pointer. IF failed, it will be set to NULL.
+ * @return
+ *     - ESP_OK: succeed
+ *     - ESP_ERR_INVALID_ARG: invalid argument
+ *     - ESP_ERR_INVALID_CRC: data validation error
+ *     - ESP_ERR_INVALID_VERSION: the bin needs a newer d2_font
+ *     - ESP_ERR_NO_MEM: Memory allocation failure
+ */
+esp_err_t d2_font_acquire_from_mem(const uint8_t *bin_ptr, size_t size, lv_font_t **out_font);
+
+/**
+ * Release a font from `d2_font_acquire_xx`. The last release unloads it.
+ * @param font `lv_font_t` object from `d2_font_acquire_xx`.
+ */
+void d2_font_release(lv_font_t *font);
+
+/**
+ * Decode every glyph of a text ahead of time and pin it in RAM.
+ *
+ * Pinned glyphs are kept as A8 bitmaps and returned directly by the bitmap callback,
+ * so the first frame drawing the text does not have to look up and decode them from flash.
+ * Calling it again with other texts adds their glyphs; letters already pinned or not in the font are skipped.
+ *
+ * Note: Only available with LVGL v9. Call it from the same context as LVGL (or with the LVGL lock held).
+ *
+ * @param font `lv_font_t` object from `d2_font_load_xx`.
+ * @param text a '\0' terminated UTF-8 string.
+ * @return
+ *     - ESP_OK: succeed
+ *     - ESP_ERR_INVALID_ARG: invalid argument
+ *     - ESP_ERR_NO_MEM: Memory allocation failure, the glyphs pinned so far are kept
+ *     - ESP_ERR_NOT_SUPPORTED: LVGL version is not supported
+ */
+esp_err_t d2_font_preload_utf8(lv_font_t *font, const char *text);
+
+/**
+ * Release all glyphs pinned by `d2_font_preload_utf8`.
+ * @param font `lv_font_t` object from `d2_font_load_xx`.
+ */
+void d2_font_preload_release(lv_font_t *font);
+
+/**
+ * Get the layout of a text: glyph ids, descriptors and pen positions.
+ *
+ * The run is cached per font, keyed by the hash of the text. Asking again for the same text returns the cached run,
+ * and while the run is cached LVGL redraws of the text (e.g. a static label) get their glyph descriptors from it
+ * instead of looking them up in the font data again.
+ *
+ * Note: The run is valid until it is evicted by other `d2_font_run_get` calls, or until `d2_font_run_cache_clear`
+ *       or `d2_font_unload` is called.
+ *
+ * @param font `lv_font_t` object from `d2_font_load_xx`.
+ * @param text a '\0' terminated UTF-8 string.
+ * @param[out] out_run Store the run pointer. IF failed, it will be set to NULL.
+ * @return
+ *     - ESP_OK: succeed
+ *     - ESP_ERR_INVALID_ARG: invalid argument
+ *     - ESP_ERR_INVALID_SIZE: the text has more than `CONFIG_D2_FONT_RUN_MAX_GLYPHS` letters
+ *     - ESP_ERR_NO_MEM: Memory allocation failure
+ *     - ESP_ERR_NOT_SUPPORTED: `CONFIG_D2_FONT_RUN_CACHE` is disabled
+ */
+esp_err_t d2_font_run_get(lv_font_t *font, const char *text, const d2_font_run_t **out_run);
+
+/**
+ * Drop all cached runs of a font. Runs returned by `d2_font_run_get` are invalid afterwards.
+ * @param font `lv_font_t` object from `d2_font_load_xx`.
+ */
+void d2_font_run_cache_clear(lv_font_t *font);
+
 #ifdef __cplusplus
 } /*extern "C"*/
 #endif
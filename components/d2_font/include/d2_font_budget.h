@@ -0,0 +1,87 @@
+/*
+ * SPDX-FileCopyrightText: 2026 udoudou
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "lvgl.h"
+
+/** Settings of `d2_font_budget_enable`*/
+typedef struct {
+    uint32_t budget_us;             /**< Glyph decoding time per frame in microseconds, 0: no time limit*/
+    uint32_t budget_glyphs;         /**< Glyphs decoded per frame, 0: no count limit*/
+    uint8_t placeholder_opa;        /**< Opacity of the box drawn in place of a deferred glyph, 0: left blank*/
+    lv_display_t *display;          /**< Display drawing the font, NULL: the default display*/
+} d2_font_budget_config_t;
+
+/** Decoding statistics, see `d2_font_budget_get_stats`*/
+typedef struct {
+    uint32_t last_frame_us;         /**< Time spent decoding glyphs of the font in the last frame*/
+    uint32_t last_frame_glyphs;     /**< Glyphs decoded in the last frame*/
+    uint32_t max_frame_us;          /**< Longest decoding time of a frame since the budget was enabled*/
+    uint32_t deferred;              /**< Glyphs drawn as placeholders since the budget was enabled*/
+    uint32_t pending;               /**< Glyphs waiting to be decoded*/
+} d2_font_budget_stats_t;
+
+/**
+ * Bound the time LVGL spends decoding glyphs of a font in one frame.
+ *
+ * Once the budget of a frame is spent, the bitmap callback draws the glyphs it would have to decode as
+ * placeholder boxes and queues them (up to `CONFIG_D2_FONT_FRAME_BUDGET_QUEUE_LEN`). After the frame, a LVGL
+ * timer decodes the queued glyphs, at most one budget per run, into a store of the budget and invalidates the
+ * areas refreshed by the frames that drew placeholders, so the text fills in over the next frames instead of
+ * stalling one frame. Pinned, stored and prefetched glyphs cost no budget.
+ *
+ * The store keeps the last `CONFIG_D2_FONT_FRAME_BUDGET_QUEUE_LEN` decoded glyphs, the oldest are replaced
+ * first, and is freed by `d2_font_budget_disable` and by `d2_font_shrink` from `D2_FONT_SHRINK_PINNED`.
+ * Glyphs pinned by `d2_font_preload_utf8` are left to the application.
+ *
+ * Frames are delimited by the `LV_EVENT_REFR_START` and `LV_EVENT_REFR_READY` events of the display, and the
+ * areas they refresh are followed with `LV_EVENT_INVALIDATE_AREA`. A frame whose areas were invalidated before
+ * the budget was enabled is redrawn as a whole.
+ *
+ * Note: Only available with LVGL v9 and `CONFIG_D2_FONT_FRAME_BUDGET`. Call it from the same context as LVGL
+ *       (or with the LVGL lock held). Calling it again changes the settings.
+ *
+ * @param font `lv_font_t` object from `d2_font_load_xx`.
+ * @param config the budget, it is copied
+ * @return
+ *     - ESP_OK: succeed
+ *     - ESP_ERR_INVALID_ARG: invalid argument, or no display
+ *     - ESP_ERR_NO_MEM: Memory allocation failure
+ *     - ESP_ERR_NOT_SUPPORTED: LVGL version is not supported, or `CONFIG_D2_FONT_FRAME_BUDGET` is disabled
+ */
+esp_err_t d2_font_budget_enable(lv_font_t *font, const d2_font_budget_config_t *config);
+
+/**
+ * Stop budgeting the decoding of a font and drop the queued and stored glyphs. `d2_font_unload` calls it.
+ * @param font `lv_font_t` object from `d2_font_load_xx`.
+ * @return
+ *     - ESP_OK: succeed, or the budget was not enabled
+ *     - ESP_ERR_INVALID_ARG: invalid argument
+ *     - ESP_ERR_NOT_SUPPORTED: LVGL version is not supported, or `CONFIG_D2_FONT_FRAME_BUDGET` is disabled
+ */
+esp_err_t d2_font_budget_disable(lv_font_t *font);
+
+/**
+ * Get the decoding statistics of a font with a budget.
+ * @param font `lv_font_t` object from `d2_font_load_xx`.
+ * @param[out] stats the statistics
+ * @return
+ *     - ESP_OK: succeed
+ *     - ESP_ERR_INVALID_ARG: invalid argument
+ *     - ESP_ERR_INVALID_STATE: no budget is enabled for the font
+ *     - ESP_ERR_NOT_SUPPORTED: LVGL version is not supported, or `CONFIG_D2_FONT_FRAME_BUDGET` is disabled
+ */
+esp_err_t d2_font_budget_get_stats(const lv_font_t *font, d2_font_budget_stats_t *stats);
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
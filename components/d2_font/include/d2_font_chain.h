@@ -0,0 +1,53 @@
+/*
+ * SPDX-FileCopyrightText: 2026 udoudou
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "src/font/lv_font.h"
+
+/** Most fonts in a chain*/
+#define D2_FONT_CHAIN_FONTS_MAX     32
+
+/**
+ * Create a font drawing each letter with the first of several fonts that has it, like a `fallback` list.
+ *
+ * A `fallback` list asks every font in turn, so a letter of the third font costs a failed cmap search in the
+ * first two. The chain merges the codepoint ranges of the cmaps of its fonts into one index once, and sends
+ * each letter straight to the fonts whose ranges hold it, in the order of `fonts`. Letters outside every range
+ * are rejected with one binary search. Fonts not from `d2_font_load_xx` (e.g. a scaled font) are taken as
+ * holding every codepoint and asked in their turn.
+ *
+ * The chain has the metrics (`line_height`, `base_line`, underline) of the first font. The `fallback` of the
+ * fonts is not used; set the `fallback` of the chain instead.
+ *
+ * Note: With LVGL v9 the fonts must put the letter in `gid.index` of their glyph descriptors, as the fonts of
+ *       `d2_font_load_xx` and `d2_font_load_scaled` do. The fonts have to outlive the chain.
+ *       Call it from the same context as LVGL (or with the LVGL lock held).
+ *
+ * @param fonts the fonts, highest priority first
+ * @param font_num 1 to `D2_FONT_CHAIN_FONTS_MAX`
+ * @param[out] out_font Store lv_font_t pointer. IF failed, it will be set to NULL.
+ * @return
+ *     - ESP_OK: succeed
+ *     - ESP_ERR_INVALID_ARG: invalid argument
+ *     - ESP_ERR_NO_MEM: Memory allocation failure
+ */
+esp_err_t d2_font_chain_create(const lv_font_t *const *fonts, uint32_t font_num, lv_font_t **out_font);
+
+/**
+ * Free a font from `d2_font_chain_create`. The fonts of the chain are not touched.
+ * @param font `lv_font_t` object from `d2_font_chain_create`.
+ */
+void d2_font_chain_delete(lv_font_t *font);
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
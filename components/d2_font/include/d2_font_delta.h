@@ -0,0 +1,65 @@
+/*
+ * SPDX-FileCopyrightText: 2026 udoudou
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+/**
+ * Apply a delta patch to the d2_font bin stored in a partition.
+ *
+ * The patch is made on the host by `tools/d2_font/d2_font_delta.py`. It only carries the regions of the font
+ * that changed, each with its own SHA-256, and copies the bytes that only moved from the old font, so applying
+ * and checking it only touches the changed and moved bytes.
+ *
+ * The flash sectors to rewrite are first staged in a journal at the end of the partition, then copied in place.
+ * If power is lost in between, `d2_font_delta_recover` (also called at the start of this function) finishes the
+ * copy, so the partition holds either the old or the new font.
+ *
+ * Note: The font in the partition must not be loaded while it is patched. The partition needs free space after
+ *       the font for the journal: one flash sector per rewritten sector, plus one. Moved bytes rewrite their
+ *       sectors too.
+ *
+ * @param label Partition label where d2_font bin is stored.
+ * @param patch the patch data.
+ * @param size patch size.
+ * @return
+ *     - ESP_OK: succeed
+ *     - ESP_ERR_NOT_FOUND: no partitions found
+ *     - ESP_ERR_INVALID_ARG: invalid argument
+ *     - ESP_ERR_INVALID_CRC: the patch is corrupted, or the data read back does not match it
+ *     - ESP_ERR_INVALID_VERSION: the patch was made for another font
+ *     - ESP_ERR_INVALID_SIZE: no room in the partition for the new font and the journal
+ *     - ESP_ERR_NO_MEM: Memory allocation failure
+ *     - Others: flash read/write errors
+ */
+esp_err_t d2_font_delta_apply(const char *label, const uint8_t *patch, size_t size);
+
+/**
+ * Finish a `d2_font_delta_apply` interrupted by a reset.
+ *
+ * Call it before loading a font from a partition that may be patched. It only reads the journal header
+ * when no patch was interrupted.
+ *
+ * @param label Partition label where d2_font bin is stored.
+ * @return
+ *     - ESP_OK: nothing to recover, or the interrupted patch is applied
+ *     - ESP_ERR_NOT_FOUND: no partitions found
+ *     - ESP_ERR_INVALID_ARG: invalid argument
+ *     - ESP_ERR_INVALID_CRC: the staged data is corrupted
+ *     - ESP_ERR_NO_MEM: Memory allocation failure
+ *     - Others: flash read/write errors
+ */
+esp_err_t d2_font_delta_recover(const char *label);
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
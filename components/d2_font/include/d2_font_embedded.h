@@ -0,0 +1,33 @@
+/*
+ * SPDX-FileCopyrightText: 2026 udoudou
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/*Only plain types here: the sources generated by `d2_font_embed` include this header without the LVGL ones*/
+
+#define D2_FONT_EMBEDDED_MAGIC          0x6D453244      /**< "D2Em"*/
+
+#define D2_FONT_EMBEDDED_FLAG_VERIFIED  0x01            /**< Header, table tags and SHA-256 checked at build time*/
+
+/** A d2_font bin linked into the application, generated by the `d2_font_embed` CMake function*/
+typedef struct {
+    uint32_t magic;                 /**< `D2_FONT_EMBEDDED_MAGIC`*/
+    uint32_t flags;                 /**< `D2_FONT_EMBEDDED_FLAG_*`*/
+    const uint8_t *bin;             /**< The bin, 4-byte aligned*/
+    uint32_t size;                  /**< Bin size*/
+} d2_font_embedded_t;
+
+/** Declare the descriptor `d2_font_embedded_<name>` generated by `d2_font_embed(<bin> NAME <name>)`*/
+#define D2_FONT_EMBEDDED_DECLARE(name)  extern const d2_font_embedded_t d2_font_embedded_##name
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
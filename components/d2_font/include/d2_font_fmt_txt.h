@@ -25,6 +25,15 @@ typedef struct {
     uint32_t dsc_index : 11;
 } __attribute__((packed))d2_font_fmt_txt_glyph_index_t;
 
+/**
+ * Glyph index of fonts whose header has `D2_FONT_HEADER_FLAG_WIDE_INDEX`, used when the bitmaps of a cmap
+ * span 2 MB or more, or there are more than 2048 glyph descriptors.
+ */
+typedef struct {
+    uint32_t bitmap_index_offset;   /**< index offset of the bitmap, from the start of `glyph_bitmap`*/
+    uint32_t dsc_index;
+} __attribute__((packed)) d2_font_fmt_txt_glyph_index_wide_t;
+
 /** Format of font character map.*/
 typedef enum {
     D2_FONT_FMT_TXT_CMAP_FORMAT0_FULL,
@@ -49,7 +58,7 @@ typedef struct {
     /** First glyph ID (array index of `glyph_dsc`) for this range*/
     uint16_t glyph_id_start;
 
-    /** index base of the bitmap for this range*/
+    /** index base of the bitmap for this range. 0 with the wide glyph index*/
     uint32_t glyph_bitmap_index_base : 30;
 
     /** Type of this character map*/
@@ -94,6 +103,24 @@ typedef struct {
 
 } __attribute__((packed)) d2_font_fmt_txt_cmap_t;
 
+/**
+ * CMAP section of fonts whose header has `D2_FONT_HEADER_FLAG_CMAP_COMPRESSED`. It is unpacked to RAM at load.
+ *
+ * `data` holds LEB128 varints. For each cmap: range_start (zigzag delta from the previous cmap), range_length,
+ * glyph_id_start, glyph_bitmap_index_base, type and list_length, then its lists:
+ *  - `unicode_list`: the first value, then each difference minus 1 (the list is strictly increasing)
+ *  - sparse `glyph_id_ofs_list`: zigzag delta from the previous value
+ *  - format 0 `glyph_id_ofs_list`: the bytes as is
+ *
+ * Unpacked, the cmaps come first, then the lists, each `uint16_t` list 2-aligned. List pointers are offsets
+ * from the start of the unpacked data.
+ */
+typedef struct {
+    uint32_t unpacked_size;         /**< Bytes of the unpacked cmaps and lists*/
+    uint32_t packed_size;           /**< Bytes of `data`*/
+    uint8_t data[0];
+} __attribute__((packed)) d2_font_fmt_txt_cmap_packed_t;
+
 /** A simple mapping of kern values from pairs*/
 typedef struct {
     /*To get a kern value of two code points:
@@ -123,11 +150,11 @@ typedef struct {
     const uint8_t * glyph_bitmap;
 
     /** Describe the glyphs */
-    const d2_font_fmt_txt_glyph_index_t *glyph_index;
+    const d2_font_fmt_txt_glyph_index_t *glyph_index;      /**< `d2_font_fmt_txt_glyph_index_wide_t` with the wide index*/
     const d2_font_fmt_txt_glyph_dsc_t * glyph_dsc;
 
     /** Map the glyphs to Unicode characters.
-     *Array of `lv_font_cmap_fmt_txt_t` variables */
+     *Array of `lv_font_cmap_fmt_txt_t` variables, or `d2_font_fmt_txt_cmap_packed_t` */
     const d2_font_fmt_txt_cmap_t * cmaps;
 
     /**
@@ -161,10 +188,85 @@ typedef struct {
     const d2_font_fmt_txt_cmap_t *cmap;
 } d2_font_fmt_txt_glyph_cache_t;
 
+/** Glyph ids held by a cmap, `[first, first + num)`*/
+typedef struct {
+    uint32_t first;
+    uint32_t num;
+} d2_font_fmt_txt_gid_range_t;
+
+/** A glyph decoded ahead of time by `d2_font_preload_utf8`*/
 typedef struct {
-    void *base_ptr;
+    uint32_t unicode_letter;
+#if LVGL_VERSION_MAJOR >= 9
+    lv_draw_buf_t draw_buf;         /**< A8 bitmap, returned as is by `d2_font_get_bitmap_fmt_txt`*/
+#endif
+} d2_font_fmt_txt_pin_glyph_t;
+
+/** Pinned glyphs, never evicted until `d2_font_preload_release`*/
+typedef struct {
+    d2_font_fmt_txt_pin_glyph_t *glyphs;    /**< Sorted by `unicode_letter`*/
+    uint32_t num;
+    uint32_t size;                          /**< Number of allocated `glyphs`*/
+} d2_font_fmt_txt_pin_t;
+
+/** A glyph of a laid out text, see `d2_font_run_get`*/
+typedef struct {
+    uint32_t unicode_letter;
+    uint32_t glyph_id;              /**< 0: the letter is not in this font*/
+    int32_t pos_x;                  /**< Pen position in pixels, from the start of the run*/
+    uint16_t adv_w;                 /**< Advance width in pixels, kerning with the next letter included*/
+    uint16_t box_w;
+    uint16_t box_h;
+    int8_t ofs_x;
+    int8_t ofs_y;
+} d2_font_run_glyph_t;
+
+/** A laid out text*/
+typedef struct {
+    uint32_t hash;                  /**< FNV-1a hash of `text`*/
+    uint32_t text_len;              /**< Length of `text` in bytes*/
+    const char *text;               /**< Copy of the text, tells hash collisions apart*/
+    int32_t width;                  /**< Sum of the advance widths in pixels*/
+    uint32_t glyph_num;
+    d2_font_run_glyph_t glyphs[];
+} d2_font_run_t;
+
+/** Categories of the memory allocated for a font, see `d2_font_load_options_t`*/
+typedef enum {
+    D2_FONT_MEM_CONTEXT,            /**< The `lv_font_t` object and its context*/
+    D2_FONT_MEM_CACHE,              /**< Pinned glyphs, cached runs, RGB565 tiles, prefetch ring*/
+    D2_FONT_MEM_INDEX,              /**< Tables built at load time, e.g. the ASCII table*/
+    D2_FONT_MEM_SCRATCH,            /**< Temporary buffers of glyph decoding and prefetch requests, access trace*/
+    D2_FONT_MEM_TYPE_MAX,
+} d2_font_mem_type_t;
+
+/** Placement and accounting of the memory of a font*/
+typedef struct {
+    uint32_t caps[D2_FONT_MEM_TYPE_MAX];
+    size_t budget[D2_FONT_MEM_TYPE_MAX];        /**< 0: no limit*/
+    size_t used[D2_FONT_MEM_TYPE_MAX];
+    size_t peak[D2_FONT_MEM_TYPE_MAX];
+    size_t mmap_size;                           /**< Bytes mapped for this font*/
+} d2_font_fmt_txt_mem_t;
+
+typedef struct {
+    void *base_ptr;                             /**< NULL while suspended with the mapping released*/
     void *mmap_handle;
+    const void *partition;                      /**< `esp_partition_t` mapped by the font, NULL if not its own*/
+    uint32_t base_offset;                       /**< Offset of `base_ptr` in the mapping of `partition`*/
+    bool suspended;                             /**< See `d2_font_suspend`*/
+    d2_font_fmt_txt_mem_t mem;
+    bool wide_index;                            /**< `glyph_index` is `d2_font_fmt_txt_glyph_index_wide_t`*/
+    const d2_font_fmt_txt_cmap_t *cmaps;        /**< In the font data, or unpacked to `cmap_ram`*/
+    const uint8_t *cmap_base;                   /**< Base of the list offsets of `cmaps`*/
+    void *cmap_ram;                             /**< Unpacked compressed cmaps, NULL if not compressed*/
+    size_t cmap_ram_size;
+    uint32_t glyph_num;                         /**< Entries of `glyph_index`, valid glyph ids are below it*/
+    d2_font_fmt_txt_gid_range_t *gid_ranges;    /**< Per cmap, built by the first glyph id lookup*/
     d2_font_fmt_txt_glyph_cache_t cache[2];
+    d2_font_fmt_txt_pin_t pin;
+    struct d2_font_context_ext_t *ext;          /**< Parts depending on the build options, follow the context*/
+    struct d2_font_shrink_hook_t *shrink_hook;  /**< Heap watch and allocation retries, see `d2_font_shrink_hook_enable`*/
 } d2_font_context_t;
 
 #if LVGL_VERSION_MAJOR >= 9
@@ -175,6 +277,19 @@ typedef struct {
  * @return pointer to an A8 bitmap (not necessarily bitmap_out) or NULL if `unicode_letter` not found
  */
 const void *d2_font_get_bitmap_fmt_txt(lv_font_glyph_dsc_t * g_dsc, lv_draw_buf_t * draw_buf);
+
+/**
+ * Same as `d2_font_get_bitmap_fmt_txt`, but only the visible part of the glyph is decoded.
+ * For draw units that know the clip area of a letter, e.g. a scrolled or partly covered label.
+ * Plain bitmaps seek to the first visible row, compressed ones stop after the last visible row,
+ * and clipped columns are not written.
+ * @param g_dsc         the glyph descriptor including which font to use, which supply the glyph_index and format.
+ * @param draw_buf      a draw buffer that can be used to store the bitmap of the glyph, it's OK not to use it.
+ * @param area          the visible rows and columns, relative to the top-left of the glyph's bounding box, inclusive.
+ *                      Pixels of `draw_buf` outside of it are left as they are.
+ * @return pointer to an A8 bitmap (not necessarily bitmap_out) or NULL if `unicode_letter` not found
+ */
+const void *d2_font_get_bitmap_area_fmt_txt(lv_font_glyph_dsc_t * g_dsc, lv_draw_buf_t * draw_buf, const lv_area_t *area);
 #else
 /**
  * Used as `get_glyph_bitmap` callback in LittelvGL's native font format if the font is uncompressed.
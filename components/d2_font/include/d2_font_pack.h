@@ -0,0 +1,80 @@
+/*
+ * SPDX-FileCopyrightText: 2026 udoudou
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "src/font/lv_font.h"
+
+/**
+ * A font family pack: several sizes of the same font in one bin, made by `tools/d2_font/d2_font_pack.py`.
+ *
+ * The sizes share the codepoint to glyph id tables (`unicode_list` and `glyph_id_ofs_list` of the cmaps),
+ * each size has its own glyph index, descriptors, kerning and bitmaps.
+ * The pack is mapped and verified once, and a `lv_font_t` object is ready for each size.
+ */
+typedef struct d2_font_pack_t d2_font_pack_t;
+
+/**
+ * Open a font pack from partition.
+ * @param label Partition label where the pack is stored.
+ * @param[out] out_pack Store the pack pointer. IF failed, it will be set to NULL.
+ * @return
+ *     - ESP_OK: succeed
+ *     - ESP_ERR_NOT_FOUND: no partitions found
+ *     - ESP_ERR_INVALID_ARG: invalid argument
+ *     - ESP_ERR_INVALID_CRC: data validation error
+ *     - ESP_ERR_INVALID_VERSION: the bin needs a newer d2_font
+ *     - ESP_ERR_NO_MEM: Memory allocation failure
+ */
+esp_err_t d2_font_pack_open(const char *label, d2_font_pack_t **out_pack);
+
+/**
+ * Open a font pack from memory.
+ *
+ * Note: The memory address space passed in should remain accessible until the pack is closed.
+ *
+ * @param bin_ptr a pointer to the pack. It can be the address obtained by mmap.
+ * @param size pack size.
+ * @param[out] out_pack Store the pack pointer. IF failed, it will be set to NULL.
+ * @return
+ *     - ESP_OK: succeed
+ *     - ESP_ERR_INVALID_ARG: invalid argument
+ *     - ESP_ERR_INVALID_CRC: data validation error
+ *     - ESP_ERR_INVALID_VERSION: the bin needs a newer d2_font
+ *     - ESP_ERR_NO_MEM: Memory allocation failure
+ */
+esp_err_t d2_font_pack_open_from_mem(const uint8_t *bin_ptr, size_t size, d2_font_pack_t **out_pack);
+
+/**
+ * Get the font of a size from a pack.
+ *
+ * Note: The font belongs to the pack, it is freed by `d2_font_pack_close`. Do not pass it to `d2_font_unload`.
+ *
+ * @param pack the pack from `d2_font_pack_open_xx`.
+ * @param size font size in pixels, as given to `d2_font_pack.py`.
+ * @param[out] out_font Store lv_font_t pointer. IF failed, it will be set to NULL.
+ * @return
+ *     - ESP_OK: succeed
+ *     - ESP_ERR_INVALID_ARG: invalid argument
+ *     - ESP_ERR_NOT_FOUND: no font of this size in the pack
+ */
+esp_err_t d2_font_pack_get(const d2_font_pack_t *pack, uint32_t size, lv_font_t **out_font);
+
+/**
+ * Close a pack and free all its fonts.
+ * @param pack the pack from `d2_font_pack_open_xx`.
+ */
+void d2_font_pack_close(d2_font_pack_t *pack);
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
@@ -0,0 +1,73 @@
+/*
+ * SPDX-FileCopyrightText: 2026 udoudou
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "esp_err.h"
+#include "src/font/lv_font.h"
+
+/**
+ * Let the prefetch task decode glyphs of a font ahead of LVGL.
+ *
+ * The task (created on the first call, on core `CONFIG_D2_FONT_PREFETCH_TASK_CORE`) looks up and decodes
+ * the letters of texts passed to `d2_font_prefetch_utf8` into a single-producer/single-consumer ring.
+ * When LVGL then draws the text, the bitmap callback hands it the decoded glyphs in the ring instead of
+ * decoding them itself. A glyph stays in its slot until LVGL asks for the next prefetched one.
+ *
+ * A suspended font is resumed first, see `d2_font_resume`. While prefetch is enabled the font cannot be
+ * suspended nor shrunk to `D2_FONT_SHRINK_INDEX`.
+ *
+ * Note: Only available with LVGL v9 and `CONFIG_D2_FONT_PREFETCH`.
+ *
+ * @param font `lv_font_t` object from `d2_font_load_xx`.
+ * @return
+ *     - ESP_OK: succeed, or already enabled
+ *     - ESP_ERR_INVALID_ARG: invalid argument
+ *     - ESP_ERR_NO_MEM: Memory allocation failure
+ *     - Others: `d2_font_resume` errors
+ *     - ESP_ERR_NOT_SUPPORTED: LVGL version is not supported, or `CONFIG_D2_FONT_PREFETCH` is disabled
+ */
+esp_err_t d2_font_prefetch_enable(lv_font_t *font);
+
+/**
+ * Stop prefetching glyphs of a font and free its ring. Waits for the prefetch task to finish the texts queued
+ * for the font. `d2_font_unload` calls it.
+ * @param font `lv_font_t` object from `d2_font_load_xx`.
+ * @return
+ *     - ESP_OK: succeed, or prefetch was not enabled
+ *     - ESP_ERR_INVALID_ARG: invalid argument
+ *     - ESP_ERR_NO_MEM: the task could not be told, prefetch is disabled and the ring is leaked
+ *     - ESP_ERR_NOT_SUPPORTED: LVGL version is not supported, or `CONFIG_D2_FONT_PREFETCH` is disabled
+ */
+esp_err_t d2_font_prefetch_disable(lv_font_t *font);
+
+/**
+ * Queue a text for the prefetch task, ideally right before it is set on a label.
+ *
+ * The glyphs are taken from the ring in the order of the text, letters drawn in another order are decoded by
+ * LVGL as usual. Glyphs bigger than `CONFIG_D2_FONT_PREFETCH_SLOT_SIZE` bytes in A8 are not prefetched.
+ * When the ring is full the task waits for LVGL to draw: the glyphs of older texts are only dropped to make
+ * room for this one while LVGL draws something else, and the rest of the text is skipped if LVGL does not
+ * draw with the font for a while.
+ *
+ * @param font `lv_font_t` object with prefetch enabled.
+ * @param text a '\0' terminated UTF-8 string, it is copied.
+ * @return
+ *     - ESP_OK: succeed
+ *     - ESP_ERR_INVALID_ARG: invalid argument
+ *     - ESP_ERR_INVALID_STATE: prefetch is not enabled for the font
+ *     - ESP_ERR_NO_MEM: Memory allocation failure
+ *     - ESP_ERR_TIMEOUT: the request queue is full, the text is skipped
+ *     - ESP_ERR_NOT_SUPPORTED: LVGL version is not supported, or `CONFIG_D2_FONT_PREFETCH` is disabled
+ */
+esp_err_t d2_font_prefetch_utf8(lv_font_t *font, const char *text);
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
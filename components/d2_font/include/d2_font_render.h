@@ -0,0 +1,153 @@
+/*
+ * SPDX-FileCopyrightText: 2026 udoudou
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "esp_err.h"
+#include "lvgl.h"
+#include "d2_font_fmt_txt.h"
+
+/** Pixel format of the destination of `d2_font_render_utf8`*/
+typedef enum {
+    D2_FONT_RENDER_FORMAT_A8,       /**< One opacity byte per pixel, glyphs are blended over the existing pixels*/
+    D2_FONT_RENDER_FORMAT_I1,       /**< One bit per pixel, MSB first, 1: ink. Pixels of 50% opacity or more are set*/
+} d2_font_render_format_t;
+
+/**
+ * Render a text straight into a buffer, without LVGL objects or draw tasks.
+ *
+ * The text is laid out like a LVGL label: advance widths and kerning of the font, the baseline from
+ * `line_height` and `base_line`, and '\n' starts a new line. Letters the font does not have are skipped.
+ * Glyphs are read row by row into the destination; no glyph bitmap is allocated, rows above and below the clip
+ * area are skipped and glyphs outside of it are not read at all.
+ *
+ * Note: Call it from the same context as LVGL (or with the LVGL lock held), it shares the glyph cache of the font.
+ *
+ * @param font `lv_font_t` object from `d2_font_load_xx`.
+ * @param text a '\0' terminated UTF-8 string.
+ * @param x left of the first line in `dst`, in pixels
+ * @param y top of the first line in `dst`, in pixels
+ * @param dst the destination buffer
+ * @param stride bytes of a line of `dst`
+ * @param fmt pixel format of `dst`
+ * @param clip the area of `dst` that may be written, inclusive, it has to be inside `dst`
+ * @return
+ *     - ESP_OK: succeed
+ *     - ESP_ERR_INVALID_ARG: invalid argument
+ *     - ESP_ERR_NOT_SUPPORTED: the bitmap format of the font is not supported
+ */
+esp_err_t d2_font_render_utf8(const lv_font_t *font, const char *text, int32_t x, int32_t y,
+                              uint8_t *dst, uint32_t stride, d2_font_render_format_t fmt, const lv_area_t *clip);
+
+/**
+ * Render a text into a RGB565 buffer, in one color on an opaque background color.
+ *
+ * Same layout and clipping as `d2_font_render_utf8`. The pixels under the ink of the glyphs get `fg` blended over
+ * `bg`, so the buffer is expected to be filled with `bg` there. With `CONFIG_D2_FONT_TILE_CACHE`, glyphs are blended
+ * once into tiles kept per font (keyed by glyph id, `fg` and `bg`, least recently used evicted first) and redraws
+ * copy the rows of the tiles with `memcpy`. Tiles of colors no longer used age out of the cache; call
+ * `d2_font_tile_cache_clear` to drop them at once when a style changes its colors.
+ *
+ * Note: Call it from the same context as LVGL (or with the LVGL lock held), it shares the glyph cache of the font.
+ *
+ * @param font `lv_font_t` object from `d2_font_load_xx`.
+ * @param text a '\0' terminated UTF-8 string.
+ * @param x left of the first line in `dst`, in pixels
+ * @param y top of the first line in `dst`, in pixels
+ * @param dst the destination buffer, RGB565 in native byte order
+ * @param stride bytes of a line of `dst`
+ * @param fg text color, RGB565
+ * @param bg background color, RGB565
+ * @param clip the area of `dst` that may be written, inclusive, it has to be inside `dst`
+ * @return
+ *     - ESP_OK: succeed
+ *     - ESP_ERR_INVALID_ARG: invalid argument
+ *     - ESP_ERR_NOT_SUPPORTED: the bitmap format of the font is not supported
+ */
+esp_err_t d2_font_render_utf8_rgb565(const lv_font_t *font, const char *text, int32_t x, int32_t y,
+                                     uint8_t *dst, uint32_t stride, uint16_t fg, uint16_t bg, const lv_area_t *clip);
+
+/**
+ * Drop all the RGB565 tiles of a font, see `d2_font_render_utf8_rgb565`.
+ * @param font `lv_font_t` object from `d2_font_load_xx`.
+ */
+void d2_font_tile_cache_clear(lv_font_t *font);
+
+/**
+ * Decode the visible part of a glyph to A8.
+ *
+ * Only the rows and columns inside `area` are decoded: plain bitmaps seek straight to the first visible row,
+ * compressed ones stop after the last visible row, and clipped columns are not written. A glyph partly outside
+ * the draw area costs in proportion to what is shown.
+ *
+ * Note: Call it from the same context as LVGL (or with the LVGL lock held), it shares the glyph cache of the font.
+ *
+ * @param font `lv_font_t` object from `d2_font_load_xx`.
+ * @param letter a UNICODE letter code
+ * @param area the rows and columns to decode, relative to the top-left of the glyph's bounding box, inclusive
+ * @param buf A8 bitmap of the whole bounding box (`box_w` x `box_h` of the glyph descriptor), pixels outside
+ *            `area` are left as they are
+ * @param stride bytes of a line of `buf`, at least `box_w`
+ * @return
+ *     - ESP_OK: succeed
+ *     - ESP_ERR_INVALID_ARG: invalid argument
+ *     - ESP_ERR_NOT_FOUND: the letter is not in this font
+ *     - ESP_ERR_NOT_SUPPORTED: the bitmap format of the font is not supported
+ */
+esp_err_t d2_font_get_glyph_a8_area(const lv_font_t *font, uint32_t letter, const lv_area_t *area,
+                                    uint8_t *buf, uint32_t stride);
+
+/**
+ * Get the layout of a glyph by its glyph id, without going through the cmaps.
+ *
+ * Glyph ids index the glyph descriptors of one bin; they come from `tools/d2_font/d2_font_gids.py` run on the
+ * same bin the font is loaded from, and are meaningless for any other bin (even the same font converted again).
+ *
+ * @param font `lv_font_t` object from `d2_font_load_xx`.
+ * @param gid the glyph id, 1 to the number of glyphs of the bin - 1
+ * @param gid_next glyph id of the next glyph for kerning, 0 for none
+ * @param out_glyph the glyph, `unicode_letter` and `pos_x` are set to 0
+ * @return
+ *     - ESP_OK: succeed
+ *     - ESP_ERR_INVALID_ARG: invalid argument
+ *     - ESP_ERR_NOT_FOUND: the glyph id is not in this font
+ */
+esp_err_t d2_font_get_glyph_dsc_by_gid(const lv_font_t *font, uint32_t gid, uint32_t gid_next,
+                                       d2_font_run_glyph_t *out_glyph);
+
+/**
+ * Same as `d2_font_get_glyph_a8_area` for a glyph id, see `d2_font_get_glyph_dsc_by_gid`.
+ * @return
+ *     - ESP_OK: succeed
+ *     - ESP_ERR_INVALID_ARG: invalid argument
+ *     - ESP_ERR_NOT_FOUND: the glyph id is not in this font
+ *     - ESP_ERR_NOT_SUPPORTED: the bitmap format of the font is not supported
+ */
+esp_err_t d2_font_get_glyph_a8_area_by_gid(const lv_font_t *font, uint32_t gid, const lv_area_t *area,
+                                           uint8_t *buf, uint32_t stride);
+
+/**
+ * Same as `d2_font_render_utf8` for a text already converted to glyph ids, see `d2_font_get_glyph_dsc_by_gid`.
+ *
+ * No UTF-8 decoding and no cmap search are done, which suits fixed UI strings converted at build time.
+ * Glyph id 0 starts a new line.
+ *
+ * @param gids the glyph ids of the text
+ * @param num number of `gids`
+ * @return
+ *     - ESP_OK: succeed
+ *     - ESP_ERR_INVALID_ARG: invalid argument
+ *     - ESP_ERR_NOT_SUPPORTED: the bitmap format of the font is not supported
+ */
+esp_err_t d2_font_render_gids(const lv_font_t *font, const uint32_t *gids, uint32_t num, int32_t x, int32_t y,
+                              uint8_t *dst, uint32_t stride, d2_font_render_format_t fmt, const lv_area_t *clip);
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
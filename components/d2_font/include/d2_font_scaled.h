@@ -0,0 +1,58 @@
+/*
+ * SPDX-FileCopyrightText: 2026 udoudou
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "src/font/lv_font.h"
+
+/** Largest factor of `d2_font_load_scaled`*/
+#define D2_FONT_SCALED_FACTOR_MAX   8
+
+/** How the glyphs of a scaled font are upsampled*/
+typedef enum {
+    D2_FONT_SCALE_NEAREST,          /**< Every pixel becomes a factor x factor block, rows are copied with `memcpy`*/
+    D2_FONT_SCALE_BILINEAR,         /**< Bilinear interpolation, softer edges for a few more operations per pixel*/
+} d2_font_scale_filter_t;
+
+/**
+ * Create a font drawing the glyphs of another font at an integer multiple of its size.
+ *
+ * Metrics (`adv_w`, `box_w`, `box_h`, `ofs_x`, `ofs_y`, kerning, `line_height`, `base_line` and the underline)
+ * are multiplied by `factor`, and the glyph bitmaps are upsampled while they are decoded. One stored size can so
+ * serve large numerals (clocks, gauges) at 2x or 3x without a bin, a mapping or a cache of its own; the cost is
+ * the upsampling and the blockier look of a pixel font blown up.
+ *
+ * With LVGL v8 the glyphs are drawn as 8 bpp bitmaps, upsampled into a buffer held by the scaled font.
+ *
+ * Note: The scaled font only serves LVGL. Other `d2_font_xx` functions take the base font, and the base font
+ *       has to outlive the scaled one. Call it from the same context as LVGL (or with the LVGL lock held).
+ *
+ * @param base_font `lv_font_t` object of a bitmap font, usually from `d2_font_load_xx`.
+ * @param factor 2 to `D2_FONT_SCALED_FACTOR_MAX`
+ * @param filter how the bitmaps are upsampled
+ * @param[out] out_font Store lv_font_t pointer. IF failed, it will be set to NULL.
+ * @return
+ *     - ESP_OK: succeed
+ *     - ESP_ERR_INVALID_ARG: invalid argument
+ *     - ESP_ERR_NO_MEM: Memory allocation failure
+ */
+esp_err_t d2_font_load_scaled(const lv_font_t *base_font, uint8_t factor, d2_font_scale_filter_t filter,
+                              lv_font_t **out_font);
+
+/**
+ * Free a font from `d2_font_load_scaled`. The base font is not touched.
+ * @param font `lv_font_t` object from `d2_font_load_scaled`.
+ */
+void d2_font_unload_scaled(lv_font_t *font);
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
@@ -0,0 +1,118 @@
+/*
+ * SPDX-FileCopyrightText: 2026 udoudou
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "src/font/lv_font.h"
+
+/** What `d2_font_shrink` frees, each level includes the ones before it*/
+typedef enum {
+    D2_FONT_SHRINK_RUNS,            /**< Cached runs, RGB565 tiles and the LVGL v8 bitmap buffer, rebuilt as text is drawn*/
+    D2_FONT_SHRINK_PINNED,          /**< Glyphs pinned by `d2_font_preload_utf8` or decoded by the frame budget*/
+    D2_FONT_SHRINK_INDEX,           /**< The ASCII table and the glyph id ranges of the cmaps*/
+    D2_FONT_SHRINK_LEVEL_MAX,
+} d2_font_shrink_level_t;
+
+/** Settings of `d2_font_shrink_hook_enable`*/
+typedef struct {
+    uint32_t caps;                                  /**< `MALLOC_CAP_*` flags of the heap watched*/
+    /** Shrink to a level when the free size of the heap falls below its threshold, 0: level not used*/
+    size_t free_below[D2_FONT_SHRINK_LEVEL_MAX];
+    uint32_t period_ms;                             /**< Period of the check, 0: 100 ms*/
+    bool timer_disabled;                            /**< No timer, only shrink when an allocation fails*/
+} d2_font_shrink_hook_config_t;
+
+/**
+ * Free the RAM a font can do without, up to a level. The font keeps working: runs and tiles are built again
+ * as text is drawn, glyphs are looked up and decoded from the font data instead of being pinned, and the
+ * ASCII table comes back at `d2_font_resume`.
+ *
+ * The prefetch ring and the access trace are not touched, see `d2_font_prefetch_disable` and
+ * `d2_font_trace_stop`. The prefetch task looks glyphs up in the index, so `D2_FONT_SHRINK_INDEX` needs it disabled.
+ *
+ * Note: Call it from the same context as LVGL (or with the LVGL lock held), not while a glyph is drawn.
+ *
+ * @param font `lv_font_t` object from `d2_font_load_xx`.
+ * @param level the last level freed
+ * @return
+ *     - ESP_OK: succeed
+ *     - ESP_ERR_INVALID_ARG: invalid argument
+ *     - ESP_ERR_INVALID_STATE: `D2_FONT_SHRINK_INDEX` while the prefetch task is enabled for the font, nothing is freed
+ */
+esp_err_t d2_font_shrink(lv_font_t *font, d2_font_shrink_level_t level);
+
+/**
+ * Put a font aside for a screen-off or low power state.
+ *
+ * Frees everything `d2_font_shrink(font, D2_FONT_SHRINK_INDEX)` does and, for fonts of
+ * `d2_font_load_from_partition_xx`, releases the mapping of the partition. The font stays loaded: it is mapped
+ * again by `d2_font_resume`, or by the first glyph lookup, without checking its SHA-256 again. Fonts on memory
+ * of the caller (`d2_font_load_from_mem_xx`, packs, embedded fonts) keep their data.
+ *
+ * Note: Call it from the same context as LVGL (or with the LVGL lock held). Fonts shared with
+ *       `d2_font_acquire` are suspended for all the users.
+ *
+ * @param font `lv_font_t` object from `d2_font_load_xx`.
+ * @return
+ *     - ESP_OK: succeed, or already suspended
+ *     - ESP_ERR_INVALID_ARG: invalid argument
+ *     - ESP_ERR_INVALID_STATE: the prefetch task is enabled for the font
+ */
+esp_err_t d2_font_suspend(lv_font_t *font);
+
+/**
+ * Map a suspended font again and rebuild its ASCII table. Optional, the first glyph lookup does it too;
+ * call it to keep the cost out of the first frame.
+ * @param font `lv_font_t` object from `d2_font_load_xx`.
+ * @return
+ *     - ESP_OK: succeed, or not suspended
+ *     - ESP_ERR_INVALID_ARG: invalid argument
+ *     - Others: `esp_partition_mmap` errors, the font stays suspended
+ */
+esp_err_t d2_font_resume(lv_font_t *font);
+
+/**
+ * Shrink a font when a heap runs low.
+ *
+ * When an allocation of the font fails, e.g. for a tile, a pinned glyph or the lines of a compressed glyph, its
+ * tiles and pinned glyphs are freed and the allocation is tried again. A new run (`d2_font_run_get`) may also
+ * drop the cached runs. The index is never freed this way.
+ *
+ * Unless `timer_disabled` is set, a LVGL timer also checks the free size of the heap and calls `d2_font_shrink`
+ * with the highest level whose threshold is crossed, between frames, before allocations start failing. Set
+ * increasing thresholds, e.g. 64 KB, 32 KB and 16 KB. The font is shrunk when the level rises, then while the
+ * heap stays low only when its caches have grown since the last shrink, so the caches of a font drawn on a low
+ * heap are not wiped at every check. While the prefetch task is enabled for the font, the timer stops at
+ * `D2_FONT_SHRINK_PINNED`.
+ *
+ * Note: Call it from the same context as LVGL (or with the LVGL lock held). Calling it again changes the
+ *       settings.
+ *
+ * @param font `lv_font_t` object from `d2_font_load_xx`.
+ * @param config the settings, it is copied
+ * @return
+ *     - ESP_OK: succeed
+ *     - ESP_ERR_INVALID_ARG: invalid argument
+ *     - ESP_ERR_NO_MEM: Memory allocation failure
+ */
+esp_err_t d2_font_shrink_hook_enable(lv_font_t *font, const d2_font_shrink_hook_config_t *config);
+
+/**
+ * Stop watching the heap and retrying allocations for a font. `d2_font_unload` calls it.
+ * @param font `lv_font_t` object from `d2_font_load_xx`.
+ */
+void d2_font_shrink_hook_disable(lv_font_t *font);
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
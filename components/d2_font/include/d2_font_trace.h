@@ -0,0 +1,97 @@
+/*
+ * SPDX-FileCopyrightText: 2026 udoudou
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "src/font/lv_font.h"
+
+/** What a trace event records*/
+typedef enum {
+    D2_FONT_TRACE_DSC,              /**< Glyph descriptor looked up in the font data, `glyph_id` 0: not in the font*/
+    D2_FONT_TRACE_DSC_RAM,          /**< Glyph descriptor served from RAM (run cache or ASCII table)*/
+    D2_FONT_TRACE_BITMAP,           /**< Glyph bitmap read from the font data*/
+    D2_FONT_TRACE_BITMAP_RAM,       /**< Glyph bitmap served from RAM (pinned or prefetched), `glyph_id` is 0*/
+} d2_font_trace_kind_t;
+
+/** A glyph access, 16 bytes*/
+typedef struct {
+    uint32_t letter : 21;           /**< UNICODE letter code*/
+    uint32_t kind : 3;              /**< `d2_font_trace_kind_t`*/
+    uint32_t reserved : 8;
+    uint32_t glyph_id;
+    uint32_t bitmap_ofs;            /**< `D2_FONT_TRACE_BITMAP`: offset of the bitmap from the start of the GBIT section*/
+    uint32_t bitmap_len;            /**< `D2_FONT_TRACE_BITMAP`: bytes of a plain bitmap, 0 for compressed ones*/
+} d2_font_trace_event_t;
+
+/**
+ * Record the glyph accesses of a font into a ring of `CONFIG_D2_FONT_TRACE_EVENTS` events.
+ *
+ * Every descriptor and bitmap request of LVGL is recorded, also the ones served from RAM, so a replay can
+ * simulate other cache setups. The oldest events are overwritten when the ring is full. Calling it again
+ * clears the ring.
+ *
+ * Note: Only available with `CONFIG_D2_FONT_TRACE`. Call it from the same context as LVGL
+ *       (or with the LVGL lock held).
+ *
+ * @param font `lv_font_t` object from `d2_font_load_xx`.
+ * @return
+ *     - ESP_OK: succeed
+ *     - ESP_ERR_INVALID_ARG: invalid argument
+ *     - ESP_ERR_NO_MEM: Memory allocation failure
+ *     - ESP_ERR_NOT_SUPPORTED: `CONFIG_D2_FONT_TRACE` is disabled
+ */
+esp_err_t d2_font_trace_start(lv_font_t *font);
+
+/**
+ * Stop recording and free the ring. `d2_font_unload` calls it.
+ * @param font `lv_font_t` object from `d2_font_load_xx`.
+ * @return
+ *     - ESP_OK: succeed, or not recording
+ *     - ESP_ERR_INVALID_ARG: invalid argument
+ *     - ESP_ERR_NOT_SUPPORTED: `CONFIG_D2_FONT_TRACE` is disabled
+ */
+esp_err_t d2_font_trace_stop(lv_font_t *font);
+
+/**
+ * Copy the recorded events, oldest first.
+ * @param font `lv_font_t` object being traced.
+ * @param[out] events output events
+ * @param max size of `events`
+ * @param[out] out_num number of events copied
+ * @param[out] out_dropped number of events overwritten since the start, can be NULL
+ * @return
+ *     - ESP_OK: succeed
+ *     - ESP_ERR_INVALID_ARG: invalid argument
+ *     - ESP_ERR_INVALID_STATE: the font is not traced
+ *     - ESP_ERR_NOT_SUPPORTED: `CONFIG_D2_FONT_TRACE` is disabled
+ */
+esp_err_t d2_font_trace_read(const lv_font_t *font, d2_font_trace_event_t *events, uint32_t max, uint32_t *out_num,
+                             uint32_t *out_dropped);
+
+/**
+ * Print the recorded events to the console, for `tools/d2_font/d2_font_trace.py`.
+ *
+ * The output is a `d2_font_trace begin` line, one `d2t <kind> <letter> <glyph_id> <bitmap_ofs> <bitmap_len>`
+ * line per event (hexadecimal letter, decimal numbers) and a `d2_font_trace end` line. Other lines of the log
+ * are ignored by the tool.
+ *
+ * @param font `lv_font_t` object being traced.
+ * @return
+ *     - ESP_OK: succeed
+ *     - ESP_ERR_INVALID_ARG: invalid argument
+ *     - ESP_ERR_INVALID_STATE: the font is not traced
+ *     - ESP_ERR_NOT_SUPPORTED: `CONFIG_D2_FONT_TRACE` is disabled
+ */
+esp_err_t d2_font_trace_dump(const lv_font_t *font);
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
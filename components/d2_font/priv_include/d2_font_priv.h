@@ -0,0 +1,483 @@
+/*
+ * SPDX-FileCopyrightText: 2025 udoudou
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "d2_font.h"
+#include "d2_font_fmt_txt.h"
+#include "d2_font_trace.h"
+#include "d2_font_shrink.h"
+
+#include "sdkconfig.h"
+#include "esp_err.h"
+#include "esp_partition.h"
+
+/** `glyph_index` is `d2_font_fmt_txt_glyph_index_wide_t`*/
+#define D2_FONT_HEADER_FLAG_WIDE_INDEX      (1 << 0)
+/** The CMAP section is `d2_font_fmt_txt_cmap_packed_t`*/
+#define D2_FONT_HEADER_FLAG_CMAP_COMPRESSED (1 << 1)
+/** Flags this version reads, bins with other flags need a newer d2_font*/
+#define D2_FONT_HEADER_FLAGS_KNOWN          (D2_FONT_HEADER_FLAG_WIDE_INDEX | D2_FONT_HEADER_FLAG_CMAP_COMPRESSED)
+
+#if CONFIG_D2_FONT_RUN_CACHE
+typedef struct {
+    d2_font_run_t *runs[CONFIG_D2_FONT_RUN_CACHE_NUM];  /**< Most recently used first*/
+    uint32_t num;
+    const d2_font_run_t *follow;    /**< Run matched by the last `get_glyph_dsc` call*/
+    uint32_t follow_pos;            /**< Position expected in `follow` by the next call*/
+} d2_font_fmt_txt_run_cache_t;
+#endif
+
+#if CONFIG_D2_FONT_ASCII_TABLE
+#define D2_FONT_ASCII_FIRST     0x20    /**< First letter of the ASCII table*/
+#define D2_FONT_ASCII_NUM       95      /**< 0x20 - 0x7E*/
+
+/** A printable ASCII letter, resolved at load time*/
+typedef struct {
+    uint32_t glyph_id;                  /**< 0: the letter is not in this font*/
+    const uint8_t *bitmap;              /**< Bitmap in the font data*/
+    d2_font_fmt_txt_glyph_dsc_t dsc;    /**< Copy of the descriptor*/
+} d2_font_fmt_txt_ascii_glyph_t;
+
+/** Descriptors and kerning of the printable ASCII letters in RAM, see `CONFIG_D2_FONT_ASCII_TABLE`*/
+typedef struct {
+    d2_font_fmt_txt_ascii_glyph_t glyphs[D2_FONT_ASCII_NUM];
+    /** Kern values of every letter pair, `kern[left * D2_FONT_ASCII_NUM + right]`. NULL if no pair is kerned*/
+    int8_t *kern;
+} d2_font_fmt_txt_ascii_t;
+#endif
+
+/** Members of the font context depending on the build options, allocated right after `d2_font_context_t`*/
+struct d2_font_context_ext_t {
+#if CONFIG_D2_FONT_RUN_CACHE
+    d2_font_fmt_txt_run_cache_t run_cache;
+#endif
+#if CONFIG_D2_FONT_ASCII_TABLE
+    d2_font_fmt_txt_ascii_t *ascii;
+#endif
+#if CONFIG_D2_FONT_TILE_CACHE
+    struct d2_font_tile_cache_t *tiles;         /**< RGB565 tiles of `d2_font_render_utf8_rgb565`*/
+#endif
+#if CONFIG_D2_FONT_PREFETCH
+    struct d2_font_prefetch_ring_t *prefetch;   /**< Glyphs decoded by the prefetch task, see `d2_font_prefetch.h`*/
+#endif
+#if CONFIG_D2_FONT_TRACE
+    struct d2_font_trace_t *trace;              /**< Recorded glyph accesses, see `d2_font_trace.h`*/
+#endif
+#if CONFIG_D2_FONT_FRAME_BUDGET
+    struct d2_font_budget_t *budget;            /**< Per frame decoding budget, see `d2_font_budget.h`*/
+#endif
+#if LVGL_VERSION_MAJOR < 9
+    uint8_t *bitmap_out;                        /**< Decompressed glyph returned to LVGL v8*/
+    size_t bitmap_out_size;
+#endif
+};
+
+/** Font metrics stored in the bin header*/
+typedef struct {
+    uint32_t version;
+    int32_t line_height;
+    int32_t base_line;
+    uint8_t subpx;
+    int8_t underline_position;
+    int8_t underline_thickness;
+    uint8_t flags;                  /**< `D2_FONT_HEADER_FLAG_xx`, 0 in older bins*/
+} __attribute__((packed)) d2_font_header_bin_t;
+
+/**
+ * Allocate memory of a font, with the heap caps of its category. Fails if the category budget would be exceeded.
+ * @param mem memory settings and counters of the font
+ * @param type memory category
+ * @param size bytes to allocate
+ * @param zero clear the memory
+ * @return the memory, NULL on failure
+ */
+void *d2_font_mem_alloc(d2_font_fmt_txt_mem_t *mem, d2_font_mem_type_t type, size_t size, bool zero);
+
+/**
+ * Resize memory from `d2_font_mem_alloc`.
+ * @param old_size current size of `ptr`, 0 if `ptr` is NULL
+ * @return the memory, NULL on failure (`ptr` is kept)
+ */
+void *d2_font_mem_realloc(d2_font_fmt_txt_mem_t *mem, d2_font_mem_type_t type, void *ptr, size_t old_size, size_t size);
+
+/**
+ * Free memory from `d2_font_mem_alloc`.
+ * @param size the size it was allocated with
+ */
+void d2_font_mem_free(d2_font_fmt_txt_mem_t *mem, d2_font_mem_type_t type, void *ptr, size_t size);
+
+/**
+ * Check the SHA-256 stored right after the data.
+ * @param bin_ptr start of the data
+ * @param length data length, the SHA-256 is at `bin_ptr + length`
+ * @return
+ *     - ESP_OK: succeed
+ *     - ESP_ERR_INVALID_CRC: data validation error
+ */
+esp_err_t d2_font_check_sha256(const uint8_t *bin_ptr, uint32_t length);
+
+/**
+ * Check the SHA-256 stored right after the data, or only compare it with the verification cache.
+ *
+ * With `CONFIG_D2_FONT_VERIFY_CACHE`, a font of a partition whose stored SHA-256 was already checked is not
+ * hashed again, and a newly checked one is recorded in NVS.
+ * @param partition partition holding the data, NULL if it does not come from a partition
+ * @param bin_ptr start of the data, the start of the partition if `partition` is set
+ * @param length data length, the SHA-256 is at `bin_ptr + length`
+ * @return
+ *     - ESP_OK: succeed
+ *     - ESP_ERR_INVALID_CRC: data validation error
+ */
+esp_err_t d2_font_verify(const esp_partition_t *partition, const uint8_t *bin_ptr, uint32_t length);
+
+/**
+ * Forget the verification of the font in a partition. Call it before the partition is written.
+ * @return
+ *     - ESP_OK: succeed, or nothing was recorded
+ *     - Others: NVS errors
+ */
+esp_err_t d2_font_verify_cache_invalidate_partition(const esp_partition_t *partition);
+
+#if CONFIG_D2_FONT_ASCII_TABLE
+/**
+ * Resolve the printable ASCII letters of a font into a table in RAM. Not fatal if it fails, the letters are
+ * then looked up in the font data.
+ */
+void d2_font_ascii_table_create(lv_font_t *font);
+
+/** Free the table of `d2_font_ascii_table_create`*/
+void d2_font_ascii_table_free(lv_font_t *font);
+#endif
+
+/**
+ * Make sure the font data is mapped, it is mapped again if the font was suspended.
+ * Call it before reading the font data through `base_ptr`.
+ * @return false: the font data could not be mapped
+ */
+static inline bool d2_font_fmt_txt_mapped(const lv_font_t *font)
+{
+    const d2_font_context_t *ctx = (const d2_font_context_t *)font->user_data;
+    return !ctx->suspended || d2_font_resume((lv_font_t *)font) == ESP_OK;
+}
+
+/**
+ * Create a `lv_font_t` object on verified font data.
+ * @param base_ptr base of the offsets stored in the font tables
+ * @param dsc_offset offset of `d2_font_fmt_txt_dsc_t` from `base_ptr`
+ * @param dsc_length length of the font tables from `d2_font_fmt_txt_dsc_t`
+ * @param font_header metrics of the font
+ * @param options memory settings, NULL for `D2_FONT_LOAD_OPTIONS_DEFAULT`
+ * @param check_tables check the bounds and tags of the tables, false if they were checked at build time
+ * @param[out] out_font Store lv_font_t pointer. IF failed, it will be set to NULL.
+ * @return
+ *     - ESP_OK: succeed
+ *     - ESP_ERR_INVALID_CRC: a table is not where it should be
+ *     - ESP_ERR_INVALID_VERSION: unknown header flags
+ *     - ESP_ERR_NO_MEM: Memory allocation failure
+ */
+esp_err_t d2_font_create(const uint8_t *base_ptr, uint32_t dsc_offset, uint32_t dsc_length,
+                         const d2_font_header_bin_t *font_header, const d2_font_load_options_t *options,
+                         bool check_tables, lv_font_t **out_font);
+
+/** A glyph resolved from the font tables*/
+typedef struct {
+    uint32_t glyph_id;
+    const d2_font_fmt_txt_glyph_dsc_t *gdsc;
+    const uint8_t *bitmap;                  /**< Bitmap in the font data, in the font's bpp and format*/
+} d2_font_fmt_txt_glyph_t;
+
+/**
+ * Look up a letter in the font tables.
+ * @param font pointer to a d2_font
+ * @param letter a UNICODE letter code
+ * @param[out] glyph store the result here
+ * @return true: found; false: the letter is not in this font
+ */
+bool d2_font_fmt_txt_resolve_glyph(const lv_font_t *font, uint32_t letter, d2_font_fmt_txt_glyph_t *glyph);
+
+/**
+ * Look up a letter in the font tables, like `d2_font_fmt_txt_resolve_glyph`, without the per-font cache.
+ * It only reads the font data, so it can run in another task than LVGL.
+ * @param font pointer to a d2_font
+ * @param letter a UNICODE letter code
+ * @param[out] glyph store the result here
+ * @return true: found; false: the letter is not in this font
+ */
+bool d2_font_fmt_txt_resolve_glyph_nocache(const lv_font_t *font, uint32_t letter, d2_font_fmt_txt_glyph_t *glyph);
+
+/**
+ * Look up the descriptor of a letter, the same way as `d2_font_get_glyph_dsc_fmt_txt` does.
+ * @param font pointer to a d2_font
+ * @param unicode_letter a UNICODE letter code
+ * @param unicode_letter_next the letter after it, for kerning
+ * @param[out] glyph store the result here, `glyph_id` is 0 and the metrics are cleared if not found
+ * @return true: found; false: the letter is not in this font
+ */
+bool d2_font_fmt_txt_lookup_glyph(const lv_font_t *font, uint32_t unicode_letter, uint32_t unicode_letter_next,
+                                  d2_font_run_glyph_t *glyph);
+
+/**
+ * Get the metrics of a glyph id, like `d2_font_fmt_txt_lookup_glyph` without the cmap lookup.
+ * @param font pointer to a d2_font
+ * @param gid a glyph id
+ * @param gid_next the glyph id after it, for kerning, 0 for none
+ * @param[out] glyph store the result here, `unicode_letter` is 0, the metrics are cleared if not found
+ * @return true: found; false: the glyph id is not in this font
+ */
+bool d2_font_fmt_txt_lookup_gid(const lv_font_t *font, uint32_t gid, uint32_t gid_next, d2_font_run_glyph_t *glyph);
+
+/**
+ * Resolve a glyph id, like `d2_font_fmt_txt_resolve_glyph` without the cmap lookup.
+ * With the compact glyph index, the cmap holding the glyph is still needed for its bitmap base: the glyph id
+ * range of every cmap is computed at the first call, in `D2_FONT_MEM_INDEX` memory.
+ * @param font pointer to a d2_font
+ * @param gid a glyph id
+ * @param[out] glyph store the result here
+ * @return true: found; false: the glyph id is not in this font
+ */
+bool d2_font_fmt_txt_resolve_gid(const lv_font_t *font, uint32_t gid, d2_font_fmt_txt_glyph_t *glyph);
+
+#if CONFIG_D2_FONT_ASCII_TABLE
+/**
+ * Resolve the printable ASCII letters and their kerning from the font tables.
+ * Call it before the table is attached to the font context.
+ * @param font pointer to a d2_font
+ * @param[out] ascii the table to fill, `kern` is not touched
+ * @param[out] kern `D2_FONT_ASCII_NUM * D2_FONT_ASCII_NUM` kern values
+ * @return true: at least one pair is kerned
+ */
+bool d2_font_fmt_txt_ascii_fill(const lv_font_t *font, d2_font_fmt_txt_ascii_t *ascii, int8_t *kern);
+#endif
+
+/**
+ * Binary search a letter in the pinned glyphs.
+ * @param pin pinned glyphs of a font
+ * @param letter a UNICODE letter code
+ * @param[out] pos index of the letter, or where it should be inserted if not found
+ * @return true: the letter is pinned
+ */
+bool d2_font_fmt_txt_pin_find(const d2_font_fmt_txt_pin_t *pin, uint32_t letter, uint32_t *pos);
+
+#if LV_USE_FONT_COMPRESSED
+typedef enum {
+    D2_RLE_STATE_SINGLE = 0,
+    D2_RLE_STATE_REPEATED,
+    D2_RLE_STATE_COUNTER,
+} d2_font_fmt_rle_state_t;
+
+typedef struct {
+    uint32_t rdp;
+    const uint8_t * in;
+    uint8_t bpp;
+    uint8_t prev_v;
+    uint8_t count;
+    d2_font_fmt_rle_state_t state;
+} d2_font_fmt_rle_t;
+#endif /*LV_USE_FONT_COMPRESSED*/
+
+/** Row by row reader of a glyph bitmap, converts the rows to A8 without decoding the whole glyph*/
+typedef struct {
+    const uint8_t *bitmap;          /**< Bitmap in the font data*/
+    const uint8_t *opa_table;       /**< Raw value to opacity, NULL for 8 bpp*/
+    uint32_t bit_pos;               /**< Plain bitmaps: bit position of the next row*/
+    uint16_t box_w;
+    uint16_t row;                   /**< Index of the next row*/
+    uint8_t bpp;
+    uint8_t bitmap_format;          /**< `d2_font_fmt_txt_bitmap_format_t`*/
+#if LV_USE_FONT_COMPRESSED
+    d2_font_fmt_rle_t rle;
+    uint8_t line[256];              /**< Raw values of the last decoded row, the prefilter XORs the next one with it*/
+#endif
+} d2_font_fmt_txt_rows_t;
+
+/**
+ * Start reading the rows of a glyph bitmap.
+ * @param font pointer to a d2_font
+ * @param glyph the glyph from `d2_font_fmt_txt_resolve_glyph`
+ * @param[out] rows the reader
+ * @return true: succeed; false: the bitmap format is not supported
+ */
+bool d2_font_fmt_txt_rows_init(const lv_font_t *font, const d2_font_fmt_txt_glyph_t *glyph, d2_font_fmt_txt_rows_t *rows);
+
+/**
+ * Skip rows. Plain bitmaps seek to the row, compressed ones decode the skipped rows without converting them.
+ * @param rows the reader
+ * @param num number of rows to skip
+ */
+void d2_font_fmt_txt_rows_skip(d2_font_fmt_txt_rows_t *rows, uint32_t num);
+
+/**
+ * Read the next row and convert the columns `[x_start, x_end)` to A8.
+ * @param rows the reader
+ * @param x_start first column to convert
+ * @param x_end column after the last one to convert, at most `box_w`
+ * @param out `x_end - x_start` opacity values
+ */
+void d2_font_fmt_txt_rows_read(d2_font_fmt_txt_rows_t *rows, int32_t x_start, int32_t x_end, uint8_t *out);
+
+/**
+ * Decode the part of a glyph inside an area to A8, see `d2_font_fmt_txt_rows_t`. Pixels outside of it are not written.
+ * @param font pointer to a d2_font
+ * @param glyph the glyph from `d2_font_fmt_txt_resolve_glyph`
+ * @param area the rows and columns to decode, relative to the top-left of the glyph's bounding box, inclusive
+ * @param bitmap_out A8 bitmap of the whole bounding box
+ * @param stride bytes of a line of `bitmap_out`
+ * @return true: succeed; false: the bitmap format is not supported
+ */
+bool d2_font_fmt_txt_decode_a8_area(const lv_font_t *font, const d2_font_fmt_txt_glyph_t *glyph, const lv_area_t *area,
+                                    uint8_t *bitmap_out, uint32_t stride);
+
+#if CONFIG_D2_FONT_TRACE
+/** Ring of glyph access events, see `d2_font_trace.h`*/
+typedef struct d2_font_trace_t {
+    uint32_t total;                 /**< Events recorded since the start, the next one goes to `total % CONFIG_D2_FONT_TRACE_EVENTS`*/
+    d2_font_trace_event_t events[CONFIG_D2_FONT_TRACE_EVENTS];
+} d2_font_trace_t;
+#endif
+
+#if LVGL_VERSION_MAJOR >= 9
+/**
+ * Decode a glyph to A8, plain or compressed.
+ * @param font pointer to a d2_font
+ * @param glyph the glyph from `d2_font_fmt_txt_resolve_glyph`
+ * @param bitmap_out output buffer, one line is `lv_draw_buf_width_to_stride(box_w, LV_COLOR_FORMAT_A8)` bytes
+ * @param caches caches freed to retry when the scratch lines cannot be allocated, see `d2_font_shrink_retry`;
+ *               0 outside of the LVGL context
+ * @return true: succeed; false: the bitmap format is not supported, or no memory for the scratch lines
+ */
+bool d2_font_fmt_txt_decode_a8(const lv_font_t *font, const d2_font_fmt_txt_glyph_t *glyph, uint8_t *bitmap_out,
+                               uint32_t caches);
+
+/**
+ * Decode a glyph and pin it, see `d2_font_preload_utf8`.
+ * @param font pointer to a d2_font
+ * @param letter a UNICODE letter code
+ * @return
+ *     - ESP_OK: the glyph is pinned, or it is not in the font or has no pixels
+ *     - ESP_ERR_NO_MEM: Memory allocation failure
+ *     - ESP_ERR_NOT_SUPPORTED: the bitmap format is not supported
+ */
+esp_err_t d2_font_pin_glyph(lv_font_t *font, uint32_t letter);
+
+#if CONFIG_D2_FONT_PREFETCH
+/**
+ * Take a glyph decoded by the prefetch task. Called by the bitmap callback, from the LVGL task only.
+ * Glyphs queued before it in the ring are dropped, they are not drawn in the prefetched order.
+ * The glyph is lent from its slot, which is released at the next call.
+ * @param font pointer to a d2_font with prefetch enabled
+ * @param letter a UNICODE letter code
+ * @return the A8 draw buffer of the glyph in the ring, NULL if not prefetched
+ */
+const lv_draw_buf_t *d2_font_prefetch_take(const lv_font_t *font, uint32_t letter);
+#endif
+
+#if CONFIG_D2_FONT_FRAME_BUDGET
+/**
+ * Ask the frame budget before decoding a glyph. Called by the bitmap callback, from the LVGL task only.
+ * @param font pointer to a d2_font with a budget
+ * @param letter a UNICODE letter code
+ * @param gdsc descriptor of the glyph
+ * @param bitmap_out output buffer, one line is `lv_draw_buf_width_to_stride(box_w, LV_COLOR_FORMAT_A8)` bytes
+ * @return true: decode the glyph, then call `d2_font_budget_end`;
+ *         false: the budget of the frame is spent, the glyph is queued and `bitmap_out` holds its placeholder
+ */
+bool d2_font_budget_begin(const lv_font_t *font, uint32_t letter, const d2_font_fmt_txt_glyph_dsc_t *gdsc,
+                          uint8_t *bitmap_out);
+
+/**
+ * Charge the decoding started by `d2_font_budget_begin` to the frame.
+ * @param font pointer to a d2_font with a budget
+ */
+void d2_font_budget_end(const lv_font_t *font);
+
+/**
+ * Get a deferred glyph decoded by the budget timer. Called by the bitmap callback, from the LVGL task only.
+ * @param font pointer to a d2_font with a budget
+ * @param letter a UNICODE letter code
+ * @return the A8 draw buffer of the glyph in the store of the budget, NULL if not decoded yet
+ */
+const lv_draw_buf_t *d2_font_budget_take(const lv_font_t *font, uint32_t letter);
+#endif
+#endif
+
+/**
+ * Free the deferred glyphs decoded by the budget timer of a font, if it has a budget.
+ * @param font pointer to a d2_font
+ */
+void d2_font_budget_clear(lv_font_t *font);
+
+/** Caches `d2_font_shrink_retry` may free*/
+#define D2_FONT_SHRINK_RETRY_RUNS           (1 << 0)    /**< Only from `d2_font_run_get`, callers may hold the others*/
+#define D2_FONT_SHRINK_RETRY_TILES          (1 << 1)
+#define D2_FONT_SHRINK_RETRY_PINNED         (1 << 2)
+
+/**
+ * Free a cache of a font after an allocation failed, when its shrink hook is enabled. Called from the same
+ * context as LVGL only, never from the prefetch task.
+ * @param font pointer to a d2_font
+ * @param[inout] caches `D2_FONT_SHRINK_RETRY_xx` flags of the caches the caller can do without, the ones tried are
+ *                      cleared; start with the caches to try, retry the allocation while it returns true
+ * @return true: something was freed, retry the allocation; false: nothing left to free
+ */
+bool d2_font_shrink_retry(const lv_font_t *font, uint32_t *caches);
+
+/**
+ * Decode the next UTF-8 character.
+ * @param txt a '\0' terminated UTF-8 string
+ * @param i index of the next byte to read, it is advanced past the character
+ * @return the UNICODE letter, 0 at the end of the string
+ */
+static inline uint32_t d2_font_utf8_next(const char *txt, uint32_t *i)
+{
+    const uint8_t *p = (const uint8_t *)txt + *i;
+    uint32_t letter;
+    uint32_t len;
+
+    if (p[0] < 0x80) {
+        letter = p[0];
+        len = 1;
+    } else if ((p[0] & 0xE0) == 0xC0) {
+        letter = p[0] & 0x1F;
+        len = 2;
+    } else if ((p[0] & 0xF0) == 0xE0) {
+        letter = p[0] & 0x0F;
+        len = 3;
+    } else if ((p[0] & 0xF8) == 0xF0) {
+        letter = p[0] & 0x07;
+        len = 4;
+    } else {
+        /*Invalid leading byte, skip it*/
+        (*i)++;
+        return 0xFFFD;
+    }
+
+    for (uint32_t n = 1; n < len; n++) {
+        if ((p[n] & 0xC0) != 0x80) {
+            /*Truncated sequence, resume at the offending byte*/
+            *i += n;
+            return 0xFFFD;
+        }
+        letter = (letter << 6) | (p[n] & 0x3F);
+    }
+    /*Overlong forms ("C0 80" would end the string), surrogates and values past U+10FFFF*/
+    static const uint32_t letter_min[] = { 0, 0, 0x80, 0x800, 0x10000 };
+    if (letter < letter_min[len] || letter > 0x10FFFF || (letter >= 0xD800 && letter <= 0xDFFF)) {
+        *i += len;
+        return 0xFFFD;
+    }
+    if (letter) {
+        *i += len;
+    }
+    return letter;
+}
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
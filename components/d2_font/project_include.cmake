@@ -0,0 +1,36 @@
+# SPDX-FileCopyrightText: 2026 udoudou
+# SPDX-License-Identifier: Apache-2.0
+
+set(D2_FONT_COMPONENT_DIR ${CMAKE_CURRENT_LIST_DIR})
+
+# d2_font_embed(<bin> [NAME <name>] [TARGET <target>])
+#
+# Link a d2_font bin into a component. The bin is checked at build time (header, table tags and SHA-256) and a
+# source defining `const d2_font_embedded_t d2_font_embedded_<name>` is generated, marked
+# `D2_FONT_EMBEDDED_FLAG_VERIFIED`, for `d2_font_load_embedded()`. The build fails if the bin is corrupted.
+#
+# Call it after `idf_component_register()`. NAME defaults to the file name without extension, TARGET to the
+# component library.
+function(d2_font_embed bin)
+    cmake_parse_arguments(_ "" "NAME;TARGET" "" ${ARGN})
+    if(NOT __TARGET)
+        set(__TARGET ${COMPONENT_LIB})
+    endif()
+    get_filename_component(bin_path ${bin} ABSOLUTE BASE_DIR ${CMAKE_CURRENT_SOURCE_DIR})
+    if(NOT __NAME)
+        get_filename_component(__NAME ${bin} NAME_WE)
+    endif()
+    string(MAKE_C_IDENTIFIER ${__NAME} name)
+
+    idf_build_get_property(python PYTHON)
+    set(script ${D2_FONT_COMPONENT_DIR}/tools/d2_font_embed.py)
+    set(out ${CMAKE_CURRENT_BINARY_DIR}/d2_font_embedded_${name}.c)
+    add_custom_command(OUTPUT ${out}
+                       COMMAND ${python} ${script} ${bin_path} ${out} --name ${name}
+                       DEPENDS ${bin_path} ${script}
+                       COMMENT "Checking and embedding d2_font ${bin}"
+                       VERBATIM)
+    target_sources(${__TARGET} PRIVATE ${out})
+    # The generated source only needs d2_font_embedded.h, which has no other dependency
+    target_include_directories(${__TARGET} PRIVATE ${D2_FONT_COMPONENT_DIR}/include)
+endfunction()
@@ -0,0 +1,99 @@
+#!/usr/bin/env python
+#
+# SPDX-FileCopyrightText: 2026 udoudou
+# SPDX-License-Identifier: Apache-2.0
+"""
+Check a d2_font bin and write a C source embedding it, for the `d2_font_embed` CMake function.
+
+    d2_font_embed.py d2_font_demo_14.bin d2_font_embedded_d2_font_demo_14.c --name d2_font_demo_14
+
+The checks are the ones `d2_font_load_from_mem` does at run time (header, dsc length, SHA-256, bounds and tags
+of the tables), so `d2_font_load_embedded` can skip them. It has no dependency, as it runs from the component
+directory during the build.
+"""
+import argparse
+import hashlib
+import re
+import struct
+import sys
+
+HEADER_MAGIC = b'D2FtHd'
+HEADER_SIZE = 8 + struct.calcsize('<IiiBbbB')
+FDSC_FMT = '<IIIIIHH'
+SHA256_LEN = 32
+IDENT_RE = re.compile(r'^[A-Za-z_][A-Za-z0-9_]*$')
+PER_LINE = 16
+
+
+def check(data: bytes) -> None:
+    if len(data) < HEADER_SIZE or data[2:8] != HEADER_MAGIC:
+        raise ValueError('Header error')
+    header_length, = struct.unpack_from('<H', data, 0)
+    if header_length < HEADER_SIZE or header_length + 4 + struct.calcsize(FDSC_FMT) > len(data):
+        raise ValueError('Header_length error')
+    dsc_length, = struct.unpack_from('<I', data, header_length)
+    if header_length + dsc_length + SHA256_LEN > len(data) or dsc_length < 4 + struct.calcsize(FDSC_FMT):
+        raise ValueError('Dsc_length error')
+    end = header_length + dsc_length
+    if hashlib.sha256(data[:end]).digest() != data[end:end + SHA256_LEN]:
+        raise ValueError('SHA256 error')
+    if (header_length + 4) % 4:
+        raise ValueError('the font tables are not 4-byte aligned')
+
+    base = header_length + 4
+    bitmap, gindex, gdsc, cmaps, kern, _, _ = struct.unpack_from(FDSC_FMT, data, base)
+    for ofs, tag in ((cmaps, b'CMAP'), (kern, b'KERN'), (gindex, b'GIDX'), (gdsc, b'GDSC'), (bitmap, b'GBIT')):
+        # same bounds as check_table() in d2_font.c
+        if ofs < 4 or ofs > dsc_length - 4 or data[base + ofs - 4:base + ofs] != tag:
+            raise ValueError('{} error'.format(tag.decode()))
+
+
+def write_source(path: str, name: str, bin_name: str, data: bytes) -> None:
+    lines = [
+        '/*',
+        ' * Generated by d2_font_embed.py from {}, do not edit.'.format(bin_name),
+        ' * SHA-256: {}'.format(data[-SHA256_LEN:].hex()),
+        ' */',
+        '#include "d2_font_embedded.h"',
+        '',
+        'static const uint8_t s_bin[{}] __attribute__((aligned(4))) = {{'.format(len(data)),
+    ]
+    for i in range(0, len(data), PER_LINE):
+        lines.append('    ' + ' '.join('0x{:02x},'.format(b) for b in data[i:i + PER_LINE]))
+    lines += [
+        '};',
+        '',
+        'const d2_font_embedded_t d2_font_embedded_{} = {{'.format(name),
+        '    .magic = D2_FONT_EMBEDDED_MAGIC,',
+        '    .flags = D2_FONT_EMBEDDED_FLAG_VERIFIED,',
+        '    .bin = s_bin,',
+        '    .size = sizeof(s_bin),',
+        '};',
+    ]
+    with open(path, 'w', encoding='utf-8') as f:
+        f.write('\n'.join(lines) + '\n')
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description='Check a d2_font bin and embed it in a C source')
+    parser.add_argument('bin', help='d2_font bin')
+    parser.add_argument('output', help='C source to write')
+    parser.add_argument('--name', required=True, help='the descriptor is d2_font_embedded_<name>')
+    args = parser.parse_args()
+
+    if not IDENT_RE.match(args.name):
+        print('error: {!r} is not a C identifier'.format(args.name), file=sys.stderr)
+        return 1
+    with open(args.bin, 'rb') as f:
+        data = f.read()
+    try:
+        check(data)
+    except ValueError as e:
+        print('error: {}: {}'.format(args.bin, e), file=sys.stderr)
+        return 1
+    write_source(args.output, args.name, args.bin.replace('\\', '/').split('/')[-1], data)
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
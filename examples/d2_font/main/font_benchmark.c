@@ -0,0 +1,142 @@
+/*
+ * SPDX-FileCopyrightText: 2026 udoudou
+ *
+ * SPDX-License-Identifier: CC0-1.0
+ */
+
+#include <inttypes.h>
+#include <string.h>
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "esp_partition.h"
+#include "esp_log.h"
+#include "lvgl.h"
+#include "d2_font.h"
+#include "d2_font_render.h"
+
+static const char *TAG = "benchmark";
+
+#define BENCHMARK_LOAD_ROUNDS    10
+#define BENCHMARK_LOOKUP_ROUNDS  100
+#define BENCHMARK_RENDER_ROUNDS  20
+#define BENCHMARK_RENDER_WIDTH   1024
+
+static const char *s_text = "逗逗测试¥abc123 The quick brown fox jumps over the lazy dog. 永和九年，岁在癸丑，暮春之初，会于会稽山阴之兰亭。";
+
+static const char *s_mem_names[D2_FONT_MEM_TYPE_MAX] = {
+    [D2_FONT_MEM_CONTEXT] = "context",
+    [D2_FONT_MEM_CACHE] = "cache",
+    [D2_FONT_MEM_INDEX] = "index",
+    [D2_FONT_MEM_SCRATCH] = "scratch",
+};
+
+/* Time `d2_font_render_utf8` of the test text into an A8 and a 1 bpp buffer, and `d2_font_render_utf8_rgb565` */
+static void benchmark_render(lv_font_t *font, uint32_t letter_num)
+{
+    uint32_t height = font->line_height;
+    uint8_t *buf = heap_caps_malloc(BENCHMARK_RENDER_WIDTH * height * sizeof(uint16_t), MALLOC_CAP_8BIT);
+    if (buf == NULL) {
+        ESP_LOGE(TAG, "No mem for render buffer");
+        return;
+    }
+    lv_area_t clip = { .x1 = 0, .y1 = 0, .x2 = BENCHMARK_RENDER_WIDTH - 1, .y2 = height - 1 };
+    const struct {
+        d2_font_render_format_t fmt;
+        uint32_t stride;
+        const char *name;
+    } targets[] = {
+        { D2_FONT_RENDER_FORMAT_A8, BENCHMARK_RENDER_WIDTH, "A8" },
+        { D2_FONT_RENDER_FORMAT_I1, BENCHMARK_RENDER_WIDTH / 8, "I1" },
+    };
+    for (int t = 0; t < sizeof(targets) / sizeof(targets[0]); t++) {
+        int64_t start = esp_timer_get_time();
+        for (int i = 0; i < BENCHMARK_RENDER_ROUNDS; i++) {
+            memset(buf, 0, targets[t].stride * height);
+            if (d2_font_render_utf8(font, s_text, 0, 0, buf, targets[t].stride, targets[t].fmt, &clip) != ESP_OK) {
+                ESP_LOGE(TAG, "Failed to render");
+                break;
+            }
+        }
+        int64_t render_us = (esp_timer_get_time() - start) / BENCHMARK_RENDER_ROUNDS;
+        ESP_LOGI(TAG, "render %s: %" PRId64 " us per text, %" PRId64 " ns per glyph", targets[t].name, render_us,
+                 render_us * 1000 / letter_num);
+    }
+
+    /*The first round fills the tile cache if it is enabled*/
+    int64_t cold_us = 0;
+    int64_t start = esp_timer_get_time();
+    for (int i = 0; i < BENCHMARK_RENDER_ROUNDS; i++) {
+        memset(buf, 0, BENCHMARK_RENDER_WIDTH * height * sizeof(uint16_t));
+        d2_font_render_utf8_rgb565(font, s_text, 0, 0, buf, BENCHMARK_RENDER_WIDTH * sizeof(uint16_t), 0xFFFF, 0x0000, &clip);
+        if (i == 0) {
+            cold_us = esp_timer_get_time() - start;
+            start = esp_timer_get_time();
+        }
+    }
+    int64_t warm_us = (esp_timer_get_time() - start) / (BENCHMARK_RENDER_ROUNDS - 1);
+    ESP_LOGI(TAG, "render RGB565: first %" PRId64 " us, then %" PRId64 " us per text", cold_us, warm_us);
+    d2_font_tile_cache_clear(font);
+    heap_caps_free(buf);
+}
+
+/* Report load time, memory and glyph lookup time of a d2_font bin */
+void example_font_benchmark(const void *bin, size_t size)
+{
+    lv_font_t *font = NULL;
+    size_t free_before = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    int64_t start = esp_timer_get_time();
+    for (int i = 0; i < BENCHMARK_LOAD_ROUNDS; i++) {
+        if (font) {
+            d2_font_unload(font);
+        }
+        if (d2_font_load_from_mem(bin, size, &font) != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to load font");
+            return;
+        }
+    }
+    int64_t load_us = (esp_timer_get_time() - start) / BENCHMARK_LOAD_ROUNDS;
+    size_t heap_used = free_before - heap_caps_get_free_size(MALLOC_CAP_8BIT);
+
+    uint32_t letter_num = 0;
+    lv_font_glyph_dsc_t dsc;
+    start = esp_timer_get_time();
+    for (int i = 0; i < BENCHMARK_LOOKUP_ROUNDS; i++) {
+        uint32_t pos = 0;
+        uint32_t letter = lv_text_encoded_next(s_text, &pos);
+        while (letter) {
+            uint32_t letter_next = lv_text_encoded_next(s_text, &pos);
+            lv_font_get_glyph_dsc(font, &dsc, letter, letter_next);
+            letter = letter_next;
+            letter_num++;
+        }
+    }
+    int64_t lookup_us = esp_timer_get_time() - start;
+
+    ESP_LOGI(TAG, "bin: %u bytes, load: %" PRId64 " us, heap: %u bytes", (unsigned)size, load_us, (unsigned)heap_used);
+    d2_font_memory_usage_t usage;
+    d2_font_get_memory_usage(font, &usage);
+    for (int i = 0; i < D2_FONT_MEM_TYPE_MAX; i++) {
+        ESP_LOGI(TAG, "%-8s %6u bytes, peak %6u bytes", s_mem_names[i], (unsigned)usage.used[i], (unsigned)usage.peak[i]);
+    }
+    ESP_LOGI(TAG, "lookup: %" PRIu32 " glyphs, %" PRId64 " ns per glyph", letter_num, lookup_us * 1000 / letter_num);
+    benchmark_render(font, letter_num / BENCHMARK_LOOKUP_ROUNDS);
+    d2_font_unload(font);
+}
+
+/* Same as `example_font_benchmark`, for a bin in a partition */
+void example_font_benchmark_partition(const char *label)
+{
+    const esp_partition_t *partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, label);
+    if (partition == NULL) {
+        ESP_LOGE(TAG, "Partition not found");
+        return;
+    }
+    const void *map_ptr;
+    esp_partition_mmap_handle_t map_handle;
+    if (esp_partition_mmap(partition, 0, partition->size, ESP_PARTITION_MMAP_DATA, &map_ptr, &map_handle) != ESP_OK) {
+        ESP_LOGE(TAG, "Partition mmap failed");
+        return;
+    }
+    example_font_benchmark(map_ptr, partition->size);
+    esp_partition_munmap(map_handle);
+}
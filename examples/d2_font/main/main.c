@@ -19,7 +19,7 @@
 #include "esp_err.h"
 #include "esp_log.h"
 #include "lvgl.h"
-#if CONFIG_EXAMPLE_FONT_IN_PARTITION || CONFIG_EXAMPLE_FONT_IN_MMAP_ASSETS
+#if CONFIG_EXAMPLE_FONT_IN_PARTITION || CONFIG_EXAMPLE_FONT_IN_MMAP_ASSETS || CONFIG_EXAMPLE_FONT_EMBEDDED
 #include "d2_font.h"
 #endif
 #if CONFIG_EXAMPLE_FONT_IN_MMAP_ASSETS
@@ -66,9 +66,15 @@ static _lock_t lvgl_api_lock;
 #if CONFIG_EXAMPLE_FONT_IN_FW
 LV_FONT_DECLARE(d2_font_demo_14);
 LV_FONT_DECLARE(lvgl_font_demo_14);
+#elif CONFIG_EXAMPLE_FONT_EMBEDDED
+D2_FONT_EMBEDDED_DECLARE(d2_font_demo_14);
 #endif
 
 extern void example_lvgl_demo_ui(lv_disp_t *disp);
+#if CONFIG_EXAMPLE_FONT_BENCHMARK
+extern void example_font_benchmark(const void *bin, size_t size);
+extern void example_font_benchmark_partition(const char *label);
+#endif
 
 typedef struct {
     uint8_t cmd;
@@ -304,6 +310,9 @@ void app_main(void)
         lv_style_set_text_font(&style_font, &d2_font_demo_14);
         // lv_style_set_text_font(&style_font, &lvgl_font_demo_14);
 #elif CONFIG_EXAMPLE_FONT_IN_PARTITION
+#if CONFIG_EXAMPLE_FONT_BENCHMARK
+        example_font_benchmark_partition("font");
+#endif
         lv_font_t *font;
         d2_font_load_from_partition("font", &font);
         if (font) {
@@ -327,6 +336,9 @@ void app_main(void)
         ESP_ERROR_CHECK(mmap_assets_new(&config, &asset_handle));
         const void *mem = mmap_assets_get_mem(asset_handle, MMAP_FONTS_D2_FONT_DEMO_14_BIN);
         int size = mmap_assets_get_size(asset_handle, MMAP_FONTS_D2_FONT_DEMO_14_BIN);
+#if CONFIG_EXAMPLE_FONT_BENCHMARK
+        example_font_benchmark(mem, size);
+#endif
         lv_font_t *font;
         d2_font_load_from_mem(mem, size, &font);
         if (font) {
@@ -335,6 +347,15 @@ void app_main(void)
         } else {
             ESP_LOGE(TAG, "Failed to load font from mmap_assets");
         }
+#elif CONFIG_EXAMPLE_FONT_EMBEDDED
+        lv_font_t *font;
+        d2_font_load_embedded(&d2_font_embedded_d2_font_demo_14, NULL, &font);
+        if (font) {
+            ESP_LOGI(TAG, "Load embedded font successfully");
+            lv_style_set_text_font(&style_font, font);
+        } else {
+            ESP_LOGE(TAG, "Failed to load embedded font");
+        }
 #endif
         lv_obj_t *scr = lv_display_get_screen_active(display);
         lv_obj_t * label = lv_label_create(scr);
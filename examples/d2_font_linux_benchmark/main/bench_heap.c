@@ -0,0 +1,102 @@
+/*
+ * SPDX-FileCopyrightText: 2026 udoudou
+ *
+ * SPDX-License-Identifier: CC0-1.0
+ */
+
+/*
+ * Heap accounting of the whole process, the linker sends the allocation functions here (see main/CMakeLists.txt).
+ * Sizes are the usable sizes of glibc, so the counts include its rounding.
+ */
+
+#include <malloc.h>
+#include <stdatomic.h>
+#include <stddef.h>
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t num, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void __real_free(void *ptr);
+int __real_posix_memalign(void **ptr, size_t alignment, size_t size);
+void *__real_aligned_alloc(size_t alignment, size_t size);
+
+static atomic_size_t s_used;
+static atomic_size_t s_peak;
+
+static void *heap_add(void *ptr)
+{
+    if (ptr) {
+        size_t size = malloc_usable_size(ptr);
+        size_t used = atomic_fetch_add(&s_used, size) + size;
+        size_t peak = atomic_load(&s_peak);
+        while (used > peak && !atomic_compare_exchange_weak(&s_peak, &peak, used)) {
+        }
+    }
+    return ptr;
+}
+
+static void heap_sub(void *ptr)
+{
+    if (ptr) {
+        atomic_fetch_sub(&s_used, malloc_usable_size(ptr));
+    }
+}
+
+void *__wrap_malloc(size_t size)
+{
+    return heap_add(__real_malloc(size));
+}
+
+void *__wrap_calloc(size_t num, size_t size)
+{
+    return heap_add(__real_calloc(num, size));
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+    heap_sub(ptr);
+    void *new_ptr = __real_realloc(ptr, size);
+    if (new_ptr == NULL && size) {
+        /*The old block is still there*/
+        heap_add(ptr);
+        return NULL;
+    }
+    return heap_add(new_ptr);
+}
+
+void __wrap_free(void *ptr)
+{
+    heap_sub(ptr);
+    __real_free(ptr);
+}
+
+int __wrap_posix_memalign(void **ptr, size_t alignment, size_t size)
+{
+    int ret = __real_posix_memalign(ptr, alignment, size);
+    if (ret == 0) {
+        heap_add(*ptr);
+    }
+    return ret;
+}
+
+void *__wrap_aligned_alloc(size_t alignment, size_t size)
+{
+    return heap_add(__real_aligned_alloc(alignment, size));
+}
+
+/* Bytes allocated now */
+size_t bench_heap_used(void)
+{
+    return atomic_load(&s_used);
+}
+
+/* Most bytes allocated at a time since the last `bench_heap_peak_reset` */
+size_t bench_heap_peak(void)
+{
+    return atomic_load(&s_peak);
+}
+
+void bench_heap_peak_reset(void)
+{
+    atomic_store(&s_peak, atomic_load(&s_used));
+}
@@ -0,0 +1,131 @@
+/*
+ * SPDX-FileCopyrightText: 2026 udoudou
+ *
+ * SPDX-License-Identifier: CC0-1.0
+ */
+
+#include <stdint.h>
+#include "lvgl.h"
+
+#define DASHBOARD_COLS      6
+#define DASHBOARD_ROWS      8
+#define LIST_ROWS           60
+#define LIST_SCROLL_STEP    8
+
+static const char *s_pages[] = {
+    "永和九年，岁在癸丑，暮春之初，会于会稽山阴之兰亭，修禊事也。群贤毕至，少长咸集。此地有崇山峻岭，茂林修竹，"
+    "又有清流激湍，映带左右，引以为流觞曲水，列坐其次。虽无丝竹管弦之盛，一觞一咏，亦足以畅叙幽情。"
+    "是日也，天朗气清，惠风和畅。仰观宇宙之大，俯察品类之盛，所以游目骋怀，足以极视听之娱，信可乐也。\n"
+    "夫人之相与，俯仰一世。或取诸怀抱，悟言一室之内；或因寄所托，放浪形骸之外。虽趣舍万殊，静躁不同，"
+    "当其欣于所遇，暂得于己，快然自足，不知老之将至；及其所之既倦，情随事迁，感慨系之矣。"
+    "向之所欣，俯仰之间，已为陈迹，犹不能不以之兴怀，况修短随化，终期于尽！古人云：“死生亦大矣。”岂不痛哉！",
+    "每览昔人兴感之由，若合一契，未尝不临文嗟悼，不能喻之于怀。固知一死生为虚诞，齐彭殇为妄作。"
+    "后之视今，亦犹今之视昔，悲夫！故列叙时人，录其所述，虽世殊事异，所以兴怀，其致一也。后之览者，亦将有感于斯文。\n"
+    "庆历四年春，滕子京谪守巴陵郡。越明年，政通人和，百废具兴。乃重修岳阳楼，增其旧制，刻唐贤今人诗赋于其上，"
+    "属予作文以记之。予观夫巴陵胜状，在洞庭一湖。衔远山，吞长江，浩浩汤汤，横无际涯；朝晖夕阴，气象万千。"
+    "此则岳阳楼之大观也，前人之述备矣。然则北通巫峡，南极潇湘，迁客骚人，多会于此，览物之情，得无异乎？",
+};
+
+static const char *s_gauges[] = {
+    "温度", "湿度", "气压", "电压", "电流", "功率", "转速", "流量",
+};
+
+static const char *s_units[] = {
+    "°C", "%", "kPa", "V", "A", "kW", "rpm", "m³/h",
+};
+
+static const char *s_list_items[] = {
+    "设置", "Wi-Fi 网络", "蓝牙设备", "显示与亮度", "声音", "通知中心", "电池 87%", "存储空间 12.4 GB / 32 GB",
+    "系统更新 v2.3.1", "关于本机", "Language 语言", "Date & Time 日期与时间",
+};
+
+typedef struct {
+    lv_obj_t *labels[DASHBOARD_COLS * DASHBOARD_ROWS];
+    uint32_t seed;
+} dashboard_t;
+
+static dashboard_t s_dashboard;
+static lv_obj_t *s_page_label;
+static uint32_t s_page;
+static lv_obj_t *s_list;
+
+static lv_obj_t *screen_create(const lv_font_t *font)
+{
+    lv_obj_t *scr = lv_obj_create(NULL);
+    lv_obj_set_style_text_font(scr, font, 0);
+    lv_obj_set_style_bg_color(scr, lv_color_white(), 0);
+    lv_obj_set_style_text_color(scr, lv_color_black(), 0);
+    return scr;
+}
+
+/* A full page of CJK paragraphs, the text changes every frame */
+lv_obj_t *bench_screen_page_create(const lv_font_t *font)
+{
+    lv_obj_t *scr = screen_create(font);
+    lv_obj_set_style_pad_all(scr, 8, 0);
+    s_page_label = lv_label_create(scr);
+    lv_obj_set_width(s_page_label, lv_pct(100));
+    lv_label_set_long_mode(s_page_label, LV_LABEL_LONG_WRAP);
+    lv_obj_set_style_text_line_space(s_page_label, 4, 0);
+    s_page = 0;
+    lv_label_set_text_static(s_page_label, s_pages[0]);
+    return scr;
+}
+
+void bench_screen_page_update(void)
+{
+    s_page = (s_page + 1) % (sizeof(s_pages) / sizeof(s_pages[0]));
+    lv_label_set_text_static(s_page_label, s_pages[s_page]);
+}
+
+/* A grid of gauges with numbers changing every frame */
+lv_obj_t *bench_screen_dashboard_create(const lv_font_t *font)
+{
+    lv_obj_t *scr = screen_create(font);
+    lv_obj_set_style_pad_all(scr, 4, 0);
+    lv_obj_set_flex_flow(scr, LV_FLEX_FLOW_ROW_WRAP);
+    for (int i = 0; i < DASHBOARD_COLS * DASHBOARD_ROWS; i++) {
+        lv_obj_t *label = lv_label_create(scr);
+        lv_obj_set_size(label, lv_pct(100 / DASHBOARD_COLS - 1), lv_pct(100 / DASHBOARD_ROWS - 1));
+        s_dashboard.labels[i] = label;
+    }
+    s_dashboard.seed = 1;
+    return scr;
+}
+
+void bench_screen_dashboard_update(void)
+{
+    for (int i = 0; i < DASHBOARD_COLS * DASHBOARD_ROWS; i++) {
+        /*Same values for every font*/
+        s_dashboard.seed = s_dashboard.seed * 1103515245 + 12345;
+        uint32_t value = (s_dashboard.seed >> 8) % 100000;
+        int kind = i % (sizeof(s_gauges) / sizeof(s_gauges[0]));
+        lv_label_set_text_fmt(s_dashboard.labels[i], "%s %02d\n%" LV_PRIu32 ".%02" LV_PRIu32 " %s", s_gauges[kind], i,
+                              value / 100, value % 100, s_units[kind]);
+    }
+}
+
+/* A list of settings scrolled by a few pixels every frame */
+lv_obj_t *bench_screen_list_create(const lv_font_t *font)
+{
+    lv_obj_t *scr = screen_create(font);
+    s_list = lv_obj_create(scr);
+    lv_obj_set_size(s_list, lv_pct(100), lv_pct(100));
+    lv_obj_set_flex_flow(s_list, LV_FLEX_FLOW_COLUMN);
+    lv_obj_set_scrollbar_mode(s_list, LV_SCROLLBAR_MODE_OFF);
+    for (int i = 0; i < LIST_ROWS; i++) {
+        lv_obj_t *label = lv_label_create(s_list);
+        lv_obj_set_width(label, lv_pct(100));
+        lv_label_set_text_fmt(label, "%02d  %s", i + 1, s_list_items[i % (sizeof(s_list_items) / sizeof(s_list_items[0]))]);
+    }
+    return scr;
+}
+
+void bench_screen_list_update(void)
+{
+    if (lv_obj_get_scroll_bottom(s_list) <= 0) {
+        lv_obj_scroll_to_y(s_list, 0, LV_ANIM_OFF);
+    } else {
+        lv_obj_scroll_by(s_list, 0, -LIST_SCROLL_STEP, LV_ANIM_OFF);
+    }
+}
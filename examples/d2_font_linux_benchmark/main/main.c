@@ -0,0 +1,268 @@
+/*
+ * SPDX-FileCopyrightText: 2026 udoudou
+ *
+ * SPDX-License-Identifier: CC0-1.0
+ */
+
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "lvgl.h"
+
+#include "d2_font.h"
+
+static const char *TAG = "benchmark";
+
+#define BENCHMARK_HOR_RES   CONFIG_BENCHMARK_HOR_RES
+#define BENCHMARK_VER_RES   CONFIG_BENCHMARK_VER_RES
+#define BENCHMARK_FRAMES    CONFIG_BENCHMARK_FRAMES
+
+extern size_t bench_heap_used(void);
+extern size_t bench_heap_peak(void);
+extern void bench_heap_peak_reset(void);
+
+extern lv_obj_t *bench_screen_page_create(const lv_font_t *font);
+extern void bench_screen_page_update(void);
+extern lv_obj_t *bench_screen_dashboard_create(const lv_font_t *font);
+extern void bench_screen_dashboard_update(void);
+extern lv_obj_t *bench_screen_list_create(const lv_font_t *font);
+extern void bench_screen_list_update(void);
+
+typedef enum {
+    FONT_KIND_D2,
+    FONT_KIND_LV,
+} font_kind_t;
+
+typedef struct {
+    const char *name;
+    const char *path;
+    font_kind_t kind;
+} font_src_t;
+
+typedef struct {
+    const char *name;
+    lv_obj_t *(*create)(const lv_font_t *font);
+    void (*update)(void);
+} screen_src_t;
+
+/* Draws with `base` and counts the glyphs drawn */
+typedef struct {
+    lv_font_t font;
+    const lv_font_t *base;
+    uint32_t glyphs;
+} bench_font_t;
+
+static const font_src_t s_fonts[] = {
+    { "d2_font plain", CONFIG_BENCHMARK_D2_FONT_PLAIN, FONT_KIND_D2 },
+    { "d2_font plain 3 bpp", CONFIG_BENCHMARK_D2_FONT_PLAIN_3BPP, FONT_KIND_D2 },
+    { "d2_font compressed", CONFIG_BENCHMARK_D2_FONT_COMPRESSED, FONT_KIND_D2 },
+    { "lv_font_fmt_txt plain", CONFIG_BENCHMARK_LV_FONT_PLAIN, FONT_KIND_LV },
+    { "lv_font_fmt_txt compressed", CONFIG_BENCHMARK_LV_FONT_COMPRESSED, FONT_KIND_LV },
+};
+
+static const screen_src_t s_screens[] = {
+    { "CJK page", bench_screen_page_create, bench_screen_page_update },
+    { "dashboard", bench_screen_dashboard_create, bench_screen_dashboard_update },
+    { "scrolling list", bench_screen_list_create, bench_screen_list_update },
+};
+
+static const char *s_mem_names[D2_FONT_MEM_TYPE_MAX] = {
+    [D2_FONT_MEM_CONTEXT] = "context",
+    [D2_FONT_MEM_CACHE] = "cache",
+    [D2_FONT_MEM_INDEX] = "index",
+    [D2_FONT_MEM_SCRATCH] = "scratch",
+};
+
+static bool bench_font_get_glyph_dsc(const lv_font_t *font, lv_font_glyph_dsc_t *dsc, uint32_t letter, uint32_t letter_next)
+{
+    const bench_font_t *bench = (const bench_font_t *)font;
+    return bench->base->get_glyph_dsc(bench->base, dsc, letter, letter_next);
+}
+
+static const void *bench_font_get_glyph_bitmap(lv_font_glyph_dsc_t *dsc, lv_draw_buf_t *draw_buf)
+{
+    bench_font_t *bench = (bench_font_t *)dsc->resolved_font;
+    bench->glyphs++;
+    /*The base font finds its data and releases the glyph from `resolved_font`*/
+    dsc->resolved_font = bench->base;
+    return bench->base->get_glyph_bitmap(dsc, draw_buf);
+}
+
+static void bench_font_init(bench_font_t *bench, const lv_font_t *base)
+{
+    bench->font = *base;
+    bench->font.get_glyph_dsc = bench_font_get_glyph_dsc;
+    bench->font.get_glyph_bitmap = bench_font_get_glyph_bitmap;
+    bench->base = base;
+    bench->glyphs = 0;
+}
+
+static uint32_t bench_tick_get(void)
+{
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+static void bench_flush_cb(lv_display_t *disp, const lv_area_t *area, uint8_t *px_map)
+{
+    lv_display_flush_ready(disp);
+}
+
+/* The file stands for the flash of a device: mapped, not read into the heap */
+static const uint8_t *bench_file_map(const char *path, size_t *size)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        ESP_LOGE(TAG, "Failed to open %s", path);
+        return NULL;
+    }
+    struct stat st;
+    void *ptr = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        ptr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+    if (ptr == MAP_FAILED) {
+        ESP_LOGE(TAG, "Failed to map %s", path);
+        return NULL;
+    }
+    *size = st.st_size;
+    return ptr;
+}
+
+static void bench_screen(lv_display_t *disp, bench_font_t *bench, const screen_src_t *screen)
+{
+    lv_obj_t *old_scr = lv_screen_active();
+    lv_obj_t *scr = screen->create(&bench->font);
+    lv_screen_load(scr);
+    lv_obj_delete(old_scr);
+
+    size_t heap_base = bench_heap_used();
+    bench_heap_peak_reset();
+    bench->glyphs = 0;
+    uint32_t first_glyphs = 0;
+    int64_t first_us = 0;
+    int64_t max_us = 0;
+    int64_t total_us = 0;
+    for (int i = 0; i < BENCHMARK_FRAMES; i++) {
+        int64_t start = esp_timer_get_time();
+        if (i) {
+            screen->update();
+        }
+        lv_obj_invalidate(scr);
+        lv_refr_now(disp);
+        int64_t frame_us = esp_timer_get_time() - start;
+        if (i == 0) {
+            first_us = frame_us;
+            first_glyphs = bench->glyphs;
+            continue;
+        }
+        total_us += frame_us;
+        if (frame_us > max_us) {
+            max_us = frame_us;
+        }
+    }
+    /*The first frame lays the screen out, the others only redraw or update it*/
+    int64_t avg_us = total_us / (BENCHMARK_FRAMES - 1);
+    uint64_t glyphs = bench->glyphs - first_glyphs;
+    ESP_LOGI(TAG, "  %-14s first %7" PRId64 " us, avg %7" PRId64 " us, max %7" PRId64 " us, "
+             "%5" PRIu64 " glyphs/frame, %8" PRIu64 " glyphs/s, frame peak +%u bytes",
+             screen->name, first_us, avg_us, max_us, glyphs / (BENCHMARK_FRAMES - 1),
+             total_us ? glyphs * 1000000 / (uint64_t)total_us : 0,
+             (unsigned)(bench_heap_peak() - heap_base));
+}
+
+static void bench_font(lv_display_t *disp, const font_src_t *src)
+{
+    if (src->path[0] == '\0') {
+        ESP_LOGI(TAG, "%s: skipped, no bin configured", src->name);
+        return;
+    }
+    lv_font_t *font = NULL;
+    const uint8_t *bin = NULL;
+    size_t size = 0;
+    size_t heap_before = bench_heap_used();
+    int64_t start = esp_timer_get_time();
+    if (src->kind == FONT_KIND_D2) {
+        bin = bench_file_map(src->path, &size);
+        if (bin == NULL) {
+            return;
+        }
+        start = esp_timer_get_time();
+        if (d2_font_load_from_mem(bin, size, &font) != ESP_OK) {
+            ESP_LOGE(TAG, "%s: failed to load %s", src->name, src->path);
+            munmap((void *)bin, size);
+            return;
+        }
+    } else {
+        char lv_path[256];
+        snprintf(lv_path, sizeof(lv_path), "A:%s", src->path);
+        font = lv_binfont_create(lv_path);
+        if (font == NULL) {
+            ESP_LOGE(TAG, "%s: failed to load %s", src->name, src->path);
+            return;
+        }
+    }
+    int64_t load_us = esp_timer_get_time() - start;
+    size_t load_heap = bench_heap_used() - heap_before;
+    ESP_LOGI(TAG, "%s: %s, load %" PRId64 " us, heap %u bytes%s", src->name, src->path, load_us, (unsigned)load_heap,
+             src->kind == FONT_KIND_D2 ? " (bin mapped)" : " (bin read into the heap)");
+
+    bench_font_t bench;
+    bench_font_init(&bench, font);
+    for (int i = 0; i < sizeof(s_screens) / sizeof(s_screens[0]); i++) {
+        bench_screen(disp, &bench, &s_screens[i]);
+    }
+    /*Nothing may draw with the font once it is unloaded*/
+    lv_obj_t *old_scr = lv_screen_active();
+    lv_screen_load(lv_obj_create(NULL));
+    lv_obj_delete(old_scr);
+
+    if (src->kind == FONT_KIND_D2) {
+        d2_font_memory_usage_t usage;
+        d2_font_get_memory_usage(font, &usage);
+        for (int i = 0; i < D2_FONT_MEM_TYPE_MAX; i++) {
+            ESP_LOGI(TAG, "  %-8s %7u bytes, peak %7u bytes", s_mem_names[i], (unsigned)usage.used[i],
+                     (unsigned)usage.peak[i]);
+        }
+        d2_font_unload(font);
+        munmap((void *)bin, size);
+    } else {
+        lv_binfont_destroy(font);
+    }
+    size_t heap_after = bench_heap_used();
+    if (heap_after > heap_before) {
+        ESP_LOGW(TAG, "  %u bytes not freed after unload", (unsigned)(heap_after - heap_before));
+    }
+}
+
+void app_main(void)
+{
+    lv_init();
+    lv_tick_set_cb(bench_tick_get);
+
+    lv_display_t *disp = lv_display_create(BENCHMARK_HOR_RES, BENCHMARK_VER_RES);
+    size_t buf_size = BENCHMARK_HOR_RES * BENCHMARK_VER_RES * sizeof(lv_color16_t);
+    void *buf = malloc(buf_size);
+    if (disp == NULL || buf == NULL) {
+        ESP_LOGE(TAG, "No mem for the display");
+        abort();
+    }
+    lv_display_set_color_format(disp, LV_COLOR_FORMAT_RGB565);
+    lv_display_set_buffers(disp, buf, NULL, buf_size, LV_DISPLAY_RENDER_MODE_FULL);
+    lv_display_set_flush_cb(disp, bench_flush_cb);
+
+    ESP_LOGI(TAG, "%dx%d RGB565, %d frames per screen, heap %u bytes", BENCHMARK_HOR_RES, BENCHMARK_VER_RES,
+             BENCHMARK_FRAMES, (unsigned)bench_heap_used());
+    for (int i = 0; i < sizeof(s_fonts) / sizeof(s_fonts[0]); i++) {
+        bench_font(disp, &s_fonts[i]);
+    }
+    ESP_LOGI(TAG, "Done");
+    exit(0);
+}
@@ -0,0 +1,739 @@
+# SPDX-FileCopyrightText: 2026 udoudou
+# SPDX-License-Identifier: Apache-2.0
+"""
+Reader and writer of d2_font bin files.
+
+The layout mirrors `components/d2_font/include/d2_font_fmt_txt.h`:
+
+    u16 header_length | 'D2FtHd' | d2_font_header_bin_t
+    u32 dsc_length    | d2_font_fmt_txt_dsc_t | 'CMAP' cmaps + lists | 'KERN' ... | 'GIDX' ... | 'GDSC' ... | 'GBIT' ...
+    sha256 of everything above
+
+All pointers in `d2_font_fmt_txt_dsc_t` and `d2_font_fmt_txt_cmap_t` are offsets from the start of
+`d2_font_fmt_txt_dsc_t`.
+
+Fonts that outgrow the 21-bit bitmap offsets or 11-bit descriptor indices of the glyph index are written with
+the wide index (`HEADER_FLAG_WIDE_INDEX`): 8 bytes per glyph, bitmap offsets from the start of GBIT.
+
+With `HEADER_FLAG_CMAP_COMPRESSED` the CMAP section holds the cmaps and their lists as varints
+(`d2_font_fmt_txt_cmap_packed_t`), unpacked to RAM by `d2_font_load_from_mem`.
+"""
+import hashlib
+import struct
+from dataclasses import dataclass
+from dataclasses import field
+from typing import Dict
+from typing import Iterator
+from typing import List
+from typing import Optional
+from typing import Tuple
+
+HEADER_MAGIC = b'D2FtHd'
+HEADER_FMT = '<IiiBbbB'
+FDSC_FMT = '<IIIIIHH'
+CMAP_FMT = '<IHHIIIH'
+GDSC_FMT = '<HBBbb'
+KERN_FMT = '<II'
+SHA256_LEN = 32
+
+CMAP_FORMAT0_FULL = 0
+CMAP_SPARSE_FULL = 1
+CMAP_FORMAT0_TINY = 2
+CMAP_SPARSE_TINY = 3
+CMAP_TYPE_NAMES = {
+    CMAP_FORMAT0_FULL: 'FORMAT0_FULL',
+    CMAP_SPARSE_FULL: 'SPARSE_FULL',
+    CMAP_FORMAT0_TINY: 'FORMAT0_TINY',
+    CMAP_SPARSE_TINY: 'SPARSE_TINY',
+}
+
+BITMAP_PLAIN = 0
+BITMAP_COMPRESSED = 1
+BITMAP_COMPRESSED_NO_PREFILTER = 2
+
+GLYPH_INDEX_OFFSET_BITS = 21
+GLYPH_INDEX_DSC_BITS = 11
+GLYPH_INDEX_WIDE_FMT = '<II'
+CMAP_BITMAP_BASE_BITS = 30
+CMAP_NUM_MAX = (1 << 9) - 1
+
+HEADER_FLAG_WIDE_INDEX = 0x01
+HEADER_FLAG_CMAP_COMPRESSED = 0x02
+# Flags these tools and d2_font read, bins with other flags are refused
+HEADER_FLAGS_KNOWN = HEADER_FLAG_WIDE_INDEX | HEADER_FLAG_CMAP_COMPRESSED
+CMAP_PACKED_FMT = '<II'
+
+
+class D2FontError(Exception):
+    pass
+
+
+@dataclass
+class Header:
+    version: int
+    line_height: int
+    base_line: int
+    subpx: int
+    underline_position: int
+    underline_thickness: int
+    flags: int = 0          # HEADER_FLAG_xx
+    extra: bytes = b''      # bytes between d2_font_header_bin_t and the end of the header
+
+    @property
+    def wide_index(self) -> bool:
+        return bool(self.flags & HEADER_FLAG_WIDE_INDEX)
+
+    @property
+    def cmap_compressed(self) -> bool:
+        return bool(self.flags & HEADER_FLAG_CMAP_COMPRESSED)
+
+    def pack(self) -> bytes:
+        body = struct.pack(HEADER_FMT, self.version, self.line_height, self.base_line, self.subpx,
+                           self.underline_position, self.underline_thickness, self.flags) + self.extra
+        return struct.pack('<H', 2 + len(HEADER_MAGIC) + len(body)) + HEADER_MAGIC + body
+
+
+@dataclass
+class GlyphDsc:
+    adv_w: int
+    box_w: int
+    box_h: int
+    ofs_x: int
+    ofs_y: int
+
+    def key(self) -> Tuple[int, int, int, int, int]:
+        return (self.adv_w, self.box_w, self.box_h, self.ofs_x, self.ofs_y)
+
+
+@dataclass
+class Cmap:
+    range_start: int
+    range_length: int
+    glyph_id_start: int
+    glyph_bitmap_index_base: int
+    type: int
+    unicode_list: Optional[List[int]] = None
+    glyph_id_ofs_list: Optional[List[int]] = None
+    # where the tables are stored, offsets from d2_font_fmt_txt_dsc_t (0: none)
+    unicode_list_ofs: int = 0
+    glyph_id_ofs_list_ofs: int = 0
+
+    @property
+    def type_name(self) -> str:
+        return CMAP_TYPE_NAMES.get(self.type, str(self.type))
+
+    def items(self) -> Iterator[Tuple[int, int]]:
+        """ Yield (codepoint, glyph_id) the same way as `get_glyph_dsc_id` resolves them """
+        if self.type == CMAP_FORMAT0_TINY:
+            for rcp in range(self.range_length):
+                yield self.range_start + rcp, self.glyph_id_start + rcp
+        elif self.type == CMAP_FORMAT0_FULL:
+            assert self.glyph_id_ofs_list is not None
+            for rcp in range(self.range_length):
+                ofs = self.glyph_id_ofs_list[rcp]
+                if ofs == 0 and rcp != 0:
+                    continue
+                yield self.range_start + rcp, self.glyph_id_start + ofs
+        else:
+            assert self.unicode_list is not None
+            for i, rcp in enumerate(self.unicode_list):
+                ofs = i if self.type == CMAP_SPARSE_TINY else self.glyph_id_ofs_list[i]  # type: ignore
+                yield self.range_start + rcp, self.glyph_id_start + ofs
+
+
+@dataclass
+class KernPair:
+    left: int
+    right: int
+    value: int
+
+
+@dataclass
+class D2Font:
+    header: Header
+    kern_scale: int
+    bpp: int
+    kern_classes: int
+    bitmap_format: int
+    cmaps: List[Cmap]
+    kern_pairs: List[KernPair]
+    kern_glyph_ids_size: int
+    # per glyph id: (index into glyph_dsc, absolute bitmap offset in the GBIT section)
+    glyph_index: List[Tuple[int, int]]
+    glyph_dsc: List[GlyphDsc]
+    bitmap: bytes
+    # layout information of the parsed file
+    sections: Dict[str, Tuple[int, int]] = field(default_factory=dict)
+    file_size: int = 0
+
+    @property
+    def glyph_num(self) -> int:
+        return len(self.glyph_index)
+
+    def codepoint_map(self) -> Dict[int, int]:
+        """ codepoint -> glyph id; the first cmap holding a codepoint wins, as in `get_glyph_dsc_id` """
+        res: Dict[int, int] = {}
+        for cmap in self.cmaps:
+            for cp, gid in cmap.items():
+                res.setdefault(cp, gid)
+        return res
+
+    def cmap_of_glyph(self, gid: int) -> Optional[Cmap]:
+        for cmap in self.cmaps:
+            for _, cmap_gid in cmap.items():
+                if cmap_gid == gid:
+                    return cmap
+        return None
+
+    def glyph(self, gid: int) -> GlyphDsc:
+        return self.glyph_dsc[self.glyph_index[gid][0]]
+
+    def glyph_bitmap_size(self, gid: int) -> int:
+        """ Stored bitmap size of a glyph. Compressed glyphs end where the next stored bitmap starts """
+        dsc = self.glyph(gid)
+        if self.bitmap_format == BITMAP_PLAIN:
+            return (dsc.box_w * dsc.box_h * self.bpp + 7) // 8
+        if not hasattr(self, '_bitmap_ends'):
+            starts = sorted(set(ofs for _, ofs in self.glyph_index[1:])) + [len(self.bitmap)]
+            self._bitmap_ends = {starts[i]: starts[i + 1] for i in range(len(starts) - 1)}
+        start = self.glyph_index[gid][1]
+        if dsc.box_w * dsc.box_h == 0:
+            return 0
+        return self._bitmap_ends.get(start, start) - start
+
+    def glyph_bitmap(self, gid: int) -> bytes:
+        start = self.glyph_index[gid][1]
+        return self.bitmap[start:start + self.glyph_bitmap_size(gid)]
+
+    def kern_value(self, left: int, right: int) -> int:
+        for pair in self.kern_pairs:
+            if pair.left == left and pair.right == right:
+                return pair.value
+        return 0
+
+
+def _check_tag(data: bytes, pos: int, tag: bytes) -> None:
+    if pos < 4 or pos > len(data) or data[pos - 4:pos] != tag:
+        raise D2FontError('{} section not found'.format(tag.decode()))
+
+
+def parse_cmaps(data: bytes, pos: int, cmap_num: int, base: int) -> List[Cmap]:
+    """ Parse `cmap_num` `d2_font_fmt_txt_cmap_t` at `pos`, their list offsets are relative to `base` """
+    cmaps = []
+    cmap_size = struct.calcsize(CMAP_FMT)
+    for i in range(cmap_num):
+        start, length, gid_start, bits32, ulist, gofs, list_len = struct.unpack_from(CMAP_FMT, data, pos + i * cmap_size)
+        cmap = Cmap(start, length, gid_start, bits32 & ((1 << CMAP_BITMAP_BASE_BITS) - 1), bits32 >> CMAP_BITMAP_BASE_BITS,
+                    unicode_list_ofs=ulist, glyph_id_ofs_list_ofs=gofs)
+        if cmap.type in (CMAP_SPARSE_FULL, CMAP_SPARSE_TINY):
+            cmap.unicode_list = list(struct.unpack_from('<{}H'.format(list_len), data, base + ulist))
+        if cmap.type == CMAP_SPARSE_FULL:
+            cmap.glyph_id_ofs_list = list(struct.unpack_from('<{}H'.format(list_len), data, base + gofs))
+        elif cmap.type == CMAP_FORMAT0_FULL:
+            cmap.glyph_id_ofs_list = list(data[base + gofs:base + gofs + length])
+        cmaps.append(cmap)
+    return cmaps
+
+
+def _write_varint(out: bytearray, value: int) -> None:
+    while value >= 0x80:
+        out.append((value & 0x7F) | 0x80)
+        value >>= 7
+    out.append(value)
+
+
+def _zigzag(value: int) -> int:
+    return ((value << 1) ^ (value >> 31)) & 0xFFFFFFFF
+
+
+def pack_cmaps(cmaps: List[Cmap], wide_index: bool = False) -> bytes:
+    """ Serialize the cmaps and their lists as `d2_font_fmt_txt_cmap_packed_t` """
+    stream = bytearray()
+    unpacked_size = struct.calcsize(CMAP_FMT) * len(cmaps)
+    range_start = 0
+    for cmap in cmaps:
+        if cmap.type in (CMAP_SPARSE_FULL, CMAP_SPARSE_TINY):
+            assert cmap.unicode_list is not None
+            list_len = len(cmap.unicode_list)
+        elif cmap.type == CMAP_FORMAT0_FULL:
+            assert cmap.glyph_id_ofs_list is not None
+            list_len = len(cmap.glyph_id_ofs_list)
+        else:
+            list_len = 0
+        for value in (_zigzag(cmap.range_start - range_start), cmap.range_length, cmap.glyph_id_start,
+                      0 if wide_index else cmap.glyph_bitmap_index_base, cmap.type, list_len):
+            _write_varint(stream, value)
+        range_start = cmap.range_start
+
+        if cmap.type in (CMAP_SPARSE_FULL, CMAP_SPARSE_TINY):
+            assert cmap.unicode_list is not None
+            prev = None
+            for value in cmap.unicode_list:
+                if prev is not None and value <= prev:
+                    raise D2FontError('unicode_list of cmap 0x{:X} is not increasing'.format(cmap.range_start))
+                _write_varint(stream, value if prev is None else value - prev - 1)
+                prev = value
+            unpacked_size += unpacked_size % 2 + 2 * list_len
+        if cmap.type == CMAP_SPARSE_FULL:
+            assert cmap.glyph_id_ofs_list is not None
+            prev = 0
+            for value in cmap.glyph_id_ofs_list:
+                _write_varint(stream, _zigzag(value - prev))
+                prev = value
+            unpacked_size += unpacked_size % 2 + 2 * list_len
+        elif cmap.type == CMAP_FORMAT0_FULL:
+            assert cmap.glyph_id_ofs_list is not None
+            stream += bytes(cmap.glyph_id_ofs_list)
+            unpacked_size += list_len
+    return struct.pack(CMAP_PACKED_FMT, unpacked_size, len(stream)) + stream
+
+
+def unpack_cmaps(data: bytes, pos: int, cmap_num: int, end: int) -> bytes:
+    """ Unpack a `d2_font_fmt_txt_cmap_packed_t` at `pos` to the cmaps and lists `d2_font_load_from_mem` makes """
+    unpacked_size, packed_size = struct.unpack_from(CMAP_PACKED_FMT, data, pos)
+    pos += struct.calcsize(CMAP_PACKED_FMT)
+    stream_end = pos + packed_size
+    if stream_end > end:
+        raise D2FontError('CMAP error')
+
+    def read() -> int:
+        nonlocal pos
+        value = 0
+        shift = 0
+        while pos < stream_end and shift < 32:
+            byte = data[pos]
+            pos += 1
+            value |= (byte & 0x7F) << shift
+            if not byte & 0x80:
+                return value
+            shift += 7
+        raise D2FontError('CMAP error')
+
+    def read_delta() -> int:
+        value = read()
+        return (value >> 1) ^ -(value & 1)
+
+    cmap_size = struct.calcsize(CMAP_FMT)
+    out = bytearray(cmap_size * cmap_num)
+    range_start = 0
+    for i in range(cmap_num):
+        range_start = (range_start + read_delta()) & 0xFFFFFFFF
+        range_length, gid_start, bitmap_base, cmap_type, list_len = (read() for _ in range(5))
+        ulist = 0
+        gofs = 0
+        if cmap_type in (CMAP_SPARSE_FULL, CMAP_SPARSE_TINY):
+            _align(out, 2)
+            ulist = len(out)
+            value = 0
+            for j in range(list_len):
+                value += read() + (1 if j else 0)
+                out += struct.pack('<H', value & 0xFFFF)
+        if cmap_type == CMAP_SPARSE_FULL:
+            _align(out, 2)
+            gofs = len(out)
+            value = 0
+            for j in range(list_len):
+                value += read_delta()
+                out += struct.pack('<H', value & 0xFFFF)
+        elif cmap_type == CMAP_FORMAT0_FULL:
+            if pos + list_len > stream_end:
+                raise D2FontError('CMAP error')
+            gofs = len(out)
+            out += data[pos:pos + list_len]
+            pos += list_len
+        out[i * cmap_size:(i + 1) * cmap_size] = struct.pack(CMAP_FMT, range_start, range_length, gid_start,
+                                                             bitmap_base | (cmap_type << CMAP_BITMAP_BASE_BITS),
+                                                             ulist, gofs, list_len)
+    if len(out) != unpacked_size:
+        raise D2FontError('CMAP error')
+    return bytes(out)
+
+
+def parse(data: bytes, verify: bool = True) -> D2Font:
+    """ Parse a d2_font bin, with the same checks as `d2_font_load_from_mem` """
+    if len(data) < 8 + struct.calcsize(HEADER_FMT) or data[2:8] != HEADER_MAGIC:
+        raise D2FontError('Header error')
+    header_length, = struct.unpack_from('<H', data, 0)
+    header_size = 8 + struct.calcsize(HEADER_FMT)
+    if header_length < header_size or header_length + 4 > len(data):
+        raise D2FontError('Header_length error')
+    header = Header(*struct.unpack_from(HEADER_FMT, data, 8), extra=data[header_size:header_length])
+
+    dsc_length, = struct.unpack_from('<I', data, header_length)
+    if header_length + dsc_length + SHA256_LEN > len(data):
+        raise D2FontError('Dsc_length error')
+    end = header_length + dsc_length
+    if verify and hashlib.sha256(data[:end]).digest() != data[end:end + SHA256_LEN]:
+        raise D2FontError('SHA256 error')
+
+    font = parse_tables(data, header_length + 4, 0, end, header)
+    font.sections = {
+        'header': (0, header_length),
+        'dsc': (header_length, 4 + struct.calcsize(FDSC_FMT)),
+        **font.sections,
+        'sha256': (end, SHA256_LEN),
+    }
+    font.file_size = len(data)
+    return font
+
+
+def parse_tables(data: bytes, base: int, fdsc_ofs: int, end: int, header: Header) -> D2Font:
+    """
+    Parse `d2_font_fmt_txt_dsc_t` at `base + fdsc_ofs` and the tables after it, up to `end`.
+    Offsets in the tables are relative to `base`.
+    """
+    if header.flags & ~HEADER_FLAGS_KNOWN:
+        raise D2FontError('Unknown header flags 0x%02x' % header.flags)
+    bitmap_ofs, gindex_ofs, gdsc_ofs, cmaps_ofs, kern_ofs, kern_scale, bits = struct.unpack_from(FDSC_FMT, data, base + fdsc_ofs)
+    cmap_num = bits & 0x1FF
+    bpp = (bits >> 9) & 0xF
+    kern_classes = (bits >> 13) & 0x1
+    bitmap_format = bits >> 14
+    for ofs, tag in ((cmaps_ofs, b'CMAP'), (kern_ofs, b'KERN'), (gindex_ofs, b'GIDX'), (gdsc_ofs, b'GDSC'),
+                     (bitmap_ofs, b'GBIT')):
+        _check_tag(data, base + ofs, tag)
+
+    cmap_data, cmap_pos = data, base + cmaps_ofs
+    if header.cmap_compressed:
+        cmap_data, cmap_pos = unpack_cmaps(data, base + cmaps_ofs, cmap_num, end), 0
+    cmaps = parse_cmaps(cmap_data, cmap_pos, cmap_num, base if cmap_data is data else 0)
+
+    bits32, glyph_id_max = struct.unpack_from(KERN_FMT, data, base + kern_ofs)
+    pair_cnt = bits32 & 0x3FFFFFFF
+    ids_size = bits32 >> 30
+    kern_pairs = []
+    if kern_classes == 0 and pair_cnt:
+        values = struct.unpack_from('<{}b'.format(pair_cnt), data, base + kern_ofs + 8)
+        ids_fmt = '<{}{}'.format(pair_cnt * 2, 'B' if ids_size == 0 else 'H')
+        ids = struct.unpack_from(ids_fmt, data, base + kern_ofs + 8 + pair_cnt)
+        kern_pairs = [KernPair(ids[2 * i], ids[2 * i + 1], values[i]) for i in range(pair_cnt)]
+
+    # The glyph index has one entry per glyph id, it ends where the GDSC section starts
+    gdsc_size = struct.calcsize(GDSC_FMT)
+    if header.wide_index:
+        gindex_size = struct.calcsize(GLYPH_INDEX_WIDE_FMT)
+        gindex_num = (gdsc_ofs - 4 - gindex_ofs) // gindex_size
+        glyph_index = [(dsc_index, bitmap_ofs) for bitmap_ofs, dsc_index in
+                       (struct.unpack_from(GLYPH_INDEX_WIDE_FMT, data, base + gindex_ofs + i * gindex_size)
+                        for i in range(gindex_num))]
+    else:
+        gindex_num = (gdsc_ofs - 4 - gindex_ofs) // 4
+        glyph_index_raw = struct.unpack_from('<{}I'.format(gindex_num), data, base + gindex_ofs)
+        gid_base = [0] * gindex_num
+        for cmap in cmaps:
+            for _, gid in cmap.items():
+                if gid < gindex_num:
+                    gid_base[gid] = cmap.glyph_bitmap_index_base
+        glyph_index = [(v >> GLYPH_INDEX_OFFSET_BITS, gid_base[gid] + (v & ((1 << GLYPH_INDEX_OFFSET_BITS) - 1)))
+                       for gid, v in enumerate(glyph_index_raw)]
+    gdsc_num = (bitmap_ofs - 4 - gdsc_ofs) // gdsc_size
+    glyph_dsc = [GlyphDsc(*struct.unpack_from(GDSC_FMT, data, base + gdsc_ofs + i * gdsc_size)) for i in range(gdsc_num)]
+    bitmap = data[base + bitmap_ofs:end]
+
+    sections = {
+        'CMAP': (base + cmaps_ofs - 4, kern_ofs - cmaps_ofs),
+        'KERN': (base + kern_ofs - 4, gindex_ofs - kern_ofs),
+        'GIDX': (base + gindex_ofs - 4, gdsc_ofs - gindex_ofs),
+        'GDSC': (base + gdsc_ofs - 4, bitmap_ofs - gdsc_ofs),
+        'GBIT': (base + bitmap_ofs - 4, end - (base + bitmap_ofs) + 4),
+    }
+    return D2Font(header, kern_scale, bpp, kern_classes, bitmap_format, cmaps, kern_pairs, ids_size,
+                  glyph_index, glyph_dsc, bitmap, sections)
+
+
+def unpack_pixels(data: bytes, num: int, bpp: int) -> List[int]:
+    """ Read `num` values of `bpp` bits, rows of plain bitmaps are not padded """
+    value = int.from_bytes(data, 'big')
+    total = len(data) * 8
+    mask = (1 << bpp) - 1
+    return [(value >> (total - (i + 1) * bpp)) & mask for i in range(num)]
+
+
+def pack_pixels(values: List[int], bpp: int) -> bytes:
+    size = (len(values) * bpp + 7) // 8
+    value = 0
+    for v in values:
+        value = (value << bpp) | v
+    value <<= size * 8 - len(values) * bpp
+    return value.to_bytes(size, 'big')
+
+
+# Bit widths of `rle_next` in d2_font_fmt_txt.c: a value repeated after 11 one-bits is followed by a 6-bit counter
+RLE_REPEAT_BITS = 11
+RLE_COUNTER_MAX = (1 << 6) - 1
+# Compressed bitmaps are only decoded at these bpp
+RLE_BPPS = (2, 3, 4)
+
+
+class _BitWriter:
+    def __init__(self) -> None:
+        self.value = 0
+        self.bits = 0
+
+    def write(self, value: int, bits: int) -> None:
+        self.value = (self.value << bits) | value
+        self.bits += bits
+
+    def to_bytes(self) -> bytes:
+        size = (self.bits + 7) // 8
+        return (self.value << (size * 8 - self.bits)).to_bytes(size, 'big')
+
+
+def rle_compress(values: List[int], box_w: int, bpp: int, prefilter: bool = True) -> bytes:
+    """
+    Compress the raw values of a glyph, row by row, as `rle_next` reads them. With `prefilter` each row is
+    XORed with the row above it first, as in the `D2_FONT_FMT_TXT_COMPRESSED` format.
+    """
+    if prefilter:
+        values = values[:box_w] + [values[i] ^ values[i - box_w] for i in range(box_w, len(values))]
+    out = _BitWriter()
+    repeat = False
+    prev = 0
+    i = 0
+    while i < len(values):
+        v = values[i]
+        if not repeat:
+            out.write(v, bpp)
+            repeat = i > 0 and v == prev
+            count = 0
+            prev = v
+            i += 1
+            continue
+        if v != prev:
+            out.write(0, 1)
+            out.write(v, bpp)
+            repeat = False
+            prev = v
+            i += 1
+            continue
+        out.write(1, 1)
+        count += 1
+        i += 1
+        if count == RLE_REPEAT_BITS:
+            # The counter covers this value and the next ones up to the value read after them
+            run = 0
+            while i + run < len(values) and values[i + run] == prev and run + 1 < RLE_COUNTER_MAX:
+                run += 1
+            out.write(run + 1, 6)
+            i += run
+            if i < len(values):
+                prev = values[i]
+                out.write(prev, bpp)
+                i += 1
+            repeat = False
+    return out.to_bytes()
+
+
+def rle_decompress(data: bytes, num: int, box_w: int, bpp: int, prefilter: bool = True) -> List[int]:
+    """ Raw values of a compressed glyph, the same way as `decompress` in d2_font_fmt_txt.c """
+    bits = ''.join('{:08b}'.format(b) for b in data) + '0' * 16
+    pos = 0
+
+    def read(n: int) -> int:
+        nonlocal pos
+        value = int(bits[pos:pos + n], 2)
+        pos += n
+        return value
+
+    values = []
+    state = 'single'
+    prev = 0
+    count = 0
+    for _ in range(num):
+        if state == 'single':
+            first = pos == 0
+            ret = read(bpp)
+            if not first and ret == prev:
+                count = 0
+                state = 'repeated'
+            prev = ret
+        elif state == 'repeated':
+            count += 1
+            if read(1):
+                ret = prev
+                if count == RLE_REPEAT_BITS:
+                    count = read(6)
+                    if count:
+                        state = 'counter'
+                    else:
+                        ret = prev = read(bpp)
+                        state = 'single'
+            else:
+                ret = prev = read(bpp)
+                state = 'single'
+        else:
+            ret = prev
+            count -= 1
+            if count == 0:
+                ret = prev = read(bpp)
+                state = 'single'
+        values.append(ret)
+    if prefilter:
+        for i in range(box_w, len(values)):
+            values[i] ^= values[i - box_w]
+    return values
+
+
+def glyph_values(font: 'D2Font', gid: int) -> List[int]:
+    """ Raw values of a glyph, row by row, plain or compressed """
+    dsc = font.glyph(gid)
+    num = dsc.box_w * dsc.box_h
+    if font.bitmap_format == BITMAP_PLAIN:
+        return unpack_pixels(font.glyph_bitmap(gid), num, font.bpp)
+    return rle_decompress(font.glyph_bitmap(gid), num, dsc.box_w, font.bpp,
+                          font.bitmap_format == BITMAP_COMPRESSED)
+
+
+def _align(buf: bytearray, align: int = 4) -> None:
+    buf.extend(b'\0' * (-len(buf) % align))
+
+
+def build_cmap_lists(cmaps: List[Cmap], body: bytearray, start: int = 0) -> List[Tuple[int, int, int]]:
+    """
+    Append the `unicode_list` and `glyph_id_ofs_list` of each cmap to `body`, which starts at offset `start`.
+    Return (unicode_list, glyph_id_ofs_list, list_length) of each cmap, offsets are 0 for missing lists.
+    """
+    lists = []
+    for cmap in cmaps:
+        ulist_ofs = 0
+        gofs_ofs = 0
+        list_len = 0
+        if cmap.type in (CMAP_SPARSE_FULL, CMAP_SPARSE_TINY):
+            assert cmap.unicode_list is not None
+            _align(body, 2)
+            ulist_ofs = start + len(body)
+            list_len = len(cmap.unicode_list)
+            body += struct.pack('<{}H'.format(list_len), *cmap.unicode_list)
+        if cmap.type == CMAP_SPARSE_FULL:
+            assert cmap.glyph_id_ofs_list is not None
+            _align(body, 2)
+            gofs_ofs = start + len(body)
+            body += struct.pack('<{}H'.format(list_len), *cmap.glyph_id_ofs_list)
+        elif cmap.type == CMAP_FORMAT0_FULL:
+            assert cmap.glyph_id_ofs_list is not None
+            gofs_ofs = start + len(body)
+            list_len = len(cmap.glyph_id_ofs_list)
+            body += bytes(cmap.glyph_id_ofs_list)
+        lists.append((ulist_ofs, gofs_ofs, list_len))
+    return lists
+
+
+def _glyph_bitmap_bases(font: D2Font) -> List[int]:
+    gid_base = [0] * font.glyph_num
+    for cmap in font.cmaps:
+        for _, gid in cmap.items():
+            gid_base[gid] = cmap.glyph_bitmap_index_base
+    return gid_base
+
+
+def fits_compact_index(font: D2Font) -> bool:
+    """ Whether the glyph index fits in `d2_font_fmt_txt_glyph_index_t` with the current cmap bitmap bases """
+    if len(font.glyph_dsc) > 1 << GLYPH_INDEX_DSC_BITS:
+        return False
+    if any(cmap.glyph_bitmap_index_base >= 1 << CMAP_BITMAP_BASE_BITS for cmap in font.cmaps):
+        return False
+    gid_base = _glyph_bitmap_bases(font)
+    return all(0 <= bitmap_ofs - gid_base[gid] < 1 << GLYPH_INDEX_OFFSET_BITS
+               for gid, (_, bitmap_ofs) in enumerate(font.glyph_index) if gid)
+
+
+def build_tables(font: D2Font, start: int = 0, lists: Optional[List[Tuple[int, int, int]]] = None) -> bytearray:
+    """
+    Serialize `d2_font_fmt_txt_dsc_t` and the tables after it. The result is stored at offset `start` from the
+    base of the offsets. The cmap lists are stored after the cmaps, unless `lists` from `build_cmap_lists` tells
+    where they already are.
+    `glyph_index` bitmap offsets are absolute in `bitmap`, they are rebased on the `glyph_bitmap_index_base`
+    of the cmap owning each glyph, which must already be set.
+    The wide index is used if `font.header` asks for it or the compact one does not fit; `font.header.flags`
+    is updated to match, so pack the header after this.
+    With `HEADER_FLAG_CMAP_COMPRESSED` the cmaps and lists are stored packed, `lists` can not be used.
+    """
+    if len(font.cmaps) > CMAP_NUM_MAX:
+        raise D2FontError('Too many cmaps: {}'.format(len(font.cmaps)))
+    if font.header.cmap_compressed and lists is not None:
+        raise D2FontError('Compressed cmaps can not use shared lists')
+    wide = font.header.wide_index or not fits_compact_index(font)
+    if wide:
+        font.header.flags |= HEADER_FLAG_WIDE_INDEX
+        if len(font.bitmap) > 0xFFFFFFFF:
+            raise D2FontError('Bitmap is too big: {}'.format(len(font.bitmap)))
+
+    fdsc_size = struct.calcsize(FDSC_FMT)
+    cmap_size = struct.calcsize(CMAP_FMT)
+    body = bytearray(fdsc_size)     # d2_font_fmt_txt_dsc_t is filled at the end
+
+    # CMAP: the cmaps, then their lists
+    _align(body)
+    body += b'CMAP'
+    cmaps_ofs = len(body)
+    if font.header.cmap_compressed:
+        body += pack_cmaps(font.cmaps, wide)
+    else:
+        body += bytes(cmap_size * len(font.cmaps))
+        if lists is None:
+            lists = build_cmap_lists(font.cmaps, body, start)
+        packed_cmaps = []
+        for cmap, (ulist_ofs, gofs_ofs, list_len) in zip(font.cmaps, lists):
+            bitmap_base = 0 if wide else cmap.glyph_bitmap_index_base
+            packed_cmaps.append(struct.pack(CMAP_FMT, cmap.range_start, cmap.range_length, cmap.glyph_id_start,
+                                            bitmap_base | (cmap.type << CMAP_BITMAP_BASE_BITS),
+                                            ulist_ofs, gofs_ofs, list_len))
+        body[cmaps_ofs:cmaps_ofs + cmap_size * len(font.cmaps)] = b''.join(packed_cmaps)
+
+    # KERN: pairs ordered by left id then right id, as `get_kern_value` binary searches them
+    _align(body)
+    body += b'KERN'
+    kern_ofs = len(body)
+    pairs = sorted(font.kern_pairs, key=lambda p: (p.left, p.right))
+    glyph_id_max = max([max(p.left, p.right) for p in pairs], default=0)
+    ids_size = 0 if glyph_id_max <= 0xFF else 1
+    body += struct.pack(KERN_FMT, len(pairs) | (ids_size << 30), glyph_id_max)
+    body += struct.pack('<{}b'.format(len(pairs)), *[p.value for p in pairs])
+    ids = [i for p in pairs for i in (p.left, p.right)]
+    body += struct.pack('<{}{}'.format(len(ids), 'B' if ids_size == 0 else 'H'), *ids)
+
+    # GIDX
+    _align(body)
+    body += b'GIDX'
+    gindex_ofs = len(body)
+    if wide:
+        for dsc_index, bitmap_ofs in font.glyph_index:
+            body += struct.pack(GLYPH_INDEX_WIDE_FMT, bitmap_ofs, dsc_index)
+    else:
+        gid_base = _glyph_bitmap_bases(font)
+        for gid, (dsc_index, bitmap_ofs) in enumerate(font.glyph_index):
+            rel = bitmap_ofs - gid_base[gid] if gid else 0
+            body += struct.pack('<I', rel | (dsc_index << GLYPH_INDEX_OFFSET_BITS))
+
+    # GDSC
+    _align(body)
+    body += b'GDSC'
+    gdsc_ofs = len(body)
+    for dsc in font.glyph_dsc:
+        body += struct.pack(GDSC_FMT, dsc.adv_w, dsc.box_w, dsc.box_h, dsc.ofs_x, dsc.ofs_y)
+
+    # GBIT
+    _align(body)
+    body += b'GBIT'
+    bitmap_ofs = len(body)
+    body += font.bitmap
+
+    bits = len(font.cmaps) | (font.bpp << 9) | (font.kern_classes << 13) | (font.bitmap_format << 14)
+    body[0:fdsc_size] = struct.pack(FDSC_FMT, start + bitmap_ofs, start + gindex_ofs, start + gdsc_ofs,
+                                    start + cmaps_ofs, start + kern_ofs, font.kern_scale, bits)
+    return body
+
+
+def build(font: D2Font) -> bytes:
+    """ Serialize a font, see `build_tables` """
+    body = build_tables(font)
+    out = bytearray(font.header.pack())
+    out += struct.pack('<I', 4 + len(body))
+    out += body
+    out += hashlib.sha256(out).digest()
+    return bytes(out)
+
+
+def load(path: str, verify: bool = True) -> D2Font:
+    with open(path, 'rb') as f:
+        return parse(f.read(), verify)
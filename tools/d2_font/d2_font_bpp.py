@@ -0,0 +1,147 @@
+#!/usr/bin/env python
+#
+# SPDX-FileCopyrightText: 2026 udoudou
+# SPDX-License-Identifier: Apache-2.0
+"""
+Compare the bitmap size of a d2_font bin at each bpp, and write it again with another bpp.
+
+    d2_font_bpp.py font_4bpp.bin
+    d2_font_bpp.py font_4bpp.bin font_3bpp.bin --bpp 3
+
+Plain bitmaps take `ceil(box_w * box_h * bpp / 8)` bytes whatever the pixels are, so the sizes of the report
+are exact for plain fonts of the same glyph boxes. Only plain fonts can be converted; the opacity of every
+pixel is moved to the nearest level of the new bpp, using the same opacity tables as the decoder.
+"""
+import argparse
+import dataclasses
+import sys
+from typing import Dict
+from typing import List
+from typing import Tuple
+
+import d2_font_bin as d2
+
+BPPS = (1, 2, 3, 4, 8)
+
+# opa*_table of d2_font_fmt_txt.c
+OPA_TABLES = {
+    1: [0, 255],
+    2: [0, 85, 170, 255],
+    3: [0, 36, 73, 109, 146, 182, 218, 255],
+    4: [v * 17 for v in range(16)],
+    8: list(range(256)),
+}
+
+
+def level_map(src_bpp: int, dst_bpp: int) -> List[int]:
+    """ Source value -> destination value of the nearest opacity """
+    dst_table = OPA_TABLES[dst_bpp]
+    return [min(range(len(dst_table)), key=lambda d: abs(dst_table[d] - opa)) for opa in OPA_TABLES[src_bpp]]
+
+
+def glyph_boxes(font: d2.D2Font) -> Dict[int, Tuple[int, int]]:
+    """ Bitmap offset -> pixels and glyph id of the largest glyph stored there; glyphs can share bitmaps """
+    boxes: Dict[int, Tuple[int, int]] = {}
+    for gid in range(1, font.glyph_num):
+        dsc = font.glyph(gid)
+        ofs = font.glyph_index[gid][1]
+        pixels = dsc.box_w * dsc.box_h
+        if ofs not in boxes or boxes[ofs][0] < pixels:
+            boxes[ofs] = (pixels, gid)
+    return boxes
+
+
+def report(font: d2.D2Font) -> None:
+    boxes = glyph_boxes(font)
+    stored = sum(1 for pixels, _ in boxes.values() if pixels)
+    print('size: {} bytes, bpp: {}, bitmap format: {}, {} glyphs, {} stored bitmaps'.format(
+        font.file_size, font.bpp, font.bitmap_format, font.glyph_num - 1, stored))
+    print()
+    print('plain bitmaps   bpp       GBIT  bytes/glyph   vs 4 bpp   bin size')
+    sizes = {bpp: sum((pixels * bpp + 7) // 8 for pixels, _ in boxes.values()) for bpp in BPPS}
+    for bpp in BPPS:
+        mark = ' <' if bpp == font.bpp and font.bitmap_format == d2.BITMAP_PLAIN else ''
+        print('                {:>3} {:>10} {:>12.1f} {:>9.1f}% {:>10}{}'.format(
+            bpp, sizes[bpp], sizes[bpp] / max(stored, 1), 100.0 * sizes[bpp] / max(sizes[4], 1),
+            font.file_size - len(font.bitmap) + sizes[bpp], mark))
+    if font.bitmap_format != d2.BITMAP_PLAIN:
+        print()
+        print('stored compressed: {} bytes'.format(len(font.bitmap)))
+
+
+def convert(font: d2.D2Font, bpp: int) -> d2.D2Font:
+    if font.bitmap_format != d2.BITMAP_PLAIN:
+        raise d2.D2FontError('Compressed bitmaps can not be converted, write the font plain with d2_font_compress.py --plain')
+    levels = level_map(font.bpp, bpp)
+    boxes = glyph_boxes(font)
+    new_ofs: Dict[int, int] = {}
+    bitmap = bytearray()
+    for ofs in sorted(boxes):
+        pixels, gid = boxes[ofs]
+        new_ofs[ofs] = len(bitmap)
+        values = d2.unpack_pixels(font.glyph_bitmap(gid), pixels, font.bpp)
+        bitmap += d2.pack_pixels([levels[v] for v in values], bpp)
+
+    glyph_index = [(0, 0)] + [(dsc_index, new_ofs[ofs]) for dsc_index, ofs in font.glyph_index[1:]]
+    gid_ofs = [ofs for _, ofs in glyph_index]
+    cmaps = []
+    for cmap in font.cmaps:
+        # The compact index stores bitmap offsets from the base of the cmap holding the glyph
+        gids = [gid for _, gid in cmap.items()]
+        base = min((gid_ofs[gid] for gid in gids), default=0)
+        cmaps.append(d2.Cmap(cmap.range_start, cmap.range_length, cmap.glyph_id_start, base, cmap.type,
+                             cmap.unicode_list, cmap.glyph_id_ofs_list))
+    # `build` goes back to the wide index if the compact one does not fit
+    header = dataclasses.replace(font.header, flags=font.header.flags & ~d2.HEADER_FLAG_WIDE_INDEX)
+    return d2.D2Font(header, font.kern_scale, bpp, font.kern_classes, font.bitmap_format, cmaps, font.kern_pairs,
+                     font.kern_glyph_ids_size, glyph_index, font.glyph_dsc, bytes(bitmap))
+
+
+def check(src: d2.D2Font, dst: d2.D2Font) -> None:
+    """ Every glyph must keep its metrics, and its pixels the level they were moved to """
+    if src.codepoint_map() != dst.codepoint_map():
+        raise d2.D2FontError('Codepoints differ')
+    levels = level_map(src.bpp, dst.bpp)
+    for gid in range(1, src.glyph_num):
+        dsc = src.glyph(gid)
+        if dsc != dst.glyph(gid):
+            raise d2.D2FontError('Glyph {} metrics differ'.format(gid))
+        pixels = dsc.box_w * dsc.box_h
+        src_values = d2.unpack_pixels(src.glyph_bitmap(gid), pixels, src.bpp)
+        if [levels[v] for v in src_values] != d2.unpack_pixels(dst.glyph_bitmap(gid), pixels, dst.bpp):
+            raise d2.D2FontError('Glyph {} bitmap differs'.format(gid))
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description='Compare the bitmap size of a d2_font bin at each bpp, '
+                                                 'and write it with another bpp')
+    parser.add_argument('input', help='d2_font bin')
+    parser.add_argument('output', nargs='?', help='d2_font bin to write, with --bpp')
+    parser.add_argument('--bpp', type=int, choices=BPPS, help='bpp of the output')
+    parser.add_argument('--no-check', action='store_true', help='do not compare the result with the input')
+    args = parser.parse_args()
+    if (args.output is None) != (args.bpp is None):
+        parser.error('output and --bpp go together')
+
+    try:
+        font = d2.load(args.input)
+        report(font)
+        if args.output is None:
+            return 0
+        data = d2.build(convert(font, args.bpp))
+        if not args.no_check:
+            check(font, d2.parse(data))
+    except (OSError, d2.D2FontError) as e:
+        print('error: {}'.format(e), file=sys.stderr)
+        return 1
+
+    with open(args.output, 'wb') as f:
+        f.write(data)
+    print()
+    print('bpp: {} -> {}'.format(font.bpp, args.bpp))
+    print('size: {} -> {} bytes'.format(font.file_size, len(data)))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,107 @@
+#!/usr/bin/env python
+#
+# SPDX-FileCopyrightText: 2026 udoudou
+# SPDX-License-Identifier: Apache-2.0
+"""
+Write a plain d2_font bin again with compressed bitmaps, or a compressed one with plain bitmaps.
+
+    d2_font_compress.py font.bin font_compressed.bin
+    d2_font_compress.py font_compressed.bin font_plain.bin --plain
+
+The bitmaps are compressed with the RLE of LVGL (`lv_font_conv` without `--no-compress`), which
+`d2_font_fmt_txt.c` decodes: rows are XORed with the row above them first, unless `--no-prefilter` is given.
+Compressed bitmaps are only decoded at 2, 3 and 4 bpp.
+"""
+import argparse
+import dataclasses
+import sys
+from typing import Dict
+from typing import Tuple
+
+import d2_font_bin as d2
+
+
+def convert(font: d2.D2Font, bitmap_format: int) -> d2.D2Font:
+    if bitmap_format != d2.BITMAP_PLAIN and font.bpp not in d2.RLE_BPPS:
+        raise d2.D2FontError('{} bpp bitmaps can not be compressed'.format(font.bpp))
+    # Glyphs sharing a stored bitmap keep sharing it if their boxes are the same
+    stored: Dict[Tuple[int, int, int], int] = {}
+    new_ofs: Dict[Tuple[int, int, int], int] = {}
+    for gid in range(1, font.glyph_num):
+        dsc = font.glyph(gid)
+        stored.setdefault((font.glyph_index[gid][1], dsc.box_w, dsc.box_h), gid)
+    bitmap = bytearray()
+    for key in sorted(stored):
+        gid = stored[key]
+        dsc = font.glyph(gid)
+        new_ofs[key] = len(bitmap)
+        values = d2.glyph_values(font, gid)
+        if bitmap_format == d2.BITMAP_PLAIN:
+            bitmap += d2.pack_pixels(values, font.bpp)
+        else:
+            bitmap += d2.rle_compress(values, dsc.box_w, font.bpp, bitmap_format == d2.BITMAP_COMPRESSED)
+
+    glyph_index = [(0, 0)]
+    for gid in range(1, font.glyph_num):
+        dsc_index, ofs = font.glyph_index[gid]
+        dsc = font.glyph(gid)
+        glyph_index.append((dsc_index, new_ofs[(ofs, dsc.box_w, dsc.box_h)]))
+    gid_ofs = [ofs for _, ofs in glyph_index]
+    cmaps = []
+    for cmap in font.cmaps:
+        # The compact index stores bitmap offsets from the base of the cmap holding the glyph
+        base = min((gid_ofs[gid] for _, gid in cmap.items()), default=0)
+        cmaps.append(d2.Cmap(cmap.range_start, cmap.range_length, cmap.glyph_id_start, base, cmap.type,
+                             cmap.unicode_list, cmap.glyph_id_ofs_list))
+    # `build` goes back to the wide index if the compact one does not fit
+    header = dataclasses.replace(font.header, flags=font.header.flags & ~d2.HEADER_FLAG_WIDE_INDEX)
+    return d2.D2Font(header, font.kern_scale, font.bpp, font.kern_classes, bitmap_format, cmaps, font.kern_pairs,
+                     font.kern_glyph_ids_size, glyph_index, font.glyph_dsc, bytes(bitmap))
+
+
+def check(src: d2.D2Font, dst: d2.D2Font) -> None:
+    """ Every glyph must keep its metrics and its pixels """
+    if src.codepoint_map() != dst.codepoint_map():
+        raise d2.D2FontError('Codepoints differ')
+    for gid in range(1, src.glyph_num):
+        if src.glyph(gid) != dst.glyph(gid):
+            raise d2.D2FontError('Glyph {} metrics differ'.format(gid))
+        if d2.glyph_values(src, gid) != d2.glyph_values(dst, gid):
+            raise d2.D2FontError('Glyph {} bitmap differs'.format(gid))
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description='Write a d2_font bin again with compressed or plain bitmaps')
+    parser.add_argument('input', help='d2_font bin')
+    parser.add_argument('output', help='d2_font bin to write')
+    group = parser.add_mutually_exclusive_group()
+    group.add_argument('--plain', action='store_true', help='write plain bitmaps')
+    group.add_argument('--no-prefilter', action='store_true', help='do not XOR the rows before compressing them')
+    parser.add_argument('--no-check', action='store_true', help='do not compare the result with the input')
+    args = parser.parse_args()
+
+    bitmap_format = d2.BITMAP_COMPRESSED
+    if args.plain:
+        bitmap_format = d2.BITMAP_PLAIN
+    elif args.no_prefilter:
+        bitmap_format = d2.BITMAP_COMPRESSED_NO_PREFILTER
+    try:
+        font = d2.load(args.input)
+        data = d2.build(convert(font, bitmap_format))
+        if not args.no_check:
+            check(font, d2.parse(data))
+    except (OSError, d2.D2FontError) as e:
+        print('error: {}'.format(e), file=sys.stderr)
+        return 1
+
+    with open(args.output, 'wb') as f:
+        f.write(data)
+    print('bpp: {}, {} glyphs'.format(font.bpp, font.glyph_num - 1))
+    print('bitmap format: {} -> {}'.format(font.bitmap_format, bitmap_format))
+    print('GBIT: {} -> {} bytes'.format(len(font.bitmap), len(d2.parse(data, False).bitmap)))
+    print('size: {} -> {} bytes'.format(font.file_size, len(data)))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
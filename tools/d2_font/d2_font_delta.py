@@ -0,0 +1,217 @@
+#!/usr/bin/env python
+#
+# SPDX-FileCopyrightText: 2026 udoudou
+# SPDX-License-Identifier: Apache-2.0
+"""
+Write a delta patch turning one d2_font bin into another, for `d2_font_delta_apply`.
+
+The new bin is compared with the old one section by section. A section that moved, e.g. behind a glyph index
+grown by added glyphs, is compared with the old section at its old offset, and the unchanged bytes are copied
+from there by the device instead of being stored. Only the byte ranges that changed are stored, each with its
+SHA-256, so the patch stays small and the device only rewrites the sectors holding changed or moved bytes.
+
+    d2_font_delta.py old.bin new.bin patch.bin
+"""
+import argparse
+import hashlib
+import struct
+import sys
+from typing import List
+from typing import Tuple
+
+import d2_font_bin as d2
+
+PATCH_MAGIC = b'D2FtDp'
+PATCH_VERSION = 2
+# <6sH32s32sII>: magic, version, base_sha256, new_sha256, new_size, region_num, then the SHA-256 of these fields
+# and of the region headers
+PATCH_HEADER_FMT = '<6sH32s32sII'
+PATCH_HEADER_SIZE = struct.calcsize(PATCH_HEADER_FMT) + 32
+# <III32s>: offset, length, source, sha256 of the new data. The data follows if the source is REGION_DATA,
+# otherwise it is copied from that offset of the old font
+REGION_FMT = '<III32s'
+REGION_DATA = 0xFFFFFFFF
+SECTOR_SIZE = 4096
+# A region costs its header, so unchanged ranges shorter than that are stored with the changes around them
+MERGE_GAP = struct.calcsize(REGION_FMT)
+
+# Bytes looked up in the old section to find where the bytes of a changed range moved, and the lookups per range
+RESYNC_LEN = 32
+RESYNC_PROBES_MAX = 256
+
+# (offset, length, source): source is the offset in the old font for copied bytes, REGION_DATA for stored bytes
+Region = Tuple[int, int, int]
+
+
+def diff(old: bytes, new: bytes, start: int, end: int, shift: int, window: Tuple[int, int]) -> List[Region]:
+    """
+    Regions making new[start:end] from the old font, where the same bytes were `shift` bytes earlier.
+    Unchanged bytes need no region if they did not move, and are copied if they did. After bytes inserted or
+    removed inside the range, the bytes that follow are looked for in old[window] to pick up the new shift.
+    """
+    def same(pos: int) -> bool:
+        return 0 <= pos - shift < len(old) and old[pos - shift] == new[pos]
+
+    regions: List[Region] = []
+    probes = 0
+    pos = start
+    while pos < end:
+        run_same = same(pos)
+        run_end = pos + 1
+        while run_end < end and same(run_end) == run_same:
+            run_end += 1
+        if run_same:
+            if shift:
+                regions.append((pos, run_end - pos, pos - shift))
+            pos = run_end
+            continue
+        # A long change: find where the bytes after it went, a few probes per range at most
+        resync = run_end
+        probe = pos
+        while probe + RESYNC_LEN <= run_end and probes < RESYNC_PROBES_MAX:
+            found = old.find(new[probe:probe + RESYNC_LEN], window[0], window[1])
+            probes += 1
+            if found >= 0 and probe - found != shift:
+                resync = probe
+                break
+            probe += RESYNC_LEN
+        if resync > pos:
+            regions.append((pos, resync - pos, REGION_DATA))
+        if resync < run_end:
+            shift = resync - found
+        pos = resync
+    return regions
+
+
+def merge(regions: List[Region]) -> List[Region]:
+    """ Store short copies with the stored bytes around them, and join stored regions close to each other """
+    merged: List[Region] = []
+    for offset, length, source in sorted(regions):
+        if source != REGION_DATA and length < MERGE_GAP:
+            source = REGION_DATA
+        if merged and merged[-1][2] == REGION_DATA and source == REGION_DATA and \
+                offset - (merged[-1][0] + merged[-1][1]) < MERGE_GAP:
+            merged[-1] = (merged[-1][0], offset + length - merged[-1][0], REGION_DATA)
+        elif merged and source != REGION_DATA and merged[-1][2] != REGION_DATA and \
+                merged[-1][0] + merged[-1][1] == offset and merged[-1][2] + merged[-1][1] == source:
+            merged[-1] = (merged[-1][0], merged[-1][1] + length, merged[-1][2])
+        else:
+            merged.append((offset, length, source))
+    return merged
+
+
+def make_patch(old: bytes, new: bytes, old_font: d2.D2Font,
+               new_font: d2.D2Font) -> Tuple[bytes, List[Tuple[str, int, int]]]:
+    report: List[Tuple[str, int, int]] = []
+    regions: List[Region] = []
+    for name, (offset, size) in sorted(new_font.sections.items(), key=lambda s: s[1][0]):
+        # The trailer always changes, the other sections are compared where they were in the old font
+        old_offset, old_size = old_font.sections[name]
+        shift = offset - old_offset if name != 'sha256' else 0
+        section = diff(old, new, offset, offset + size, shift, (old_offset, old_offset + old_size))
+        report.append((name, sum(length for _, length, source in section if source == REGION_DATA),
+                       sum(length for _, length, source in section if source != REGION_DATA)))
+        regions += section
+    # Bytes between sections (tag padding)
+    covered = sorted(new_font.sections.values())
+    pos = 0
+    for offset, size in covered + [(len(new), 0)]:
+        if offset > pos:
+            regions += diff(old, new, pos, offset, 0, (pos, offset))
+        pos = max(pos, offset + size)
+    regions = merge(regions)
+
+    header = struct.pack(PATCH_HEADER_FMT, PATCH_MAGIC, PATCH_VERSION, old[-d2.SHA256_LEN:], new[-d2.SHA256_LEN:],
+                         len(new), len(regions))
+    header_sha256 = hashlib.sha256(header)
+    body = bytearray()
+    for offset, length, source in regions:
+        data = new[offset:offset + length]
+        region = struct.pack(REGION_FMT, offset, length, source, hashlib.sha256(data).digest())
+        header_sha256.update(region)
+        body += region
+        if source == REGION_DATA:
+            body += data
+    return header + header_sha256.digest() + bytes(body), report
+
+
+def apply(old: bytes, patch: bytes) -> bytes:
+    """ Same result as `d2_font_delta_apply` on a partition holding `old` """
+    magic, version, base_sha256, new_sha256, new_size, region_num = struct.unpack_from(PATCH_HEADER_FMT, patch)
+    if magic != PATCH_MAGIC or version != PATCH_VERSION:
+        raise d2.D2FontError('patch header error')
+    if old[-d2.SHA256_LEN:] != base_sha256:
+        raise d2.D2FontError('patch is made for another font')
+    out = bytearray(old[:new_size].ljust(new_size, b'\xff'))
+    header_sha256 = hashlib.sha256(patch[:struct.calcsize(PATCH_HEADER_FMT)])
+    pos = PATCH_HEADER_SIZE
+    for _ in range(region_num):
+        offset, length, source, sha256 = struct.unpack_from(REGION_FMT, patch, pos)
+        header_sha256.update(patch[pos:pos + struct.calcsize(REGION_FMT)])
+        pos += struct.calcsize(REGION_FMT)
+        # Copies read the old font: every sector is staged from it before any is written
+        if source == REGION_DATA:
+            data = patch[pos:pos + length]
+            pos += length
+        elif source + length <= len(old):
+            data = old[source:source + length]
+        else:
+            raise d2.D2FontError('region at 0x{:x} copies beyond the old font'.format(offset))
+        if hashlib.sha256(data).digest() != sha256:
+            raise d2.D2FontError('region at 0x{:x} SHA256 error'.format(offset))
+        out[offset:offset + length] = data
+    if header_sha256.digest() != patch[struct.calcsize(PATCH_HEADER_FMT):PATCH_HEADER_SIZE]:
+        raise d2.D2FontError('patch header SHA256 error')
+    if out[-d2.SHA256_LEN:] != new_sha256:
+        raise d2.D2FontError('patched font SHA256 error')
+    return bytes(out)
+
+
+def sectors(patch: bytes) -> int:
+    """ Flash sectors rewritten by the patch, the journal needs as many free sectors plus one """
+    region_num = struct.unpack_from(PATCH_HEADER_FMT, patch)[-1]
+    pos = PATCH_HEADER_SIZE
+    touched = set()
+    for _ in range(region_num):
+        offset, length, source, _ = struct.unpack_from(REGION_FMT, patch, pos)
+        pos += struct.calcsize(REGION_FMT) + (length if source == REGION_DATA else 0)
+        touched.update(range(offset // SECTOR_SIZE, (offset + length - 1) // SECTOR_SIZE + 1))
+    return len(touched)
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description='Write a delta patch between two d2_font bins')
+    parser.add_argument('old', help='d2_font bin on the device')
+    parser.add_argument('new', help='d2_font bin to update to')
+    parser.add_argument('patch', help='patch file to write')
+    args = parser.parse_args()
+
+    with open(args.old, 'rb') as f:
+        old = f.read()
+    with open(args.new, 'rb') as f:
+        new = f.read()
+    try:
+        old_font = d2.parse(old)
+        new_font = d2.parse(new)
+        if old == new:
+            raise d2.D2FontError('fonts are identical')
+        patch, report = make_patch(old, new, old_font, new_font)
+        if apply(old, patch) != new:
+            raise d2.D2FontError('patch check failed')
+    except d2.D2FontError as e:
+        print('error: {}'.format(e), file=sys.stderr)
+        return 1
+
+    with open(args.patch, 'wb') as f:
+        f.write(patch)
+
+    for name, changed, copied in report:
+        print('{:8} {:8} bytes changed {:8} bytes moved'.format(name, changed, copied))
+    region_num = struct.unpack_from(PATCH_HEADER_FMT, patch)[-1]
+    print('{} bytes -> {} bytes, patch {} bytes in {} regions, {} sectors rewritten'.format(
+        len(old), len(new), len(patch), region_num, sectors(patch)))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
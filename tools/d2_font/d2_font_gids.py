@@ -0,0 +1,112 @@
+#!/usr/bin/env python
+#
+# SPDX-FileCopyrightText: 2026 udoudou
+# SPDX-License-Identifier: Apache-2.0
+"""
+Convert the fixed strings of a UI to glyph id arrays of one d2_font bin.
+
+    d2_font_gids.py d2_font_demo_14.bin strings.json -o demo_14_gids.h
+
+`strings.json` is an object of C identifier -> text. Each text becomes a `static const uint32_t` array for
+`d2_font_render_gids`, with '\n' written as glyph id 0 (new line). Codepoints are looked up like
+`get_glyph_dsc_id` does, the first cmap holding a codepoint wins.
+
+Glyph ids only make sense for the bin they were read from, so the header records the SHA-256 of the bin; convert
+the strings again whenever the bin is rebuilt.
+"""
+import argparse
+import json
+import os
+import re
+import sys
+from typing import Dict
+from typing import List
+
+import d2_font_bin as d2
+
+IDENT_RE = re.compile(r'^[A-Za-z_][A-Za-z0-9_]*$')
+PER_LINE = 12
+
+
+def to_gids(text: str, cp_map: Dict[int, int], skip_missing: bool) -> List[int]:
+    gids = []
+    for ch in text:
+        if ch == '\n':
+            gids.append(0)
+            continue
+        gid = cp_map.get(ord(ch))
+        if gid is None:
+            if skip_missing:
+                continue
+            raise d2.D2FontError('U+{:04X} {!r} is not in the font'.format(ord(ch), ch))
+        gids.append(gid)
+    return gids
+
+
+def c_comment(text: str) -> str:
+    return text.replace('\n', '\\n').replace('*/', '*\\/')
+
+
+def write_header(path: str, bin_path: str, sha256: bytes, arrays: Dict[str, List[int]],
+                 texts: Dict[str, str]) -> None:
+    lines = [
+        '/*',
+        ' * Generated by d2_font_gids.py, do not edit.',
+        ' * Font: {}'.format(os.path.basename(bin_path)),
+        ' * SHA-256: {}'.format(sha256.hex()),
+        ' * The glyph ids are only valid for this bin.',
+        ' */',
+        '#pragma once',
+        '',
+        '#include <stdint.h>',
+    ]
+    for name, gids in arrays.items():
+        lines.append('')
+        lines.append('/* {} */'.format(c_comment(texts[name])))
+        lines.append('static const uint32_t {}[] = {{'.format(name))
+        for i in range(0, len(gids), PER_LINE):
+            lines.append('    ' + ' '.join('{},'.format(gid) for gid in gids[i:i + PER_LINE]))
+        lines.append('};')
+    with open(path, 'w', encoding='utf-8') as f:
+        f.write('\n'.join(lines) + '\n')
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description='Convert strings to glyph id arrays of a d2_font bin')
+    parser.add_argument('bin', help='d2_font bin the glyph ids are read from')
+    parser.add_argument('strings', help='JSON object of C identifier -> text')
+    parser.add_argument('-o', '--output', required=True, help='C header to write')
+    parser.add_argument('--skip-missing', action='store_true',
+                        help='drop the characters the font does not have instead of failing')
+    args = parser.parse_args()
+
+    with open(args.strings, 'r', encoding='utf-8') as f:
+        texts = json.load(f)
+    try:
+        if not isinstance(texts, dict):
+            raise d2.D2FontError('{} is not a JSON object'.format(args.strings))
+        font = d2.load(args.bin)
+        cp_map = font.codepoint_map()
+        arrays: Dict[str, List[int]] = {}
+        for name, text in texts.items():
+            if not IDENT_RE.match(name):
+                raise d2.D2FontError('{!r} is not a C identifier'.format(name))
+            if not isinstance(text, str):
+                raise d2.D2FontError('{}: text is not a string'.format(name))
+            try:
+                arrays[name] = to_gids(text, cp_map, args.skip_missing)
+            except d2.D2FontError as e:
+                raise d2.D2FontError('{}: {}'.format(name, e))
+    except d2.D2FontError as e:
+        print('error: {}'.format(e), file=sys.stderr)
+        return 1
+
+    with open(args.bin, 'rb') as f:
+        sha256 = f.read()[-d2.SHA256_LEN:]
+    write_header(args.output, args.bin, sha256, arrays, texts)
+    print('{} strings, {} glyph ids'.format(len(arrays), sum(len(gids) for gids in arrays.values())))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,206 @@
+#!/usr/bin/env python
+#
+# SPDX-FileCopyrightText: 2026 udoudou
+# SPDX-License-Identifier: Apache-2.0
+"""
+Report how a d2_font bin is laid out and what a glyph lookup costs.
+
+    d2_font_inspect.py d2_font_demo_14.bin
+
+The lookup cost follows `get_glyph_dsc_id` and `get_kern_value` in d2_font_fmt_txt.c: cmaps are checked one
+after another until one holds the codepoint, sparse cmaps binary search their `unicode_list`, then the
+`glyph_index` and `glyph_dsc` entries are read and kern pairs are binary searched. Every step is counted as
+one read of the font data, which is a flash access through the mmap cache in most setups.
+"""
+import argparse
+import collections
+import math
+import sys
+from typing import Any
+from typing import Callable
+from typing import Dict
+from typing import List
+
+import d2_font_bin as d2
+
+# Thresholds of the layout warnings
+SMALL_SPARSE_LIST = 16
+SMALL_SPARSE_WARN_NUM = 8
+SCAN_WARN_DEPTH = 16
+LIMIT_WARN_RATIO = 0.9
+
+
+def bsearch_probes(n: int) -> int:
+    return math.ceil(math.log2(n + 1)) if n else 0
+
+
+def histogram(title: str, counter: Dict, label: Callable[[Any], str] = str) -> None:
+    print('\n{}'.format(title))
+    total = sum(counter.values())
+    for key in sorted(counter):
+        n = counter[key]
+        print('  {:>12} {:>7} {:5.1f}% {}'.format(label(key), n, 100.0 * n / total, '#' * max(1, round(40.0 * n / total))))
+
+
+def bucket(size: int) -> int:
+    """ Power of two bucket """
+    return 1 << (size.bit_length() - 1) if size else 0
+
+
+def bucket_label(low: int) -> str:
+    return '{}-{} B'.format(low, low * 2 - 1) if low else '0 B'
+
+
+def cmap_glyph_num(cmap: d2.Cmap) -> int:
+    return sum(1 for _ in cmap.items())
+
+
+def lookup_cost(font: d2.D2Font, cmap_pos: int) -> int:
+    """ Reads of the font data to get the glyph descriptor of a codepoint held by `font.cmaps[cmap_pos]` """
+    cmap = font.cmaps[cmap_pos]
+    cost = cmap_pos + 1                 # range checks of the cmaps scanned
+    if cmap.type == d2.CMAP_FORMAT0_FULL:
+        cost += 1
+    elif cmap.type == d2.CMAP_SPARSE_TINY:
+        cost += bsearch_probes(len(cmap.unicode_list or []))
+    elif cmap.type == d2.CMAP_SPARSE_FULL:
+        cost += bsearch_probes(len(cmap.unicode_list or [])) + 1
+    cost += 2                           # glyph_index, glyph_dsc
+    return cost
+
+
+def report(font: d2.D2Font, show_glyphs: bool) -> List[str]:
+    warnings = []
+    print('size: {} bytes, bpp: {}, bitmap format: {}, line height: {}, base line: {}, glyph index: {}{}'.format(
+        font.file_size, font.bpp, font.bitmap_format, font.header.line_height, font.header.base_line,
+        'wide' if font.header.wide_index else 'compact', ', cmaps compressed' if font.header.cmap_compressed else ''))
+
+    print('\nsections')
+    for name, (ofs, size) in font.sections.items():
+        print('  {:<8} offset 0x{:06X} {:>9} bytes {:5.1f}%'.format(name, ofs, size, 100.0 * size / font.file_size))
+
+    print('\ncmaps (checked in this order for every lookup)')
+    print('  {:>3} {:<13} {:>8} {:>8} {:>7} {:>6} {:>6} {:>5}'.format(
+        '#', 'type', 'first', 'last', 'length', 'list', 'glyphs', 'cost'))
+    type_count: collections.Counter = collections.Counter()
+    type_ranges: Dict[int, List[int]] = collections.defaultdict(list)
+    small_sparse = 0
+    for i, cmap in enumerate(font.cmaps):
+        list_len = len(cmap.unicode_list) if cmap.unicode_list is not None else len(cmap.glyph_id_ofs_list or [])
+        print('  {:>3} {:<13} {:>8} {:>8} {:>7} {:>6} {:>6} {:>5}'.format(
+            i, cmap.type_name, 'U+{:04X}'.format(cmap.range_start), 'U+{:04X}'.format(cmap.range_start + cmap.range_length - 1),
+            cmap.range_length, list_len, cmap_glyph_num(cmap), lookup_cost(font, i)))
+        type_count[cmap.type] += 1
+        type_ranges[cmap.type].append(cmap.range_length)
+        if cmap.type in (d2.CMAP_SPARSE_TINY, d2.CMAP_SPARSE_FULL) and list_len < SMALL_SPARSE_LIST:
+            small_sparse += 1
+    print('\n  {:<13} {:>5} {:>10} {:>10} {:>10}'.format('type', 'cmaps', 'min range', 'avg range', 'max range'))
+    for cmap_type, n in sorted(type_count.items()):
+        ranges = type_ranges[cmap_type]
+        print('  {:<13} {:>5} {:>10} {:>10.1f} {:>10}'.format(
+            d2.CMAP_TYPE_NAMES.get(cmap_type, str(cmap_type)), n, min(ranges), sum(ranges) / n, max(ranges)))
+
+    glyph_num = font.glyph_num - 1
+    gids = range(1, font.glyph_num)
+    histogram('glyph box width', collections.Counter(font.glyph(g).box_w for g in gids))
+    histogram('glyph box height', collections.Counter(font.glyph(g).box_h for g in gids))
+    sizes = {g: font.glyph_bitmap_size(g) for g in gids}
+    histogram('glyph bitmap size', collections.Counter(bucket(s) for s in sizes.values()), bucket_label)
+
+    raw_total = 0
+    stored_total = 0
+    ratios: collections.Counter = collections.Counter()
+    for g in gids:
+        dsc = font.glyph(g)
+        raw = (dsc.box_w * dsc.box_h * font.bpp + 7) // 8
+        raw_total += raw
+        stored_total += sizes[g]
+        if raw:
+            ratios[min(round(sizes[g] / raw, 1), 9.9)] += 1
+    print('\nbitmap: {} bytes stored, {} bytes unpacked, ratio {:.3f}'.format(
+        stored_total, raw_total, stored_total / raw_total if raw_total else 0))
+    if font.bitmap_format != d2.BITMAP_PLAIN:
+        histogram('compression ratio (stored / unpacked)', ratios)
+        bigger = sum(1 for g in gids if sizes[g] > (font.glyph(g).box_w * font.glyph(g).box_h * font.bpp + 7) // 8)
+        if bigger:
+            warnings.append('{} glyphs are bigger compressed than plain'.format(bigger))
+    if show_glyphs:
+        cp_of_gid = {gid: cp for cp, gid in font.codepoint_map().items()}
+        print('\n  {:>6} {:>8} {:>6} {:>7} {:>6} {:>6}'.format('gid', 'char', 'box', 'stored', 'plain', 'ratio'))
+        for g in gids:
+            dsc = font.glyph(g)
+            raw = (dsc.box_w * dsc.box_h * font.bpp + 7) // 8
+            print('  {:>6} {:>8} {:>6} {:>7} {:>6} {:>6.2f}'.format(
+                g, 'U+{:04X}'.format(cp_of_gid[g]) if g in cp_of_gid else '-', '{}x{}'.format(dsc.box_w, dsc.box_h),
+                sizes[g], raw, sizes[g] / raw if raw else 0))
+
+    dsc_unique = len(set(font.glyph(g).key() for g in gids))
+    print('\nglyph_dsc: {} entries for {} glyphs, {:.1f}% deduplicated ({} unique used)'.format(
+        len(font.glyph_dsc), glyph_num, 100.0 * (1 - len(font.glyph_dsc) / glyph_num) if glyph_num else 0, dsc_unique))
+
+    kern_lefts = len(set(p.left for p in font.kern_pairs))
+    kern_probes = bsearch_probes(len(font.kern_pairs))
+    print('kern: {} pairs, {} left glyphs, ids stored as {}, classes: {}, bsearch {} probes'.format(
+        len(font.kern_pairs), kern_lefts, 'uint8' if font.kern_glyph_ids_size == 0 else 'uint16',
+        font.kern_classes, kern_probes))
+
+    print('\nestimated reads of the font data per get_glyph_dsc (with kerning: two lookups and the kern search)')
+    kern_id_max = max([max(p.left, p.right) for p in font.kern_pairs], default=0)
+    weighted = 0
+    for i, cmap in enumerate(font.cmaps):
+        cost = lookup_cost(font, i)
+        # Glyph ids above the biggest kerned one skip the kern search
+        kerned = any(gid <= kern_id_max for _, gid in cmap.items())
+        with_kern = 2 * cost - 2 + (kern_probes if kerned else 0)
+        n = cmap_glyph_num(cmap)
+        weighted += cost * n
+        print('  U+{:04X}-U+{:04X} {:>4} reads, {:>4} with kerning'.format(
+            cmap.range_start, cmap.range_start + cmap.range_length - 1, cost, with_kern))
+    if glyph_num:
+        print('  average over all glyphs: {:.1f} reads'.format(weighted / glyph_num))
+
+    # Slow or risky layouts
+    if small_sparse >= SMALL_SPARSE_WARN_NUM:
+        warnings.append('{} sparse cmaps hold fewer than {} codepoints each, every lookup past them scans them all. '
+                        'Merge them (e.g. with d2_font_subset.py)'.format(small_sparse, SMALL_SPARSE_LIST))
+    if len(font.cmaps) > SCAN_WARN_DEPTH:
+        warnings.append('{} cmaps: codepoints in the last ones cost {} range checks'.format(len(font.cmaps), len(font.cmaps)))
+    for i, cmap in enumerate(font.cmaps):
+        if cmap.range_start <= 0x7E and cmap.range_start + cmap.range_length > 0x20 and i >= 4:
+            warnings.append('ASCII is in cmap #{}, it is checked after {} other cmaps'.format(i, i))
+    if font.header.wide_index:
+        # No limits to warn about
+        return warnings
+    if len(font.glyph_dsc) > LIMIT_WARN_RATIO * (1 << d2.GLYPH_INDEX_DSC_BITS):
+        warnings.append('{} glyph_dsc entries, the index limit is {}'.format(len(font.glyph_dsc), 1 << d2.GLYPH_INDEX_DSC_BITS))
+    for cmap in font.cmaps:
+        gids_in = [gid for _, gid in cmap.items()]
+        if gids_in:
+            span = max(font.glyph_index[g][1] for g in gids_in) - cmap.glyph_bitmap_index_base
+            if span > LIMIT_WARN_RATIO * (1 << d2.GLYPH_INDEX_OFFSET_BITS):
+                warnings.append('Bitmaps of cmap U+{:04X} span {} bytes, the offset limit is {}'.format(
+                    cmap.range_start, span, 1 << d2.GLYPH_INDEX_OFFSET_BITS))
+    return warnings
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description='Report the layout and lookup cost of a d2_font bin')
+    parser.add_argument('input', help='d2_font bin')
+    parser.add_argument('--glyphs', action='store_true', help='list every glyph with its compression ratio')
+    args = parser.parse_args()
+
+    try:
+        font = d2.load(args.input)
+    except (OSError, d2.D2FontError) as e:
+        print('error: {}'.format(e), file=sys.stderr)
+        return 1
+
+    warnings = report(font, args.glyphs)
+    print('\n{} warnings'.format(len(warnings)))
+    for w in warnings:
+        print('  - {}'.format(w))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,294 @@
+#!/usr/bin/env python
+#
+# SPDX-FileCopyrightText: 2026 udoudou
+# SPDX-License-Identifier: Apache-2.0
+"""
+Write the glyphs of a d2_font bin as an LVGL font bin, loaded with `lv_binfont_create`, to compare the two
+engines on the same glyphs.
+
+    d2_font_lvgl.py font.bin lvgl_font.bin
+
+The layout is the one of `lv_font_conv --format bin`: tables 'head', 'cmap', 'loca', 'glyf' and 'kern', each
+starting with its u32 length and its label. The bitmaps are written as they are stored, plain or compressed,
+with the bpp, metrics, cmaps and kern pairs of the d2_font bin. Every glyph is read back and compared.
+"""
+import argparse
+import struct
+import sys
+from typing import Dict
+from typing import List
+from typing import Tuple
+
+import d2_font_bin as d2
+
+# font_header_bin_t of lv_binfont_loader.c
+HEAD_FMT = '<IHHHhHhHhhHHBBBBBBBBBBhH'
+# cmap_table_bin_t of lv_binfont_loader.c
+CMAP_FMT = '<IIHHHBB'
+LABEL_FMT = '<I4s'
+HEAD_VERSION = 1
+# 'cmap', 'loca' and 'glyf', 'kern' when the font has kern pairs
+TABLES_COUNT = 3
+# LVGL reads the glyph_id_ofs_list of a FORMAT0_FULL cmap with a u8 length
+FORMAT0_FULL_MAX = 0xFF
+ADV_W_FORMAT_FP12_4 = 1
+
+
+def _bits_unsigned(value: int) -> int:
+    return max(value.bit_length(), 1)
+
+
+def _bits_signed(value: int) -> int:
+    return (value if value >= 0 else ~value).bit_length() + 1
+
+
+class _BitWriter:
+    def __init__(self) -> None:
+        self.value = 0
+        self.bits = 0
+
+    def write(self, value: int, bits: int) -> None:
+        self.value = (self.value << bits) | (value & ((1 << bits) - 1))
+        self.bits += bits
+
+    def to_bytes(self) -> bytes:
+        assert self.bits % 8 == 0
+        return self.value.to_bytes(self.bits // 8, 'big')
+
+
+def _table(label: bytes, body: bytes) -> bytes:
+    return struct.pack(LABEL_FMT, 8 + len(body), label) + body
+
+
+def _glyph_bits(font: d2.D2Font) -> Tuple[int, int, int]:
+    """ Bits of adv_w, ofs_x/ofs_y and box_w/box_h; adv_w takes the padding so the bitmaps start on a byte """
+    dscs = [font.glyph(gid) for gid in range(1, font.glyph_num)]
+    xy_bits = max([_bits_signed(v) for d in dscs for v in (d.ofs_x, d.ofs_y)], default=1)
+    wh_bits = max([_bits_unsigned(v) for d in dscs for v in (d.box_w, d.box_h)], default=1)
+    adv_bits = max([_bits_unsigned(d.adv_w) for d in dscs], default=1)
+    adv_bits += -(adv_bits + 2 * xy_bits + 2 * wh_bits) % 8
+    return adv_bits, xy_bits, wh_bits
+
+
+def build(font: d2.D2Font) -> bytes:
+    if font.kern_classes:
+        raise d2.D2FontError('Kerning classes are not supported')
+    adv_bits, xy_bits, wh_bits = _glyph_bits(font)
+    glyph_id_format = 0 if font.glyph_num <= 0x100 else 1
+
+    # cmap: the subtable headers, then their lists
+    headers = bytearray()
+    lists = bytearray()
+    data_start = 8 + 4 + struct.calcsize(CMAP_FMT) * len(font.cmaps)
+    for cmap in font.cmaps:
+        if cmap.range_length > 0xFFFF or cmap.glyph_id_start > 0xFFFF:
+            raise d2.D2FontError('Cmap U+{:04X} does not fit in an LVGL font'.format(cmap.range_start))
+        data = b''
+        entries = 0
+        if cmap.type == d2.CMAP_FORMAT0_FULL:
+            assert cmap.glyph_id_ofs_list is not None
+            if len(cmap.glyph_id_ofs_list) > FORMAT0_FULL_MAX:
+                raise d2.D2FontError('Cmap U+{:04X} has more than {} entries'.format(cmap.range_start,
+                                                                                    FORMAT0_FULL_MAX))
+            entries = len(cmap.glyph_id_ofs_list)
+            data = bytes(cmap.glyph_id_ofs_list)
+        elif cmap.type in (d2.CMAP_SPARSE_FULL, d2.CMAP_SPARSE_TINY):
+            assert cmap.unicode_list is not None
+            entries = len(cmap.unicode_list)
+            data = struct.pack('<{}H'.format(entries), *cmap.unicode_list)
+            if cmap.type == d2.CMAP_SPARSE_FULL:
+                assert cmap.glyph_id_ofs_list is not None
+                data += struct.pack('<{}H'.format(entries), *cmap.glyph_id_ofs_list)
+        headers += struct.pack(CMAP_FMT, data_start + len(lists) if data else 0, cmap.range_start,
+                               cmap.range_length, cmap.glyph_id_start, entries, cmap.type, 0)
+        lists += data
+    cmap_table = _table(b'cmap', struct.pack('<I', len(font.cmaps)) + headers + lists)
+
+    # glyf: every glyph id with its metrics and its bitmap, id 0 is empty
+    glyf = bytearray()
+    offsets = []
+    for gid in range(font.glyph_num):
+        offsets.append(8 + len(glyf))
+        bits = _BitWriter()
+        if gid == 0:
+            bits.write(0, adv_bits + 2 * xy_bits + 2 * wh_bits)
+            glyf += bits.to_bytes()
+            continue
+        dsc = font.glyph(gid)
+        bits.write(dsc.adv_w, adv_bits)
+        bits.write(dsc.ofs_x, xy_bits)
+        bits.write(dsc.ofs_y, xy_bits)
+        bits.write(dsc.box_w, wh_bits)
+        bits.write(dsc.box_h, wh_bits)
+        glyf += bits.to_bytes()
+        if dsc.box_w * dsc.box_h:
+            glyf += font.glyph_bitmap(gid)
+    glyf_table = _table(b'glyf', bytes(glyf))
+    index_to_loc_format = 0 if len(glyf_table) <= 0xFFFF else 1
+    loca_table = _table(b'loca', struct.pack('<I', len(offsets)) +
+                        struct.pack('<{}{}'.format(len(offsets), 'H' if index_to_loc_format == 0 else 'I'), *offsets))
+
+    # kern: sorted pairs, `get_kern_value` binary searches them by left then right glyph id
+    kern_table = b''
+    if font.kern_pairs:
+        pairs = sorted(font.kern_pairs, key=lambda p: (p.left, p.right))
+        ids = [i for p in pairs for i in (p.left, p.right)]
+        kern_table = _table(b'kern', struct.pack('<B3xI', 0, len(pairs)) +
+                            struct.pack('<{}{}'.format(len(ids), 'B' if glyph_id_format == 0 else 'H'), *ids) +
+                            struct.pack('<{}b'.format(len(pairs)), *[p.value for p in pairs]))
+
+    header = font.header
+    ascent = header.line_height - header.base_line
+    descent = -header.base_line
+    head = struct.pack(HEAD_FMT, HEAD_VERSION, TABLES_COUNT + (1 if kern_table else 0), header.line_height,
+                       ascent, descent, ascent, descent, 0, descent, ascent, 0, font.kern_scale,
+                       index_to_loc_format, glyph_id_format, ADV_W_FORMAT_FP12_4, font.bpp, xy_bits, wh_bits,
+                       adv_bits, font.bitmap_format, header.subpx, 0, header.underline_position,
+                       header.underline_thickness)
+    return _table(b'head', head) + cmap_table + loca_table + glyf_table + kern_table
+
+
+class _BitReader:
+    def __init__(self, data: bytes, pos: int) -> None:
+        self.data = data
+        self.pos = pos * 8
+
+    def read(self, bits: int) -> int:
+        value = 0
+        for _ in range(bits):
+            value = (value << 1) | ((self.data[self.pos >> 3] >> (7 - (self.pos & 7))) & 1)
+            self.pos += 1
+        return value
+
+    def read_signed(self, bits: int) -> int:
+        value = self.read(bits)
+        return value - (1 << bits) if value & (1 << (bits - 1)) else value
+
+
+def _read_label(data: bytes, pos: int, label: bytes) -> int:
+    length, found = struct.unpack_from(LABEL_FMT, data, pos)
+    if found != label:
+        raise d2.D2FontError("Error reading '{}' label".format(label.decode()))
+    return length
+
+
+def parse(data: bytes) -> Tuple[tuple, Dict[int, int], List[Tuple[d2.GlyphDsc, bytes]], Dict[Tuple[int, int], int]]:
+    """
+    Read an LVGL font bin the way `lv_binfont_create` does.
+    Return the header fields, codepoint -> glyph id, (metrics, bitmap) per glyph id and the kern pairs.
+    """
+    head_length = _read_label(data, 0, b'head')
+    head = struct.unpack_from(HEAD_FMT, data, 8)
+    (_, tables_count, _, _, _, _, _, _, _, _, default_adv_w, _, index_to_loc_format, glyph_id_format, adv_w_format,
+     _, xy_bits, wh_bits, adv_bits, _, _, _, _, _) = head
+
+    cmap_start = head_length
+    cmap_length = _read_label(data, cmap_start, b'cmap')
+    cmap_num, = struct.unpack_from('<I', data, cmap_start + 8)
+    codepoints: Dict[int, int] = {}
+    for i in range(cmap_num):
+        data_ofs, range_start, range_length, gid_start, entries, cmap_type, _ = struct.unpack_from(
+            CMAP_FMT, data, cmap_start + 12 + i * struct.calcsize(CMAP_FMT))
+        pos = cmap_start + data_ofs
+        cmap = d2.Cmap(range_start, range_length, gid_start, 0, cmap_type)
+        if cmap_type == d2.CMAP_FORMAT0_FULL:
+            cmap.glyph_id_ofs_list = list(data[pos:pos + (entries & 0xFF)])
+        elif cmap_type in (d2.CMAP_SPARSE_FULL, d2.CMAP_SPARSE_TINY):
+            cmap.unicode_list = list(struct.unpack_from('<{}H'.format(entries), data, pos))
+            if cmap_type == d2.CMAP_SPARSE_FULL:
+                cmap.glyph_id_ofs_list = list(struct.unpack_from('<{}H'.format(entries), data, pos + 2 * entries))
+        elif cmap_type != d2.CMAP_FORMAT0_TINY:
+            raise d2.D2FontError('Unknown cmap type {}'.format(cmap_type))
+        for cp, gid in cmap.items():
+            codepoints.setdefault(cp, gid)
+
+    loca_start = cmap_start + cmap_length
+    loca_length = _read_label(data, loca_start, b'loca')
+    loca_count, = struct.unpack_from('<I', data, loca_start + 8)
+    offsets = list(struct.unpack_from('<{}{}'.format(loca_count, 'H' if index_to_loc_format == 0 else 'I'), data,
+                                      loca_start + 12))
+
+    glyf_start = loca_start + loca_length
+    glyf_length = _read_label(data, glyf_start, b'glyf')
+    nbits = adv_bits + 2 * xy_bits + 2 * wh_bits
+    glyphs = []
+    for i, ofs in enumerate(offsets):
+        bits = _BitReader(data, glyf_start + ofs)
+        adv_w = bits.read(adv_bits) if adv_bits else default_adv_w
+        if adv_w_format == 0:
+            adv_w *= 16
+        dsc = d2.GlyphDsc(adv_w, 0, 0, bits.read_signed(xy_bits), bits.read_signed(xy_bits))
+        dsc.box_w = bits.read(wh_bits)
+        dsc.box_h = bits.read(wh_bits)
+        end = offsets[i + 1] if i + 1 < loca_count else glyf_length
+        bitmap = b''
+        if i == 0:
+            dsc = d2.GlyphDsc(0, 0, 0, 0, 0)
+        elif dsc.box_w * dsc.box_h:
+            if nbits % 8:
+                raise d2.D2FontError('Glyph {} bitmap does not start on a byte'.format(i))
+            bitmap = data[glyf_start + ofs + nbits // 8:glyf_start + end]
+        glyphs.append((dsc, bitmap))
+
+    kern: Dict[Tuple[int, int], int] = {}
+    if tables_count >= TABLES_COUNT + 1:
+        kern_start = glyf_start + glyf_length
+        _read_label(data, kern_start, b'kern')
+        kern_format, pair_cnt = struct.unpack_from('<B3xI', data, kern_start + 8)
+        if kern_format != 0:
+            raise d2.D2FontError('Unknown kern format {}'.format(kern_format))
+        ids_fmt = '<{}{}'.format(2 * pair_cnt, 'B' if glyph_id_format == 0 else 'H')
+        ids = struct.unpack_from(ids_fmt, data, kern_start + 16)
+        values = struct.unpack_from('<{}b'.format(pair_cnt), data, kern_start + 16 + struct.calcsize(ids_fmt))
+        kern = {(ids[2 * i], ids[2 * i + 1]): values[i] for i in range(pair_cnt)}
+    return head, codepoints, glyphs, kern
+
+
+def check(src: d2.D2Font, data: bytes) -> None:
+    """ Every glyph must keep its metrics and its stored bitmap, and every kern pair its value """
+    head, codepoints, glyphs, kern = parse(data)
+    bpp, bitmap_format = head[15], head[19]
+    if (bpp, bitmap_format, head[11]) != (src.bpp, src.bitmap_format, src.kern_scale):
+        raise d2.D2FontError('Header differs')
+    if head[3] - head[4] != src.header.line_height or -head[4] != src.header.base_line:
+        raise d2.D2FontError('Line height or base line differs')
+    if codepoints != src.codepoint_map():
+        raise d2.D2FontError('Codepoints differ')
+    if len(glyphs) != src.glyph_num:
+        raise d2.D2FontError('Glyph count differs')
+    for gid in range(1, src.glyph_num):
+        dsc, bitmap = glyphs[gid]
+        if dsc != src.glyph(gid):
+            raise d2.D2FontError('Glyph {} metrics differ'.format(gid))
+        if dsc.box_w * dsc.box_h and bitmap != src.glyph_bitmap(gid):
+            raise d2.D2FontError('Glyph {} bitmap differs'.format(gid))
+    if kern != {(p.left, p.right): p.value for p in src.kern_pairs}:
+        raise d2.D2FontError('Kern pairs differ')
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description='Write the glyphs of a d2_font bin as an LVGL font bin')
+    parser.add_argument('input', help='d2_font bin')
+    parser.add_argument('output', help='LVGL font bin to write')
+    parser.add_argument('--no-check', action='store_true', help='do not compare the result with the input')
+    args = parser.parse_args()
+
+    try:
+        font = d2.load(args.input)
+        data = build(font)
+        if not args.no_check:
+            check(font, data)
+    except (OSError, d2.D2FontError) as e:
+        print('error: {}'.format(e), file=sys.stderr)
+        return 1
+
+    with open(args.output, 'wb') as f:
+        f.write(data)
+    print('bpp: {}, bitmap format: {}, {} glyphs, {} kern pairs'.format(font.bpp, font.bitmap_format,
+                                                                         font.glyph_num - 1, len(font.kern_pairs)))
+    print('size: {} -> {} bytes'.format(font.file_size, len(data)))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
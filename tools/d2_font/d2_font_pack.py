@@ -0,0 +1,147 @@
+#!/usr/bin/env python
+#
+# SPDX-FileCopyrightText: 2026 udoudou
+# SPDX-License-Identifier: Apache-2.0
+"""
+Pack several sizes of a font into one bin, for `d2_font_pack_open`.
+
+All the sizes must map the same codepoints to the same glyph ids (same font converter options, or subset
+with the same corpus). Their cmap lists are then stored once, each size keeps its own glyph index,
+descriptors, kerning and bitmaps.
+
+    d2_font_pack.py family.bin 14=font_14.bin 16=font_16.bin 20=font_20.bin
+"""
+import argparse
+import hashlib
+import struct
+import sys
+from typing import List
+from typing import Tuple
+
+import d2_font_bin as d2
+
+PACK_MAGIC = b'D2FtPk'
+PACK_VERSION = 1
+# <II>: version, font_num
+PACK_HEADER_FMT = '<II'
+# <III> + d2_font_header_bin_t: size, dsc_offset, dsc_length, header
+PACK_FONT_FMT = '<III' + d2.HEADER_FMT[1:]
+LISTS_TAG = b'ULST'
+
+
+def parse_font_arg(text: str) -> Tuple[int, str]:
+    size, sep, path = text.partition('=')
+    if not sep or not size.isdigit():
+        raise argparse.ArgumentTypeError('expected SIZE=FILE: {}'.format(text))
+    return int(size), path
+
+
+def cmap_key(cmap: d2.Cmap) -> tuple:
+    """ What a pack shares between sizes: everything but the bitmap base """
+    return (cmap.range_start, cmap.range_length, cmap.glyph_id_start, cmap.type,
+            cmap.unicode_list, cmap.glyph_id_ofs_list)
+
+
+def build(fonts: List[Tuple[int, d2.D2Font]]) -> bytes:
+    first = fonts[0][1]
+    for size, font in fonts[1:]:
+        if [cmap_key(c) for c in font.cmaps] != [cmap_key(c) for c in first.cmaps]:
+            raise d2.D2FontError('{} px does not map codepoints like {} px, convert or subset both with the same '
+                                 'characters'.format(size, fonts[0][0]))
+
+    body = bytearray(LISTS_TAG)
+    lists = d2.build_cmap_lists(first.cmaps, body)
+    entries = []
+    for size, font in fonts:
+        d2._align(body)
+        start = len(body)
+        # The sizes share the lists instead of compressing them
+        font.header.flags &= ~d2.HEADER_FLAG_CMAP_COMPRESSED
+        tables = d2.build_tables(font, start, lists)
+        body += tables
+        h = font.header
+        entries.append(struct.pack(PACK_FONT_FMT, size, start, len(tables), h.version, h.line_height, h.base_line,
+                                   h.subpx, h.underline_position, h.underline_thickness, h.flags))
+
+    header_length = 2 + len(PACK_MAGIC) + struct.calcsize(PACK_HEADER_FMT) + struct.calcsize(PACK_FONT_FMT) * len(fonts)
+    out = bytearray(struct.pack('<H', header_length) + PACK_MAGIC)
+    out += struct.pack(PACK_HEADER_FMT, PACK_VERSION, len(fonts))
+    out += b''.join(entries)
+    out += struct.pack('<I', 4 + len(body))
+    out += body
+    out += hashlib.sha256(out).digest()
+    return bytes(out)
+
+
+def parse(data: bytes) -> List[Tuple[int, d2.D2Font]]:
+    """ Parse a pack, with the same checks as `d2_font_pack_open_from_mem` """
+    if len(data) < 8 + struct.calcsize(PACK_HEADER_FMT) or data[2:8] != PACK_MAGIC:
+        raise d2.D2FontError('Header error')
+    header_length, = struct.unpack_from('<H', data, 0)
+    version, font_num = struct.unpack_from(PACK_HEADER_FMT, data, 8)
+    entry_pos = 8 + struct.calcsize(PACK_HEADER_FMT)
+    if font_num == 0 or entry_pos + font_num * struct.calcsize(PACK_FONT_FMT) > header_length:
+        raise d2.D2FontError('Header error')
+    dsc_length, = struct.unpack_from('<I', data, header_length)
+    end = header_length + dsc_length
+    if end + d2.SHA256_LEN > len(data):
+        raise d2.D2FontError('Dsc_length error')
+    if hashlib.sha256(data[:end]).digest() != data[end:end + d2.SHA256_LEN]:
+        raise d2.D2FontError('SHA256 error')
+
+    base = header_length + 4
+    fonts = []
+    for i in range(font_num):
+        size, dsc_offset, length, *header = struct.unpack_from(PACK_FONT_FMT, data, entry_pos + i * struct.calcsize(PACK_FONT_FMT))
+        if dsc_offset + length > dsc_length - 4:
+            raise d2.D2FontError('Font {} error'.format(i))
+        fonts.append((size, d2.parse_tables(data, base, dsc_offset, base + dsc_offset + length, d2.Header(*header))))
+    return fonts
+
+
+def check(fonts: List[Tuple[int, d2.D2Font]], packed: List[Tuple[int, d2.D2Font]]) -> None:
+    """ Every size must read back with the same glyphs as its source bin """
+    if [size for size, _ in fonts] != [size for size, _ in packed]:
+        raise d2.D2FontError('check: sizes differ')
+    for (size, src), (_, dst) in zip(fonts, packed):
+        same = (src.codepoint_map() == dst.codepoint_map() and src.glyph_num == dst.glyph_num and
+                all(src.glyph(gid) == dst.glyph(gid) and src.glyph_bitmap(gid) == dst.glyph_bitmap(gid)
+                    for gid in range(1, src.glyph_num)) and
+                sorted((p.left, p.right, p.value) for p in src.kern_pairs) ==
+                sorted((p.left, p.right, p.value) for p in dst.kern_pairs) and
+                src.header.pack()[2:8 + struct.calcsize(d2.HEADER_FMT)] == dst.header.pack()[2:8 + struct.calcsize(d2.HEADER_FMT)])
+        if not same:
+            raise d2.D2FontError('check: {} px differs from its source'.format(size))
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description='Pack several sizes of a font into one bin')
+    parser.add_argument('output', help='pack to write')
+    parser.add_argument('fonts', nargs='+', type=parse_font_arg, metavar='SIZE=FILE',
+                        help='d2_font bin of a size, in pixels')
+    parser.add_argument('--no-check', action='store_true', help='do not read the pack back')
+    args = parser.parse_args()
+
+    sizes = [size for size, _ in args.fonts]
+    if len(set(sizes)) != len(sizes):
+        print('error: a size is given twice', file=sys.stderr)
+        return 1
+    try:
+        fonts = [(size, d2.load(path)) for size, path in args.fonts]
+        pack = build(fonts)
+        if not args.no_check:
+            check(fonts, parse(pack))
+    except d2.D2FontError as e:
+        print('error: {}'.format(e), file=sys.stderr)
+        return 1
+
+    with open(args.output, 'wb') as f:
+        f.write(pack)
+
+    total = sum(font.file_size for _, font in fonts)
+    print('{} sizes: {} bytes in separate bins -> {} bytes packed'.format(len(fonts), total, len(pack)))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,217 @@
+#!/usr/bin/env python
+#
+# SPDX-FileCopyrightText: 2026 udoudou
+# SPDX-License-Identifier: Apache-2.0
+"""
+Write a d2_font bin holding only the characters a product uses.
+
+The characters come from corpus files (every character found is kept), from the command line, or from
+codepoint ranges. Cmaps are rebuilt for the kept codepoints, glyph ids are renumbered, identical glyph
+descriptors are merged, unused bitmaps and kern pairs are dropped and the SHA-256 trailer is recomputed.
+
+    d2_font_subset.py d2_font_demo_14.bin out.bin --text strings.txt --range 0x20-0x7E
+"""
+import argparse
+import dataclasses
+import sys
+from typing import Dict
+from typing import Iterable
+from typing import List
+from typing import Set
+from typing import Tuple
+
+import d2_font_bin as d2
+
+# A FORMAT0_TINY cmap costs one cmap entry, a codepoint in a SPARSE_TINY cmap costs 2 bytes of unicode_list.
+# Consecutive runs shorter than this are cheaper in a sparse cmap.
+TINY_MIN_RUN = 12
+RANGE_LENGTH_MAX = 0xFFFF
+
+
+def parse_range(text: str) -> range:
+    first, _, last = text.partition('-')
+    start = int(first, 0)
+    end = int(last, 0) if last else start
+    if end < start:
+        raise argparse.ArgumentTypeError('invalid range: {}'.format(text))
+    return range(start, end + 1)
+
+
+def plan_cmaps(codepoints: List[int], tiny_min_run: int) -> List[Tuple[int, List[int]]]:
+    """ Split sorted codepoints into (cmap type, codepoints) groups """
+    runs: List[List[int]] = []
+    for cp in codepoints:
+        if runs and cp == runs[-1][-1] + 1 and len(runs[-1]) < RANGE_LENGTH_MAX:
+            runs[-1].append(cp)
+        else:
+            runs.append([cp])
+
+    groups: List[Tuple[int, List[int]]] = []
+    sparse: List[int] = []
+    for run in runs:
+        if len(run) >= tiny_min_run:
+            if sparse:
+                groups.append((d2.CMAP_SPARSE_TINY, sparse))
+                sparse = []
+            groups.append((d2.CMAP_FORMAT0_TINY, run))
+            continue
+        for cp in run:
+            if sparse and (cp - sparse[0] >= RANGE_LENGTH_MAX or len(sparse) >= RANGE_LENGTH_MAX):
+                groups.append((d2.CMAP_SPARSE_TINY, sparse))
+                sparse = []
+            sparse.append(cp)
+    if sparse:
+        groups.append((d2.CMAP_SPARSE_TINY, sparse))
+    return groups
+
+
+def subset(font: d2.D2Font, keep: Set[int], keep_kern: bool = True, tiny_min_run: int = TINY_MIN_RUN,
+           wide_index: bool = False) -> d2.D2Font:
+    """ With `wide_index` bitmap offsets are not limited, cmaps are not split every 2 MB of bitmaps """
+    cp_map = font.codepoint_map()
+    codepoints = sorted(cp for cp in keep if cp in cp_map)
+    groups = plan_cmaps(codepoints, tiny_min_run)
+
+    glyph_dsc = [font.glyph(0)]
+    dsc_ids: Dict[Tuple[int, int, int, int, int], int] = {glyph_dsc[0].key(): 0}
+    glyph_index = [(0, 0)]
+    bitmap = bytearray()
+    cmaps: List[d2.Cmap] = []
+    gid_map: Dict[int, int] = {}
+
+    def add_cmap(cmap_type: int, cps: List[int], glyph_id_start: int) -> None:
+        cmap = d2.Cmap(cps[0], cps[-1] - cps[0] + 1, glyph_id_start, glyph_index[glyph_id_start][1], cmap_type)
+        if cmap_type == d2.CMAP_SPARSE_TINY:
+            cmap.unicode_list = [cp - cps[0] for cp in cps]
+        cmaps.append(cmap)
+
+    for cmap_type, cps in groups:
+        first = 0
+        first_gid = len(glyph_index)
+        for i, cp in enumerate(cps):
+            old_gid = cp_map[cp]
+            glyph_bitmap = font.glyph_bitmap(old_gid)
+            if not wide_index and i > first and len(bitmap) - glyph_index[first_gid][1] >= 1 << d2.GLYPH_INDEX_OFFSET_BITS:
+                # The bitmap offset inside a cmap is 21 bits, start another cmap
+                add_cmap(cmap_type, cps[first:i], first_gid)
+                first = i
+                first_gid = len(glyph_index)
+            dsc = font.glyph(old_gid)
+            dsc_index = dsc_ids.setdefault(dsc.key(), len(glyph_dsc))
+            if dsc_index == len(glyph_dsc):
+                glyph_dsc.append(dsc)
+            gid_map[old_gid] = len(glyph_index)
+            glyph_index.append((dsc_index, len(bitmap)))
+            bitmap += glyph_bitmap
+        add_cmap(cmap_type, cps[first:], first_gid)
+
+    kern_pairs = []
+    if keep_kern and font.kern_classes == 0:
+        kern_pairs = [d2.KernPair(gid_map[p.left], gid_map[p.right], p.value) for p in font.kern_pairs
+                      if p.left in gid_map and p.right in gid_map]
+
+    flags = font.header.flags & ~(d2.HEADER_FLAG_WIDE_INDEX | d2.HEADER_FLAG_CMAP_COMPRESSED)
+    if wide_index:
+        flags |= d2.HEADER_FLAG_WIDE_INDEX
+    header = dataclasses.replace(font.header, flags=flags)
+    return d2.D2Font(header, font.kern_scale, font.bpp, 0, font.bitmap_format,
+                     cmaps, kern_pairs, 0, glyph_index, glyph_dsc, bytes(bitmap))
+
+
+def check(src: d2.D2Font, dst: d2.D2Font, codepoints: Iterable[int], check_kern: bool = True) -> None:
+    """ Every kept codepoint must resolve to the same metrics, bitmap and kerning """
+    src_map = src.codepoint_map()
+    dst_map = dst.codepoint_map()
+    gid_map = {}
+    for cp in codepoints:
+        if cp not in src_map:
+            continue
+        if cp not in dst_map:
+            raise d2.D2FontError('U+{:04X} is missing'.format(cp))
+        src_gid = src_map[cp]
+        dst_gid = dst_map[cp]
+        if src.glyph(src_gid) != dst.glyph(dst_gid) or src.glyph_bitmap(src_gid) != dst.glyph_bitmap(dst_gid):
+            raise d2.D2FontError('U+{:04X} differs'.format(cp))
+        gid_map[src_gid] = dst_gid
+    if not check_kern:
+        return
+    src_kern = {(gid_map[p.left], gid_map[p.right]): p.value for p in src.kern_pairs
+                if p.left in gid_map and p.right in gid_map}
+    dst_kern = {(p.left, p.right): p.value for p in dst.kern_pairs}
+    if src_kern != dst_kern:
+        raise d2.D2FontError('Kerning differs')
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description='Write a d2_font bin holding only the given characters')
+    parser.add_argument('input', help='d2_font bin')
+    parser.add_argument('output', help='subset d2_font bin to write')
+    parser.add_argument('--text', action='append', default=[], metavar='FILE',
+                        help='UTF-8 corpus or character list, every character in it is kept. Can be repeated')
+    parser.add_argument('--chars', action='append', default=[], metavar='STRING', help='characters to keep')
+    parser.add_argument('--range', action='append', default=[], type=parse_range, metavar='FIRST-LAST',
+                        help='codepoint range to keep, e.g. 0x20-0x7E. Can be repeated')
+    parser.add_argument('--no-kern', action='store_true', help='drop kerning')
+    parser.add_argument('--wide-index', action='store_true',
+                        help='write the wide glyph index, for fonts with 2 MB+ of bitmaps. '
+                             'It is also used when there are more than 2048 glyph descriptors')
+    parser.add_argument('--compress-cmaps', action='store_true',
+                        help='store the cmaps compressed, they are unpacked to RAM when the font is loaded')
+    parser.add_argument('--no-check', action='store_true', help='do not compare the result with the input')
+    args = parser.parse_args()
+
+    keep: Set[int] = set()
+    for path in args.text:
+        with open(path, encoding='utf-8') as f:
+            keep.update(ord(c) for c in f.read())
+    for chars in args.chars:
+        keep.update(ord(c) for c in chars)
+    for r in args.range:
+        keep.update(r)
+    # line breaks of the corpus are not glyphs
+    keep.difference_update((0x0A, 0x0D))
+    if not keep:
+        parser.error('nothing to keep, use --text, --chars or --range')
+
+    try:
+        font = d2.load(args.input)
+        cp_map = font.codepoint_map()
+        missing = sorted(cp for cp in keep if cp not in cp_map)
+        if missing:
+            print('{} characters are not in the font: {}{}'.format(
+                len(missing), ''.join(chr(cp) for cp in missing[:32]), '...' if len(missing) > 32 else ''))
+
+        wide_index = args.wide_index
+        result = subset(font, keep, not args.no_kern, wide_index=wide_index)
+        if not wide_index and len(result.glyph_dsc) > 1 << d2.GLYPH_INDEX_DSC_BITS:
+            # The compact index can not address them, no need to split cmaps for it either
+            wide_index = True
+            result = subset(font, keep, not args.no_kern, wide_index=wide_index)
+        if len(result.cmaps) > d2.CMAP_NUM_MAX:
+            # Too fragmented, keep every run in sparse cmaps
+            result = subset(font, keep, not args.no_kern, tiny_min_run=RANGE_LENGTH_MAX + 1, wide_index=wide_index)
+        if args.compress_cmaps:
+            result.header.flags |= d2.HEADER_FLAG_CMAP_COMPRESSED
+        data = d2.build(result)
+        if not args.no_check:
+            check(font, d2.parse(data), keep, not args.no_kern)
+    except (OSError, d2.D2FontError) as e:
+        print('error: {}'.format(e), file=sys.stderr)
+        return 1
+
+    with open(args.output, 'wb') as f:
+        f.write(data)
+
+    print('glyphs: {} -> {}'.format(font.glyph_num - 1, result.glyph_num - 1))
+    print('cmaps: {} -> {}'.format(len(font.cmaps), len(result.cmaps)))
+    print('glyph index: {}'.format('wide' if result.header.wide_index else 'compact'))
+    print('CMAP section: {} -> {} bytes{}'.format(font.sections['CMAP'][1], d2.parse(data).sections['CMAP'][1],
+                                                  ', compressed' if result.header.cmap_compressed else ''))
+    print('glyph_dsc: {} -> {}'.format(len(font.glyph_dsc), len(result.glyph_dsc)))
+    print('kern pairs: {} -> {}'.format(len(font.kern_pairs), len(result.kern_pairs)))
+    print('size: {} -> {} bytes'.format(font.file_size, len(data)))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,263 @@
+#!/usr/bin/env python
+#
+# SPDX-FileCopyrightText: 2026 udoudou
+# SPDX-License-Identifier: Apache-2.0
+"""
+Replay a glyph access trace of `d2_font_trace_dump` against a bin, to size the caches before building firmware.
+
+    d2_font_trace.py d2_font_demo_14.bin monitor.log --gid-cache 0,16,64 --bitmap-cache 0,4k,16k
+
+The log is the console output of the device, other lines are ignored. Every descriptor and bitmap request of
+LVGL is replayed, also the ones the device served from RAM, through:
+
+- a glyph id cache of N letters (LRU), a hit skips the cmap search and the GIDX/GDSC reads
+- a bitmap cache of N bytes of A8 glyphs (LRU), a hit skips the bitmap read and the decoding
+- a flash cache of `--flash-cache` lines of `--line-size` bytes (LRU), every missed line is fetched from flash
+
+The cmap search itself is not modelled, its tables are small and stay in the flash cache. Bitmap lengths come
+from the bin, compressed glyphs are read up to the next stored bitmap.
+"""
+import argparse
+import re
+import struct
+import sys
+from collections import OrderedDict
+from typing import Dict
+from typing import List
+from typing import NamedTuple
+from typing import Optional
+from typing import Tuple
+
+import d2_font_bin as d2
+
+EVENT_RE = re.compile(r'd2t (\d) ([0-9a-fA-F]+) (\d+) (\d+) (\d+)')
+DROPPED_RE = re.compile(r'd2_font_trace begin \d+ dropped (\d+)')
+
+TRACE_DSC = 0
+TRACE_DSC_RAM = 1
+TRACE_BITMAP = 2
+TRACE_BITMAP_RAM = 3
+
+
+class Event(NamedTuple):
+    kind: int
+    letter: int
+    gid: int
+    bitmap_ofs: int
+    bitmap_len: int
+
+
+class Result(NamedTuple):
+    gid_cache: int
+    bitmap_cache: int
+    dsc_hits: int
+    dsc_num: int
+    bitmap_hits: int
+    bitmap_num: int
+    bytes_read: int
+    bytes_fetched: int
+
+
+class Lru:
+    """ LRU of keys with a size each, evicting the oldest keys once `capacity` is exceeded """
+
+    def __init__(self, capacity: int) -> None:
+        self.capacity = capacity
+        self.used = 0
+        self.items: 'OrderedDict[int, int]' = OrderedDict()
+
+    def access(self, key: int, size: int = 1) -> bool:
+        if key in self.items:
+            self.items.move_to_end(key)
+            return True
+        if size > self.capacity:
+            return False
+        self.items[key] = size
+        self.used += size
+        while self.used > self.capacity:
+            _, old = self.items.popitem(last=False)
+            self.used -= old
+        return False
+
+
+class FlashCache:
+    def __init__(self, lines: int, line_size: int) -> None:
+        self.lines = Lru(lines)
+        self.line_size = line_size
+        self.bytes_read = 0
+        self.bytes_fetched = 0
+
+    def read(self, ofs: int, length: int) -> None:
+        if length <= 0:
+            return
+        self.bytes_read += length
+        for line in range(ofs // self.line_size, (ofs + length - 1) // self.line_size + 1):
+            if not self.lines.access(line):
+                self.bytes_fetched += self.line_size
+
+
+def parse_size(text: str) -> int:
+    text = text.strip().lower()
+    scale = 1
+    if text.endswith('k'):
+        text, scale = text[:-1], 1024
+    elif text.endswith('m'):
+        text, scale = text[:-1], 1024 * 1024
+    return int(text, 0) * scale
+
+
+def parse_sizes(text: str) -> List[int]:
+    return [parse_size(v) for v in text.split(',') if v.strip()]
+
+
+def read_trace(path: str) -> Tuple[List[Event], int]:
+    """ Events of every dump in the log, and the number of events the device dropped """
+    events = []
+    dropped = 0
+    with open(path, 'r', encoding='utf-8', errors='replace') as f:
+        for line in f:
+            m = EVENT_RE.search(line)
+            if m:
+                kind, letter, gid, ofs, length = m.groups()
+                events.append(Event(int(kind), int(letter, 16), int(gid), int(ofs), int(length)))
+                continue
+            m = DROPPED_RE.search(line)
+            if m:
+                dropped += int(m.group(1))
+    return events, dropped
+
+
+class Layout:
+    """ Where the font data of a glyph lives in the bin """
+
+    def __init__(self, font: d2.D2Font) -> None:
+        self.font = font
+        self.cp_map = font.codepoint_map()
+        self.gidx_start = font.sections['GIDX'][0] + 4
+        self.gidx_size = struct.calcsize(d2.GLYPH_INDEX_WIDE_FMT) if font.header.wide_index else 4
+        self.gdsc_start = font.sections['GDSC'][0] + 4
+        self.gdsc_size = struct.calcsize(d2.GDSC_FMT)
+        self.gbit_start = font.sections['GBIT'][0] + 4
+
+    def gid(self, event: Event) -> int:
+        """ `D2_FONT_TRACE_BITMAP_RAM` events and ASCII table hits only hold the letter """
+        if event.gid:
+            return event.gid
+        return self.cp_map.get(event.letter, 0)
+
+    def dsc_reads(self, gid: int) -> List[Tuple[int, int]]:
+        dsc_index = self.font.glyph_index[gid][0]
+        return [(self.gidx_start + gid * self.gidx_size, self.gidx_size),
+                (self.gdsc_start + dsc_index * self.gdsc_size, self.gdsc_size)]
+
+    def bitmap_read(self, gid: int) -> Tuple[int, int]:
+        return self.gbit_start + self.font.glyph_index[gid][1], self.font.glyph_bitmap_size(gid)
+
+    def a8_size(self, gid: int) -> int:
+        dsc = self.font.glyph(gid)
+        return dsc.box_w * dsc.box_h
+
+
+def replay(layout: Layout, events: List[Event], gid_cache: int, bitmap_cache: int, flash_lines: int,
+           line_size: int) -> Result:
+    gids = Lru(gid_cache)
+    bitmaps = Lru(bitmap_cache)
+    flash = FlashCache(flash_lines, line_size)
+    dsc_hits = dsc_num = bitmap_hits = bitmap_num = 0
+    for event in events:
+        gid = layout.gid(event)
+        if gid == 0 or gid >= layout.font.glyph_num:
+            continue
+        if event.kind in (TRACE_DSC, TRACE_DSC_RAM):
+            dsc_num += 1
+            if gids.access(event.letter):
+                dsc_hits += 1
+                continue
+            for ofs, length in layout.dsc_reads(gid):
+                flash.read(ofs, length)
+        elif event.kind in (TRACE_BITMAP, TRACE_BITMAP_RAM):
+            bitmap_num += 1
+            if bitmaps.access(gid, layout.a8_size(gid)):
+                bitmap_hits += 1
+                continue
+            flash.read(*layout.bitmap_read(gid))
+    return Result(gid_cache, bitmap_cache, dsc_hits, dsc_num, bitmap_hits, bitmap_num, flash.bytes_read,
+                  flash.bytes_fetched)
+
+
+def check_events(layout: Layout, events: List[Event]) -> Optional[str]:
+    """ Plain bitmaps of the trace must match the bin, or the trace is from another font """
+    for event in events:
+        if event.kind != TRACE_BITMAP or event.gid >= layout.font.glyph_num:
+            continue
+        ofs = layout.font.glyph_index[event.gid][1]
+        if event.bitmap_ofs != ofs or (event.bitmap_len and event.bitmap_len != layout.font.glyph_bitmap_size(event.gid)):
+            return 'glyph {} (U+{:04X}) does not match the bin, was the trace recorded with another font?'.format(
+                event.gid, event.letter)
+    return None
+
+
+def rate(hits: int, num: int) -> str:
+    return '{:6.1f}%'.format(100.0 * hits / num) if num else '      -'
+
+
+def print_report(events: List[Event], dropped: int, results: List[Result], flash_lines: int, line_size: int) -> None:
+    kinds: Dict[int, int] = {}
+    for event in events:
+        kinds[event.kind] = kinds.get(event.kind, 0) + 1
+    print('{} events ({} descriptor, {} from RAM on the device; {} bitmap, {} from RAM on the device)'.format(
+        len(events), kinds.get(TRACE_DSC, 0) + kinds.get(TRACE_DSC_RAM, 0), kinds.get(TRACE_DSC_RAM, 0),
+        kinds.get(TRACE_BITMAP, 0) + kinds.get(TRACE_BITMAP_RAM, 0), kinds.get(TRACE_BITMAP_RAM, 0)))
+    if dropped:
+        print('warning: the device dropped {} older events, raise CONFIG_D2_FONT_TRACE_EVENTS'.format(dropped))
+    print('flash cache: {} lines of {} bytes'.format(flash_lines, line_size))
+    print()
+    print('{:>10} {:>13} {:>9} {:>9} {:>12} {:>14}'.format('gid cache', 'bitmap cache', 'gid hit', 'bmp hit',
+                                                          'bytes read', 'bytes fetched'))
+    for r in results:
+        print('{:>10} {:>13} {:>9} {:>9} {:>12} {:>14}'.format(r.gid_cache, r.bitmap_cache, rate(r.dsc_hits, r.dsc_num),
+                                                              rate(r.bitmap_hits, r.bitmap_num), r.bytes_read,
+                                                              r.bytes_fetched))
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description='Replay a d2_font glyph access trace to size the caches')
+    parser.add_argument('bin', help='d2_font bin the trace was recorded with')
+    parser.add_argument('log', help='console log holding the output of d2_font_trace_dump')
+    parser.add_argument('--gid-cache', default='0,16,64,256', help='glyph id cache sizes in letters, comma separated')
+    parser.add_argument('--bitmap-cache', default='0,4k,16k,64k',
+                        help='bitmap cache sizes in bytes of A8 glyphs, comma separated, k and m suffixes allowed')
+    parser.add_argument('--line-size', type=parse_size, default=32, help='flash cache line size in bytes')
+    parser.add_argument('--flash-cache', type=parse_size, default=512,
+                        help='flash cache lines available to the font data')
+    args = parser.parse_args()
+
+    try:
+        gid_caches = parse_sizes(args.gid_cache)
+        bitmap_caches = parse_sizes(args.bitmap_cache)
+    except ValueError as e:
+        print('error: {}'.format(e), file=sys.stderr)
+        return 1
+    if args.line_size <= 0 or args.flash_cache < 0 or not gid_caches or not bitmap_caches:
+        print('error: invalid cache sizes', file=sys.stderr)
+        return 1
+    try:
+        layout = Layout(d2.load(args.bin))
+        events, dropped = read_trace(args.log)
+        if not events:
+            raise d2.D2FontError('no d2t lines in {}'.format(args.log))
+        mismatch = check_events(layout, events)
+        if mismatch:
+            raise d2.D2FontError(mismatch)
+    except d2.D2FontError as e:
+        print('error: {}'.format(e), file=sys.stderr)
+        return 1
+
+    results = [replay(layout, events, gid_cache, bitmap_cache, args.flash_cache, args.line_size)
+               for gid_cache in gid_caches for bitmap_cache in bitmap_caches]
+    print_report(events, dropped, results, args.flash_cache, args.line_size)
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())